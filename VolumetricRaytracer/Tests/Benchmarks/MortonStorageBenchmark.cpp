@@ -0,0 +1,99 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "TestHelpers.h"
+#include "Octree.h"
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	double MeasureOctreeBuild(VObjectPtr<Voxel::VVoxelVolume> volume, const int& repetitions)
+	{
+		double bestTime = 1e30;
+
+		for (int i = 0; i < repetitions; i++)
+		{
+			std::vector<Voxel::VCellGPUOctreeNode> nodes;
+			size_t nodeAxisCount = 0;
+
+			volume->MakeDirty();
+
+			auto start = std::chrono::steady_clock::now();
+			volume->GenerateGPUOctreeStructure(nodes, nodeAxisCount);
+			bestTime = std::min(bestTime, Tests::VTestHelpers::GetElapsedMilliseconds(start));
+		}
+
+		return bestTime;
+	}
+
+	double MeasureRandomCellReads(VObjectPtr<Voxel::VVoxelVolume> volume, const std::vector<VIntVector>& cells, float& outChecksum)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		outChecksum = 0;
+
+		for (const VIntVector& cell : cells)
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				outChecksum += volume->GetVoxel(cell + Voxel::VCell::VOXEL_COORDS[i]).Density;
+			}
+		}
+
+		return Tests::VTestHelpers::GetElapsedMilliseconds(start);
+	}
+}
+
+//Octree build and random cell corner reads on dense vs Morton storage for a sphere volume
+int main()
+{
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "res  octree build dense/morton (ms)  2M random cells dense/morton (ms)" << std::endl;
+
+	for (uint8_t resolution = 6; resolution <= 8; resolution++)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> denseVolume = Tests::VTestHelpers::CreateSphereVolume(resolution, Voxel::EVVoxelStorageType::Dense);
+		VObjectPtr<Voxel::VVoxelVolume> mortonVolume = Tests::VTestHelpers::CreateSphereVolume(resolution, Voxel::EVVoxelStorageType::Morton);
+
+		int repetitions = resolution < 8 ? 3 : 1;
+
+		double denseBuild = MeasureOctreeBuild(denseVolume, repetitions);
+		double mortonBuild = MeasureOctreeBuild(mortonVolume, repetitions);
+
+		int cellCount = (int)denseVolume->GetSize() - 1;
+		std::vector<VIntVector> cells(2000000);
+		std::mt19937 rng(7);
+
+		for (VIntVector& cell : cells)
+		{
+			cell = VIntVector(rng() % cellCount, rng() % cellCount, rng() % cellCount);
+		}
+
+		float denseChecksum = 0;
+		float mortonChecksum = 0;
+
+		double denseReads = MeasureRandomCellReads(denseVolume, cells, denseChecksum);
+		double mortonReads = MeasureRandomCellReads(mortonVolume, cells, mortonChecksum);
+
+		std::cout << (int)resolution << "    " << denseBuild << " / " << mortonBuild << "    " << denseReads << " / " << mortonReads << (denseChecksum == mortonChecksum ? "" : "  (checksum mismatch)") << std::endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
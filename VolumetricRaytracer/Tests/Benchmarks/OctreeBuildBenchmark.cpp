@@ -0,0 +1,151 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "LinearOctree.h"
+#include "SurfaceBitmap.h"
+#include "VoxelStorageFactory.h"
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	std::shared_ptr<Voxel::IVVoxelStorage> CopyVoxels(VObjectPtr<Voxel::VVoxelVolume> volume)
+	{
+		VIntVector maxVoxel = VIntVector::ONE * ((int)volume->GetSize() - 1);
+
+		Voxel::VVoxelBox box;
+		volume->ReadVoxelBox(VIntVector::ZERO, maxVoxel, box);
+
+		std::shared_ptr<Voxel::IVVoxelStorage> storage = Voxel::VVoxelStorageFactory::CreateStorage(Voxel::EVVoxelStorageType::Dense, volume->GetCellSize());
+		storage->Allocate(volume->GetSize(), Voxel::VVoxel());
+		storage->WriteBox(VIntVector::ZERO, maxVoxel, box.Voxels.data());
+
+		return storage;
+	}
+
+	//Surface through most cells, the worst case for the node count
+	VObjectPtr<Voxel::VVoxelVolume> CreateSineVolume(const uint8_t& resolution)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(resolution, 100.f, Voxel::EVVoxelStorageType::Dense);
+
+		int voxelCount = (int)volume->GetSize();
+
+		Voxel::VVoxelBox box;
+		volume->ReadVoxelBox(VIntVector::ZERO, VIntVector::ONE * (voxelCount - 1), box);
+
+		size_t i = 0;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int z = 0; z < voxelCount; z++)
+			{
+				for (int y = 0; y < voxelCount; y++, i++)
+				{
+					box.Voxels[i].Density = std::sin(x * 0.9f) + std::sin(y * 0.9f) + std::sin(z * 0.9f);
+					box.Voxels[i].Material = box.Voxels[i].Density <= 0 ? 1 : 0;
+				}
+			}
+		}
+
+		volume->WriteVoxelBox(box);
+
+		return volume;
+	}
+
+	double MeasureLinearOctreeBuild(const uint8_t& resolution, const Voxel::IVVoxelStorage& voxels, const Voxel::VSurfaceBitmap& surfaceBitmap, const int& repetitions, size_t& outNodeCount)
+	{
+		double bestTime = 1e30;
+
+		for (int i = 0; i < repetitions; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			Voxel::VLinearCellOctree octree(resolution, voxels, &surfaceBitmap);
+			bestTime = std::min(bestTime, Tests::VTestHelpers::GetElapsedMilliseconds(start));
+
+			outNodeCount = octree.GetNodeCount();
+		}
+
+		return bestTime;
+	}
+}
+
+//Linear octree build time over the OpenMP thread count. Thread counts above the processor count are skipped, their speedup would only show overhead
+int main()
+{
+	std::vector<int> threadCounts = { 1 };
+
+#ifdef _OPENMP
+	int processorCount = omp_get_num_procs();
+
+	for (int threadCount = 2; threadCount <= 32 && threadCount <= processorCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	std::cout << "processors: " << processorCount << std::endl;
+
+	if (threadCounts.size() == 1)
+	{
+		std::cout << "one processor, scaling is not measured" << std::endl;
+	}
+#else
+	std::cout << "built without OpenMP, only the serial build is measured" << std::endl;
+#endif
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "volume        threads: build time in ms (speedup over one thread)" << std::endl;
+
+	for (uint8_t resolution = 6; resolution <= 8; resolution++)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volumes[2] = { Tests::VTestHelpers::CreateSphereVolume(resolution, Voxel::EVVoxelStorageType::Dense), CreateSineVolume(resolution) };
+		const char* volumeNames[2] = { "sphere", "sine" };
+
+		for (int v = 0; v < 2; v++)
+		{
+			std::shared_ptr<Voxel::IVVoxelStorage> voxels = CopyVoxels(volumes[v]);
+			const Voxel::VSurfaceBitmap& surfaceBitmap = volumes[v]->GetSurfaceBitmap();
+
+			int repetitions = resolution < 8 ? 5 : 2;
+			size_t nodeCount = 0;
+
+			std::cout << "res " << (int)resolution << " " << std::setw(6) << volumeNames[v] << "  ";
+
+			double serialTime = 0;
+
+			for (int threadCount : threadCounts)
+			{
+#ifdef _OPENMP
+				omp_set_num_threads(threadCount);
+#endif
+
+				double time = MeasureLinearOctreeBuild(resolution, *voxels, surfaceBitmap, repetitions, nodeCount);
+				serialTime = threadCount == 1 ? time : serialTime;
+
+				std::cout << threadCount << ": " << time << " (" << serialTime / time << "x)  ";
+			}
+
+			std::cout << " " << nodeCount << " nodes" << std::endl;
+		}
+	}
+
+	return 0;
+}
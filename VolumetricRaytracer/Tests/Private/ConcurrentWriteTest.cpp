@@ -0,0 +1,155 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include <random>
+#include <thread>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	const int WRITER_COUNT = 4;
+
+	//Every writer proposes its own voxel for each index, so the final state only depends on the per voxel minimum
+	Voxel::VVoxel GetProposedVoxel(const int& writer, const VIntVector& voxelIndex)
+	{
+		std::minstd_rand random((unsigned int)(writer * 7919 + voxelIndex.X * 104729 + voxelIndex.Y * 1299709 + voxelIndex.Z * 15485863));
+		std::uniform_real_distribution<float> density(-10.f, 10.f);
+
+		Voxel::VVoxel voxel;
+		voxel.Density = density(random);
+		voxel.Material = voxel.Density <= 0.f ? 1 : 0;
+
+		return voxel;
+	}
+
+	void WriteRegion(Voxel::VVoxelVolume& volume, const int& writer, const VIntVector& min, const VIntVector& max)
+	{
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				for (int z = min.Z; z <= max.Z; z++)
+				{
+					volume.AtomicMinVoxel(VIntVector(x, y, z), GetProposedVoxel(writer, VIntVector(x, y, z)));
+				}
+			}
+		}
+	}
+
+	void TestConcurrentMatchesSerial(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> concurrent = Tests::VTestHelpers::CreateSphereVolume(5, storageType);
+		VObjectPtr<Voxel::VVoxelVolume> serial = Tests::VTestHelpers::CreateSphereVolume(5, storageType);
+
+		//Crosses brick borders and includes far field bricks of the narrow band storage
+		VIntVector min = VIntVector(3, 5, 0);
+		VIntVector max = VIntVector(20, 17, 12);
+
+		concurrent->BeginConcurrentWrite(min, max);
+		serial->BeginConcurrentWrite(min, max);
+
+		std::vector<std::thread> writers;
+
+		for (int writer = 0; writer < WRITER_COUNT; writer++)
+		{
+			writers.emplace_back([&concurrent, writer, min, max]() {
+				WriteRegion(*concurrent, writer, min, max);
+			});
+		}
+
+		for (std::thread& writer : writers)
+		{
+			writer.join();
+		}
+
+		for (int writer = 0; writer < WRITER_COUNT; writer++)
+		{
+			WriteRegion(*serial, writer, min, max);
+		}
+
+		concurrent->EndConcurrentWrite(min, max);
+		serial->EndConcurrentWrite(min, max);
+
+		int mismatchCount = 0;
+		int voxelCount = (int)concurrent->GetSize();
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					Voxel::VVoxel a = concurrent->GetVoxel(VIntVector(x, y, z));
+					Voxel::VVoxel b = serial->GetVoxel(VIntVector(x, y, z));
+
+					mismatchCount += a.Density != b.Density || a.Material != b.Material ? 1 : 0;
+				}
+			}
+		}
+
+		V_CHECK(mismatchCount == 0);
+	}
+
+	//Writes to different storages must not wait on each other or corrupt each other
+	void TestIndependentStorages(const Voxel::EVVoxelStorageType& storageType)
+	{
+		std::vector<VObjectPtr<Voxel::VVoxelVolume>> volumes;
+
+		for (int writer = 0; writer < WRITER_COUNT; writer++)
+		{
+			volumes.push_back(Tests::VTestHelpers::CreateSphereVolume(4, storageType));
+			volumes[writer]->BeginConcurrentWrite(VIntVector::ZERO, VIntVector::ONE * 15);
+		}
+
+		std::vector<std::thread> writers;
+
+		for (int writer = 0; writer < WRITER_COUNT; writer++)
+		{
+			writers.emplace_back([&volumes, writer]() {
+				WriteRegion(*volumes[writer], writer, VIntVector::ZERO, VIntVector::ONE * 15);
+			});
+		}
+
+		for (std::thread& writer : writers)
+		{
+			writer.join();
+		}
+
+		for (int writer = 0; writer < WRITER_COUNT; writer++)
+		{
+			volumes[writer]->EndConcurrentWrite(VIntVector::ZERO, VIntVector::ONE * 15);
+
+			VObjectPtr<Voxel::VVoxelVolume> reference = Tests::VTestHelpers::CreateSphereVolume(4, storageType);
+			reference->BeginConcurrentWrite(VIntVector::ZERO, VIntVector::ONE * 15);
+			WriteRegion(*reference, writer, VIntVector::ZERO, VIntVector::ONE * 15);
+			reference->EndConcurrentWrite(VIntVector::ZERO, VIntVector::ONE * 15);
+
+			V_CHECK(volumes[writer]->GetVoxel(VIntVector(7, 3, 11)).Density == reference->GetVoxel(VIntVector(7, 3, 11)).Density);
+			V_CHECK(volumes[writer]->GetVoxel(VIntVector::ONE * 15).Material == reference->GetVoxel(VIntVector::ONE * 15).Material);
+		}
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestConcurrentMatchesSerial(storageType);
+		TestIndependentStorages(storageType);
+	}
+
+	return Tests::VTestHelpers::Finish("ConcurrentWriteTest");
+}
@@ -0,0 +1,198 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelVolume.h"
+#include "GradientField.h"
+#include "MathHelpers.h"
+#include <random>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	//Worst case of 2x8 bit octahedral normals is a bit above one degree
+	const float MAX_NORMAL_ANGLE_COS = 0.9993f;
+
+	const float SPHERE_RADIUS = 37.3f;
+
+	VVector GetCentralDifference(const Voxel::VVoxelVolume& volume, const VIntVector& voxelIndex)
+	{
+		int voxelMax = (int)volume.GetSize() - 1;
+
+		auto getDensity = [&](const VIntVector& offset)
+		{
+			return volume.GetVoxel(VIntVector::Min(VIntVector::Max(voxelIndex + offset, 0), voxelMax)).Density;
+		};
+
+		return VVector(
+			getDensity(VIntVector(1, 0, 0)) - getDensity(VIntVector(-1, 0, 0)),
+			getDensity(VIntVector(0, 1, 0)) - getDensity(VIntVector(0, -1, 0)),
+			getDensity(VIntVector(0, 0, 1)) - getDensity(VIntVector(0, 0, -1)));
+	}
+
+	int CountGradientMismatches(const Voxel::VVoxelVolume& volume)
+	{
+		const Voxel::VGradientField& field = volume.GetGradientField();
+
+		int voxelCount = (int)volume.GetSize();
+		int mismatchCount = field.GetVoxelCountAlongAxis() == (size_t)voxelCount ? 0 : 1;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					VVector expected = GetCentralDifference(volume, VIntVector(x, y, z));
+
+					if (expected.Length() > 1e-4f)
+					{
+						mismatchCount += field.GetGradient(VIntVector(x, y, z)).Dot(expected.GetNormalized()) < MAX_NORMAL_ANGLE_COS ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		return mismatchCount;
+	}
+
+	void TestNormalEncoding()
+	{
+		std::mt19937 rng(5);
+		std::normal_distribution<float> distribution;
+
+		int mismatchCount = 0;
+
+		for (int i = 0; i < 100000; i++)
+		{
+			VVector normal = VVector(distribution(rng), distribution(rng), distribution(rng)).GetNormalized();
+
+			//Axis aligned normals hit the folds of the octahedron
+			if (i < 6)
+			{
+				normal = VVector::ZERO;
+				(&normal.X)[i / 2] = i % 2 == 0 ? 1.f : -1.f;
+			}
+
+			VVector decoded = Voxel::VGradientField::DecodeNormal(Voxel::VGradientField::EncodeNormal(normal.X, normal.Y, normal.Z));
+
+			mismatchCount += std::abs(decoded.Length() - 1.f) > 1e-4f || decoded.Dot(normal) < MAX_NORMAL_ANGLE_COS ? 1 : 0;
+		}
+
+		V_CHECK(mismatchCount == 0);
+	}
+
+	void TestGradientField(const Voxel::EVVoxelStorageType& storageType)
+	{
+		std::mt19937 rng(9);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType, SPHERE_RADIUS);
+
+		V_CHECK(!volume->IsGradientFieldEnabled());
+		V_CHECK(volume->GetGradientField().IsEmpty());
+
+		volume->SetGradientFieldEnabled(true);
+
+		V_CHECK(CountGradientMismatches(*volume) == 0);
+
+		//Edits refresh the gradients of their neighbours as well
+		int voxelCount = (int)volume->GetSize();
+
+		for (int i = 0; i < 200; i++)
+		{
+			VIntVector voxelIndex = VIntVector(rng() % voxelCount, rng() % voxelCount, rng() % voxelCount);
+
+			Voxel::VVoxel voxel = volume->GetVoxel(voxelIndex);
+			voxel.Density = (rng() % 2 == 0 ? -1.f : 1.f) * (float)(rng() % 1000) / 100.f;
+
+			volume->SetVoxel(voxelIndex, voxel);
+		}
+
+		V_CHECK(CountGradientMismatches(*volume) == 0);
+
+		Voxel::VVoxelBox box;
+		volume->ReadVoxelBox(VIntVector(3, 20, 7), VIntVector(19, 32, 12), box);
+
+		for (size_t i = 0; i < box.Voxels.size(); i++)
+		{
+			box.Voxels[i].Density = (float)(i % 17) - 8.f;
+		}
+
+		V_CHECK(volume->WriteVoxelBox(box));
+		V_CHECK(CountGradientMismatches(*volume) == 0);
+
+		volume->SetGradientFieldEnabled(false);
+
+		V_CHECK(volume->GetGradientField().IsEmpty());
+	}
+
+	//Blended normals in cells on the sphere surface have to point away from its center. The band sphere also has an inner surface
+	//and band edges where the gradients see the empty fill, so only cells centered close to the radius are checked
+	void TestSphereNormals()
+	{
+		std::mt19937 rng(21);
+		std::uniform_real_distribution<float> cellPosition(0.f, 1.f);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, Voxel::EVVoxelStorageType::Dense, SPHERE_RADIUS);
+		volume->SetGradientFieldEnabled(true);
+
+		const Voxel::VGradientField& field = volume->GetGradientField();
+
+		int cellCount = (int)volume->GetSize() - 1;
+		int checkedCount = 0;
+		int mismatchCount = 0;
+
+		for (int x = 0; x < cellCount; x++)
+		{
+			for (int y = 0; y < cellCount; y++)
+			{
+				for (int z = 0; z < cellCount; z++)
+				{
+					VIntVector cellIndex = VIntVector(x, y, z);
+
+					VVector cellCenter = volume->VoxelIndexToRelativePosition(cellIndex) + VVector::ONE * (volume->GetCellSize() * 0.5f);
+
+					if (!volume->GetSurfaceBitmap().IsSurfaceCell(cellIndex) || std::abs(cellCenter.Length() - SPHERE_RADIUS) > volume->GetCellSize() * 0.5f)
+					{
+						continue;
+					}
+
+					VVector cellPos = VVector(cellPosition(rng), cellPosition(rng), cellPosition(rng));
+					VVector position = volume->VoxelIndexToRelativePosition(cellIndex) + cellPos * volume->GetCellSize();
+
+					checkedCount++;
+					mismatchCount += field.GetNormal(cellIndex, cellPos).Dot(position.GetNormalized()) < 0.99f ? 1 : 0;
+				}
+			}
+		}
+
+		V_CHECK(checkedCount > 0);
+		V_CHECK(mismatchCount == 0);
+	}
+}
+
+int main()
+{
+	TestNormalEncoding();
+
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestGradientField(storageType);
+	}
+
+	TestSphereNormals();
+
+	return Tests::VTestHelpers::Finish("GradientFieldTest");
+}
@@ -0,0 +1,107 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelizerTestHelpers.h"
+#include "VolumeConverter.h"
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	//Half floats keep 11 significant bits, so the rounding error stays below 2^-11 of the stored value
+	const float MAX_RELATIVE_ERROR = 1.f / 2048.f;
+	const float MAX_SURFACE_ERROR = 1e-3f;
+
+	bool IsSameOctree(const std::vector<Voxel::VCellGPUOctreeNode>& nodesA, const std::vector<Voxel::VCellGPUOctreeNode>& nodesB)
+	{
+		if (nodesA.size() != nodesB.size())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < nodesA.size(); i++)
+		{
+			if (nodesA[i].IsLeaf != nodesB[i].IsLeaf || nodesA[i].CellIndex != nodesB[i].CellIndex || nodesA[i].Children != nodesB[i].Children)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void TestHalfMatchesDense(const std::string& meshName, const float& meshSize)
+	{
+		Voxelizer::VMeshInfo mesh = Tests::VVoxelizerTestHelpers::CreateBoxMesh(VVector(meshSize, meshSize * 0.6f, meshSize * 0.3f), meshName);
+		Voxelizer::VTextureLibrary textureLib;
+
+		VObjectPtr<Voxel::VVoxelVolume> dense = Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh, textureLib, Voxel::EVVoxelStorageType::Dense);
+		VObjectPtr<Voxel::VVoxelVolume> half = Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh, textureLib, Voxel::EVVoxelStorageType::Half);
+
+		int voxelCount = (int)dense->GetSize();
+		float maxSurfaceError = 0.f;
+		int relativeErrorCount = 0;
+		int signMismatchCount = 0;
+		int materialMismatchCount = 0;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					Voxel::VVoxel expected = dense->GetVoxel(VIntVector(x, y, z));
+					Voxel::VVoxel actual = half->GetVoxel(VIntVector(x, y, z));
+
+					float error = std::abs(expected.Density - actual.Density);
+
+					if (std::abs(expected.Density) < 1.f)
+					{
+						maxSurfaceError = VMathHelpers::Max(maxSurfaceError, error);
+					}
+
+					relativeErrorCount += error > std::abs(expected.Density) * MAX_RELATIVE_ERROR ? 1 : 0;
+					signMismatchCount += (expected.Density <= 0.f) != (actual.Density <= 0.f) ? 1 : 0;
+					materialMismatchCount += expected.Material != actual.Material ? 1 : 0;
+				}
+			}
+		}
+
+		V_CHECK(maxSurfaceError < MAX_SURFACE_ERROR);
+		V_CHECK(relativeErrorCount == 0);
+		V_CHECK(signMismatchCount == 0);
+		V_CHECK(materialMismatchCount == 0);
+
+		//The octree only depends on where the density changes sign, so both storages have to produce the same tree
+		std::vector<Voxel::VCellGPUOctreeNode> denseNodes;
+		std::vector<Voxel::VCellGPUOctreeNode> halfNodes;
+		size_t denseAxisCount = 0;
+		size_t halfAxisCount = 0;
+
+		dense->GenerateGPUOctreeStructure(denseNodes, denseAxisCount);
+		half->GenerateGPUOctreeStructure(halfNodes, halfAxisCount);
+
+		V_CHECK(denseAxisCount == halfAxisCount);
+		V_CHECK(IsSameOctree(denseNodes, halfNodes));
+	}
+}
+
+int main()
+{
+	TestHalfMatchesDense("box_5", 0.5f);
+	TestHalfMatchesDense("box_6", 300.f);
+
+	return Tests::VTestHelpers::Finish("HalfVoxelizationTest");
+}
@@ -0,0 +1,836 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "LinearOctree.h"
+#include "SurfaceBitmap.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	VIntVector GetRegionMaxCell(const Voxel::VLinearOctreeNode& node, const size_t& maxDepth)
+	{
+		return node.GetCellIndex() + VIntVector::ONE * ((1 << (maxDepth - node.Depth)) - 1);
+	}
+
+	//Straightforward serial build with the same depth first layout, every region with a surface cell is split down to single cells
+	void BuildReferenceNode(std::vector<Voxel::VLinearOctreeNode>& nodes, const size_t& nodeIndex, const size_t& maxDepth, const Voxel::VSurfaceBitmap& surfaceBitmap)
+	{
+		Voxel::VLinearOctreeNode node = nodes[nodeIndex];
+
+		if (node.Depth == maxDepth || surfaceBitmap.CountSurfaceCells(node.GetCellIndex(), GetRegionMaxCell(node, maxDepth)) == 0)
+		{
+			return;
+		}
+
+		uint32_t firstChild = (uint32_t)nodes.size();
+		int childCellCount = 1 << (maxDepth - node.Depth - 1);
+
+		nodes.resize(nodes.size() + 8);
+		nodes[nodeIndex].FirstChild = firstChild;
+
+		for (int i = 0; i < 8; i++)
+		{
+			VIntVector cellIndex = node.GetCellIndex() + Voxel::VCell::VOXEL_COORDS[i] * childCellCount;
+
+			nodes[firstChild + i].CellIndex[0] = (uint16_t)cellIndex.X;
+			nodes[firstChild + i].CellIndex[1] = (uint16_t)cellIndex.Y;
+			nodes[firstChild + i].CellIndex[2] = (uint16_t)cellIndex.Z;
+			nodes[firstChild + i].Depth = node.Depth + 1;
+
+			BuildReferenceNode(nodes, firstChild + i, maxDepth, surfaceBitmap);
+
+			if (!nodes[firstChild + i].IsLeaf())
+			{
+				nodes[nodeIndex].ChildMask |= 1 << i;
+			}
+		}
+	}
+
+	bool IsSameNode(const Voxel::VLinearOctreeNode& node, const Voxel::VLinearOctreeNode& other)
+	{
+		return node.FirstChild == other.FirstChild && node.GetCellIndex() == other.GetCellIndex() && node.ChildMask == other.ChildMask && node.Depth == other.Depth;
+	}
+
+	//Walks down to the leaf containing the cell
+	size_t FindLeaf(const Voxel::VLinearCellOctree& octree, const VIntVector& cellIndex)
+	{
+		size_t nodeIndex = 0;
+
+		while (!octree.GetNode(nodeIndex).IsLeaf())
+		{
+			const Voxel::VLinearOctreeNode& node = octree.GetNode(nodeIndex);
+			int childCellCount = 1 << (octree.GetMaxDepth() - node.Depth - 1);
+			VIntVector local = (cellIndex - node.GetCellIndex()) / childCellCount;
+
+			nodeIndex = node.FirstChild + (local.X | (local.Y << 1) | (local.Z << 2));
+		}
+
+		return nodeIndex;
+	}
+
+	//Every node has to be reachable from the root exactly once and describe the right region of the surface
+	int CountStructureErrors(const Voxel::VLinearCellOctree& octree, const Voxel::VSurfaceBitmap& surfaceBitmap, size_t& outReachableCount)
+	{
+		size_t maxDepth = octree.GetMaxDepth();
+		int errorCount = 0;
+
+		std::vector<int> visitCount(octree.GetNodeCount(), 0);
+		std::vector<size_t> stack = { 0 };
+
+		outReachableCount = 0;
+
+		while (!stack.empty())
+		{
+			size_t nodeIndex = stack.back();
+			stack.pop_back();
+
+			if (nodeIndex >= octree.GetNodeCount() || visitCount[nodeIndex]++ > 0)
+			{
+				errorCount++;
+				continue;
+			}
+
+			outReachableCount++;
+
+			const Voxel::VLinearOctreeNode& node = octree.GetNode(nodeIndex);
+			size_t surfaceCellCount = surfaceBitmap.CountSurfaceCells(node.GetCellIndex(), GetRegionMaxCell(node, maxDepth));
+
+			if (node.IsLeaf())
+			{
+				//Leaves above the last level are collapsed empty space
+				errorCount += node.Depth < maxDepth && surfaceCellCount > 0 ? 1 : 0;
+				errorCount += node.ChildMask != 0 ? 1 : 0;
+				continue;
+			}
+
+			errorCount += node.Depth >= maxDepth || surfaceCellCount == 0 ? 1 : 0;
+
+			int childCellCount = 1 << (maxDepth - node.Depth - 1);
+			uint8_t childMask = 0;
+
+			for (int i = 0; i < 8; i++)
+			{
+				const Voxel::VLinearOctreeNode& child = octree.GetNode(node.FirstChild + i);
+
+				errorCount += child.Depth != node.Depth + 1 ? 1 : 0;
+				errorCount += child.GetCellIndex() != node.GetCellIndex() + Voxel::VCell::VOXEL_COORDS[i] * childCellCount ? 1 : 0;
+
+				childMask |= child.IsLeaf() ? 0 : 1 << i;
+
+				stack.push_back(node.FirstChild + i);
+			}
+
+			errorCount += childMask != node.ChildMask ? 1 : 0;
+		}
+
+		//Each surface cell ends in its own leaf on the last level
+		int cellCount = (int)octree.GetCellCountAlongAxis();
+
+		for (int x = 0; x < cellCount; x++)
+		{
+			for (int y = 0; y < cellCount; y++)
+			{
+				for (int z = 0; z < cellCount; z++)
+				{
+					VIntVector cellIndex = VIntVector(x, y, z);
+
+					if (surfaceBitmap.IsSurfaceCell(cellIndex))
+					{
+						const Voxel::VLinearOctreeNode& leaf = octree.GetNode(FindLeaf(octree, cellIndex));
+						errorCount += leaf.Depth != maxDepth || leaf.GetCellIndex() != cellIndex ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		return errorCount;
+	}
+
+	int CountGPUNodeErrors(const Voxel::VLinearCellOctree& octree, const std::vector<Voxel::VCellGPUOctreeNode>& gpuNodes, const size_t& nodeAxisCount)
+	{
+		int errorCount = gpuNodes.size() == octree.GetNodeCount() && nodeAxisCount * nodeAxisCount * nodeAxisCount >= gpuNodes.size() ? 0 : 1;
+
+		for (size_t i = 0; i < gpuNodes.size() && i < octree.GetNodeCount(); i++)
+		{
+			const Voxel::VLinearOctreeNode& node = octree.GetNode(i);
+
+			errorCount += gpuNodes[i].IsLeaf != node.IsLeaf() ? 1 : 0;
+
+			if (node.IsLeaf())
+			{
+				errorCount += gpuNodes[i].CellIndex != node.GetCellIndex() ? 1 : 0;
+				continue;
+			}
+
+			for (int c = 0; c < 8 && gpuNodes[i].Children.size() == 8; c++)
+			{
+				errorCount += VMathHelpers::Index3DTo1D(gpuNodes[i].Children[c], nodeAxisCount, nodeAxisCount) != node.FirstChild + c ? 1 : 0;
+			}
+		}
+
+		return errorCount;
+	}
+
+	void TestOctreeStructure(const uint8_t& resolution, const float& radius)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(resolution, Voxel::EVVoxelStorageType::Dense, radius);
+		const Voxel::VSurfaceBitmap& surfaceBitmap = volume->GetSurfaceBitmap();
+
+		std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
+		size_t nodeAxisCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> octree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+
+		V_CHECK(octree->GetMaxDepth() == resolution);
+		V_CHECK(octree->GetFreeNodeCount() == 0);
+
+		//A fresh build has no unreachable nodes
+		size_t reachableCount = 0;
+
+		V_CHECK(CountStructureErrors(*octree, surfaceBitmap, reachableCount) == 0);
+		V_CHECK(reachableCount == octree->GetNodeCount());
+		V_CHECK(CountGPUNodeErrors(*octree, gpuNodes, nodeAxisCount) == 0);
+
+		//Above PARALLEL_SPLIT_DEPTH + 1 the subtrees are built by worker threads, the merged pool has to match the serial layout node for node
+		std::vector<Voxel::VLinearOctreeNode> referenceNodes(1);
+		BuildReferenceNode(referenceNodes, 0, resolution, surfaceBitmap);
+
+		V_CHECK(referenceNodes.size() == octree->GetNodeCount());
+
+		int mismatchCount = 0;
+
+		for (size_t i = 0; i < referenceNodes.size() && i < octree->GetNodeCount(); i++)
+		{
+			mismatchCount += IsSameNode(referenceNodes[i], octree->GetNode(i)) ? 0 : 1;
+		}
+
+		V_CHECK(mismatchCount == 0);
+	}
+
+	//Compares the trees reachable from both roots, the node indices of a patched pool differ from a fresh build
+	int CountTreeMismatches(const std::vector<Voxel::VCellGPUOctreeNode>& nodes, const size_t& nodeAxisCount, const size_t& nodeIndex,
+		const std::vector<Voxel::VCellGPUOctreeNode>& otherNodes, const size_t& otherNodeAxisCount, const size_t& otherNodeIndex)
+	{
+		if (nodeIndex >= nodes.size() || otherNodeIndex >= otherNodes.size())
+		{
+			return 1;
+		}
+
+		const Voxel::VCellGPUOctreeNode& node = nodes[nodeIndex];
+		const Voxel::VCellGPUOctreeNode& otherNode = otherNodes[otherNodeIndex];
+
+		if (node.IsLeaf != otherNode.IsLeaf)
+		{
+			return 1;
+		}
+
+		if (node.IsLeaf)
+		{
+			return node.CellIndex != otherNode.CellIndex ? 1 : 0;
+		}
+
+		if (node.Children.size() != 8 || otherNode.Children.size() != 8)
+		{
+			return 1;
+		}
+
+		int mismatchCount = 0;
+
+		for (int c = 0; c < 8; c++)
+		{
+			mismatchCount += CountTreeMismatches(nodes, nodeAxisCount, VMathHelpers::Index3DTo1D(node.Children[c], nodeAxisCount, nodeAxisCount),
+				otherNodes, otherNodeAxisCount, VMathHelpers::Index3DTo1D(otherNode.Children[c], otherNodeAxisCount, otherNodeAxisCount));
+		}
+
+		return mismatchCount;
+	}
+
+	//Fills the box with the density, 0 puts the sphere of CreateSphereVolume back
+	void EditBox(VObjectPtr<Voxel::VVoxelVolume> volume, const VIntVector& min, const VIntVector& max, const float& density, const float& radius)
+	{
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				for (int z = min.Z; z <= max.Z; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+					float distance = volume->VoxelIndexToRelativePosition(voxelIndex).Length() - radius;
+
+					Voxel::VVoxel voxel;
+					voxel.Density = density != 0 ? density : (std::abs(distance) < volume->GetCellSize() * 2 ? distance : 200.f);
+					voxel.Material = voxel.Density <= 0 ? 1 : 0;
+
+					volume->SetVoxel(voxelIndex, voxel);
+				}
+			}
+		}
+	}
+
+	//Edits the volume, patches the GPU nodes of the first build with the changed ranges and compares them with a full rebuild after every step
+	void TestUpdateRegion(const uint8_t& resolution)
+	{
+		const float radius = 40.f;
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(resolution, Voxel::EVVoxelStorageType::Dense, radius);
+
+		std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
+		size_t nodeAxisCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> octree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+		volume->ClearDirtyRegions();
+
+		//The patches are uploaded into a texture with room for nodeAxisCount^3 nodes
+		gpuNodes.resize(nodeAxisCount * nodeAxisCount * nodeAxisCount);
+
+		int voxelCount = (int)volume->GetSize();
+		int quarter = voxelCount / 4;
+		int center = voxelCount / 2;
+
+		struct VEdit
+		{
+			VIntVector Min;
+			VIntVector Max;
+			float Density;
+		};
+
+		//Removes a corner of the sphere, carves a small block into the freed space, puts both back and flips a single voxel on the sphere
+		std::vector<VEdit> edits = {
+			{ VIntVector(0, 0, 0), VIntVector(center, center, center), 200.f },
+			{ VIntVector(quarter, quarter, quarter), VIntVector(quarter + 2, quarter + 2, quarter + 1), -1.f },
+			{ VIntVector(0, 0, 0), VIntVector(center, center, center), 0.f },
+			{ VIntVector(center, center, voxelCount - 1), VIntVector(center, center, voxelCount - 1), -1.f },
+			{ VIntVector(center, center, voxelCount - 1), VIntVector(center, center, voxelCount - 1), 0.f }
+		};
+
+		for (const VEdit& edit : edits)
+		{
+			EditBox(volume, edit.Min, edit.Max, edit.Density, radius);
+
+			std::vector<Voxel::VLinearOctreeNodeRange> changedRanges;
+			std::vector<Voxel::VCellGPUOctreeNode> changedNodes;
+
+			V_CHECK(volume->UpdateGPUOctreeStructure(*octree, nodeAxisCount, changedRanges, changedNodes));
+			volume->ClearDirtyRegions();
+
+			//The ranges are merged, sorted and list the patched nodes in order
+			size_t changedNodeCount = 0;
+
+			for (size_t i = 0; i < changedRanges.size(); i++)
+			{
+				V_CHECK(i == 0 || changedRanges[i].FirstNode > changedRanges[i - 1].FirstNode + changedRanges[i - 1].NodeCount);
+
+				for (size_t n = 0; n < changedRanges[i].NodeCount && changedNodeCount + n < changedNodes.size(); n++)
+				{
+					gpuNodes[changedRanges[i].FirstNode + n] = changedNodes[changedNodeCount + n];
+				}
+
+				changedNodeCount += changedRanges[i].NodeCount;
+			}
+
+			V_CHECK(changedNodeCount == changedNodes.size());
+			V_CHECK(!changedRanges.empty());
+
+			size_t reachableCount = 0;
+
+			V_CHECK(CountStructureErrors(*octree, volume->GetSurfaceBitmap(), reachableCount) == 0);
+
+			//Released child blocks are either reused or counted as free
+			V_CHECK(reachableCount + octree->GetFreeNodeCount() == octree->GetNodeCount());
+
+			std::vector<Voxel::VCellGPUOctreeNode> freshNodes;
+			size_t freshNodeAxisCount = 0;
+
+			std::shared_ptr<Voxel::VLinearCellOctree> freshOctree = volume->GenerateGPUOctreeStructure(freshNodes, freshNodeAxisCount);
+
+			V_CHECK(freshOctree->GetNodeCount() == reachableCount);
+			V_CHECK(CountTreeMismatches(gpuNodes, nodeAxisCount, 0, freshNodes, freshNodeAxisCount, 0) == 0);
+		}
+
+		//Every edit was reverted and the freed child blocks have been reused
+		V_CHECK(octree->GetNodeCount() <= nodeAxisCount * nodeAxisCount * nodeAxisCount);
+
+		//Without edits there is nothing to patch
+		std::vector<Voxel::VLinearOctreeNodeRange> changedRanges;
+		std::vector<Voxel::VCellGPUOctreeNode> changedNodes;
+
+		V_CHECK(volume->UpdateGPUOctreeStructure(*octree, nodeAxisCount, changedRanges, changedNodes));
+		V_CHECK(changedRanges.empty() && changedNodes.empty());
+
+		//A pool that outgrows the texture needs a full rebuild
+		EditBox(volume, VIntVector(1, 1, 1), VIntVector(voxelCount - 2, voxelCount - 2, 2), -1.f, radius);
+
+		V_CHECK(!volume->UpdateGPUOctreeStructure(*octree, nodeAxisCount, changedRanges, changedNodes));
+		V_CHECK(changedRanges.empty());
+	}
+
+	//Exact signed distance to a sphere in every voxel, so the densities change by at most one unit per unit
+	VObjectPtr<Voxel::VVoxelVolume> CreateDistanceVolume(const uint8_t& resolution, const float& radius)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(resolution, 100.f, Voxel::EVVoxelStorageType::Dense);
+		volume->SetDensityLipschitzBound(1.f);
+
+		int voxelCount = (int)volume->GetSize();
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+
+					Voxel::VVoxel voxel;
+					voxel.Density = volume->VoxelIndexToRelativePosition(voxelIndex).Length() - radius;
+					voxel.Material = voxel.Density <= 0 ? 1 : 0;
+
+					volume->SetVoxel(voxelIndex, voxel);
+				}
+			}
+		}
+
+		return volume;
+	}
+
+	//Union of an off center box and a sphere, scaled by lipschitzBound. Not a sphere distance and not exact inside the union, but the
+	//densities still change by at most lipschitzBound per unit
+	VObjectPtr<Voxel::VVoxelVolume> CreateBoxAndSphereVolume(const uint8_t& resolution, const float& lipschitzBound)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(resolution, 100.f, Voxel::EVVoxelStorageType::Dense);
+		volume->SetDensityLipschitzBound(lipschitzBound);
+
+		int voxelCount = (int)volume->GetSize();
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+					VVector position = volume->VoxelIndexToRelativePosition(voxelIndex);
+
+					VVector boxOffset = position - VVector(-20.f, 10.f, 5.f);
+					VVector q = VVector(std::abs(boxOffset.X) - 35.f, std::abs(boxOffset.Y) - 15.f, std::abs(boxOffset.Z) - 25.f);
+
+					float boxDistance = VVector::Max(q, 0.f).Length() + std::min(std::max(q.X, std::max(q.Y, q.Z)), 0.f);
+					float sphereDistance = (position - VVector(45.f, -40.f, 30.f)).Length() - 22.f;
+
+					Voxel::VVoxel voxel;
+					voxel.Density = std::min(boxDistance, sphereDistance) * lipschitzBound;
+					voxel.Material = voxel.Density <= 0 ? 1 : 0;
+
+					volume->SetVoxel(voxelIndex, voxel);
+				}
+			}
+		}
+
+		return volume;
+	}
+
+	std::vector<size_t> GetReachableNodes(const Voxel::VLinearCellOctree& octree)
+	{
+		std::vector<size_t> res;
+		std::vector<size_t> stack = { 0 };
+
+		while (!stack.empty())
+		{
+			size_t nodeIndex = stack.back();
+			stack.pop_back();
+
+			res.push_back(nodeIndex);
+
+			const Voxel::VLinearOctreeNode& node = octree.GetNode(nodeIndex);
+
+			for (int i = 0; i < 8 && !node.IsLeaf(); i++)
+			{
+				stack.push_back(node.FirstChild + i);
+			}
+		}
+
+		return res;
+	}
+
+	//The interval of a node has to contain every voxel of its region. Fresh builds and single cell leaves are exact
+	int CountDensityBoundErrors(const Voxel::VLinearCellOctree& octree, VObjectPtr<Voxel::VVoxelVolume> volume, const bool& exact)
+	{
+		int errorCount = octree.HasDensityBounds() ? 0 : 1;
+
+		for (size_t nodeIndex : GetReachableNodes(octree))
+		{
+			const Voxel::VLinearOctreeNode& node = octree.GetNode(nodeIndex);
+
+			VIntVector minVoxel = node.GetCellIndex();
+			VIntVector maxVoxel = GetRegionMaxCell(node, octree.GetMaxDepth()) + VIntVector::ONE;
+
+			float minDensity = std::numeric_limits<float>::max();
+			float maxDensity = -std::numeric_limits<float>::max();
+
+			for (int x = minVoxel.X; x <= maxVoxel.X; x++)
+			{
+				for (int y = minVoxel.Y; y <= maxVoxel.Y; y++)
+				{
+					for (int z = minVoxel.Z; z <= maxVoxel.Z; z++)
+					{
+						float density = volume->GetVoxel(VIntVector(x, y, z)).Density;
+
+						minDensity = std::min(minDensity, density);
+						maxDensity = std::max(maxDensity, density);
+					}
+				}
+			}
+
+			const Voxel::VOctreeDensityBounds& bounds = octree.GetDensityBounds(nodeIndex);
+
+			if (exact || node.Depth == octree.GetMaxDepth())
+			{
+				errorCount += bounds.MinDensity != minDensity || bounds.MaxDensity != maxDensity ? 1 : 0;
+			}
+			else
+			{
+				errorCount += bounds.MinDensity > minDensity || bounds.MaxDensity < maxDensity ? 1 : 0;
+			}
+		}
+
+		return errorCount;
+	}
+
+	//No surface cell may be closer to the node region than its distance bound. Returns the number of nodes with a bound in outBoundedCount
+	int CountDistanceBoundErrors(const Voxel::VLinearCellOctree& octree, const Voxel::VSurfaceBitmap& surfaceBitmap, size_t& outBoundedCount)
+	{
+		std::vector<VIntVector> surfaceCells;
+		int cellCount = (int)octree.GetCellCountAlongAxis();
+
+		for (int x = 0; x < cellCount; x++)
+		{
+			for (int y = 0; y < cellCount; y++)
+			{
+				for (int z = 0; z < cellCount; z++)
+				{
+					if (surfaceBitmap.IsSurfaceCell(VIntVector(x, y, z)))
+					{
+						surfaceCells.push_back(VIntVector(x, y, z));
+					}
+				}
+			}
+		}
+
+		int errorCount = 0;
+		outBoundedCount = 0;
+
+		for (size_t nodeIndex : GetReachableNodes(octree))
+		{
+			float bound = octree.GetDistanceBound(nodeIndex);
+
+			if (bound <= 0)
+			{
+				continue;
+			}
+
+			outBoundedCount++;
+
+			const Voxel::VLinearOctreeNode& node = octree.GetNode(nodeIndex);
+
+			VIntVector regionMin = node.GetCellIndex();
+			VIntVector regionMax = GetRegionMaxCell(node, octree.GetMaxDepth()) + VIntVector::ONE;
+
+			for (const VIntVector& cell : surfaceCells)
+			{
+				//Gap between the node box and the cell box along each axis
+				float dx = (float)std::max(std::max(regionMin.X - (cell.X + 1), cell.X - regionMax.X), 0);
+				float dy = (float)std::max(std::max(regionMin.Y - (cell.Y + 1), cell.Y - regionMax.Y), 0);
+				float dz = (float)std::max(std::max(regionMin.Z - (cell.Z + 1), cell.Z - regionMax.Z), 0);
+
+				errorCount += std::sqrt(dx * dx + dy * dy + dz * dz) < bound ? 1 : 0;
+			}
+		}
+
+		return errorCount;
+	}
+
+	//Marches random rays in small steps and checks that no surface cell comes before the first candidate. Returns the visited node count of all rays
+	size_t CheckSurfaceCandidates(const Voxel::VLinearCellOctree& octree, const Voxel::VSurfaceBitmap& surfaceBitmap, std::mt19937& rng, int& outSkippedSurfaceCount)
+	{
+		float cellCount = (float)octree.GetCellCountAlongAxis();
+
+		std::uniform_real_distribution<float> originDistribution(-4.f, cellCount + 4.f);
+		std::uniform_real_distribution<float> directionDistribution(-1.f, 1.f);
+		std::uniform_real_distribution<float> lengthDistribution(0.25f, 4.f);
+
+		size_t visitedNodeCount = 0;
+		outSkippedSurfaceCount = 0;
+
+		for (int i = 0; i < 300; i++)
+		{
+			VVector origin = VVector(originDistribution(rng), originDistribution(rng), originDistribution(rng));
+			VVector direction = VVector(directionDistribution(rng), directionDistribution(rng), directionDistribution(rng));
+
+			if (direction.Length() < 0.1f)
+			{
+				continue;
+			}
+
+			//Distances are multiples of direction, so the length must not matter
+			direction = direction / direction.Length() * lengthDistribution(rng);
+
+			float maxDistance = cellCount * 2.f / direction.Length();
+			float step = 0.02f / direction.Length();
+			float surfaceDistance = -1;
+
+			for (float t = 0; t <= maxDistance && surfaceDistance < 0; t += step)
+			{
+				VVector position = origin + direction * t;
+
+				if (position.X >= 0 && position.Y >= 0 && position.Z >= 0 && position.X < cellCount && position.Y < cellCount && position.Z < cellCount &&
+					surfaceBitmap.IsSurfaceCell(VIntVector((int)position.X, (int)position.Y, (int)position.Z)))
+				{
+					surfaceDistance = t;
+				}
+			}
+
+			Voxel::VOctreeRayHit hit;
+			size_t rayVisitedNodeCount = 0;
+
+			bool found = octree.FindFirstSurfaceCandidate(origin, direction, maxDistance, hit, &rayVisitedNodeCount);
+
+			visitedNodeCount += rayVisitedNodeCount;
+
+			if (surfaceDistance >= 0 && (!found || hit.Distance > surfaceDistance + step))
+			{
+				outSkippedSurfaceCount++;
+			}
+
+			//A candidate is a leaf or a node that lies completely inside
+			if (found && !hit.Inside && !octree.GetNode(hit.NodeIndex).IsLeaf())
+			{
+				outSkippedSurfaceCount++;
+			}
+
+			if (found && hit.Inside && !octree.GetDensityBounds(hit.NodeIndex).IsInside())
+			{
+				outSkippedSurfaceCount++;
+			}
+		}
+
+		return visitedNodeCount;
+	}
+
+	void TestDensityBounds(const uint8_t& resolution)
+	{
+		std::mt19937 rng(7);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = CreateDistanceVolume(resolution, 40.f);
+
+		std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
+		size_t nodeAxisCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> octree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+		volume->ClearDirtyRegions();
+
+		size_t boundedCount = 0;
+
+		V_CHECK(CountDensityBoundErrors(*octree, volume, true) == 0);
+		V_CHECK(CountDistanceBoundErrors(*octree, volume->GetSurfaceBitmap(), boundedCount) == 0);
+		V_CHECK(boundedCount > 0);
+
+		//The GPU nodes carry the same intervals
+		int gpuMismatchCount = 0;
+
+		for (size_t i = 0; i < gpuNodes.size(); i++)
+		{
+			gpuMismatchCount += gpuNodes[i].MinDensity != octree->GetDensityBounds(i).MinDensity || gpuNodes[i].DistanceBound != octree->GetDistanceBound(i) ? 1 : 0;
+		}
+
+		V_CHECK(gpuMismatchCount == 0);
+
+		int skippedSurfaceCount = 0;
+		size_t visitedNodeCount = CheckSurfaceCandidates(*octree, volume->GetSurfaceBitmap(), rng, skippedSurfaceCount);
+
+		V_CHECK(skippedSurfaceCount == 0);
+
+		//The same rays with intervals only, the distance bounds have to save node visits
+		std::mt19937 intervalRng(7);
+
+		volume->SetDensityLipschitzBound(0.f);
+
+		std::shared_ptr<Voxel::VLinearCellOctree> unboundedOctree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+		size_t unboundedVisitedNodeCount = CheckSurfaceCandidates(*unboundedOctree, volume->GetSurfaceBitmap(), intervalRng, skippedSurfaceCount);
+
+		V_CHECK(skippedSurfaceCount == 0);
+		V_CHECK(visitedNodeCount < unboundedVisitedNodeCount);
+
+		volume->SetDensityLipschitzBound(1.f);
+		volume->ClearDirtyRegions();
+
+		//Subtracts a sphere from the surface. Only changed voxels are written, which keeps the edit incremental and the field a distance bound
+		VVector holeCenter = VVector(40.f, 0.f, 0.f);
+		int voxelCount = (int)volume->GetSize();
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+					Voxel::VVoxel voxel = volume->GetVoxel(voxelIndex);
+
+					float holeDistance = (volume->VoxelIndexToRelativePosition(voxelIndex) - holeCenter).Length() - 15.f;
+
+					if (-holeDistance > voxel.Density)
+					{
+						voxel.Density = -holeDistance;
+						voxel.Material = voxel.Density <= 0 ? 1 : 0;
+
+						volume->SetVoxel(voxelIndex, voxel);
+					}
+				}
+			}
+		}
+
+		V_CHECK(volume->GetDirtyRegionCount() < volume->GetRegionCount());
+
+		std::vector<Voxel::VLinearOctreeNodeRange> changedRanges;
+		std::vector<Voxel::VCellGPUOctreeNode> changedNodes;
+
+		if (volume->UpdateGPUOctreeStructure(*octree, nodeAxisCount, changedRanges, changedNodes))
+		{
+			//Patched leaves that cover more than a cell may only have grown their interval
+			V_CHECK(CountDensityBoundErrors(*octree, volume, false) == 0);
+			V_CHECK(CountDistanceBoundErrors(*octree, volume->GetSurfaceBitmap(), boundedCount) == 0);
+
+			CheckSurfaceCandidates(*octree, volume->GetSurfaceBitmap(), rng, skippedSurfaceCount);
+
+			V_CHECK(skippedSurfaceCount == 0);
+		}
+		else
+		{
+			V_CHECK(false);
+		}
+
+		//A full build tightens the intervals again
+		octree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+
+		V_CHECK(CountDensityBoundErrors(*octree, volume, true) == 0);
+		V_CHECK(CountDistanceBoundErrors(*octree, volume->GetSurfaceBitmap(), boundedCount) == 0);
+
+		//LODs inherit the bound, the renderer skips through their octrees the same way
+		volume->GenerateLODs(2);
+
+		for (size_t lod = 1; lod <= volume->GetLODCount(); lod++)
+		{
+			std::shared_ptr<const Voxel::VVoxelVolume> lodVolume = volume->GetLOD(lod);
+
+			std::vector<Voxel::VCellGPUOctreeNode> lodNodes;
+			size_t lodNodeAxisCount = 0;
+			size_t lodBoundedCount = 0;
+
+			std::shared_ptr<Voxel::VLinearCellOctree> lodOctree = lodVolume->GenerateGPUOctreeStructure(lodNodes, lodNodeAxisCount);
+
+			V_CHECK(lodVolume->GetDensityLipschitzBound() == volume->GetDensityLipschitzBound());
+			V_CHECK(CountDistanceBoundErrors(*lodOctree, lodVolume->GetSurfaceBitmap(), lodBoundedCount) == 0);
+
+			//Below 16 cells along the axis no empty node is far enough from the surface to get past the margin
+			V_CHECK(lodBoundedCount > 0 || lodVolume->GetResolution() < 4);
+		}
+	}
+
+	//Checks the distance bounds of a box and sphere union against the distance of every node to every surface cell
+	void TestBoxDistanceBounds(const uint8_t& resolution)
+	{
+		std::mt19937 rng(11);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = CreateBoxAndSphereVolume(resolution, 1.f);
+
+		std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
+		size_t nodeAxisCount = 0;
+		size_t boundedCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> octree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+
+		V_CHECK(CountDistanceBoundErrors(*octree, volume->GetSurfaceBitmap(), boundedCount) == 0);
+		V_CHECK(boundedCount > 0);
+
+		int skippedSurfaceCount = 0;
+		CheckSurfaceCandidates(*octree, volume->GetSurfaceBitmap(), rng, skippedSurfaceCount);
+
+		V_CHECK(skippedSurfaceCount == 0);
+
+		//Scaling the densities together with the Lipschitz bound must not change the bounds in cells
+		VObjectPtr<Voxel::VVoxelVolume> scaledVolume = CreateBoxAndSphereVolume(resolution, 3.f);
+
+		std::vector<Voxel::VCellGPUOctreeNode> scaledGPUNodes;
+		size_t scaledNodeAxisCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> scaledOctree = scaledVolume->GenerateGPUOctreeStructure(scaledGPUNodes, scaledNodeAxisCount);
+
+		int scaleMismatchCount = scaledOctree->GetNodeCount() == octree->GetNodeCount() ? 0 : 1;
+
+		for (size_t i = 0; i < octree->GetNodeCount() && scaleMismatchCount == 0; i++)
+		{
+			scaleMismatchCount += std::abs(scaledOctree->GetDistanceBound(i) - octree->GetDistanceBound(i)) > 1e-3f ? 1 : 0;
+		}
+
+		V_CHECK(scaleMismatchCount == 0);
+	}
+
+	void TestEmptyOctree()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(5, 100.f, Voxel::EVVoxelStorageType::Dense);
+
+		Voxel::VVoxel emptyVoxel;
+		emptyVoxel.Density = 200.f;
+
+		volume->FillVolume(emptyVoxel);
+
+		std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
+		size_t nodeAxisCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> octree = volume->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+
+		//Without a surface the whole volume collapses into the root
+		V_CHECK(octree->GetNodeCount() == 1);
+		V_CHECK(octree->GetNode(0).IsLeaf());
+		V_CHECK(gpuNodes.size() == 1 && gpuNodes[0].IsLeaf);
+		V_CHECK(nodeAxisCount == 1);
+	}
+}
+
+int main()
+{
+	TestEmptyOctree();
+
+	TestOctreeStructure(3, 40.f);
+	TestOctreeStructure(4, 37.3f);
+
+	//Parallel builds
+	TestOctreeStructure(5, 40.f);
+	TestOctreeStructure(6, 23.1f);
+
+	TestUpdateRegion(4);
+	TestUpdateRegion(5);
+
+	TestDensityBounds(4);
+	TestDensityBounds(5);
+
+	TestBoxDistanceBounds(4);
+	TestBoxDistanceBounds(5);
+
+	return Tests::VTestHelpers::Finish("LinearOctreeTest");
+}
@@ -0,0 +1,80 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "TestHelpers.h"
+#include "MathHelpers.h"
+#include "CPUFeatures.h"
+#include <random>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	uint64_t ReferenceMortonEncode(const uint32_t& x, const uint32_t& y, const uint32_t& z)
+	{
+		uint64_t code = 0;
+
+		for (int bit = 0; bit < 21; bit++)
+		{
+			code |= (uint64_t)((x >> bit) & 1) << (bit * 3);
+			code |= (uint64_t)((y >> bit) & 1) << (bit * 3 + 1);
+			code |= (uint64_t)((z >> bit) & 1) << (bit * 3 + 2);
+		}
+
+		return code;
+	}
+
+	void TestMortonCodes()
+	{
+		V_CHECK(VMathHelpers::MortonEncode3D(1, 0, 0) == 1);
+		V_CHECK(VMathHelpers::MortonEncode3D(0, 1, 0) == 2);
+		V_CHECK(VMathHelpers::MortonEncode3D(0, 0, 1) == 4);
+		V_CHECK(VMathHelpers::MortonEncode3D(0x1FFFFF, 0x1FFFFF, 0x1FFFFF) == 0x7FFFFFFFFFFFFFFFull);
+
+		std::mt19937 rng(1);
+		int mismatchCount = 0;
+
+		for (int i = 0; i < 100000; i++)
+		{
+			uint32_t x = rng() & 0x1FFFFF;
+			uint32_t y = rng() & 0x1FFFFF;
+			uint32_t z = rng() & 0x1FFFFF;
+
+			uint64_t code = VMathHelpers::MortonEncode3D(x, y, z);
+
+			uint32_t decodedX = 0;
+			uint32_t decodedY = 0;
+			uint32_t decodedZ = 0;
+
+			VMathHelpers::MortonDecode3D(code, decodedX, decodedY, decodedZ);
+
+			if (code != ReferenceMortonEncode(x, y, z) || decodedX != x || decodedY != y || decodedZ != z)
+			{
+				mismatchCount++;
+			}
+		}
+
+		V_CHECK(mismatchCount == 0);
+	}
+}
+
+int main()
+{
+	std::cout << "BMI2 Morton codes: " << (VCPUFeatures::HasFastBMI2() ? "yes" : "no") << std::endl;
+
+	TestMortonCodes();
+
+	return Tests::VTestHelpers::Finish("MathHelpersTest");
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelVolume.h"
+#include "SurfaceBitmap.h"
+#include <random>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	bool HasSurfaceBruteForce(const Voxel::VVoxelVolume& volume, const VIntVector& cellIndex)
+	{
+		Voxel::VCell cell;
+
+		for (int i = 0; i < 8; i++)
+		{
+			cell.Voxels[i] = volume.GetVoxel(cellIndex + Voxel::VCell::VOXEL_COORDS[i]);
+		}
+
+		return cell.HasSurface();
+	}
+
+	int CountBitmapMismatches(const Voxel::VVoxelVolume& volume)
+	{
+		const Voxel::VSurfaceBitmap& bitmap = volume.GetSurfaceBitmap();
+
+		int cellCount = (int)volume.GetSize() - 1;
+		int mismatchCount = bitmap.GetCellCountAlongAxis() == (size_t)cellCount ? 0 : 1;
+
+		for (int x = 0; x < cellCount; x++)
+		{
+			for (int y = 0; y < cellCount; y++)
+			{
+				for (int z = 0; z < cellCount; z++)
+				{
+					VIntVector cellIndex = VIntVector(x, y, z);
+					mismatchCount += bitmap.IsSurfaceCell(cellIndex) != HasSurfaceBruteForce(volume, cellIndex) ? 1 : 0;
+				}
+			}
+		}
+
+		return mismatchCount;
+	}
+
+	int CountRangeMismatches(const Voxel::VVoxelVolume& volume, std::mt19937& rng)
+	{
+		const Voxel::VSurfaceBitmap& bitmap = volume.GetSurfaceBitmap();
+
+		int cellCount = (int)volume.GetSize() - 1;
+		int mismatchCount = 0;
+
+		for (int i = 0; i < 200; i++)
+		{
+			VIntVector a = VIntVector(rng() % cellCount, rng() % cellCount, rng() % cellCount);
+			VIntVector b = VIntVector(rng() % cellCount, rng() % cellCount, rng() % cellCount);
+			VIntVector minCell = VIntVector::Min(a, b);
+			VIntVector maxCell = VIntVector::Max(a, b);
+
+			size_t surfaceCellCount = 0;
+
+			for (int x = minCell.X; x <= maxCell.X; x++)
+			{
+				for (int y = minCell.Y; y <= maxCell.Y; y++)
+				{
+					for (int z = minCell.Z; z <= maxCell.Z; z++)
+					{
+						surfaceCellCount += HasSurfaceBruteForce(volume, VIntVector(x, y, z)) ? 1 : 0;
+					}
+				}
+			}
+
+			mismatchCount += bitmap.CountSurfaceCells(minCell, maxCell) != surfaceCellCount ? 1 : 0;
+			mismatchCount += bitmap.HasSurface(minCell, maxCell) != (surfaceCellCount > 0) ? 1 : 0;
+		}
+
+		return mismatchCount;
+	}
+
+	void TestSurfaceBitmap(const Voxel::EVVoxelStorageType& storageType)
+	{
+		std::mt19937 rng(3);
+
+		//Odd radius so the surface crosses cells at many different offsets
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType, 37.3f);
+
+		V_CHECK(CountBitmapMismatches(*volume) == 0);
+		V_CHECK(CountRangeMismatches(*volume, rng) == 0);
+		V_CHECK(volume->GetSurfaceBitmap().CountSurfaceCells() > 0);
+
+		//Single voxel edits update the cached bitmap incrementally, including sign flips on the volume border and material only changes
+		int voxelCount = (int)volume->GetSize();
+
+		for (int i = 0; i < 300; i++)
+		{
+			VIntVector voxelIndex = VIntVector(rng() % voxelCount, rng() % voxelCount, rng() % voxelCount);
+
+			if (i % 10 == 0)
+			{
+				voxelIndex.X = 0;
+			}
+
+			Voxel::VVoxel voxel = volume->GetVoxel(voxelIndex);
+
+			if (i % 3 == 0)
+			{
+				voxel.Material = (uint8_t)(rng() % 4);
+			}
+			else
+			{
+				voxel.Density = -voxel.Density;
+			}
+
+			volume->SetVoxel(voxelIndex, voxel);
+
+			//Read the bitmap between edits so every edit hits an up to date cache
+			if (i % 50 == 0)
+			{
+				V_CHECK(CountBitmapMismatches(*volume) == 0);
+			}
+		}
+
+		V_CHECK(CountBitmapMismatches(*volume) == 0);
+
+		//Box writes update the cells around the box, a solid block carves a new surface through the sphere band
+		Voxel::VVoxelBox box;
+		volume->ReadVoxelBox(VIntVector(5, 9, 0), VIntVector(20, 14, 11), box);
+
+		for (Voxel::VVoxel& voxel : box.Voxels)
+		{
+			voxel.Density = -1.f;
+			voxel.Material = 2;
+		}
+
+		V_CHECK(volume->WriteVoxelBox(box));
+
+		V_CHECK(CountBitmapMismatches(*volume) == 0);
+		V_CHECK(CountRangeMismatches(*volume, rng) == 0);
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestSurfaceBitmap(storageType);
+	}
+
+	return Tests::VTestHelpers::Finish("SurfaceBitmapTest");
+}
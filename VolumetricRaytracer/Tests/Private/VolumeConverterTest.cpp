@@ -0,0 +1,106 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelizerTestHelpers.h"
+#include "VolumeConverter.h"
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	//Densities of the voxelizer are distances relative to the extraction threshold, so near the surface they stay below one no matter how large the mesh is
+	const float NEAR_SURFACE_DENSITY = 1.f;
+	const float DENSITY_EPSILON = 1e-5f;
+
+	void TestNarrowBandKeepsSurfaceDensities(const float& meshSize)
+	{
+		//The top face lies just past a brick border, so the brick below it only receives positive densities from the outer side of the shell
+		Voxelizer::VMeshInfo mesh = Tests::VVoxelizerTestHelpers::CreateBoxMesh(VVector(meshSize, meshSize * 0.6484f, meshSize), "box_5");
+		Voxelizer::VTextureLibrary textureLib;
+
+		VObjectPtr<Voxel::VVoxelVolume> dense = Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh, textureLib, Voxel::EVVoxelStorageType::Dense);
+		VObjectPtr<Voxel::VVoxelVolume> narrowBand = Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh, textureLib, Voxel::EVVoxelStorageType::NarrowBand);
+
+		V_CHECK(narrowBand->GetStorageType() == Voxel::EVVoxelStorageType::NarrowBand);
+		V_CHECK(narrowBand->GetSize() == dense->GetSize());
+
+		int voxelCount = (int)dense->GetSize();
+		int surfaceVoxelCount = 0;
+		int densityMismatchCount = 0;
+		int signMismatchCount = 0;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					Voxel::VVoxel expected = dense->GetVoxel(VIntVector(x, y, z));
+					Voxel::VVoxel actual = narrowBand->GetVoxel(VIntVector(x, y, z));
+
+					if (std::abs(expected.Density) < NEAR_SURFACE_DENSITY)
+					{
+						surfaceVoxelCount++;
+						densityMismatchCount += std::abs(expected.Density - actual.Density) > DENSITY_EPSILON || expected.Material != actual.Material ? 1 : 0;
+					}
+
+					signMismatchCount += (expected.Density <= 0.f) != (actual.Density <= 0.f) ? 1 : 0;
+				}
+			}
+		}
+
+		V_CHECK(surfaceVoxelCount > 0);
+		V_CHECK(densityMismatchCount == 0);
+		V_CHECK(signMismatchCount == 0);
+
+		//Far from the surface the narrow band still has to release its bricks
+		V_CHECK(narrowBand->GetAllocatedBytes() < dense->GetAllocatedBytes());
+	}
+
+	void TestMeshNames()
+	{
+		int tileCount = 0;
+		uint8_t resolution = 0;
+
+		V_CHECK(Voxelizer::VVolumeConverter::ExtractTileCountFromName("cube_8x4", tileCount) && tileCount == 4);
+		V_CHECK(Voxelizer::VVolumeConverter::ExtractResolutionFromName("cube_8x4", resolution) && resolution == 8);
+		V_CHECK(!Voxelizer::VVolumeConverter::ExtractTileCountFromName("cube_10", tileCount));
+		V_CHECK(Voxelizer::VVolumeConverter::ExtractResolutionFromName("cube_10", resolution) && resolution == 10);
+	}
+
+	//Volumes above the render limit are still voxelized at their resolution, only the renderer rejects them
+	void TestResolutionAboveRenderLimit()
+	{
+		Voxelizer::VMeshInfo mesh = Tests::VVoxelizerTestHelpers::CreateBoxMesh(VVector(1.f, 1.f, 1.f), "box_9");
+		Voxelizer::VTextureLibrary textureLib;
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh, textureLib);
+
+		V_CHECK(volume->GetResolution() == 9);
+		V_CHECK(volume->GetVoxel(volume->RelativePositionToVoxelIndex(VVector(1.f, 0.f, 0.f))).Density < 0.f);
+	}
+}
+
+int main()
+{
+	//A meter sized mesh has cells far smaller than its densities, a large one cells far larger
+	TestNarrowBandKeepsSurfaceDensities(0.5f);
+	TestNarrowBandKeepsSurfaceDensities(300.f);
+
+	TestMeshNames();
+	TestResolutionAboveRenderLimit();
+
+	return Tests::VTestHelpers::Finish("VolumeConverterTest");
+}
@@ -0,0 +1,300 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelVolume.h"
+#include "VoxelDistanceQuery.h"
+#include "VoxelObject.h"
+#include "Scene.h"
+#include "MathHelpers.h"
+#include <random>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	const float SPHERE_RADIUS = 37.3f;
+
+	//Exact signed distance everywhere, the query can sample it directly
+	VObjectPtr<Voxel::VVoxelVolume> CreateSolidSphereVolume(const Voxel::EVVoxelStorageType& storageType, const float& densityScale = 1.f)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(5, 100.f, storageType, densityScale);
+
+		int voxelCount = (int)volume->GetSize();
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					Voxel::VVoxel voxel;
+					voxel.Density = (volume->VoxelIndexToRelativePosition(VIntVector(x, y, z)).Length() - SPHERE_RADIUS) * densityScale;
+					voxel.Material = voxel.Density <= 0 ? 1 : 0;
+
+					volume->SetVoxel(VIntVector(x, y, z), voxel);
+				}
+			}
+		}
+
+		return volume;
+	}
+
+	VVector GetRandomPosition(std::mt19937& rng, const float& extends)
+	{
+		std::uniform_real_distribution<float> coordinate(-extends, extends);
+
+		return VVector(coordinate(rng), coordinate(rng), coordinate(rng));
+	}
+
+	float GetSegmentDistance(const VVector& point, const VVector& start, const VVector& end)
+	{
+		VVector segment = end - start;
+		float lengthSquared = segment.LengthSquared();
+		float t = lengthSquared > 0.f ? VMathHelpers::Clamp((point - start).Dot(segment) / lengthSquared, 0.f, 1.f) : 0.f;
+
+		return (point - (start + segment * t)).Length();
+	}
+
+	//Distances come back in volume units whatever the density scale is
+	void TestSpheres(const Voxel::EVVoxelStorageType& storageType, const float& densityScale)
+	{
+		std::mt19937 rng(19);
+		std::uniform_real_distribution<float> radius(0.f, 10.f);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = CreateSolidSphereVolume(storageType, densityScale);
+
+		//Enough queries for several parallel chunks
+		const size_t queryCount = 5000;
+
+		std::vector<VVector> centers(queryCount);
+		std::vector<float> radii(queryCount);
+		std::vector<Voxel::VVoxelDistanceResult> results(queryCount);
+		std::vector<Voxel::VVoxelDistanceResult> pointResults(queryCount);
+
+		for (size_t i = 0; i < queryCount; i++)
+		{
+			centers[i] = GetRandomPosition(rng, 95.f);
+			radii[i] = radius(rng);
+		}
+
+		volume->QuerySpheres(centers.data(), radii.data(), queryCount, results.data());
+		volume->QuerySpheres(centers.data(), nullptr, queryCount, pointResults.data());
+
+		//Trilinear interpolation of a sphere distance is a bit larger than the distance between the voxels
+		const float tolerance = volume->GetCellSize() * 0.1f;
+
+		int distanceMismatchCount = 0;
+		int normalMismatchCount = 0;
+		int overlapMismatchCount = 0;
+
+		for (size_t i = 0; i < queryCount; i++)
+		{
+			//The sphere distance has a cone point in the center that trilinear interpolation rounds off
+			if (centers[i].Length() < volume->GetCellSize() * 2)
+			{
+				continue;
+			}
+
+			float expected = centers[i].Length() - SPHERE_RADIUS - radii[i];
+
+			distanceMismatchCount += std::abs(results[i].Distance - expected) > tolerance ? 1 : 0;
+			distanceMismatchCount += std::abs(pointResults[i].Distance - (expected + radii[i])) > tolerance ? 1 : 0;
+
+			//The interpolated gradient turns by about a cell over the distance to the center
+			if (centers[i].Length() > volume->GetCellSize() * 4)
+			{
+				normalMismatchCount += results[i].Normal.Dot(centers[i].GetNormalized()) < 0.99f ? 1 : 0;
+			}
+
+			if (std::abs(expected) > tolerance)
+			{
+				overlapMismatchCount += results[i].IsOverlapping() != (expected < 0) ? 1 : 0;
+				overlapMismatchCount += std::abs(results[i].GetPenetrationDepth() - VMathHelpers::Max(-expected, 0.f)) > tolerance ? 1 : 0;
+			}
+		}
+
+		V_CHECK(distanceMismatchCount == 0);
+		V_CHECK(normalMismatchCount == 0);
+		V_CHECK(overlapMismatchCount == 0);
+	}
+
+	//Outside the volume the distance continues from the closest point of the volume box, which never underestimates
+	void TestOutsideVolume()
+	{
+		std::mt19937 rng(23);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = CreateSolidSphereVolume(Voxel::EVVoxelStorageType::Dense);
+
+		int underestimateCount = 0;
+
+		for (int i = 0; i < 1000; i++)
+		{
+			VVector center = GetRandomPosition(rng, 300.f);
+
+			Voxel::VVoxelDistanceResult result;
+			volume->QuerySpheres(&center, nullptr, 1, &result);
+
+			underestimateCount += result.Distance < center.Length() - SPHERE_RADIUS - volume->GetCellSize() * 0.1f ? 1 : 0;
+		}
+
+		V_CHECK(underestimateCount == 0);
+	}
+
+	//The band sphere only has distances near its surface, the rest of the volume is found through the surface bitmap
+	void TestClampedField()
+	{
+		std::mt19937 rng(29);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, Voxel::EVVoxelStorageType::NarrowBand, SPHERE_RADIUS);
+
+		//The inner shell of the band sphere is a second surface, keep the queries outside of the sphere.
+		//Outside the search only reaches as far as the sphere, so the radius is large enough to find the surface
+		const float radius = Voxel::VVoxelDistanceQuery::MAX_SURFACE_SEARCH_CELLS * volume->GetCellSize() * 0.5f;
+
+		int mismatchCount = 0;
+		int overestimateCount = 0;
+
+		for (int i = 0; i < 1000; i++)
+		{
+			VVector center = GetRandomPosition(rng, 95.f);
+			float expected = center.Length() - SPHERE_RADIUS;
+
+			if (expected < 0)
+			{
+				continue;
+			}
+
+			Voxel::VVoxelDistanceResult result;
+			volume->QuerySpheres(&center, &radius, 1, &result);
+
+			Voxel::VVoxelDistanceResult pointResult;
+			volume->QuerySpheres(&center, nullptr, 1, &pointResult);
+
+			//With the surface in reach the estimate is within a cell, points without a surface next to them only get a lower bound
+			if (expected < radius)
+			{
+				mismatchCount += std::abs(result.Distance - (expected - radius)) > volume->GetCellSize() ? 1 : 0;
+			}
+
+			overestimateCount += result.Distance > expected - radius + volume->GetCellSize() ? 1 : 0;
+			overestimateCount += pointResult.Distance > expected + volume->GetCellSize() ? 1 : 0;
+		}
+
+		V_CHECK(mismatchCount == 0);
+		V_CHECK(overestimateCount == 0);
+	}
+
+	void TestCapsules(const Voxel::EVVoxelStorageType& storageType)
+	{
+		std::mt19937 rng(31);
+		std::uniform_real_distribution<float> radius(0.f, 10.f);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = CreateSolidSphereVolume(storageType);
+
+		const size_t queryCount = 500;
+
+		std::vector<VVector> starts(queryCount);
+		std::vector<VVector> ends(queryCount);
+		std::vector<float> radii(queryCount);
+		std::vector<Voxel::VVoxelDistanceResult> results(queryCount);
+
+		for (size_t i = 0; i < queryCount; i++)
+		{
+			starts[i] = GetRandomPosition(rng, 95.f);
+			ends[i] = GetRandomPosition(rng, 95.f);
+			radii[i] = radius(rng);
+
+			//Some capsules degenerate to spheres
+			if (i % 10 == 0)
+			{
+				ends[i] = starts[i];
+			}
+		}
+
+		volume->QueryCapsules(starts.data(), ends.data(), radii.data(), queryCount, results.data());
+
+		//The refined samples are an eighth of a cell apart, on top of the interpolation error
+		const float tolerance = volume->GetCellSize() * 0.25f;
+
+		int distanceMismatchCount = 0;
+		int sphereMismatchCount = 0;
+
+		for (size_t i = 0; i < queryCount; i++)
+		{
+			float expected = GetSegmentDistance(VVector::ZERO, starts[i], ends[i]) - SPHERE_RADIUS - radii[i];
+
+			distanceMismatchCount += std::abs(results[i].Distance - expected) > tolerance ? 1 : 0;
+
+			if (i % 10 == 0)
+			{
+				Voxel::VVoxelDistanceResult sphereResult;
+				volume->QuerySpheres(&starts[i], &radii[i], 1, &sphereResult);
+
+				sphereMismatchCount += sphereResult.Distance != results[i].Distance ? 1 : 0;
+			}
+		}
+
+		V_CHECK(distanceMismatchCount == 0);
+		V_CHECK(sphereMismatchCount == 0);
+	}
+
+	//World space queries go through the object transform, distances scale with the smallest scale component
+	void TestObjectQueries()
+	{
+		VObjectPtr<Scene::VScene> scene = VObject::CreateObject<Scene::VScene>();
+
+		VVector position = VVector(500.f, -20.f, 10.f);
+		VQuat rotation = VQuat::FromAxisAngle(VVector(0.f, 0.f, 1.f), 0.7f);
+		float scale = 2.f;
+
+		VObjectPtr<Scene::VVoxelObject> object = scene->SpawnObject<Scene::VVoxelObject>(position, rotation, VVector::ONE * scale);
+		object->SetVoxelVolume(CreateSolidSphereVolume(Voxel::EVVoxelStorageType::Dense));
+
+		VVector center = position + VVector(0.f, 100.f, 0.f);
+		float radius = 5.f;
+
+		Voxel::VVoxelDistanceResult sphereResult;
+		object->QuerySpheres(&center, &radius, 1, &sphereResult);
+
+		V_CHECK(std::abs(sphereResult.Distance - (100.f - SPHERE_RADIUS * scale - radius)) < scale);
+		V_CHECK(sphereResult.Normal.Dot(VVector(0.f, 1.f, 0.f)) > 0.99f);
+
+		//Capsule passing the sphere center at 60 units
+		VVector start = position + VVector(-200.f, 60.f, 0.f);
+		VVector end = position + VVector(200.f, 60.f, 0.f);
+
+		Voxel::VVoxelDistanceResult capsuleResult;
+		object->QueryCapsules(&start, &end, &radius, 1, &capsuleResult);
+
+		V_CHECK(std::abs(capsuleResult.Distance - (60.f - SPHERE_RADIUS * scale - radius)) < scale);
+		V_CHECK(capsuleResult.Normal.Dot(VVector(0.f, 1.f, 0.f)) > 0.99f);
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : { Voxel::EVVoxelStorageType::Dense, Voxel::EVVoxelStorageType::Planar, Voxel::EVVoxelStorageType::Brick })
+	{
+		TestSpheres(storageType, 1.f);
+		TestSpheres(storageType, 4.f);
+		TestCapsules(storageType);
+	}
+
+	TestOutsideVolume();
+	TestClampedField();
+	TestObjectQueries();
+
+	return Tests::VTestHelpers::Finish("VoxelDistanceQueryTest");
+}
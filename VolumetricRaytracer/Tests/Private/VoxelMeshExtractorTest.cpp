@@ -0,0 +1,199 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelVolume.h"
+#include "VoxelMeshExtractor.h"
+#include <map>
+#include <tuple>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	const float SPHERE_RADIUS = 37.3f;
+
+	//Every directed edge of a closed, consistently wound mesh is used once, and its reverse is used by exactly one other triangle
+	int CountOpenEdges(const Voxel::VVoxelMesh& mesh, size_t& outEdgeCount)
+	{
+		std::map<std::pair<uint32_t, uint32_t>, int> directedEdges;
+
+		for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				directedEdges[std::make_pair(mesh.Indices[i + e], mesh.Indices[i + (e + 1) % 3])]++;
+			}
+		}
+
+		int openEdgeCount = 0;
+
+		for (const auto& edge : directedEdges)
+		{
+			auto reverse = directedEdges.find(std::make_pair(edge.first.second, edge.first.first));
+			openEdgeCount += edge.second != 1 || reverse == directedEdges.end() || reverse->second != 1 ? 1 : 0;
+		}
+
+		outEdgeCount = directedEdges.size() / 2;
+
+		return openEdgeCount;
+	}
+
+	int CountDuplicateVertices(const Voxel::VVoxelMesh& mesh)
+	{
+		std::map<std::tuple<float, float, float>, int> positions;
+
+		for (const VVector& position : mesh.Positions)
+		{
+			positions[std::make_tuple(position.X, position.Y, position.Z)]++;
+		}
+
+		return (int)(mesh.Positions.size() - positions.size());
+	}
+
+	//The shared sphere only writes a band around the surface and leaves its core empty, a mesh needs the solid sphere
+	VObjectPtr<Voxel::VVoxelVolume> CreateSolidSphereVolume(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(5, 100.f, storageType);
+
+		int voxelCount = (int)volume->GetSize();
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+
+					Voxel::VVoxel voxel;
+					voxel.Density = volume->VoxelIndexToRelativePosition(voxelIndex).Length() - SPHERE_RADIUS;
+					voxel.Material = voxel.Density <= 0 ? 1 : 0;
+
+					volume->SetVoxel(voxelIndex, voxel);
+				}
+			}
+		}
+
+		return volume;
+	}
+
+	void TestSphereMesh(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = CreateSolidSphereVolume(storageType);
+
+		Voxel::VVoxelMesh mesh;
+		volume->ExtractMesh(mesh);
+
+		V_CHECK(mesh.GetTriangleCount() > 0);
+		V_CHECK(mesh.Indices.size() == mesh.GetTriangleCount() * 3);
+		V_CHECK(mesh.Normals.size() == mesh.GetVertexCount());
+		V_CHECK(mesh.Materials.size() == mesh.GetVertexCount());
+
+		int invalidIndexCount = 0;
+
+		for (uint32_t index : mesh.Indices)
+		{
+			invalidIndexCount += index >= mesh.GetVertexCount() ? 1 : 0;
+		}
+
+		V_CHECK(invalidIndexCount == 0);
+
+		if (invalidIndexCount > 0)
+		{
+			return;
+		}
+
+		//A sphere has to come out as one closed surface of genus 0
+		size_t edgeCount = 0;
+
+		V_CHECK(CountOpenEdges(mesh, edgeCount) == 0);
+		V_CHECK((int64_t)mesh.GetVertexCount() - (int64_t)edgeCount + (int64_t)mesh.GetTriangleCount() == 2);
+		V_CHECK(CountDuplicateVertices(mesh) == 0);
+
+		//Vertices stay within their cell of the surface and normals point away from the center
+		int misplacedVertexCount = 0;
+		int flippedNormalCount = 0;
+
+		for (size_t i = 0; i < mesh.GetVertexCount(); i++)
+		{
+			misplacedVertexCount += std::abs(mesh.Positions[i].Length() - SPHERE_RADIUS) > volume->GetCellSize() ? 1 : 0;
+			flippedNormalCount += mesh.Normals[i].Dot(mesh.Positions[i]) <= 0 ? 1 : 0;
+		}
+
+		V_CHECK(misplacedVertexCount == 0);
+		V_CHECK(flippedNormalCount == 0);
+
+		//Triangles are wound outwards, so the enclosed volume is positive and close to the sphere
+		float enclosedVolume = 0;
+
+		for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+		{
+			const VVector& a = mesh.Positions[mesh.Indices[i]];
+			const VVector& b = mesh.Positions[mesh.Indices[i + 1]];
+			const VVector& c = mesh.Positions[mesh.Indices[i + 2]];
+
+			enclosedVolume += a.Dot(b.Cross(c)) / 6.f;
+		}
+
+		float sphereVolume = 4.f / 3.f * 3.14159265f * SPHERE_RADIUS * SPHERE_RADIUS * SPHERE_RADIUS;
+
+		V_CHECK(std::abs(enclosedVolume - sphereVolume) < sphereVolume * 0.05f);
+	}
+
+	//The band sphere is a hollow shell, its inner and outer surface are two separate closed meshes
+	void TestShellMesh()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, Voxel::EVVoxelStorageType::Dense, SPHERE_RADIUS);
+
+		Voxel::VVoxelMesh mesh;
+		volume->ExtractMesh(mesh);
+
+		size_t edgeCount = 0;
+
+		V_CHECK(CountOpenEdges(mesh, edgeCount) == 0);
+		V_CHECK((int64_t)mesh.GetVertexCount() - (int64_t)edgeCount + (int64_t)mesh.GetTriangleCount() == 4);
+	}
+
+	void TestEmptyVolume()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(4, 100.f);
+
+		Voxel::VVoxel emptyVoxel;
+		emptyVoxel.Density = 10.f;
+
+		volume->FillVolume(emptyVoxel);
+
+		Voxel::VVoxelMesh mesh;
+		mesh.Indices.push_back(0);
+
+		volume->ExtractMesh(mesh);
+
+		V_CHECK(mesh.GetTriangleCount() == 0);
+		V_CHECK(mesh.GetVertexCount() == 0);
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestSphereMesh(storageType);
+	}
+
+	TestShellMesh();
+	TestEmptyVolume();
+
+	return Tests::VTestHelpers::Finish("VoxelMeshExtractorTest");
+}
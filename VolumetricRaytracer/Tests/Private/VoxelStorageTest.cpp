@@ -0,0 +1,542 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelStorageFactory.h"
+#include "CompactVoxelStorage.h"
+#include "MortonVoxelStorage.h"
+#include "PaletteVoxelStorage.h"
+#include "VoxelVolume.h"
+#include "MathHelpers.h"
+#include <random>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	const size_t VOXEL_COUNT = 33;
+	const float CELL_SIZE = 2.f;
+
+	//Densities are written within 1.5 cells of the surface, inside the band of the narrow band storage
+	const float MAX_WRITTEN_DENSITY = CELL_SIZE * 1.5f;
+
+	class VReferenceVolume
+	{
+	public:
+		VReferenceVolume(const Voxel::VVoxel& fillVoxel)
+			: Voxels(VOXEL_COUNT * VOXEL_COUNT * VOXEL_COUNT, fillVoxel)
+		{}
+
+		Voxel::VVoxel& At(const VIntVector& voxelIndex)
+		{
+			return Voxels[VMathHelpers::Index3DTo1D(voxelIndex, VOXEL_COUNT, VOXEL_COUNT)];
+		}
+
+		std::vector<Voxel::VVoxel> Voxels;
+	};
+
+	Voxel::VVoxel GetFillVoxel()
+	{
+		Voxel::VVoxel voxel;
+		voxel.Density = CELL_SIZE * 10.f;
+		voxel.Material = 0;
+
+		return voxel;
+	}
+
+	Voxel::VVoxel GetRandomVoxel(std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> density(-MAX_WRITTEN_DENSITY, MAX_WRITTEN_DENSITY);
+
+		Voxel::VVoxel voxel;
+		voxel.Density = density(rng);
+		voxel.Material = (uint8_t)(rng() % 8);
+
+		return voxel;
+	}
+
+	VIntVector GetRandomIndex(std::mt19937& rng)
+	{
+		return VIntVector(rng() % VOXEL_COUNT, rng() % VOXEL_COUNT, rng() % VOXEL_COUNT);
+	}
+
+	//Lossy storages quantize densities, everything else has to return them unchanged
+	bool IsSameVoxel(const Voxel::EVVoxelStorageType& storageType, const Voxel::VVoxel& expected, const Voxel::VVoxel& actual)
+	{
+		float tolerance = 0.f;
+
+		switch (storageType)
+		{
+		case Voxel::EVVoxelStorageType::Compact:
+			//Densities that round to zero are pushed out to one step to keep their sign
+			tolerance = CELL_SIZE / Voxel::VCompactVoxel::DENSITY_STEPS_PER_CELL + 1e-6f;
+			break;
+		case Voxel::EVVoxelStorageType::Half:
+			tolerance = std::abs(expected.Density) / 2048.f + 1e-6f;
+			break;
+		default:
+			break;
+		}
+
+		return std::abs(expected.Density - actual.Density) <= tolerance && expected.Material == actual.Material && (expected.Density <= 0.f) == (actual.Density <= 0.f);
+	}
+
+	int CountMismatches(const Voxel::EVVoxelStorageType& storageType, const Voxel::IVVoxelStorage& storage, VReferenceVolume& reference)
+	{
+		int mismatchCount = 0;
+
+		for (int x = 0; x < (int)VOXEL_COUNT; x++)
+		{
+			for (int y = 0; y < (int)VOXEL_COUNT; y++)
+			{
+				for (int z = 0; z < (int)VOXEL_COUNT; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+					Voxel::VVoxel expected = reference.At(voxelIndex);
+
+					mismatchCount += IsSameVoxel(storageType, expected, storage.GetVoxel(voxelIndex)) ? 0 : 1;
+					mismatchCount += IsSameVoxel(storageType, expected, storage.GetVoxel(VMathHelpers::Index3DTo1D(voxelIndex, VOXEL_COUNT, VOXEL_COUNT))) ? 0 : 1;
+				}
+			}
+		}
+
+		return mismatchCount;
+	}
+
+	void WriteRandomVoxels(Voxel::IVVoxelStorage& storage, VReferenceVolume& reference, std::mt19937& rng, const int& count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			VIntVector voxelIndex = GetRandomIndex(rng);
+			Voxel::VVoxel voxel = GetRandomVoxel(rng);
+
+			storage.SetVoxel(voxelIndex, voxel);
+			reference.At(voxelIndex) = voxel;
+		}
+	}
+
+	void WriteRandomBox(Voxel::IVVoxelStorage& storage, VReferenceVolume& reference, std::mt19937& rng)
+	{
+		VIntVector a = GetRandomIndex(rng);
+		VIntVector b = GetRandomIndex(rng);
+		VIntVector min = VIntVector::Min(a, b);
+		VIntVector max = VIntVector::Max(a, b);
+
+		std::vector<Voxel::VVoxel> box;
+
+		//Box layout is x, then z, then y innermost
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int z = min.Z; z <= max.Z; z++)
+			{
+				for (int y = min.Y; y <= max.Y; y++)
+				{
+					box.push_back(GetRandomVoxel(rng));
+					reference.At(VIntVector(x, y, z)) = box.back();
+				}
+			}
+		}
+
+		storage.WriteBox(min, max, box.data());
+	}
+
+	void TestRoundTrip(const Voxel::EVVoxelStorageType& storageType)
+	{
+		std::mt19937 rng(7);
+
+		std::shared_ptr<Voxel::IVVoxelStorage> storage = Voxel::VVoxelStorageFactory::CreateStorage(storageType, CELL_SIZE);
+		storage->Allocate(VOXEL_COUNT, GetFillVoxel());
+
+		V_CHECK(storage->GetType() == storageType);
+		V_CHECK(storage->GetVoxelCountAlongAxis() == VOXEL_COUNT);
+
+		VReferenceVolume reference(GetFillVoxel());
+
+		V_CHECK(CountMismatches(storageType, *storage, reference) == 0);
+
+		WriteRandomVoxels(*storage, reference, rng, 2000);
+		WriteRandomBox(*storage, reference, rng);
+		WriteRandomBox(*storage, reference, rng);
+
+		V_CHECK(CountMismatches(storageType, *storage, reference) == 0);
+
+		//ReadBox has its own fast path in most storages
+		VIntVector min = VIntVector(3, 0, 17);
+		VIntVector max = VIntVector(20, 32, 25);
+
+		std::vector<Voxel::VVoxel> box((size_t)(max.X - min.X + 1) * (max.Y - min.Y + 1) * (max.Z - min.Z + 1));
+		storage->ReadBox(min, max, box.data());
+
+		int boxMismatchCount = 0;
+		size_t i = 0;
+
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int z = min.Z; z <= max.Z; z++)
+			{
+				for (int y = min.Y; y <= max.Y; y++)
+				{
+					boxMismatchCount += IsSameVoxel(storageType, reference.At(VIntVector(x, y, z)), box[i++]) ? 0 : 1;
+				}
+			}
+		}
+
+		V_CHECK(boxMismatchCount == 0);
+
+		//Serialized voxels are already quantized, so a lossy storage has to read back exactly what it wrote
+		std::shared_ptr<Voxel::IVVoxelStorage> loaded = Voxel::VVoxelStorageFactory::CreateStorage(storageType, CELL_SIZE);
+		loaded->Deserialize(VOXEL_COUNT, storage->Serialize());
+
+		int serializationMismatchCount = 0;
+
+		for (size_t voxel = 0; voxel < VOXEL_COUNT * VOXEL_COUNT * VOXEL_COUNT; voxel++)
+		{
+			serializationMismatchCount += storage->GetVoxel(voxel).Density != loaded->GetVoxel(voxel).Density || storage->GetVoxel(voxel).Material != loaded->GetVoxel(voxel).Material ? 1 : 0;
+		}
+
+		V_CHECK(serializationMismatchCount == 0);
+	}
+
+	void TestCloneCopyOnWrite(const Voxel::EVVoxelStorageType& storageType)
+	{
+		std::mt19937 rng(11);
+
+		std::shared_ptr<Voxel::IVVoxelStorage> storage = Voxel::VVoxelStorageFactory::CreateStorage(storageType, CELL_SIZE);
+		storage->Allocate(VOXEL_COUNT, GetFillVoxel());
+
+		VReferenceVolume reference(GetFillVoxel());
+		WriteRandomVoxels(*storage, reference, rng, 500);
+
+		std::shared_ptr<Voxel::IVVoxelStorage> clone = storage->Clone();
+		VReferenceVolume cloneReference = reference;
+
+		V_CHECK(clone->GetType() == storageType);
+		V_CHECK(CountMismatches(storageType, *clone, cloneReference) == 0);
+
+		//Writes to either side must stay on that side
+		WriteRandomVoxels(*storage, reference, rng, 500);
+		WriteRandomBox(*storage, reference, rng);
+
+		V_CHECK(CountMismatches(storageType, *clone, cloneReference) == 0);
+
+		WriteRandomVoxels(*clone, cloneReference, rng, 500);
+		WriteRandomBox(*clone, cloneReference, rng);
+
+		V_CHECK(CountMismatches(storageType, *storage, reference) == 0);
+		V_CHECK(CountMismatches(storageType, *clone, cloneReference) == 0);
+	}
+
+	void TestCompactEncoding()
+	{
+		Voxel::VCompactVoxelStorage storage(CELL_SIZE);
+		storage.Allocate(VOXEL_COUNT, GetFillVoxel());
+
+		const float maxDensity = CELL_SIZE * INT16_MAX / Voxel::VCompactVoxel::DENSITY_STEPS_PER_CELL;
+
+		Voxel::VVoxel voxel;
+		voxel.Material = 5;
+
+		voxel.Density = maxDensity * 2.f;
+		storage.SetVoxel(VIntVector(1, 0, 0), voxel);
+
+		voxel.Density = -maxDensity * 2.f;
+		storage.SetVoxel(VIntVector(2, 0, 0), voxel);
+
+		voxel.Density = CELL_SIZE * 0.0001f;
+		storage.SetVoxel(VIntVector(3, 0, 0), voxel);
+
+		voxel.Density = -CELL_SIZE * 0.0001f;
+		storage.SetVoxel(VIntVector(4, 0, 0), voxel);
+
+		voxel.Density = CELL_SIZE * 0.5f;
+		storage.SetVoxel(VIntVector(5, 0, 0), voxel);
+
+		const Voxel::VCompactVoxel* compactVoxels = storage.GetCompactVoxels();
+
+		auto getCompactVoxel = [compactVoxels](const VIntVector& voxelIndex)
+		{
+			return compactVoxels[VMathHelpers::Index3DTo1D(voxelIndex, VOXEL_COUNT, VOXEL_COUNT)];
+		};
+
+		//Out of range densities saturate and remember that they did
+		V_CHECK(getCompactVoxel(VIntVector(1, 0, 0)).Density == INT16_MAX);
+		V_CHECK(getCompactVoxel(VIntVector(1, 0, 0)).Flags & Voxel::VCompactVoxel::FLAG_DENSITY_CLAMPED);
+		V_CHECK(getCompactVoxel(VIntVector(2, 0, 0)).Density == -INT16_MAX);
+		V_CHECK(getCompactVoxel(VIntVector(2, 0, 0)).Flags & Voxel::VCompactVoxel::FLAG_DENSITY_CLAMPED);
+		V_CHECK(std::abs(storage.GetVoxel(VIntVector(1, 0, 0)).Density - maxDensity) < 1e-3f);
+
+		//Densities below one step keep their sign
+		V_CHECK(getCompactVoxel(VIntVector(3, 0, 0)).Density == 1);
+		V_CHECK(getCompactVoxel(VIntVector(4, 0, 0)).Density == -1);
+
+		V_CHECK(getCompactVoxel(VIntVector(5, 0, 0)).Density == Voxel::VCompactVoxel::DENSITY_STEPS_PER_CELL * 0.5f);
+		V_CHECK(getCompactVoxel(VIntVector(5, 0, 0)).Flags == 0);
+		V_CHECK(getCompactVoxel(VIntVector(5, 0, 0)).Material == 5);
+
+		//The flag survives serialization
+		Voxel::VCompactVoxelStorage loaded(CELL_SIZE);
+		loaded.Deserialize(VOXEL_COUNT, storage.Serialize());
+
+		V_CHECK(loaded.GetCompactVoxels()[VMathHelpers::Index3DTo1D(VIntVector(1, 0, 0), VOXEL_COUNT, VOXEL_COUNT)].Flags & Voxel::VCompactVoxel::FLAG_DENSITY_CLAMPED);
+	}
+
+	void TestPlanarEditing()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> denseVolume = VObject::CreateObject<Voxel::VVoxelVolume>(3, 100.f, Voxel::EVVoxelStorageType::Dense);
+
+		V_CHECK(denseVolume->GetDensityPlaneForEditing() == nullptr);
+		V_CHECK(denseVolume->GetMaterialPlaneForEditing() == nullptr);
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(3, 100.f, Voxel::EVVoxelStorageType::Planar);
+		volume->FillVolume(GetFillVoxel());
+
+		std::shared_ptr<const Voxel::VVoxelVolume> snapshot = volume->TakeSnapshot();
+
+		V_CHECK(!volume->IsDirty());
+
+		float* densities = volume->GetDensityPlaneForEditing();
+		uint8_t* materials = volume->GetMaterialPlaneForEditing();
+
+		V_CHECK(densities != nullptr && materials != nullptr);
+		V_CHECK(volume->IsDirty());
+
+		size_t voxelCount = (size_t)volume->GetSize() * volume->GetSize() * volume->GetSize();
+
+		for (size_t i = 0; i < voxelCount; i++)
+		{
+			densities[i] = (float)i;
+			materials[i] = (uint8_t)(i % 3);
+		}
+
+		//Writes through the planes show up in the per voxel API, the snapshot still holds the old planes
+		int mismatchCount = 0;
+		int snapshotMismatchCount = 0;
+
+		for (size_t i = 0; i < voxelCount; i++)
+		{
+			mismatchCount += volume->GetVoxel(i).Density != (float)i || volume->GetVoxel(i).Material != (uint8_t)(i % 3) ? 1 : 0;
+			snapshotMismatchCount += snapshot->GetVoxel(i).Density != GetFillVoxel().Density || snapshot->GetVoxel(i).Material != GetFillVoxel().Material ? 1 : 0;
+		}
+
+		V_CHECK(mismatchCount == 0);
+		V_CHECK(snapshotMismatchCount == 0);
+
+		V_CHECK(volume->GetDensityPlane() == densities);
+		V_CHECK(snapshot->GetDensityPlane() != densities);
+	}
+
+	void TestMortonIndexing()
+	{
+		Voxel::VMortonVoxelStorage storage;
+		storage.Allocate(VOXEL_COUNT, GetFillVoxel());
+
+		size_t tileCount = (VOXEL_COUNT + Voxel::VMortonVoxelStorage::TILE_SIZE - 1) / Voxel::VMortonVoxelStorage::TILE_SIZE;
+		std::vector<bool> used(tileCount * tileCount * tileCount * Voxel::VMortonVoxelStorage::TILE_VOXEL_COUNT, false);
+
+		int outOfRangeCount = 0;
+		int collisionCount = 0;
+		int scatteredCellCount = 0;
+
+		for (int x = 0; x < (int)VOXEL_COUNT; x++)
+		{
+			for (int y = 0; y < (int)VOXEL_COUNT; y++)
+			{
+				for (int z = 0; z < (int)VOXEL_COUNT; z++)
+				{
+					size_t storageIndex = storage.GetStorageIndex(VIntVector(x, y, z));
+
+					if (storageIndex >= used.size())
+					{
+						outOfRangeCount++;
+						continue;
+					}
+
+					collisionCount += used[storageIndex] ? 1 : 0;
+					used[storageIndex] = true;
+
+					//The corners of an even aligned cell are one run of 8 voxels
+					if (x % 2 == 0 && y % 2 == 0 && z % 2 == 0 && x + 1 < (int)VOXEL_COUNT && y + 1 < (int)VOXEL_COUNT && z + 1 < (int)VOXEL_COUNT)
+					{
+						size_t minIndex = storageIndex;
+						size_t maxIndex = storageIndex;
+
+						for (const VIntVector& corner : Voxel::VCell::VOXEL_COORDS)
+						{
+							size_t cornerIndex = storage.GetStorageIndex(VIntVector(x, y, z) + corner);
+							minIndex = VMathHelpers::Min(minIndex, cornerIndex);
+							maxIndex = VMathHelpers::Max(maxIndex, cornerIndex);
+						}
+
+						scatteredCellCount += maxIndex - minIndex == 7 && minIndex % 8 == 0 ? 0 : 1;
+					}
+				}
+			}
+		}
+
+		V_CHECK(outOfRangeCount == 0);
+		V_CHECK(collisionCount == 0);
+		V_CHECK(scatteredCellCount == 0);
+	}
+
+	void TestMaterialPalette()
+	{
+		std::mt19937 rng(13);
+
+		const size_t voxelCount = Voxel::VPaletteVoxelStorage::BRICK_VOXEL_COUNT;
+
+		Voxel::VVoxelMaterialPalette palette(voxelCount, 0);
+		std::vector<uint8_t> reference(voxelCount, 0);
+
+		uint8_t material = 0;
+		V_CHECK(palette.IsUniform(material) && material == 0);
+		V_CHECK(palette.GetBitsPerVoxel() == 0);
+
+		//Every step adds materials until the palette has to grow past 4 bits
+		for (size_t materialCount : { 2, 3, 5, 16, 17, 200 })
+		{
+			for (size_t i = 0; i < voxelCount; i++)
+			{
+				reference[i] = (uint8_t)(rng() % materialCount);
+				palette.Set(i, reference[i]);
+			}
+
+			int mismatchCount = 0;
+
+			for (size_t i = 0; i < voxelCount; i++)
+			{
+				mismatchCount += palette.Get(i) != reference[i] ? 1 : 0;
+			}
+
+			std::vector<uint8_t> decoded(voxelCount);
+			palette.Decode(0, voxelCount, decoded.data());
+
+			V_CHECK(mismatchCount == 0);
+			V_CHECK(decoded == reference);
+			V_CHECK(!palette.IsUniform(material));
+			V_CHECK(palette.GetBitsPerVoxel() >= VMathHelpers::Min(8u, (unsigned int)std::ceil(std::log2((float)palette.GetPaletteSize()))));
+		}
+
+		std::vector<uint8_t> uniform(voxelCount, 42);
+		palette.Encode(0, voxelCount, uniform.data());
+
+		V_CHECK(palette.IsUniform(material) && material == 42);
+
+		std::vector<char> data;
+		palette.Serialize(data);
+
+		Voxel::VVoxelMaterialPalette loaded(voxelCount);
+		const char* dataStart = data.data();
+
+		V_CHECK(loaded.Deserialize(dataStart, data.data() + data.size()));
+		V_CHECK(loaded.Get(voxelCount - 1) == 42);
+	}
+
+	void TestPaletteUniformMaterial()
+	{
+		std::mt19937 rng(17);
+
+		Voxel::VPaletteVoxelStorage storage;
+		storage.Allocate(VOXEL_COUNT, GetFillVoxel());
+
+		VReferenceVolume reference(GetFillVoxel());
+
+		//A few bricks get mixed materials, one brick gets a single different material
+		for (int i = 0; i < 40; i++)
+		{
+			VIntVector voxelIndex = VIntVector(rng() % 16, rng() % 16, rng() % 16);
+
+			Voxel::VVoxel voxel = GetRandomVoxel(rng);
+			voxel.Material = 1 + (uint8_t)(rng() % 3);
+
+			storage.SetVoxel(voxelIndex, voxel);
+			reference.At(voxelIndex) = voxel;
+		}
+
+		for (int x = 24; x < 32; x++)
+		{
+			for (int y = 24; y < 32; y++)
+			{
+				for (int z = 24; z < 32; z++)
+				{
+					Voxel::VVoxel voxel = GetRandomVoxel(rng);
+					voxel.Material = 7;
+
+					storage.SetVoxel(VIntVector(x, y, z), voxel);
+					reference.At(VIntVector(x, y, z)) = voxel;
+				}
+			}
+		}
+
+		int wrongUniformCount = 0;
+		int missedUniformCount = 0;
+
+		for (int i = 0; i < 500; i++)
+		{
+			VIntVector min = GetRandomIndex(rng);
+			VIntVector max = VIntVector::Min(min + VIntVector(rng() % 12, rng() % 12, rng() % 12), (int)VOXEL_COUNT - 1);
+
+			//Snap every other box to whole bricks, where the fast path has to be exact
+			bool brickAligned = i % 2 == 0;
+
+			if (brickAligned)
+			{
+				const int brickSize = (int)Voxel::VPaletteVoxelStorage::BRICK_SIZE;
+
+				min = (min / brickSize) * brickSize;
+				max = VIntVector::Min((max / brickSize) * brickSize + VIntVector(brickSize - 1, brickSize - 1, brickSize - 1), (int)VOXEL_COUNT - 1);
+			}
+
+			bool uniform = true;
+			uint8_t expectedMaterial = reference.At(min).Material;
+
+			for (int x = min.X; x <= max.X; x++)
+			{
+				for (int y = min.Y; y <= max.Y; y++)
+				{
+					for (int z = min.Z; z <= max.Z; z++)
+					{
+						uniform &= reference.At(VIntVector(x, y, z)).Material == expectedMaterial;
+					}
+				}
+			}
+
+			uint8_t material = 0;
+			bool reportedUniform = storage.IsUniformMaterial(min, max, material);
+
+			//Reporting a mixed box as uniform is a bug, the reverse is only allowed for boxes cutting through bricks
+			wrongUniformCount += reportedUniform && (!uniform || material != expectedMaterial) ? 1 : 0;
+			missedUniformCount += brickAligned && uniform && !reportedUniform ? 1 : 0;
+		}
+
+		V_CHECK(wrongUniformCount == 0);
+		V_CHECK(missedUniformCount == 0);
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestRoundTrip(storageType);
+		TestCloneCopyOnWrite(storageType);
+	}
+
+	TestCompactEncoding();
+	TestPlanarEditing();
+	TestMortonIndexing();
+	TestMaterialPalette();
+	TestPaletteUniformMaterial();
+
+	return Tests::VTestHelpers::Finish("VoxelStorageTest");
+}
@@ -0,0 +1,343 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelizerTestHelpers.h"
+#include "VoxelVolumeGrid.h"
+#include "VolumeConverter.h"
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	const uint8_t TILE_RESOLUTION = 3;
+	const int CELLS_PER_TILE = 1 << TILE_RESOLUTION;
+	const float TILE_EXTENDS = 40.f;
+
+	VObjectPtr<Voxel::VVoxelVolumeGrid> CreateGrid(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolumeGrid> grid = VObject::CreateObject<Voxel::VVoxelVolumeGrid>(TILE_RESOLUTION, TILE_EXTENDS, VIntVector(3, 2, 2), storageType);
+
+		Voxel::VVoxel fillVoxel;
+		fillVoxel.Density = 500.f;
+		fillVoxel.Material = 0;
+
+		grid->SetFillVoxel(fillVoxel);
+
+		return grid;
+	}
+
+	bool IsSameVoxel(const Voxel::VVoxel& voxel, const Voxel::VVoxel& other)
+	{
+		return voxel.Density == other.Density && voxel.Material == other.Material;
+	}
+
+	bool IsInTile(const VIntVector& voxelIndex, const VIntVector& tileIndex)
+	{
+		VIntVector local = voxelIndex - tileIndex * CELLS_PER_TILE;
+
+		return local >= VIntVector::ZERO && local <= VIntVector::ONE * CELLS_PER_TILE;
+	}
+
+	//Every loaded tile containing the voxel, found by testing all of them
+	std::vector<VIntVector> GetLoadedTilesContaining(VObjectPtr<Voxel::VVoxelVolumeGrid> grid, const VIntVector& voxelIndex)
+	{
+		std::vector<VIntVector> res;
+
+		for (const VIntVector& tileIndex : grid->GetLoadedTiles())
+		{
+			if (IsInTile(voxelIndex, tileIndex))
+			{
+				res.push_back(tileIndex);
+			}
+		}
+
+		return res;
+	}
+
+	Voxel::VVoxel GetTileVoxel(VObjectPtr<Voxel::VVoxelVolumeGrid> grid, const VIntVector& tileIndex, const VIntVector& voxelIndex)
+	{
+		return grid->GetTile(tileIndex)->GetVoxel(voxelIndex - grid->GetTileVoxelOffset(tileIndex));
+	}
+
+	//Number of grid voxels whose loaded tiles don't all hold the same voxel
+	int CountSeamMismatches(VObjectPtr<Voxel::VVoxelVolumeGrid> grid)
+	{
+		VIntVector size = grid->GetSize();
+		int mismatchCount = 0;
+
+		for (int x = 0; x < size.X; x++)
+		{
+			for (int y = 0; y < size.Y; y++)
+			{
+				for (int z = 0; z < size.Z; z++)
+				{
+					VIntVector voxelIndex(x, y, z);
+					std::vector<VIntVector> tiles = GetLoadedTilesContaining(grid, voxelIndex);
+
+					for (size_t i = 1; i < tiles.size(); i++)
+					{
+						mismatchCount += !IsSameVoxel(GetTileVoxel(grid, tiles[0], voxelIndex), GetTileVoxel(grid, tiles[i], voxelIndex)) ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		return mismatchCount;
+	}
+
+	//Only tiles that are written to are allocated, writes to shared voxels reach every tile sharing them
+	void TestSparseTiles()
+	{
+		VObjectPtr<Voxel::VVoxelVolumeGrid> grid = CreateGrid(Voxel::EVVoxelStorageType::Dense);
+
+		V_CHECK(grid->GetSize() == VIntVector(25, 17, 17));
+		V_CHECK(grid->GetLoadedTileCount() == 0);
+
+		Voxel::VVoxel voxel;
+		voxel.Density = -3.f;
+		voxel.Material = 1;
+
+		//The fill voxel doesn't need a tile
+		grid->SetVoxel(VIntVector(3, 3, 3), grid->GetFillVoxel());
+		V_CHECK(grid->GetLoadedTileCount() == 0);
+
+		grid->SetVoxel(VIntVector(3, 3, 3), voxel);
+		V_CHECK(grid->GetLoadedTileCount() == 1);
+		V_CHECK(grid->IsTileLoaded(VIntVector::ZERO));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(VIntVector(3, 3, 3)), voxel));
+
+		//Corner shared by eight tiles
+		VIntVector corner = VIntVector::ONE * CELLS_PER_TILE;
+		grid->SetVoxel(corner, voxel);
+
+		V_CHECK(grid->GetLoadedTileCount() == 8);
+
+		for (const VIntVector& tileIndex : grid->GetLoadedTiles())
+		{
+			V_CHECK(IsInTile(corner, tileIndex));
+			V_CHECK(IsSameVoxel(GetTileVoxel(grid, tileIndex, corner), voxel));
+		}
+
+		//Unloaded tiles and voxels outside of the grid read as the fill voxel
+		V_CHECK(!grid->IsTileLoaded(VIntVector(2, 0, 0)));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(VIntVector(20, 3, 3)), grid->GetFillVoxel()));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(VIntVector(25, 0, 0)), grid->GetFillVoxel()));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(VIntVector(-1, 0, 0)), grid->GetFillVoxel()));
+
+		//New tiles start with the borders of their loaded neighbors
+		VObjectPtr<Voxel::VVoxelVolume> tile = grid->AllocateTile(VIntVector(2, 1, 1));
+		V_CHECK(tile != nullptr);
+		V_CHECK(IsSameVoxel(GetTileVoxel(grid, VIntVector(1, 1, 1), VIntVector(16, 8, 8)), GetTileVoxel(grid, VIntVector(2, 1, 1), VIntVector(16, 8, 8))));
+		V_CHECK(CountSeamMismatches(grid) == 0);
+
+		V_CHECK(grid->AllocateTile(VIntVector(3, 0, 0)) == nullptr);
+	}
+
+	//Tiles written independently disagree on their borders until they are stitched, then every seam voxel holds the lowest density of all sides
+	void TestStitchBorders(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolumeGrid> grid = CreateGrid(storageType);
+		VIntVector tileCount = grid->GetTileCount();
+
+		for (int x = 0; x < tileCount.X; x++)
+		{
+			for (int y = 0; y < tileCount.Y; y++)
+			{
+				for (int z = 0; z < tileCount.Z; z++)
+				{
+					//One tile stays unloaded, the seams next to it are left alone
+					if (VIntVector(x, y, z) == VIntVector(2, 1, 0))
+					{
+						continue;
+					}
+
+					VObjectPtr<Voxel::VVoxelVolume> tile = grid->AllocateTile(VIntVector(x, y, z));
+					VIntVector offset = grid->GetTileVoxelOffset(VIntVector(x, y, z));
+
+					//Each tile sees a slightly shifted sphere, so all shared voxels differ between tiles
+					float shift = (x * 4 + y * 2 + z) * 0.5f;
+
+					for (int vx = 0; vx <= CELLS_PER_TILE; vx++)
+					{
+						for (int vy = 0; vy <= CELLS_PER_TILE; vy++)
+						{
+							for (int vz = 0; vz <= CELLS_PER_TILE; vz++)
+							{
+								VIntVector local(vx, vy, vz);
+
+								Voxel::VVoxel voxel;
+								voxel.Density = grid->VoxelIndexToRelativePosition(offset + local).Length() - 30.f + shift;
+								voxel.Material = voxel.Density <= 0.f ? 1 : 2;
+
+								tile->SetVoxel(local, voxel);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		V_CHECK(CountSeamMismatches(grid) > 0);
+
+		//Lowest voxel of every seam, from the values the storages actually kept
+		VIntVector size = grid->GetSize();
+		std::vector<Voxel::VVoxel> expected((size_t)size.X * size.Y * size.Z);
+
+		for (int x = 0; x < size.X; x++)
+		{
+			for (int y = 0; y < size.Y; y++)
+			{
+				for (int z = 0; z < size.Z; z++)
+				{
+					VIntVector voxelIndex(x, y, z);
+					Voxel::VVoxel& lowest = expected[VMathHelpers::Index3DTo1D(voxelIndex, size.Y, size.Z)];
+
+					lowest.Density = std::numeric_limits<float>::max();
+
+					for (const VIntVector& tileIndex : GetLoadedTilesContaining(grid, voxelIndex))
+					{
+						Voxel::VVoxel voxel = GetTileVoxel(grid, tileIndex, voxelIndex);
+
+						if (voxel.Density < lowest.Density || (voxel.Density == lowest.Density && voxel.Material > lowest.Material))
+						{
+							lowest = voxel;
+						}
+					}
+				}
+			}
+		}
+
+		grid->StitchBorders();
+
+		V_CHECK(CountSeamMismatches(grid) == 0);
+
+		//The narrow band reads stitched far field values back as its far field density, only the sides have to agree there
+		if (storageType == Voxel::EVVoxelStorageType::NarrowBand)
+		{
+			return;
+		}
+
+		int lowestMismatchCount = 0;
+
+		for (int x = 0; x < size.X; x++)
+		{
+			for (int y = 0; y < size.Y; y++)
+			{
+				for (int z = 0; z < size.Z; z++)
+				{
+					VIntVector voxelIndex(x, y, z);
+
+					if (!GetLoadedTilesContaining(grid, voxelIndex).empty())
+					{
+						lowestMismatchCount += !IsSameVoxel(grid->GetVoxel(voxelIndex), expected[VMathHelpers::Index3DTo1D(voxelIndex, size.Y, size.Z)]) ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		V_CHECK(lowestMismatchCount == 0);
+	}
+
+	//Tiles stream out and back in through their archives, volumes that don't fit the grid are rejected
+	void TestTileStreaming()
+	{
+		VObjectPtr<Voxel::VVoxelVolumeGrid> grid = CreateGrid(Voxel::EVVoxelStorageType::Brick);
+
+		Voxel::VVoxel voxel;
+		voxel.Density = -1.5f;
+		voxel.Material = 3;
+
+		VIntVector tileIndex(1, 0, 1);
+		VIntVector voxelIndex = grid->GetTileVoxelOffset(tileIndex) + VIntVector(2, 5, 7);
+
+		grid->SetVoxel(voxelIndex, voxel);
+
+		std::shared_ptr<VSerializationArchive> archive = grid->SerializeTile(tileIndex);
+		V_CHECK(archive != nullptr);
+		V_CHECK(grid->SerializeTile(VIntVector::ZERO) == nullptr);
+
+		grid->UnloadTile(tileIndex);
+		V_CHECK(!grid->IsTileLoaded(tileIndex));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(voxelIndex), grid->GetFillVoxel()));
+
+		V_CHECK(grid->LoadTile(tileIndex, L"", archive));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(voxelIndex), voxel));
+		V_CHECK(IsSameVoxel(grid->GetVoxel(voxelIndex + VIntVector::ONE), grid->GetFillVoxel()));
+
+		V_CHECK(!grid->LoadTile(tileIndex, VObject::CreateObject<Voxel::VVoxelVolume>(TILE_RESOLUTION + 1, TILE_EXTENDS)));
+		V_CHECK(!grid->LoadTile(tileIndex, VObject::CreateObject<Voxel::VVoxelVolume>(TILE_RESOLUTION, TILE_EXTENDS * 2)));
+		V_CHECK(!grid->LoadTile(VIntVector(0, 2, 0), VObject::CreateObject<Voxel::VVoxelVolume>(TILE_RESOLUTION, TILE_EXTENDS)));
+		V_CHECK(grid->LoadTile(VIntVector::ZERO, VObject::CreateObject<Voxel::VVoxelVolume>(TILE_RESOLUTION, TILE_EXTENDS)));
+	}
+
+	//A voxelized grid samples the same field as one volume with the resolution of the whole grid
+	void TestVoxelizedGrid()
+	{
+		Voxelizer::VMeshInfo mesh = Tests::VVoxelizerTestHelpers::CreateBoxMesh(VVector(1.f, 0.8f, 0.15f), "box_5");
+		Voxelizer::VTextureLibrary textureLib;
+
+		VObjectPtr<Voxel::VVoxelVolume> volume = Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh, textureLib, Voxel::EVVoxelStorageType::NarrowBand);
+		VObjectPtr<Voxel::VVoxelVolumeGrid> grid = Voxelizer::VVolumeConverter::ConvertMeshInfoToVolumeGrid(mesh, textureLib, 3, 4);
+
+		V_CHECK(grid->GetSize() == VIntVector::ONE * (int)volume->GetSize());
+		V_CHECK(std::abs(grid->GetCellSize() - volume->GetCellSize()) < 1e-5f);
+
+		//The flat box leaves the top and bottom layer of tiles empty
+		V_CHECK(grid->GetLoadedTileCount() == grid->GetTotalTileCount() / 2);
+
+		int voxelCount = (int)volume->GetSize();
+		int signMismatchCount = 0;
+		int surfaceMismatchCount = 0;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					Voxel::VVoxel expected = volume->GetVoxel(VIntVector(x, y, z));
+					Voxel::VVoxel actual = grid->GetVoxel(VIntVector(x, y, z));
+
+					signMismatchCount += (expected.Density <= 0.f) != (actual.Density <= 0.f) ? 1 : 0;
+
+					//Densities are normalized by the extraction threshold, the surface lies within one unit
+					if (std::abs(expected.Density) < 1.f)
+					{
+						surfaceMismatchCount += std::abs(expected.Density - actual.Density) > 1e-4f || expected.Material != actual.Material ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		V_CHECK(signMismatchCount == 0);
+		V_CHECK(surfaceMismatchCount == 0);
+		V_CHECK(CountSeamMismatches(grid) == 0);
+	}
+}
+
+int main()
+{
+	TestSparseTiles();
+
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestStitchBorders(storageType);
+	}
+
+	TestTileStreaming();
+	TestVoxelizedGrid();
+
+	return Tests::VTestHelpers::Finish("VoxelVolumeGridTest");
+}
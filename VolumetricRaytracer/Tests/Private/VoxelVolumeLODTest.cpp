@@ -0,0 +1,165 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelVolume.h"
+#include "NarrowBandVoxelStorage.h"
+#include "MathHelpers.h"
+#include <cfloat>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	//Each LOD voxel has to be the smallest density of the 3x3x3 footprint around voxel 2i of the finer level
+	int CountFootprintMismatches(const Voxel::VVoxelVolume& finer, const Voxel::VVoxelVolume& lod)
+	{
+		int mismatchCount = 0;
+		int lodSize = (int)lod.GetSize();
+		int finerMax = (int)finer.GetSize() - 1;
+
+		//Narrow band levels only keep the side of the surface outside their band
+		float farFieldDensity = lod.GetStorageType() == Voxel::EVVoxelStorageType::NarrowBand ?
+			lod.GetCellSize() * lod.GetDensityScale() * Voxel::VNarrowBandVoxelStorage::BAND_CELL_COUNT : FLT_MAX;
+
+		for (int x = 0; x < lodSize; x++)
+		{
+			for (int y = 0; y < lodSize; y++)
+			{
+				for (int z = 0; z < lodSize; z++)
+				{
+					VIntVector center = VIntVector(x, y, z) * 2;
+					VIntVector footprintMin = VIntVector::Max(center - VIntVector::ONE, 0);
+					VIntVector footprintMax = VIntVector::Min(center + VIntVector::ONE, finerMax);
+
+					float minDensity = finer.GetVoxel(center).Density;
+
+					for (int fx = footprintMin.X; fx <= footprintMax.X; fx++)
+					{
+						for (int fy = footprintMin.Y; fy <= footprintMax.Y; fy++)
+						{
+							for (int fz = footprintMin.Z; fz <= footprintMax.Z; fz++)
+							{
+								minDensity = VMathHelpers::Min(minDensity, finer.GetVoxel(VIntVector(fx, fy, fz)).Density);
+							}
+						}
+					}
+
+					float lodDensity = lod.GetVoxel(VIntVector(x, y, z)).Density;
+
+					if (std::abs(minDensity) >= farFieldDensity)
+					{
+						mismatchCount += std::abs(lodDensity) >= farFieldDensity && (lodDensity < 0) == (minDensity < 0) ? 0 : 1;
+					}
+					else
+					{
+						mismatchCount += lodDensity != minDensity ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		return mismatchCount;
+	}
+
+	void TestMinFilter(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType);
+		volume->GenerateLODs();
+
+		V_CHECK(volume->GetLODCount() == 4);
+		V_CHECK(!volume->AreLODsOutdated());
+		V_CHECK(volume->GetLOD(0) == nullptr);
+
+		const Voxel::VVoxelVolume* finer = volume.get();
+
+		for (size_t lod = 1; lod <= volume->GetLODCount(); lod++)
+		{
+			std::shared_ptr<const Voxel::VVoxelVolume> lodVolume = volume->GetLOD(lod);
+
+			V_CHECK(lodVolume != nullptr);
+			V_CHECK(lodVolume->GetSize() == (finer->GetSize() - 1) / 2 + 1);
+			V_CHECK(lodVolume->GetStorageType() == storageType);
+			V_CHECK(CountFootprintMismatches(*finer, *lodVolume) == 0);
+
+			finer = lodVolume.get();
+		}
+
+		volume->SetVoxel(VIntVector(0, 0, 0), Voxel::VVoxel());
+
+		V_CHECK(volume->AreLODsOutdated());
+	}
+
+	void TestSelectLOD()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, Voxel::EVVoxelStorageType::Dense);
+		volume->GenerateLODs(2);
+
+		V_CHECK(volume->GetLODCount() == 2);
+
+		//32 cells along the axis
+		V_CHECK(volume->SelectLOD(64.f) == 0);
+		V_CHECK(volume->SelectLOD(32.f) == 0);
+		V_CHECK(volume->SelectLOD(16.f) == 1);
+		V_CHECK(volume->SelectLOD(8.f) == 2);
+		V_CHECK(volume->SelectLOD(1.f) == 2);
+		V_CHECK(volume->SelectLOD(0.f) == 2);
+	}
+
+	void TestSerializedLODs()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(4, Voxel::EVVoxelStorageType::Dense);
+		volume->SetDensityLipschitzBound(1.f);
+		volume->GenerateLODs();
+
+		VObjectPtr<Voxel::VVoxelVolume> loaded = VObject::CreateObject<Voxel::VVoxelVolume>(1, 1.f);
+		loaded->Deserialize(L"", volume->Serialize());
+
+		V_CHECK(loaded->GetLODCount() == volume->GetLODCount());
+		V_CHECK(loaded->GetDensityLipschitzBound() == 1.f);
+
+		for (size_t lod = 1; lod <= volume->GetLODCount() && lod <= loaded->GetLODCount(); lod++)
+		{
+			std::shared_ptr<const Voxel::VVoxelVolume> expected = volume->GetLOD(lod);
+			std::shared_ptr<const Voxel::VVoxelVolume> actual = loaded->GetLOD(lod);
+
+			int mismatchCount = actual->GetSize() == expected->GetSize() ? 0 : 1;
+			size_t voxelCount = (size_t)expected->GetSize() * expected->GetSize() * expected->GetSize();
+
+			for (size_t i = 0; i < voxelCount && mismatchCount == 0; i++)
+			{
+				mismatchCount += actual->GetVoxel(i).Density != expected->GetVoxel(i).Density ? 1 : 0;
+			}
+
+			V_CHECK(mismatchCount == 0);
+		}
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		//Lossy storages quantize again at the coarser cell size, so their levels are not exact copies of finer voxels
+		if (storageType != Voxel::EVVoxelStorageType::Compact && storageType != Voxel::EVVoxelStorageType::Half)
+		{
+			TestMinFilter(storageType);
+		}
+	}
+
+	TestSelectLOD();
+	TestSerializedLODs();
+
+	return Tests::VTestHelpers::Finish("VoxelVolumeLODTest");
+}
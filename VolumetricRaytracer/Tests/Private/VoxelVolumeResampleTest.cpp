@@ -0,0 +1,228 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "TestHelpers.h"
+#include "VoxelVolume.h"
+#include "MathHelpers.h"
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	//Trilinear interpolation of the source at a position given in source voxels
+	float SampleTrilinear(const Voxel::VVoxelVolume& source, const VVector& position)
+	{
+		int sourceMax = (int)source.GetSize() - 1;
+
+		VIntVector min = VIntVector(VMathHelpers::Min((int)std::floor(position.X), sourceMax), VMathHelpers::Min((int)std::floor(position.Y), sourceMax), VMathHelpers::Min((int)std::floor(position.Z), sourceMax));
+		VVector t = VVector(position.X - min.X, position.Y - min.Y, position.Z - min.Z);
+
+		float density = 0;
+
+		for (const VIntVector& corner : Voxel::VCell::VOXEL_COORDS)
+		{
+			VIntVector voxelIndex = VIntVector::Min(min + corner, sourceMax);
+			float weight = (corner.X ? t.X : 1 - t.X) * (corner.Y ? t.Y : 1 - t.Y) * (corner.Z ? t.Z : 1 - t.Z);
+
+			density += weight * source.GetVoxel(voxelIndex).Density;
+		}
+
+		return density;
+	}
+
+	float GetFootprintMinDensity(const Voxel::VVoxelVolume& source, const VIntVector& center, const int& footprint)
+	{
+		VIntVector min = VIntVector::Max(center - VIntVector::ONE * footprint, 0);
+		VIntVector max = VIntVector::Min(center + VIntVector::ONE * footprint, (int)source.GetSize() - 1);
+
+		float minDensity = source.GetVoxel(center).Density;
+
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				for (int z = min.Z; z <= max.Z; z++)
+				{
+					minDensity = VMathHelpers::Min(minDensity, source.GetVoxel(VIntVector(x, y, z)).Density);
+				}
+			}
+		}
+
+		return minDensity;
+	}
+
+	bool IsLossless(const Voxel::EVVoxelStorageType& storageType)
+	{
+		return storageType != Voxel::EVVoxelStorageType::Compact && storageType != Voxel::EVVoxelStorageType::Half && storageType != Voxel::EVVoxelStorageType::NarrowBand;
+	}
+
+	void TestUpsampling(const Voxel::EVVoxelStorageType& storageType, const Voxel::EVResampleFilter& filter)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(4, storageType, 37.3f);
+		std::shared_ptr<const Voxel::VVoxelVolume> source = volume->CreateSnapshot();
+
+		V_CHECK(volume->ResampleTo(5, filter));
+		V_CHECK(volume->GetResolution() == 5);
+		V_CHECK(volume->GetSize() == (source->GetSize() - 1) * 2 + 1);
+		V_CHECK(volume->GetVolumeExtends() == source->GetVolumeExtends());
+		V_CHECK(std::abs(volume->GetCellSize() * 2 - source->GetCellSize()) < 1e-5f);
+		V_CHECK(volume->GetStorageType() == storageType);
+
+		int voxelCount = (int)volume->GetSize();
+		int signMismatchCount = 0;
+		int sourceMismatchCount = 0;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					Voxel::VVoxel voxel = volume->GetVoxel(VIntVector(x, y, z));
+
+					//The output is inside exactly where the trilinear interpolation of the source is, so the surface stays in place
+					float reference = SampleTrilinear(*source, VVector(x, y, z) * 0.5f);
+
+					if (std::abs(reference) > 1e-3f)
+					{
+						signMismatchCount += (voxel.Density < 0) != (reference < 0) ? 1 : 0;
+					}
+
+					//Both filters interpolate, voxels on top of source voxels keep their value
+					if (x % 2 == 0 && y % 2 == 0 && z % 2 == 0 && IsLossless(storageType))
+					{
+						Voxel::VVoxel sourceVoxel = source->GetVoxel(VIntVector(x, y, z) / 2);
+						sourceMismatchCount += std::abs(voxel.Density - sourceVoxel.Density) > 1e-4f || voxel.Material != sourceVoxel.Material ? 1 : 0;
+					}
+				}
+			}
+		}
+
+		V_CHECK(signMismatchCount == 0);
+		V_CHECK(sourceMismatchCount == 0);
+	}
+
+	void TestDownsampling(const Voxel::EVVoxelStorageType& storageType, const Voxel::EVResampleFilter& filter)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType, 37.3f);
+		std::shared_ptr<const Voxel::VVoxelVolume> source = volume->CreateSnapshot();
+
+		V_CHECK(volume->ResampleTo(4, filter));
+		V_CHECK(volume->GetSize() == (source->GetSize() - 1) / 2 + 1);
+
+		int voxelCount = (int)volume->GetSize();
+		int signMismatchCount = 0;
+
+		for (int x = 0; x < voxelCount; x++)
+		{
+			for (int y = 0; y < voxelCount; y++)
+			{
+				for (int z = 0; z < voxelCount; z++)
+				{
+					//Inside if any source voxel between the neighbouring output voxels is inside, thin bands must not disappear
+					float reference = GetFootprintMinDensity(*source, VIntVector(x, y, z) * 2, 1);
+					signMismatchCount += (volume->GetVoxel(VIntVector(x, y, z)).Density < 0) != (reference < 0) ? 1 : 0;
+				}
+			}
+		}
+
+		V_CHECK(signMismatchCount == 0);
+	}
+
+	//Both filters reproduce linear functions, so a linear field has to come out unchanged away from the clamped borders
+	void TestLinearField(const Voxel::EVResampleFilter& filter, const uint8_t& sourceResolution, const uint8_t& targetResolution)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(sourceResolution, 100.f);
+
+		auto linearField = [](const VVector& position)
+		{
+			return position.X * 0.5f - position.Y * 0.25f + position.Z + 3.f;
+		};
+
+		int sourceCount = (int)volume->GetSize();
+
+		for (int x = 0; x < sourceCount; x++)
+		{
+			for (int y = 0; y < sourceCount; y++)
+			{
+				for (int z = 0; z < sourceCount; z++)
+				{
+					Voxel::VVoxel voxel;
+					voxel.Density = linearField(volume->VoxelIndexToRelativePosition(VIntVector(x, y, z)));
+
+					volume->SetVoxel(VIntVector(x, y, z), voxel);
+				}
+			}
+		}
+
+		V_CHECK(volume->ResampleTo(targetResolution, filter));
+
+		int targetCount = (int)volume->GetSize();
+		int border = targetResolution > sourceResolution ? 4 : 2;
+		float maxError = 0;
+
+		for (int x = border; x < targetCount - border; x++)
+		{
+			for (int y = border; y < targetCount - border; y++)
+			{
+				for (int z = border; z < targetCount - border; z++)
+				{
+					VIntVector voxelIndex = VIntVector(x, y, z);
+					float expected = linearField(volume->VoxelIndexToRelativePosition(voxelIndex));
+
+					//Sign fixes replace the filtered value, only compare where the field is clearly on one side
+					if (std::abs(expected) > volume->GetCellSize() * 2)
+					{
+						maxError = VMathHelpers::Max(maxError, std::abs(volume->GetVoxel(voxelIndex).Density - expected));
+					}
+				}
+			}
+		}
+
+		V_CHECK(maxError < 1e-3f);
+	}
+
+	void TestResolutionLimits()
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(3, Voxel::EVVoxelStorageType::Dense);
+
+		V_CHECK(!volume->ResampleTo(Voxel::VVoxelVolume::MAX_RESOLUTION + 1));
+		V_CHECK(volume->GetResolution() == 3);
+
+		V_CHECK(volume->ResampleTo(3));
+		V_CHECK(volume->GetResolution() == 3);
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		for (Voxel::EVResampleFilter filter : { Voxel::EVResampleFilter::Trilinear, Voxel::EVResampleFilter::Tricubic })
+		{
+			TestUpsampling(storageType, filter);
+			TestDownsampling(storageType, filter);
+		}
+	}
+
+	for (Voxel::EVResampleFilter filter : { Voxel::EVResampleFilter::Trilinear, Voxel::EVResampleFilter::Tricubic })
+	{
+		TestLinearField(filter, 4, 5);
+		TestLinearField(filter, 5, 4);
+	}
+
+	TestResolutionLimits();
+
+	return Tests::VTestHelpers::Finish("VoxelVolumeResampleTest");
+}
@@ -0,0 +1,401 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "TestHelpers.h"
+#include "MathHelpers.h"
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+using namespace VolumeRaytracer;
+
+namespace
+{
+	//Node indices differ between a patched and a fresh octree, so only the trees reachable from the root are compared.
+	//Patched density bounds are only conservative, so the bounds are left out
+	bool IsSameReachableTree(const std::vector<Voxel::VCellGPUOctreeNode>& nodesA, const size_t& axisCountA, const size_t& indexA, const std::vector<Voxel::VCellGPUOctreeNode>& nodesB, const size_t& axisCountB, const size_t& indexB)
+	{
+		const Voxel::VCellGPUOctreeNode& nodeA = nodesA[indexA];
+		const Voxel::VCellGPUOctreeNode& nodeB = nodesB[indexB];
+
+		if (nodeA.IsLeaf != nodeB.IsLeaf)
+		{
+			return false;
+		}
+
+		if (nodeA.IsLeaf)
+		{
+			return nodeA.CellIndex == nodeB.CellIndex;
+		}
+
+		for (int i = 0; i < 8; i++)
+		{
+			size_t childA = VMathHelpers::Index3DTo1D(nodeA.Children[i], axisCountA, axisCountA);
+			size_t childB = VMathHelpers::Index3DTo1D(nodeB.Children[i], axisCountB, axisCountB);
+
+			if (!IsSameReachableTree(nodesA, axisCountA, childA, nodesB, axisCountB, childB))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void CarveSphere(Voxel::VVoxelVolume& volume, const VVector& center, const float& radius, const bool& add)
+	{
+		float margin = radius + volume.GetCellSize() * 2;
+		VIntVector min = VIntVector::Max(volume.RelativePositionToVoxelIndex(center - VVector::ONE * margin), VIntVector::ZERO);
+		VIntVector max = VIntVector::Min(volume.RelativePositionToVoxelIndex(center + VVector::ONE * margin), VIntVector::ONE * ((int)volume.GetSize() - 1));
+
+		volume.ParallelForEachVoxel(min, max, [&](const VIntVector& voxelIndex, Voxel::VVoxel& voxel) {
+			float distance = (volume.VoxelIndexToRelativePosition(voxelIndex) - center).Length() - radius;
+
+			if (add && distance < voxel.Density)
+			{
+				voxel.Density = distance;
+				voxel.Material = 2;
+			}
+			else if (!add && -distance > voxel.Density)
+			{
+				voxel.Density = -distance;
+			}
+		});
+	}
+
+	void TestSnapshotIsolation(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType);
+		std::shared_ptr<const Voxel::VVoxelVolume> snapshot = volume->CreateSnapshot();
+
+		VIntVector center = VIntVector::ONE * ((int)volume->GetSize() / 2);
+		Voxel::VVoxel before = snapshot->GetVoxel(center);
+
+		Voxel::VVoxel edit;
+		edit.Density = 12.f;
+		edit.Material = 3;
+
+		volume->SetVoxel(center, edit);
+
+		V_CHECK(snapshot->GetVoxel(center).Density == before.Density);
+		V_CHECK(snapshot->GetVoxel(center).Material == before.Material);
+		V_CHECK(volume->GetVoxel(center).Material == edit.Material);
+
+		//Box writes go through WriteBox, which has its own copy on write path in most storages
+		VIntVector boxMin = VIntVector::ZERO;
+		VIntVector boxMax = VIntVector::ONE * 9;
+
+		Voxel::VVoxelBox snapshotBefore;
+		snapshot->ReadVoxelBox(boxMin, boxMax, snapshotBefore);
+
+		volume->ParallelForEachVoxel(boxMin, boxMax, [](const VIntVector&, Voxel::VVoxel& voxel) {
+			voxel.Material = 5;
+		});
+
+		Voxel::VVoxelBox snapshotAfter;
+		snapshot->ReadVoxelBox(boxMin, boxMax, snapshotAfter);
+
+		int changedCount = 0;
+
+		for (size_t i = 0; i < snapshotBefore.Voxels.size(); i++)
+		{
+			changedCount += snapshotBefore.Voxels[i].Material != snapshotAfter.Voxels[i].Material || snapshotBefore.Voxels[i].Density != snapshotAfter.Voxels[i].Density ? 1 : 0;
+		}
+
+		V_CHECK(changedCount == 0);
+		V_CHECK(volume->GetVoxel(boxMax).Material == 5);
+
+		//Writing to the copy must not reach the snapshot either
+		std::shared_ptr<const Voxel::VVoxelVolume> second = volume->CreateSnapshot();
+		volume->SetVoxel(VIntVector::ZERO, edit);
+
+		V_CHECK(second->GetVoxel(VIntVector::ZERO).Material == 5);
+	}
+
+	//A taken snapshot owns the pending edits, later edits have to show up in the next one
+	void TestTakeSnapshotKeepsLaterEdits(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType);
+
+		std::shared_ptr<const Voxel::VVoxelVolume> first = volume->TakeSnapshot();
+
+		V_CHECK(first->IsDirty());
+		V_CHECK(first->GetDirtyRegionCount() == first->GetRegionCount());
+		V_CHECK(!volume->IsDirty());
+		V_CHECK(volume->GetDirtyRegionCount() == 0);
+
+		Voxel::VVoxel edit;
+		edit.Density = -3.f;
+		edit.Material = 4;
+
+		volume->SetVoxel(VIntVector(1, 2, 3), edit);
+
+		std::shared_ptr<const Voxel::VVoxelVolume> second = volume->TakeSnapshot();
+
+		std::vector<Voxel::VVoxelRegion> dirtyRegions;
+		second->GetDirtyRegions(dirtyRegions);
+
+		V_CHECK(second->IsDirty());
+		V_CHECK(dirtyRegions.size() == 1 && dirtyRegions[0].Min == VIntVector::ZERO);
+		V_CHECK(second->GetVoxel(VIntVector(1, 2, 3)).Material == edit.Material);
+		V_CHECK(first->GetVoxel(VIntVector(1, 2, 3)).Material != edit.Material);
+		V_CHECK(first->GetDirtyRegionCount() == first->GetRegionCount());
+	}
+
+	//Mirrors the render sync: every frame takes a snapshot and patches an octree the consumer owns
+	void TestIncrementalSyncThroughSnapshots(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(6, storageType);
+
+		std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
+		size_t nodeAxisCount = 0;
+
+		std::shared_ptr<Voxel::VLinearCellOctree> octree = volume->TakeSnapshot()->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> position(-60.f, 60.f);
+		std::uniform_real_distribution<float> radius(2.f, 15.f);
+
+		int incrementalFrames = 0;
+
+		for (int frame = 0; frame < 40; frame++)
+		{
+			CarveSphere(*volume, VVector(position(rng), position(rng), position(rng)), radius(rng), frame % 3 == 0);
+
+			std::shared_ptr<const Voxel::VVoxelVolume> snapshot = volume->TakeSnapshot();
+
+			//Edits after the snapshot belong to the next frame and are only uploaded if they stayed dirty
+			CarveSphere(*volume, VVector(position(rng), position(rng), position(rng)), radius(rng), true);
+
+			std::vector<Voxel::VLinearOctreeNodeRange> changedRanges;
+			std::vector<Voxel::VCellGPUOctreeNode> changedNodes;
+
+			//The live volume keeps its bitmap current, so the patch must not rebuild one on the snapshot
+			V_CHECK(!snapshot->IsSurfaceBitmapOutdated());
+
+			if (snapshot->UpdateGPUOctreeStructure(*octree, nodeAxisCount, changedRanges, changedNodes))
+			{
+				size_t changedNodeIndex = 0;
+
+				for (const Voxel::VLinearOctreeNodeRange& range : changedRanges)
+				{
+					//The traversal texture holds nodeAxisCount^3 nodes, new child blocks may land past the last built node
+					gpuNodes.resize(std::max(gpuNodes.size(), (size_t)range.FirstNode + range.NodeCount));
+
+					for (uint32_t i = 0; i < range.NodeCount; i++)
+					{
+						gpuNodes[range.FirstNode + i] = changedNodes[changedNodeIndex++];
+					}
+				}
+
+				incrementalFrames++;
+			}
+			else
+			{
+				gpuNodes.clear();
+				octree = snapshot->GenerateGPUOctreeStructure(gpuNodes, nodeAxisCount);
+			}
+
+			std::vector<Voxel::VCellGPUOctreeNode> referenceNodes;
+			size_t referenceAxisCount = 0;
+
+			snapshot->GenerateGPUOctreeStructure(referenceNodes, referenceAxisCount);
+
+			V_CHECK(IsSameReachableTree(gpuNodes, nodeAxisCount, 0, referenceNodes, referenceAxisCount, 0));
+
+			//Restoring marks the whole volume changed, so the reference builds its bitmap from scratch
+			VObjectPtr<Voxel::VVoxelVolume> reference = VObject::CreateObject<Voxel::VVoxelVolume>(volume->GetResolution(), volume->GetVolumeExtends(), storageType);
+			reference->RestoreSnapshot(snapshot);
+
+			V_CHECK(reference->IsSurfaceBitmapOutdated());
+			V_CHECK(snapshot->GetSurfaceBitmap().GetWords() == reference->GetSurfaceBitmap().GetWords());
+		}
+
+		V_CHECK(incrementalFrames > 0);
+	}
+
+	bool IsSameVoxelBox(const Voxel::VVoxelBox& box, const Voxel::VVoxelBox& other)
+	{
+		for (size_t i = 0; i < box.Voxels.size(); i++)
+		{
+			if (box.Voxels[i].Density != other.Voxels[i].Density || box.Voxels[i].Material != other.Voxels[i].Material)
+			{
+				return false;
+			}
+		}
+
+		return box.Voxels.size() == other.Voxels.size();
+	}
+
+	//An editor thread keeps writing while this thread takes snapshots like the render sync. Every box edit writes one value,
+	//so a snapshot has to see it completely or not at all, and must not change anymore once it is taken
+	void TestSnapshotsWhileEditing(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(5, storageType);
+
+		VIntVector volumeMax = VIntVector::ONE * ((int)volume->GetSize() - 1);
+		VIntVector editMin = VIntVector(3, 9, 5);
+		VIntVector editMax = VIntVector(20, 17, 12);
+
+		auto fillEditBox = [&](const int& edit) {
+			Voxel::VVoxel voxel;
+			voxel.Density = edit % 2 == 0 ? -1.f : 1.f;
+			voxel.Material = (uint8_t)(edit % 7 + 1);
+
+			volume->ParallelForEachVoxel(editMin, editMax, [voxel](const VIntVector&, Voxel::VVoxel& target) {
+				target = voxel;
+			});
+
+			return voxel;
+		};
+
+		//The sphere crosses the box, so the box is filled once before the first snapshot can see it
+		fillEditBox(0);
+
+		std::atomic<bool> snapshotsDone(false);
+		std::atomic<int> editCount(0);
+
+		std::thread editor([&]() {
+			for (int edit = 1; !snapshotsDone; edit++)
+			{
+				Voxel::VVoxel voxel = fillEditBox(edit);
+
+				volume->SetVoxel(VIntVector(edit % 30, 25, 27), voxel);
+
+				editCount++;
+			}
+		});
+
+		std::vector<std::shared_ptr<const Voxel::VVoxelVolume>> snapshots;
+		std::vector<Voxel::VVoxelBox> capturedVoxels;
+
+		int tornEditCount = 0;
+
+		for (int i = 0; i < 50; i++)
+		{
+			snapshots.push_back(volume->TakeSnapshot());
+			capturedVoxels.emplace_back();
+			snapshots.back()->ReadVoxelBox(VIntVector::ZERO, volumeMax, capturedVoxels.back());
+
+			Voxel::VVoxel first = snapshots.back()->GetVoxel(editMin);
+
+			for (int x = editMin.X; x <= editMax.X; x++)
+			{
+				for (int y = editMin.Y; y <= editMax.Y; y++)
+				{
+					for (int z = editMin.Z; z <= editMax.Z; z++)
+					{
+						Voxel::VVoxel voxel = snapshots.back()->GetVoxel(VIntVector(x, y, z));
+						tornEditCount += voxel.Density != first.Density || voxel.Material != first.Material ? 1 : 0;
+					}
+				}
+			}
+
+			std::this_thread::yield();
+		}
+
+		snapshotsDone = true;
+		editor.join();
+
+		V_CHECK(editCount > 0);
+		V_CHECK(tornEditCount == 0);
+
+		int changedSnapshotCount = 0;
+
+		for (size_t i = 0; i < snapshots.size(); i++)
+		{
+			Voxel::VVoxelBox voxels;
+			snapshots[i]->ReadVoxelBox(VIntVector::ZERO, volumeMax, voxels);
+
+			changedSnapshotCount += IsSameVoxelBox(voxels, capturedVoxels[i]) ? 0 : 1;
+		}
+
+		V_CHECK(changedSnapshotCount == 0);
+	}
+
+	//A snapshot requested during a lock free write waits for its end and then holds all of it
+	void TestSnapshotWaitsForConcurrentWrite(const Voxel::EVVoxelStorageType& storageType)
+	{
+		VObjectPtr<Voxel::VVoxelVolume> volume = Tests::VTestHelpers::CreateSphereVolume(4, storageType);
+
+		//Empty space far from the sphere, so every proposed voxel is the new minimum
+		VIntVector min = VIntVector::ZERO;
+		VIntVector max = VIntVector(3, 2, 3);
+
+		volume->BeginConcurrentWrite(min, max);
+
+		std::shared_ptr<const Voxel::VVoxelVolume> snapshot;
+
+		std::thread renderer([&]() {
+			snapshot = volume->TakeSnapshot();
+		});
+
+		//Gives the render thread the chance to ask for the snapshot before the writes start
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		Voxel::VVoxel voxel;
+		voxel.Density = -1.f;
+		voxel.Material = 6;
+
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				for (int z = min.Z; z <= max.Z; z++)
+				{
+					volume->AtomicMinVoxel(VIntVector(x, y, z), voxel);
+				}
+			}
+		}
+
+		volume->EndConcurrentWrite(min, max);
+		renderer.join();
+
+		int missingCount = 0;
+
+		for (int x = min.X; x <= max.X; x++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				for (int z = min.Z; z <= max.Z; z++)
+				{
+					missingCount += snapshot->GetVoxel(VIntVector(x, y, z)).Material != voxel.Material ? 1 : 0;
+				}
+			}
+		}
+
+		V_CHECK(missingCount == 0);
+	}
+}
+
+int main()
+{
+	for (Voxel::EVVoxelStorageType storageType : Tests::VTestHelpers::GetAllStorageTypes())
+	{
+		TestSnapshotIsolation(storageType);
+		TestSnapshotsWhileEditing(storageType);
+		TestSnapshotWaitsForConcurrentWrite(storageType);
+	}
+
+	for (Voxel::EVVoxelStorageType storageType : { Voxel::EVVoxelStorageType::Dense, Voxel::EVVoxelStorageType::Brick })
+	{
+		TestTakeSnapshotKeepsLaterEdits(storageType);
+		TestIncrementalSyncThroughSnapshots(storageType);
+	}
+
+	return Tests::VTestHelpers::Finish("VoxelVolumeSnapshotTest");
+}
\ No newline at end of file
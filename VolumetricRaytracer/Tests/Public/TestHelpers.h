@@ -0,0 +1,108 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "VoxelVolume.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Tests
+	{
+		class VTestHelpers
+		{
+		public:
+			static int& GetFailureCount()
+			{
+				static int failureCount = 0;
+				return failureCount;
+			}
+
+			static void ReportFailure(const char* file, const int& line, const char* expression)
+			{
+				std::cerr << file << "(" << line << "): check failed: " << expression << std::endl;
+				GetFailureCount()++;
+			}
+
+			//Prints the result and returns the process exit code
+			static int Finish(const char* testName)
+			{
+				if (GetFailureCount() == 0)
+				{
+					std::cout << testName << ": passed" << std::endl;
+					return 0;
+				}
+
+				std::cout << testName << ": " << GetFailureCount() << " checks failed" << std::endl;
+				return 1;
+			}
+
+			static double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+			{
+				return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			static std::vector<Voxel::EVVoxelStorageType> GetAllStorageTypes()
+			{
+				return { Voxel::EVVoxelStorageType::Dense, Voxel::EVVoxelStorageType::Brick, Voxel::EVVoxelStorageType::Compact, Voxel::EVVoxelStorageType::Planar,
+					Voxel::EVVoxelStorageType::Morton, Voxel::EVVoxelStorageType::NarrowBand, Voxel::EVVoxelStorageType::Palette, Voxel::EVVoxelStorageType::Half };
+			}
+
+			//Exact signed distance to a sphere around the volume center in a 2 cell band, everything else is empty space
+			static VObjectPtr<Voxel::VVoxelVolume> CreateSphereVolume(const uint8_t& resolution, const Voxel::EVVoxelStorageType& storageType, const float& radius = 40.f)
+			{
+				VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(resolution, 100.f, storageType);
+
+				Voxel::VVoxel emptyVoxel;
+				emptyVoxel.Density = 200.f;
+				emptyVoxel.Material = 0;
+
+				volume->FillVolume(emptyVoxel);
+
+				int voxelCount = (int)volume->GetSize();
+
+				for (int x = 0; x < voxelCount; x++)
+				{
+					for (int y = 0; y < voxelCount; y++)
+					{
+						for (int z = 0; z < voxelCount; z++)
+						{
+							VIntVector voxelIndex = VIntVector(x, y, z);
+							float distance = volume->VoxelIndexToRelativePosition(voxelIndex).Length() - radius;
+
+							if (std::abs(distance) < volume->GetCellSize() * 2)
+							{
+								Voxel::VVoxel voxel;
+								voxel.Density = distance;
+								voxel.Material = distance <= 0 ? 1 : 0;
+
+								volume->SetVoxel(voxelIndex, voxel);
+							}
+						}
+					}
+				}
+
+				return volume;
+			}
+		};
+	}
+}
+
+#define V_CHECK(expression) \
+	do { if (!(expression)) VolumeRaytracer::Tests::VTestHelpers::ReportFailure(__FILE__, __LINE__, #expression); } while (0)
@@ -0,0 +1,60 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "SceneInfo.h"
+#include <iterator>
+#include <string>
+
+namespace VolumeRaytracer
+{
+	namespace Tests
+	{
+		class VVoxelizerTestHelpers
+		{
+		public:
+			//Closed box with outward facing triangles. The name carries the resolution like meshes exported for the voxelizer
+			static Voxelizer::VMeshInfo CreateBoxMesh(const VVector& halfSize, const std::string& meshName)
+			{
+				Voxelizer::VMeshInfo mesh;
+				mesh.MeshName = meshName;
+				mesh.Bounds = VAABB(VVector::ZERO, halfSize);
+
+				for (int i = 0; i < 8; i++)
+				{
+					Voxelizer::VVertex vertex;
+					vertex.Position = VVector((i & 1) != 0 ? halfSize.X : -halfSize.X, (i & 2) != 0 ? halfSize.Y : -halfSize.Y, (i & 4) != 0 ? halfSize.Z : -halfSize.Z);
+					vertex.Normal = vertex.Position.GetNormalized();
+
+					mesh.Vertices.push_back(vertex);
+				}
+
+				//Two triangles per face, counter clockwise seen from outside
+				const size_t indices[] = {
+					0, 2, 1, 1, 2, 3,
+					4, 5, 6, 5, 7, 6,
+					0, 1, 4, 1, 5, 4,
+					2, 6, 3, 3, 6, 7,
+					0, 4, 2, 2, 4, 6,
+					1, 3, 5, 3, 7, 5
+				};
+
+				mesh.Indices.assign(std::begin(indices), std::end(indices));
+
+				return mesh;
+			}
+		};
+	}
+}
@@ -279,34 +279,25 @@ VolumeRaytracer::VObjectPtr<VolumeRaytracer::Scene::VVoxelObject> VolumeRaytrace
 
 	densityObj->GetRootShape().AddChild(sphere);
 
-	size_t voxelCount = voxelVolume->GetSize();
+	VIntVector maxVoxelIndex = VIntVector::ONE * ((int)voxelVolume->GetSize() - 1);
 
-	size_t volumeSize = voxelCount * voxelCount * voxelCount;
+	//Writes the whole volume as one box, SetVoxel would take the edit lock for every voxel and serialize the loop
+	voxelVolume->ParallelForEachVoxel(VIntVector::ZERO, maxVoxelIndex, [&](const VIntVector& voxelIndex, Voxel::VVoxel& outVoxel) {
+		VVector voxelPos = voxelVolume->VoxelIndexToRelativePosition(voxelIndex);
 
-#pragma omp parallel for collapse(3)
-	for (int x = 0; x < voxelCount; x++)
-	{
-		for (int y = 0; y < voxelCount; y++)
-		{
-			for (int z = 0; z < voxelCount; z++)
-			{
-				VIntVector voxelIndex = VIntVector(x, y, z);
-
-				VVector voxelPos = voxelVolume->VoxelIndexToRelativePosition(voxelIndex);
-
-				float density = densityObj->Evaluate(voxelPos);
+		float density = densityObj->Evaluate(voxelPos);
 
-				Voxel::VVoxel voxel;
+		outVoxel.Material = density <= 0 ? 1 : 0;
+		outVoxel.Density = density;
+	});
 
-				voxel.Material = density <= 0 ? 1 : 0;
-				voxel.Density = density;
+	voxelVolume->SetMaterial(material);
 
-				voxelVolume->SetVoxel(voxelIndex, voxel);
-			}
-		}
-	}
+	//The density generator evaluates exact signed distances, so the octree can store distance bounds for the traversal
+	voxelVolume->SetDensityLipschitzBound(1.f);
 
-	voxelVolume->SetMaterial(material);
+	//Lets the renderer trace distant spheres against coarser levels
+	voxelVolume->GenerateLODs();
 
 	VObjectPtr<Scene::VVoxelObject> sphereObj = Scene->SpawnObject<Scene::VVoxelObject>(VVector::ZERO, VQuat::IDENTITY, VVector::ONE);
 
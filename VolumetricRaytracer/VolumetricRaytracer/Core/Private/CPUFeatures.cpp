@@ -0,0 +1,130 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "CPUFeatures.h"
+
+#if defined(V_X64_CPU)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	struct VCPUFeatureFlags
+	{
+		bool AVX2 = false;
+		bool F16C = false;
+		bool FastBMI2 = false;
+	};
+
+#if defined(V_X64_CPU)
+	void CPUID(const uint32_t& leaf, const uint32_t& subLeaf, uint32_t outRegisters[4])
+	{
+#ifdef _MSC_VER
+		int registers[4];
+		__cpuidex(registers, (int)leaf, (int)subLeaf);
+		memcpy(outRegisters, registers, sizeof(registers));
+#else
+		__cpuid_count(leaf, subLeaf, outRegisters[0], outRegisters[1], outRegisters[2], outRegisters[3]);
+#endif
+	}
+
+	uint64_t ReadXCR0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t eax = 0;
+		uint32_t edx = 0;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((uint64_t)edx << 32) | eax;
+#endif
+	}
+#endif
+
+	VCPUFeatureFlags DetectFeatures()
+	{
+		VCPUFeatureFlags flags;
+
+#if defined(V_X64_CPU)
+		uint32_t registers[4] = {};
+
+		CPUID(0, 0, registers);
+
+		uint32_t maxLeaf = registers[0];
+		char vendor[13] = {};
+		memcpy(vendor, &registers[1], 4);
+		memcpy(vendor + 4, &registers[3], 4);
+		memcpy(vendor + 8, &registers[2], 4);
+
+		if (maxLeaf < 1)
+		{
+			return flags;
+		}
+
+		CPUID(1, 0, registers);
+
+		uint32_t baseFamily = (registers[0] >> 8) & 0xF;
+		uint32_t family = baseFamily == 0xF ? baseFamily + ((registers[0] >> 20) & 0xFF) : baseFamily;
+
+		//AVX registers are only usable if the OS saves the YMM state on context switches
+		bool osSavesYMM = (registers[2] & (1u << 27)) != 0 && (ReadXCR0() & 0x6) == 0x6;
+		bool avx = osSavesYMM && (registers[2] & (1u << 28)) != 0;
+
+		flags.F16C = avx && (registers[2] & (1u << 29)) != 0;
+
+		if (maxLeaf >= 7)
+		{
+			CPUID(7, 0, registers);
+
+			flags.AVX2 = avx && (registers[1] & (1u << 5)) != 0;
+
+			bool bmi2 = (registers[1] & (1u << 8)) != 0;
+			bool slowBMI2 = strcmp(vendor, "AuthenticAMD") == 0 && family < 0x19;
+
+			flags.FastBMI2 = bmi2 && !slowBMI2;
+		}
+#endif
+
+		return flags;
+	}
+
+	const VCPUFeatureFlags& GetFeatures()
+	{
+		static const VCPUFeatureFlags features = DetectFeatures();
+		return features;
+	}
+}
+
+bool VolumeRaytracer::VCPUFeatures::HasAVX2()
+{
+	return GetFeatures().AVX2;
+}
+
+bool VolumeRaytracer::VCPUFeatures::HasF16C()
+{
+	return GetFeatures().F16C;
+}
+
+bool VolumeRaytracer::VCPUFeatures::HasFastBMI2()
+{
+	return GetFeatures().FastBMI2;
+}
\ No newline at end of file
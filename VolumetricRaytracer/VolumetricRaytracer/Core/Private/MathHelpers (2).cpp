@@ -13,6 +13,64 @@
 */
 
 #include "MathHelpers.h"
+#include "CPUFeatures.h"
+#include <cstring>
+
+#if defined(V_X64_CPU)
+#include <immintrin.h>
+#endif
+
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define V_USE_F16C_CONVERSION
+#endif
+
+namespace
+{
+	const uint64_t MORTON_MASK_X = 0x1249249249249249ull;
+	const uint64_t MORTON_MASK_Y = MORTON_MASK_X << 1;
+	const uint64_t MORTON_MASK_Z = MORTON_MASK_X << 2;
+
+	uint64_t SpreadBits3(uint64_t v)
+	{
+		v &= 0x1fffff;
+		v = (v | v << 32) & 0x1f00000000ffffull;
+		v = (v | v << 16) & 0x1f0000ff0000ffull;
+		v = (v | v << 8) & 0x100f00f00f00f00full;
+		v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+		v = (v | v << 2) & 0x1249249249249249ull;
+
+		return v;
+	}
+
+	uint32_t CompactBits3(uint64_t v)
+	{
+		v &= 0x1249249249249249ull;
+		v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ull;
+		v = (v ^ (v >> 4)) & 0x100f00f00f00f00full;
+		v = (v ^ (v >> 8)) & 0x1f0000ff0000ffull;
+		v = (v ^ (v >> 16)) & 0x1f00000000ffffull;
+		v = (v ^ (v >> 32)) & 0x1fffff;
+
+		return (uint32_t)v;
+	}
+
+#if defined(V_X64_CPU)
+	V_TARGET_BMI2 uint64_t MortonEncodeBMI2(const uint32_t& x, const uint32_t& y, const uint32_t& z)
+	{
+		return _pdep_u64(x, MORTON_MASK_X) | _pdep_u64(y, MORTON_MASK_Y) | _pdep_u64(z, MORTON_MASK_Z);
+	}
+
+	V_TARGET_BMI2 void MortonDecodeBMI2(const uint64_t& code, uint32_t& outX, uint32_t& outY, uint32_t& outZ)
+	{
+		outX = (uint32_t)_pext_u64(code, MORTON_MASK_X);
+		outY = (uint32_t)_pext_u64(code, MORTON_MASK_Y);
+		outZ = (uint32_t)_pext_u64(code, MORTON_MASK_Z);
+	}
+
+	const bool USE_BMI2_MORTON = VolumeRaytracer::VCPUFeatures::HasFastBMI2();
+#endif
+}
 
 VolumeRaytracer::VIntVector VolumeRaytracer::VMathHelpers::Index1DTo3D(const size_t& index, const size_t& yCount, const size_t& zCount)
 {
@@ -25,9 +83,14 @@ VolumeRaytracer::VIntVector VolumeRaytracer::VMathHelpers::Index1DTo3D(const siz
 
 void VolumeRaytracer::VMathHelpers::Index1DTo3D(const size_t& index, const size_t& yCount, const size_t& zCount, int& outX, int& outY, int& outZ)
 {
-	outX = (index / (yCount * zCount));
-	outZ = ((index - outX * yCount * zCount) / yCount);
-	outY = (index - outX * yCount * zCount - outZ * yCount);
+	uint64_t sliceSize = (uint64_t)yCount * (uint64_t)zCount;
+	uint64_t x = (uint64_t)index / sliceSize;
+	uint64_t sliceIndex = (uint64_t)index - x * sliceSize;
+	uint64_t z = sliceIndex / (uint64_t)yCount;
+
+	outX = (int)x;
+	outZ = (int)z;
+	outY = (int)(sliceIndex - z * (uint64_t)yCount);
 }
 
 size_t VolumeRaytracer::VMathHelpers::Index3DTo1D(const VIntVector& index, const size_t& yCount, const size_t& zCount)
@@ -35,6 +98,149 @@ size_t VolumeRaytracer::VMathHelpers::Index3DTo1D(const VIntVector& index, const
 	return Index3DTo1D(index.X, index.Y, index.Z, yCount, zCount);
 }
 
+uint64_t VolumeRaytracer::VMathHelpers::MortonEncode3D(const uint32_t& x, const uint32_t& y, const uint32_t& z)
+{
+#if defined(V_X64_CPU)
+	if (USE_BMI2_MORTON)
+	{
+		return MortonEncodeBMI2(x, y, z);
+	}
+#endif
+
+	return SpreadBits3(x) | (SpreadBits3(y) << 1) | (SpreadBits3(z) << 2);
+}
+
+void VolumeRaytracer::VMathHelpers::MortonDecode3D(const uint64_t& code, uint32_t& outX, uint32_t& outY, uint32_t& outZ)
+{
+#if defined(V_X64_CPU)
+	if (USE_BMI2_MORTON)
+	{
+		MortonDecodeBMI2(code, outX, outY, outZ);
+		return;
+	}
+#endif
+
+	outX = CompactBits3(code);
+	outY = CompactBits3(code >> 1);
+	outZ = CompactBits3(code >> 2);
+}
+
+uint16_t VolumeRaytracer::VMathHelpers::FloatToHalf(const float& value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	if (magnitude >= 0x7F800000)
+	{
+		//Inf stays inf, nan gets quieted
+		return magnitude == 0x7F800000 ? sign | 0x7C00 : sign | 0x7E00 | ((magnitude >> 13) & 0x3FF);
+	}
+
+	//Everything from 65520 upwards rounds to inf
+	if (magnitude >= 0x477FF000)
+	{
+		return sign | 0x7C00;
+	}
+
+	uint32_t half = 0;
+	uint32_t remainder = 0;
+	uint32_t halfway = 0;
+
+	if (magnitude < 0x38800000)
+	{
+		//Result is a denormal half, everything up to 2^-25 rounds to zero
+		if (magnitude <= 0x33000000)
+		{
+			return sign;
+		}
+
+		const uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+		const uint32_t shift = 126 - (magnitude >> 23);
+
+		half = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else
+	{
+		half = (magnitude - 0x38000000) >> 13;
+		remainder = magnitude & 0x1FFF;
+		halfway = 0x1000;
+	}
+
+	if (remainder > halfway || (remainder == halfway && (half & 1)))
+	{
+		half++;
+	}
+
+	return sign | (uint16_t)half;
+}
+
+float VolumeRaytracer::VMathHelpers::HalfToFloat(const uint16_t& value)
+{
+	const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1F;
+	const uint32_t mantissa = value & 0x3FF;
+
+	uint32_t bits = 0;
+
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+	}
+	else if (exponent == 0)
+	{
+		float res = (float)mantissa * (1.f / 16777216.f);
+		return sign != 0 ? -res : res;
+	}
+	else
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+
+	float res;
+	memcpy(&res, &bits, sizeof(res));
+
+	return res;
+}
+
+void VolumeRaytracer::VMathHelpers::FloatToHalf(const float* values, uint16_t* outValues, const size_t& count)
+{
+	size_t i = 0;
+
+#ifdef V_USE_F16C_CONVERSION
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm_storeu_si128((__m128i*)(outValues + i), _mm256_cvtps_ph(_mm256_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		outValues[i] = FloatToHalf(values[i]);
+	}
+}
+
+void VolumeRaytracer::VMathHelpers::HalfToFloat(const uint16_t* values, float* outValues, const size_t& count)
+{
+	size_t i = 0;
+
+#ifdef V_USE_F16C_CONVERSION
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm256_storeu_ps(outValues + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(values + i))));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		outValues[i] = HalfToFloat(values[i]);
+	}
+}
+
 float VolumeRaytracer::VMathHelpers::ToRadians(float degrees)
 {
 	return degrees * (3.141592f / 180.f);
@@ -42,5 +248,5 @@ float VolumeRaytracer::VMathHelpers::ToRadians(float degrees)
 
 size_t VolumeRaytracer::VMathHelpers::Index3DTo1D(const int& x, const int& y, const int& z, const size_t& yCount, const size_t& zCount)
 {
-	return x * yCount * zCount + z * yCount + y;
+	return (size_t)((uint64_t)x * (uint64_t)yCount * (uint64_t)zCount + (uint64_t)z * (uint64_t)yCount + (uint64_t)y);
 }
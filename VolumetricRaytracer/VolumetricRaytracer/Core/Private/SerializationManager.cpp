@@ -15,12 +15,17 @@
 #include "SerializationManager.h"
 #include "ISerializable.h"
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <fstream>
 
 namespace VolumeRaytracer
 {
 	namespace Internal
 	{
+		//Child buffers are aligned to this inside the file so they can be used directly from a file mapping
+		const size_t BUFFER_ALIGNMENT = 16;
+
 		void SerializeArchive(const std::shared_ptr<VSerializationArchive>& archive, std::ofstream& stream)
 		{
 			stream.write(reinterpret_cast<char*>(&archive->BufferSize), sizeof(size_t));
@@ -38,8 +43,17 @@ namespace VolumeRaytracer
 
 				size_t numChars = propName.size() + 1;
 
+				//Pad the name with additional null terminators until the child buffer is aligned. Readers stop at the first terminator
+				size_t bufferOffset = (size_t)stream.tellp() + sizeof(size_t) + numChars + sizeof(size_t);
+				size_t padding = (BUFFER_ALIGNMENT - bufferOffset % BUFFER_ALIGNMENT) % BUFFER_ALIGNMENT;
+
+				std::string paddedName = propName;
+				paddedName.resize(numChars + padding, '\0');
+
+				numChars += padding;
+
 				stream.write(reinterpret_cast<char*>(&numChars), sizeof(size_t));
-				stream.write(propName.c_str(), numChars);
+				stream.write(paddedName.c_str(), numChars);
 
 				SerializeArchive(elem.second, stream);
 			}
@@ -97,6 +111,91 @@ namespace VolumeRaytracer
 
 			return res;
 		}
+
+		bool ReadFromMapping(const char* data, const size_t& dataSize, size_t& offset, void* dst, const size_t& size)
+		{
+			if (offset + size > dataSize || offset + size < offset)
+			{
+				return false;
+			}
+
+			memcpy(dst, data + offset, size);
+			offset += size;
+
+			return true;
+		}
+
+		std::shared_ptr<VSerializationArchive> DeserializeArchive(char* data, const size_t& dataSize, size_t& offset, const std::shared_ptr<void>& mappedFile)
+		{
+			std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+
+			size_t bufferSize = 0;
+
+			if (!ReadFromMapping(data, dataSize, offset, &bufferSize, sizeof(size_t)) || offset + bufferSize > dataSize || offset + bufferSize < offset)
+			{
+				return nullptr;
+			}
+
+			//Buffers are not copied. They point directly into the mapping
+			if (bufferSize > 0)
+			{
+				res->BufferSize = bufferSize;
+				res->Buffer = data + offset;
+				res->MappedFile = mappedFile;
+
+				offset += bufferSize;
+			}
+
+			size_t numProperties = 0;
+
+			if (!ReadFromMapping(data, dataSize, offset, &numProperties, sizeof(size_t)))
+			{
+				return nullptr;
+			}
+
+			for (size_t i = 0; i < numProperties; i++)
+			{
+				size_t strLength = 0;
+
+				if (!ReadFromMapping(data, dataSize, offset, &strLength, sizeof(size_t)) || offset + strLength > dataSize || offset + strLength < offset)
+				{
+					return nullptr;
+				}
+
+				std::string propertyName = std::string(data + offset, strnlen(data + offset, strLength));
+				offset += strLength;
+
+				std::shared_ptr<VSerializationArchive> propArchive = DeserializeArchive(data, dataSize, offset, mappedFile);
+
+				if (propArchive == nullptr)
+				{
+					return nullptr;
+				}
+
+				res->Properties[propertyName] = propArchive;
+			}
+
+			return res;
+		}
+
+		std::shared_ptr<VSerializationArchive> DeserializeMappedFile(const std::wstring& filePath)
+		{
+			try
+			{
+				boost::interprocess::file_mapping file = boost::interprocess::file_mapping(boost::filesystem::path(filePath).string().c_str(), boost::interprocess::read_only);
+
+				//Copy on write mapping. Pages are only copied by the OS if voxel data gets edited in place
+				std::shared_ptr<boost::interprocess::mapped_region> region = std::make_shared<boost::interprocess::mapped_region>(file, boost::interprocess::copy_on_write);
+
+				size_t offset = 0;
+
+				return DeserializeArchive(static_cast<char*>(region->get_address()), region->get_size(), offset, region);
+			}
+			catch (const boost::interprocess::interprocess_exception&)
+			{
+				return nullptr;
+			}
+		}
 	}
 }
 
@@ -104,12 +203,19 @@ bool VolumeRaytracer::VSerializationManager::LoadObjectFromFile(std::shared_ptr<
 {
 	if (boost::filesystem::exists(filePath))
 	{
-		std::ifstream stream = std::ifstream(filePath, std::ios::binary);
+		std::shared_ptr<VSerializationArchive> archive = Internal::DeserializeMappedFile(filePath);
 
-		std::shared_ptr<VSerializationArchive> archive = Internal::DeserializeArchive(stream);
-		obj->Deserialize(filePath, archive);
+		//Fall back to reading the file if it can't be mapped
+		if (archive == nullptr)
+		{
+			std::ifstream stream = std::ifstream(filePath, std::ios::binary);
 
-		stream.close();
+			archive = Internal::DeserializeArchive(stream);
+
+			stream.close();
+		}
+
+		obj->Deserialize(filePath, archive);
 
 		return true;
 	}
@@ -0,0 +1,44 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define V_X64_CPU
+#endif
+
+//Functions marked with these may use the instruction set without global compiler flags. Only call them after checking VCPUFeatures
+#if defined(V_X64_CPU) && (defined(__GNUC__) || defined(__clang__))
+#define V_TARGET_AVX2 __attribute__((target("avx2")))
+#define V_TARGET_F16C __attribute__((target("avx,f16c")))
+#define V_TARGET_BMI2 __attribute__((target("bmi2")))
+#else
+#define V_TARGET_AVX2
+#define V_TARGET_F16C
+#define V_TARGET_BMI2
+#endif
+
+namespace VolumeRaytracer
+{
+	//Instruction set extensions supported by the running CPU and OS. Checked once on first use
+	class VCPUFeatures
+	{
+	public:
+		static bool HasAVX2();
+		static bool HasF16C();
+		//pdep / pext, except on CPUs that microcode them (AMD before Zen 3) where the bit twiddling fallback is faster
+		static bool HasFastBMI2();
+	};
+}
\ No newline at end of file
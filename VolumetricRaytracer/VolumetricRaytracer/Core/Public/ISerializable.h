@@ -24,7 +24,7 @@ namespace VolumeRaytracer
 		VSerializationArchive() = default;
 		~VSerializationArchive()
 		{
-			if (Buffer != nullptr)
+			if (Buffer != nullptr && MappedFile == nullptr)
 			{
 				delete[] Buffer;
 				Buffer = nullptr;
@@ -57,10 +57,25 @@ namespace VolumeRaytracer
 			return res;
 		}
 
+		//Returns the buffer as T array if it points into a mapped file and is aligned, nullptr otherwise. The archive has to outlive the returned pointer
+		template<typename T>
+		T* GetMappedBufferAs(const size_t& elementCount)
+		{
+			if (MappedFile != nullptr && BufferSize >= elementCount * sizeof(T) && reinterpret_cast<uintptr_t>(Buffer) % alignof(T) == 0)
+			{
+				return reinterpret_cast<T*>(Buffer);
+			}
+
+			return nullptr;
+		}
+
 	public:
 		size_t BufferSize = 0;
 		char* Buffer = nullptr;
 
+		//Keeps the file mapping alive if Buffer points into it. The buffer is not owned by the archive in this case
+		std::shared_ptr<void> MappedFile = nullptr;
+
 		boost::unordered_map<std::string, std::shared_ptr<VSerializationArchive>> Properties;
 	};
 
@@ -26,6 +26,15 @@ namespace VolumeRaytracer
 		static size_t Index3DTo1D(const int& x, const int& y, const int& z, const size_t& yCount, const size_t& zCount);
 		static size_t Index3DTo1D(const VIntVector& index, const size_t& yCount, const size_t& zCount);
 
+		static uint64_t MortonEncode3D(const uint32_t& x, const uint32_t& y, const uint32_t& z);
+		static void MortonDecode3D(const uint64_t& code, uint32_t& outX, uint32_t& outY, uint32_t& outZ);
+
+		//IEEE half precision conversion, rounds to nearest even
+		static uint16_t FloatToHalf(const float& value);
+		static float HalfToFloat(const uint16_t& value);
+		static void FloatToHalf(const float* values, uint16_t* outValues, const size_t& count);
+		static void HalfToFloat(const uint16_t* values, float* outValues, const size_t& count);
+
 		static float ToRadians(float degrees);
 
 		template<typename T>
@@ -201,6 +201,11 @@ bool VolumeRaytracer::Renderer::DX::VDXRenderer::HasValidWindow() const
 	return WindowRenderTarget != nullptr;
 }
 
+unsigned int VolumeRaytracer::Renderer::DX::VDXRenderer::GetOutputHeight() const
+{
+	return HasValidWindow() ? WindowRenderTarget->GetHeight() : 0;
+}
+
 bool VolumeRaytracer::Renderer::DX::VDXRenderer::SetupRenderer()
 {
 	if (!IsActive())
@@ -34,6 +34,7 @@
 #include "../../Core/Public/MathHelpers.h"
 #include "Material.h"
 #include "VoxelVolume.h"
+#include <cmath>
 
 void VolumeRaytracer::Renderer::DX::VRDXScene::InitFromScene(std::weak_ptr<VRenderer> renderer, std::weak_ptr<Scene::VScene> scene)
 {
@@ -459,7 +460,7 @@ void VolumeRaytracer::Renderer::DX::VRDXScene::BuildTopLevelAccelerationStructur
 	{
 		std::weak_ptr<Voxel::VVoxelVolume> volume = dynamic_cast<Scene::IVRenderableObject*>(elem->GetObjectDesc().LevelObject)->GetVoxelVolume();
 
-		if (!volume.expired())
+		if (!volume.expired() && VoxelVolumes.find(volume.lock().get()) != VoxelVolumes.end())
 		{
 			std::shared_ptr<VDXVoxelVolume> dxVolume = VoxelVolumes[volume.lock().get()];
 
@@ -546,6 +547,12 @@ void VolumeRaytracer::Renderer::DX::VRDXScene::BuildTopLevelAccelerationStructur
 
 void VolumeRaytracer::Renderer::DX::VRDXScene::AddVoxelVolume(std::weak_ptr<VDXRenderer> renderer, Voxel::VVoxelVolume* voxelVolume)
 {
+	if (voxelVolume->GetResolution() > Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION)
+	{
+		V_LOG_ERROR("Voxel volume resolution exceeds the maximum render resolution of 8! Skipping volume");
+		return;
+	}
+
 	if (VoxelVolumes.find(voxelVolume) == VoxelVolumes.end())
 	{
 		VDXVoxelVolumeDesc volumeDesc;
@@ -775,6 +782,8 @@ void VolumeRaytracer::Renderer::DX::VRDXScene::UpdateSceneGeometry(std::weak_ptr
 		UpdateBLAS = true;
 	}
 
+	UpdateVoxelVolumeLODs(renderer, scene);
+
 	for (auto& elem : VoxelVolumes)
 	{
 		if (elem.second->NeedsUpdate())
@@ -817,6 +826,51 @@ void VolumeRaytracer::Renderer::DX::VRDXScene::UpdateSceneGeometry(std::weak_ptr
 	}
 }
 
+void VolumeRaytracer::Renderer::DX::VRDXScene::UpdateVoxelVolumeLODs(std::weak_ptr<VDXRenderer> renderer, std::weak_ptr<Scene::VScene> scene)
+{
+	unsigned int outputHeight = renderer.lock()->GetOutputHeight();
+
+	if (outputHeight == 0)
+	{
+		return;
+	}
+
+	VObjectPtr<Scene::VCamera> cam = scene.lock()->GetActiveCamera();
+
+	float pixelsPerUnitAtUnitDistance = outputHeight / (2.f * std::tan(DirectX::XMConvertToRadians(cam->FOVAngle) * 0.5f));
+
+	//A volume shared by several objects is uploaded once, so the largest instance on screen picks its level
+	boost::unordered_map<Voxel::VVoxelVolume*, float> projectedSizes;
+
+	for (auto& elem : ObjectsInScene)
+	{
+		Scene::VLevelObject* levelObject = elem->GetObjectDesc().LevelObject;
+		std::weak_ptr<Voxel::VVoxelVolume> volume = dynamic_cast<Scene::IVRenderableObject*>(levelObject)->GetVoxelVolume();
+
+		if (!volume.expired())
+		{
+			VAABB bounds = levelObject->GetBounds();
+
+			float radius = bounds.GetExtends().Length();
+			float distance = VMathHelpers::Max((bounds.GetCenterPosition() - cam->Position).Length() - radius, cam->NearClipPlane);
+
+			float& projectedSize = projectedSizes[volume.lock().get()];
+			projectedSize = VMathHelpers::Max(projectedSize, radius * 2.f / distance * pixelsPerUnitAtUnitDistance);
+		}
+	}
+
+	//Volumes without an object in the scene keep their level until one references them again
+	for (auto& elem : VoxelVolumes)
+	{
+		auto projectedSize = projectedSizes.find(elem.first);
+
+		if (projectedSize != projectedSizes.end())
+		{
+			elem.second->SetProjectedSize(projectedSize->second);
+		}
+	}
+}
+
 void VolumeRaytracer::Renderer::DX::VRDXScene::UpdateSceneObjects(std::weak_ptr<VDXRenderer> renderer, std::weak_ptr<Scene::VScene> scene)
 {
 	VObjectPtr<Scene::VScene> scenePtr = scene.lock();
@@ -19,6 +19,7 @@
 #include "VoxelVolume.h"
 #include "DXRenderer.h"
 #include "TextureFactory.h"
+#include <algorithm>
 
 VolumeRaytracer::Renderer::DX::VDXVoxelVolume::VDXVoxelVolume(std::weak_ptr<VDXRenderer> renderer, const VDXVoxelVolumeDesc& volumeDesc)
 {
@@ -34,7 +35,24 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateFromVoxelVolume(std::w
 {
 	if (!renderer.expired())
 	{
-		if (LastVoxelCount != Desc.Volume->GetSize())
+		VolumeSnapshot = Desc.Volume->TakeSnapshot();
+
+		//A level shares the extends of the volume and differs in voxel count, so switching levels always takes the full upload below
+		size_t lod = VolumeSnapshot->AreLODsOutdated() ? 0 : SelectedLOD;
+		std::shared_ptr<const Voxel::VVoxelVolume> lodVolume = VolumeSnapshot->GetLOD(lod);
+
+		if (lodVolume != nullptr)
+		{
+			VolumeSnapshot = lodVolume;
+		}
+		else
+		{
+			lod = 0;
+		}
+
+		UploadedLOD = lod;
+
+		if (LastVoxelCount != VolumeSnapshot->GetSize())
 		{
 			UpdateTraversalTexture(renderer);
 			UpdateVolumeTexture(renderer);
@@ -43,19 +61,21 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateFromVoxelVolume(std::w
 		}
 		else
 		{
-			if (Desc.Volume->IsDirty())
+			if (VolumeSnapshot->IsDirty())
 			{
 				UpdateTraversalTexture(renderer);
 				UpdateVolumeTexture(renderer);
 				UpdateGeometryConstantBuffer();
 			}
 
-			if (LastCellSize != Desc.Volume->GetCellSize())
+			if (LastCellSize != VolumeSnapshot->GetCellSize())
 			{
 				UpdateAABBBuffer();
 				UpdateGeometryConstantBuffer();
 			}
 		}
+
+		VolumeSnapshot = nullptr;
 	}
 }
 
@@ -64,9 +84,15 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::SetTextures(const VDXVoxelVo
 	TextureIndices = textureIndices;
 }
 
+void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::SetProjectedSize(const float& projectedSizeInPixels)
+{
+	//Edits reach the volume before its LODs are regenerated, until then only the volume itself is up to date
+	SelectedLOD = Desc.Volume->AreLODsOutdated() ? 0 : Desc.Volume->SelectLOD(projectedSizeInPixels);
+}
+
 bool VolumeRaytracer::Renderer::DX::VDXVoxelVolume::NeedsUpdate() const
 {
-	return Desc.Volume->IsDirty();
+	return Desc.Volume->IsDirty() || SelectedLOD != UploadedLOD;
 }
 
 const VolumeRaytracer::Renderer::DX::VDXVoxelVolumeDesc& VolumeRaytracer::Renderer::DX::VDXVoxelVolume::GetDesc() const
@@ -87,6 +113,7 @@ const VolumeRaytracer::Renderer::DX::VDXAccelerationStructureBuffers& VolumeRayt
 void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::InitFromVoxelVolume(std::weak_ptr<VDXRenderer> renderer, const VDXVoxelVolumeDesc& volumeDesc)
 {
 	Desc = volumeDesc;
+	VolumeSnapshot = Desc.Volume->TakeSnapshot();
 
 	AllocateAABBBuffer(renderer);
 	AllocateGeometryConstantBuffer(renderer);
@@ -97,6 +124,8 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::InitFromVoxelVolume(std::wea
 	UpdateAABBBuffer();
 	UpdateGeometryConstantBuffer();
 
+	VolumeSnapshot = nullptr;
+
 	CreateBottomLevelAccelerationStructure(renderer);
 }
 
@@ -110,6 +139,8 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::Cleanup()
 
 	VolumeTexture = nullptr;
 	TraversalTexture = nullptr;
+	TraversalOctree = nullptr;
+	VolumeSnapshot = nullptr;
 }
 
 void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::CreateBottomLevelAccelerationStructure(std::weak_ptr<VDXRenderer> renderer)
@@ -221,9 +252,25 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::AllocateGeometryConstantBuff
 void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateTraversalTexture(std::weak_ptr<VDXRenderer> renderer)
 {
 	std::vector<Voxel::VCellGPUOctreeNode> gpuNodes;
-	size_t gpuVolumeSize = 0;
+	std::vector<Voxel::VLinearOctreeNodeRange> changedRanges;
+	size_t gpuVolumeSize = LastTraversalNodeCount;
+
+	//Edits only patch the changed nodes, everything else rebuilds the whole traversal texture
+	bool incrementalUpdate = TraversalTexture && TraversalOctree && VolumeSnapshot->GetSize() == LastVoxelCount && 
+		VolumeSnapshot->UpdateGPUOctreeStructure(*TraversalOctree, gpuVolumeSize, changedRanges, gpuNodes);
+
+	if (!incrementalUpdate)
+	{
+		gpuNodes.clear();
+		TraversalOctree = VolumeSnapshot->GenerateGPUOctreeStructure(gpuNodes, gpuVolumeSize);
+
+		Voxel::VLinearOctreeNodeRange fullRange;
+		fullRange.FirstNode = 0;
+		fullRange.NodeCount = (uint32_t)gpuNodes.size();
 
-	Desc.Volume->GenerateGPUOctreeStructure(gpuNodes, gpuVolumeSize);
+		changedRanges.clear();
+		changedRanges.push_back(fullRange);
+	}
 
 	if (!TraversalTexture || gpuVolumeSize != LastTraversalNodeCount)
 	{
@@ -232,58 +279,23 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateTraversalTexture(std::
 
 	if (TraversalTexture && !renderer.expired())
 	{
+		if (changedRanges.empty())
+		{
+			return;
+		}
+
 		uint8_t* pixels = nullptr;
 		size_t arraySize = 0;
 
 		TraversalTexture->GetPixels(0, pixels, &arraySize);
 
-		size_t voxelCount = Desc.Volume->GetVoxelCount();
-		
-		VIntVector nodeIndex = VIntVector::ZERO;
+		size_t gpuNodeIndex = 0;
 
-		//#pragma omp parallel for
-		for (int i = 0; i < gpuNodes.size(); i++)
+		for (const Voxel::VLinearOctreeNodeRange& range : changedRanges)
 		{
-			const Voxel::VCellGPUOctreeNode& gpuNode = gpuNodes[i];
-			nodeIndex = VMathHelpers::Index1DTo3D(i, gpuVolumeSize, gpuVolumeSize);
-			nodeIndex = VIntVector(nodeIndex.Z, nodeIndex.X, nodeIndex.Y) * VIntVector(2, 8, 2);
-
-			if (gpuNode.IsLeaf)
-			{
-				for (int vi = 0; vi < 8; vi++)
-				{
-					VIntVector relVoxelIndex = Voxel::VCell::VOXEL_COORDS[vi];
-					relVoxelIndex = VIntVector(relVoxelIndex.Z, relVoxelIndex.X, relVoxelIndex.Y) * VIntVector(1, 4, 1);
-
-					size_t voxelIndex = VMathHelpers::Index3DTo1D(nodeIndex + relVoxelIndex, gpuVolumeSize * 8, gpuVolumeSize * 2);
-
-					//EncodeVoxel(gpuNode.Cell.Voxels[vi], pixels[voxelIndex], pixels[voxelIndex + 1], pixels[voxelIndex + 2]);
-					
-					VIntVector volumeIndex = gpuNode.CellIndex;
-
-					pixels[voxelIndex] = volumeIndex.X;
-					pixels[voxelIndex + 1] = volumeIndex.Y;
-					pixels[voxelIndex + 2] = volumeIndex.Z;
-					pixels[voxelIndex + 3] = 1;
-				}
-			}
-			else
+			for (size_t i = 0; i < range.NodeCount; i++, gpuNodeIndex++)
 			{
-				for (int ci = 0; ci < 8; ci++)
-				{
-					VIntVector childIndex3D = gpuNode.Children[ci] * VIntVector(2,2,2);
-					childIndex3D = VIntVector(childIndex3D.Z, childIndex3D.X, childIndex3D.Y);
-
-					VIntVector relNodeIndex = Voxel::VCell::VOXEL_COORDS[ci];
-					relNodeIndex = VIntVector(relNodeIndex.Z, relNodeIndex.X, relNodeIndex.Y) * VIntVector(1, 4, 1);
-
-					size_t nodePixelIndex = VMathHelpers::Index3DTo1D(nodeIndex + relNodeIndex, gpuVolumeSize * 8, gpuVolumeSize * 2);
-
-					pixels[nodePixelIndex] = (uint8_t)childIndex3D.Y;
-					pixels[nodePixelIndex + 1] = (uint8_t)childIndex3D.Z;
-					pixels[nodePixelIndex + 2] = (uint8_t)childIndex3D.X;
-					pixels[nodePixelIndex + 3] = 0;
-				}
+				EncodeOctreeNodeToTraversalTexture(gpuNodes[gpuNodeIndex], range.FirstNode + i, gpuVolumeSize, pixels);
 			}
 		}
 
@@ -293,9 +305,12 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateTraversalTexture(std::
 
 void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateVolumeTexture(std::weak_ptr<VDXRenderer> renderer)
 {
-	if (!VolumeTexture || Desc.Volume->GetSize() !=  LastVoxelCount)
+	bool fullUpdate = false;
+
+	if (!VolumeTexture || VolumeSnapshot->GetSize() !=  LastVoxelCount)
 	{
-		AllocateVolumeTexture(renderer, Desc.Volume->GetSize());
+		AllocateVolumeTexture(renderer, VolumeSnapshot->GetSize());
+		fullUpdate = true;
 	}
 
 	if (TraversalTexture && !renderer.expired())
@@ -305,21 +320,41 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateVolumeTexture(std::wea
 
 		VolumeTexture->GetPixels(0, pixels, &arraySize);
 
-		size_t voxelCount = Desc.Volume->GetVoxelCount();
-
-		//#pragma omp parallel for
-		for (int i = 0; i < voxelCount; i++)
+		if (fullUpdate || VolumeSnapshot->GetDirtyRegionCount() == VolumeSnapshot->GetRegionCount())
 		{
-			Voxel::VVoxel v = Desc.Volume->GetVoxel(i);
-
-			VIntVector voxelIndex3D = VMathHelpers::Index1DTo3D(i, Desc.Volume->GetSize(), Desc.Volume->GetSize());
+			size_t voxelCount = VolumeSnapshot->GetVoxelCount();
 
-			voxelIndex3D = VIntVector(voxelIndex3D.Z, voxelIndex3D.X * 4, voxelIndex3D.Y);
+			//#pragma omp parallel for
+			for (size_t i = 0; i < voxelCount; i++)
+			{
+				EncodeVoxelToVolumeTexture(VolumeSnapshot->GetVoxel(i), VMathHelpers::Index1DTo3D(i, VolumeSnapshot->GetSize(), VolumeSnapshot->GetSize()), pixels);
+			}
+		}
+		else
+		{
+			std::vector<Voxel::VVoxelRegion> dirtyRegions;
+			Voxel::VVoxelBox regionVoxels;
 
-			int pixelIndex = VMathHelpers::Index3DTo1D(voxelIndex3D, Desc.Volume->GetSize() * 4, Desc.Volume->GetSize());
+			VolumeSnapshot->GetDirtyRegions(dirtyRegions);
 
-			EncodeVoxel(v, pixels[pixelIndex], pixels[pixelIndex + 1], pixels[pixelIndex + 2]);
-			pixels[pixelIndex + 3] = v.Material;
+			for (const Voxel::VVoxelRegion& region : dirtyRegions)
+			{
+				if (VolumeSnapshot->ReadVoxelBox(region.Min, region.Max, regionVoxels))
+				{
+					for (int x = region.Min.X; x <= region.Max.X; x++)
+					{
+						for (int z = region.Min.Z; z <= region.Max.Z; z++)
+						{
+							const Voxel::VVoxel* row = regionVoxels.GetRow(x, z);
+
+							for (int y = region.Min.Y; y <= region.Max.Y; y++)
+							{
+								EncodeVoxelToVolumeTexture(row[y - region.Min.Y], VIntVector(x, y, z), pixels);
+							}
+						}
+					}
+				}
+			}
 		}
 
 		renderer.lock()->UploadToGPU(VolumeTexture);
@@ -332,7 +367,7 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateAABBBuffer()
 	{
 		D3D12_RAYTRACING_AABB dxAABB = {};
 
-		VAABB bounds = Desc.Volume->GetVolumeBounds();
+		VAABB bounds = VolumeSnapshot->GetVolumeBounds();
 
 		VVector min = bounds.GetMin();
 		VVector max = bounds.GetMax();
@@ -350,7 +385,7 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateAABBBuffer()
 		memcpy(mappedData, &dxAABB, sizeof(dxAABB));
 		AABBBuffer->Unmap(0, nullptr);
 		
-		LastCellSize = Desc.Volume->GetCellSize();
+		LastCellSize = VolumeSnapshot->GetCellSize();
 	}
 }
 
@@ -375,16 +410,16 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateGeometryConstantBuffer
 		GeometryCB->Map(0, &mapRange, reinterpret_cast<void**>(&dataPtr));
 
 		VGeometryConstantBuffer constantBufferData = VGeometryConstantBuffer();
-		VMaterial volumeMaterial = Desc.Volume->GetMaterial();
+		VMaterial volumeMaterial = VolumeSnapshot->GetMaterial();
 
 		constantBufferData.tint = DirectX::XMFLOAT4(volumeMaterial.AlbedoColor.R, volumeMaterial.AlbedoColor.G, volumeMaterial.AlbedoColor.B, volumeMaterial.AlbedoColor.A);
 		constantBufferData.roughness = volumeMaterial.Roughness;
 		constantBufferData.metallness = volumeMaterial.Metallic;
 		constantBufferData.k = std::pow(volumeMaterial.Roughness + 1, 2) / 8.f;
-		constantBufferData.voxelAxisCount = Desc.Volume->GetSize();
-		constantBufferData.volumeExtend = Desc.Volume->GetVolumeExtends();
+		constantBufferData.voxelAxisCount = VolumeSnapshot->GetSize();
+		constantBufferData.volumeExtend = VolumeSnapshot->GetVolumeExtends();
 		constantBufferData.distanceBtwVoxels = (constantBufferData.volumeExtend * 2) / (constantBufferData.voxelAxisCount - 1);
-		constantBufferData.octreeDepth = Desc.Volume->GetResolution();
+		constantBufferData.octreeDepth = VolumeSnapshot->GetResolution();
 		constantBufferData.albedoTexture = TextureIndices.AlbedoIndex;
 		constantBufferData.normalTexture = TextureIndices.NormalIndex;
 		constantBufferData.rmTexture = TextureIndices.RMIndex;
@@ -396,6 +431,61 @@ void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::UpdateGeometryConstantBuffer
 	}
 }
 
+void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::EncodeVoxelToVolumeTexture(const Voxel::VVoxel& voxel, const VIntVector& voxelIndex, uint8_t* pixels)
+{
+	VIntVector pixelIndex3D = VIntVector(voxelIndex.Z, voxelIndex.X * 4, voxelIndex.Y);
+
+	size_t pixelIndex = VMathHelpers::Index3DTo1D(pixelIndex3D, VolumeSnapshot->GetSize() * 4, VolumeSnapshot->GetSize());
+
+	EncodeVoxel(voxel, pixels[pixelIndex], pixels[pixelIndex + 1], pixels[pixelIndex + 2]);
+	pixels[pixelIndex + 3] = voxel.Material;
+}
+
+void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::EncodeOctreeNodeToTraversalTexture(const Voxel::VCellGPUOctreeNode& gpuNode, const size_t& nodeIndex, const size_t& gpuVolumeSize, uint8_t* pixels)
+{
+	VIntVector nodeIndex3D = VMathHelpers::Index1DTo3D(nodeIndex, gpuVolumeSize, gpuVolumeSize);
+	nodeIndex3D = VIntVector(nodeIndex3D.Z, nodeIndex3D.X, nodeIndex3D.Y) * VIntVector(2, 8, 2);
+
+	if (gpuNode.IsLeaf)
+	{
+		//Alpha marks leaves and carries their distance bound in whole cells, the shader skips that far past the node
+		uint8_t leafAlpha = 1 + (uint8_t)std::min(std::floor(gpuNode.DistanceBound), 254.f);
+
+		for (int vi = 0; vi < 8; vi++)
+		{
+			VIntVector relVoxelIndex = Voxel::VCell::VOXEL_COORDS[vi];
+			relVoxelIndex = VIntVector(relVoxelIndex.Z, relVoxelIndex.X, relVoxelIndex.Y) * VIntVector(1, 4, 1);
+
+			size_t voxelIndex = VMathHelpers::Index3DTo1D(nodeIndex3D + relVoxelIndex, gpuVolumeSize * 8, gpuVolumeSize * 2);
+
+			VIntVector volumeIndex = gpuNode.CellIndex;
+
+			pixels[voxelIndex] = volumeIndex.X;
+			pixels[voxelIndex + 1] = volumeIndex.Y;
+			pixels[voxelIndex + 2] = volumeIndex.Z;
+			pixels[voxelIndex + 3] = leafAlpha;
+		}
+	}
+	else
+	{
+		for (int ci = 0; ci < 8; ci++)
+		{
+			VIntVector childIndex3D = gpuNode.Children[ci] * VIntVector(2,2,2);
+			childIndex3D = VIntVector(childIndex3D.Z, childIndex3D.X, childIndex3D.Y);
+
+			VIntVector relNodeIndex = Voxel::VCell::VOXEL_COORDS[ci];
+			relNodeIndex = VIntVector(relNodeIndex.Z, relNodeIndex.X, relNodeIndex.Y) * VIntVector(1, 4, 1);
+
+			size_t nodePixelIndex = VMathHelpers::Index3DTo1D(nodeIndex3D + relNodeIndex, gpuVolumeSize * 8, gpuVolumeSize * 2);
+
+			pixels[nodePixelIndex] = (uint8_t)childIndex3D.Y;
+			pixels[nodePixelIndex + 1] = (uint8_t)childIndex3D.Z;
+			pixels[nodePixelIndex + 2] = (uint8_t)childIndex3D.X;
+			pixels[nodePixelIndex + 3] = 0;
+		}
+	}
+}
+
 void VolumeRaytracer::Renderer::DX::VDXVoxelVolume::EncodeVoxel(const Voxel::VVoxel& voxel, uint8_t& outR, uint8_t& outG, uint8_t& outB)
 {
 	float density = voxel.Density;
@@ -171,6 +171,7 @@ namespace VolumeRaytracer
 				void UploadToGPU(VObjectPtr<VTexture> texture) override;
 
 				bool HasValidWindow() const;
+				unsigned int GetOutputHeight() const;
 
 			private:
 				bool SetupRenderer();
@@ -149,6 +149,7 @@ namespace VolumeRaytracer
 				void UpdateLights(const unsigned int& backBufferIndex);
 
 				void UpdateSceneGeometry(std::weak_ptr<VDXRenderer> renderer, std::weak_ptr<Scene::VScene> scene);
+				void UpdateVoxelVolumeLODs(std::weak_ptr<VDXRenderer> renderer, std::weak_ptr<Scene::VScene> scene);
 				void UpdateSceneObjects(std::weak_ptr<VDXRenderer> renderer, std::weak_ptr<Scene::VScene> scene);
 
 				bool ContainsLevelObject(Scene::VLevelObject* levelObject) const;
@@ -16,6 +16,7 @@
 
 #include "DXHelper.h"
 #include "Object.h"
+#include "Vector.h"
 #include <memory>
 
 namespace VolumeRaytracer
@@ -24,6 +25,8 @@ namespace VolumeRaytracer
 	{
 		class VVoxelVolume;
 		class VVoxel;
+		class VLinearCellOctree;
+		struct VCellGPUOctreeNode;
 	}
 
 	namespace Renderer
@@ -59,6 +62,8 @@ namespace VolumeRaytracer
 
 				void UpdateFromVoxelVolume(std::weak_ptr<VDXRenderer> renderer);
 				void SetTextures(const VDXVoxelVolumeTextureIndices& textureIndices);
+				//Selects the LOD the next update uploads from the largest size an instance of the volume covers on screen
+				void SetProjectedSize(const float& projectedSizeInPixels);
 				bool NeedsUpdate() const;
 
 				const VDXVoxelVolumeDesc& GetDesc() const;
@@ -83,6 +88,8 @@ namespace VolumeRaytracer
 				void UpdateGeometryConstantBuffer();
 
 				void EncodeVoxel(const Voxel::VVoxel& voxel, uint8_t& outR, uint8_t& outG, uint8_t& outB);
+				void EncodeVoxelToVolumeTexture(const Voxel::VVoxel& voxel, const VIntVector& voxelIndex, uint8_t* pixels);
+				void EncodeOctreeNodeToTraversalTexture(const Voxel::VCellGPUOctreeNode& gpuNode, const size_t& nodeIndex, const size_t& gpuVolumeSize, uint8_t* pixels);
 
 			private:
 				VObjectPtr<VDXTexture3D> VolumeTexture = nullptr;
@@ -93,10 +100,16 @@ namespace VolumeRaytracer
 				VDXAccelerationStructureBuffers BLAS;
 
 				VDXVoxelVolumeDesc Desc;
+				//Uploads read from a snapshot that took over the pending edits of Desc.Volume. Edits made after it stay dirty for the next update.
+				//Only held during an update, so later edits don't have to copy the voxels it shares
+				std::shared_ptr<const Voxel::VVoxelVolume> VolumeSnapshot = nullptr;
+				std::shared_ptr<Voxel::VLinearCellOctree> TraversalOctree = nullptr;
 				VDXVoxelVolumeTextureIndices TextureIndices;
 				size_t LastVoxelCount;
 				size_t LastTraversalNodeCount;
 				float LastCellSize;
+				size_t SelectedLOD = 0;
+				size_t UploadedLOD = 0;
 
 				D3D12_RAYTRACING_GEOMETRY_DESC GeometryDesc;
 			};
@@ -16,6 +16,8 @@ struct VoxelOctreeNode
 {
 	float size;
 	float3 nodePos;
+	//No surface is closer to the node than this, 0 if unknown
+	float distanceBound;
 };
 
 int3 WorldSpaceToVoxelSpace(in float3 worldLocation)
@@ -182,6 +184,22 @@ int3 GoToNextVoxel(in Ray ray, in float3 voxelPos, in float cellSize, out float
 	return res;
 }
 
+//Same as GoToNextVoxel, but skips ahead as far as the distance bound of the node reaches from t
+int3 GoToNextNode(in Ray ray, in VoxelOctreeNode node, in float t, out float newT)
+{
+	int3 res = GoToNextVoxel(ray, node.nodePos, node.size, newT);
+
+	float boundT = t + node.distanceBound / length(ray.direction);
+
+	if (boundT > newT)
+	{
+		newT = boundT;
+		res = WorldSpaceToVoxelSpace(GetPositionAlongRay(ray, newT));
+	}
+
+	return res;
+}
+
 float CalculateCellExit(in Ray ray, in float3 cellPos, in float cellSize)
 {
 	float3 tMax = float3(100000, 100000, 100000);
@@ -290,12 +308,19 @@ inline bool IsCellIndexInsideOctreeNode(in int3 parentIndex, in int3 minNodeInde
 	}
 }
 
+//Leaves store 1 + their distance bound in cells in alpha, branches 0
+inline float GetLeafDistanceBound(in uint alpha)
+{
+	return (alpha - 1) * g_geometryCB[InstanceID()].distanceBtwVoxels;
+}
+
 VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 {
 	VoxelOctreeNode res =
 	{
 		0,
-		float3(-1,-1,-1)
+		float3(-1,-1,-1),
+		0
 	};
 
 	if (IsValidCell(cellIndex))
@@ -306,10 +331,13 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 		int3 currentNodeIndex = int3(0,0,0);
 		int3 currentNodePtr = int3(0,0,0);
 		
-		if (g_traversalVolume[instanceID][int3(0, 0, 0)].a == 1)
+		uint rootAlpha = g_traversalVolume[instanceID][int3(0, 0, 0)].a;
+
+		if (rootAlpha >= 1)
 		{
 			res.size = GetNodeSize(0);
 			res.nodePos = float3(1, 1, 1) * res.size * -0.5;
+			res.distanceBound = GetLeafDistanceBound(rootAlpha);
 			return res;
 		}
 		
@@ -331,10 +359,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n1.a == 1)
+				if (n1.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n1.rgb);
+					res.distanceBound = GetLeafDistanceBound(n1.a);
 						
 					return res;
 				}
@@ -351,10 +380,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n2.a == 1)
+				if (n2.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n2.rgb);
+					res.distanceBound = GetLeafDistanceBound(n2.a);
 						
 					return res;
 				}
@@ -371,10 +401,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n3.a == 1)
+				if (n3.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n3.rgb);
+					res.distanceBound = GetLeafDistanceBound(n3.a);
 						
 					return res;
 				}
@@ -391,10 +422,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n4.a == 1)
+				if (n4.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n4.rgb);
+					res.distanceBound = GetLeafDistanceBound(n4.a);
 						
 					return res;
 				}
@@ -411,10 +443,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n5.a == 1)
+				if (n5.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n5.rgb);
+					res.distanceBound = GetLeafDistanceBound(n5.a);
 						
 					return res;
 				}
@@ -431,10 +464,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n6.a == 1)
+				if (n6.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n6.rgb);
+					res.distanceBound = GetLeafDistanceBound(n6.a);
 						
 					return res;
 				}
@@ -451,10 +485,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n7.a == 1)
+				if (n7.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n7.rgb);
+					res.distanceBound = GetLeafDistanceBound(n7.a);
 						
 					return res;
 				}
@@ -471,10 +506,11 @@ VoxelOctreeNode GetOctreeNode(in int3 cellIndex)
 			
 			if (IsCellIndexInsideOctreeNode(currentNodeIndex, minNodeIndex, cellIndex, currentDepth, maxDepth, nodeCount))
 			{
-				if (n8.a == 1)
+				if (n8.a >= 1)
 				{
 					res.size = GetNodeSize(currentDepth);
 					res.nodePos = VoxelIndexToWorldSpace(n8.rgb);
+					res.distanceBound = GetLeafDistanceBound(n8.a);
 						
 					return res;
 				}
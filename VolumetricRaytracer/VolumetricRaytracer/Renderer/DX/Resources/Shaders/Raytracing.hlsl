@@ -251,7 +251,7 @@ void VRIntersection()
 					}
 				#endif
 				
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 				
 				//if (cell.v8 == -1.f)
 				//{
@@ -409,7 +409,7 @@ void VRIntersectionShadowRay()
 			[branch]
 			if (IsValidCell(currentVoxelPos))
 			{
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 
 				if (HasIsoSurfaceInsideCell(instance, currentVoxelPos))
 				{
@@ -353,7 +353,7 @@ void VRIntersectionShadowRay()
 			[branch]
 			if (IsValidVoxelIndex(currentVoxelPos))
 			{
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 				
 				if (GetVoxelDensity(currentVoxelPos, instance) <= 0.f)
 				{
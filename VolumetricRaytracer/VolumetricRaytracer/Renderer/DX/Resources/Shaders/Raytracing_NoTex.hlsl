@@ -247,7 +247,7 @@ void VRIntersection()
 					}
 				#endif
 				
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 				
 				//if (cell.v8 == -1.f)
 				//{
@@ -405,7 +405,7 @@ void VRIntersectionShadowRay()
 			[branch]
 			if (IsValidCell(currentVoxelPos))
 			{
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 
 				if (HasIsoSurfaceInsideCell(instance, currentVoxelPos))
 				{
@@ -164,7 +164,7 @@ void VRIntersection()
 					}
 				#endif
 				
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 				
 				//if (cell.v8 == -1.f)
 				//{
@@ -322,7 +322,7 @@ void VRIntersectionShadowRay()
 			[branch]
 			if (IsValidCell(currentVoxelPos))
 			{
-				nextVoxelPos = GoToNextVoxel(localRay, octreeNode.nodePos, octreeNode.size, cellExit);
+				nextVoxelPos = GoToNextNode(localRay, octreeNode, cellEnter, cellExit);
 
 				if (HasIsoSurfaceInsideCell(instance, currentVoxelPos))
 				{
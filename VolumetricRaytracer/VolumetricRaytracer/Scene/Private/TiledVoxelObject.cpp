@@ -0,0 +1,159 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "TiledVoxelObject.h"
+#include "VoxelObject.h"
+#include "Scene.h"
+#include "VoxelVolumeGrid.h"
+#include "MathHelpers.h"
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::SetVolumeGrid(VObjectPtr<Voxel::VVoxelVolumeGrid> grid)
+{
+	DestroyTileObjects();
+
+	VolumeGrid = grid;
+
+	RefreshTiles();
+}
+
+VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolumeGrid> VolumeRaytracer::Scene::VTiledVoxelObject::GetVolumeGrid() const
+{
+	return VolumeGrid;
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::RefreshTiles()
+{
+	std::shared_ptr<VScene> scene = GetScene().lock();
+
+	if (scene == nullptr || VolumeGrid == nullptr)
+	{
+		return;
+	}
+
+	TileObjects.resize(VolumeGrid->GetTotalTileCount());
+
+	VIntVector tileCount = VolumeGrid->GetTileCount();
+
+	for (size_t i = 0; i < TileObjects.size(); i++)
+	{
+		VIntVector tileIndex = VMathHelpers::Index1DTo3D(i, tileCount.Y, tileCount.Z);
+		VObjectPtr<Voxel::VVoxelVolume> tile = VolumeGrid->GetTile(tileIndex);
+
+		if (tile == nullptr)
+		{
+			if (TileObjects[i] != nullptr)
+			{
+				scene->DestroyObject(TileObjects[i]);
+				TileObjects[i] = nullptr;
+			}
+		}
+		else if (TileObjects[i] == nullptr)
+		{
+			TileObjects[i] = scene->SpawnObject<VVoxelObject>(GetTilePosition(tileIndex), Rotation, Scale);
+			TileObjects[i]->SetVoxelVolume(tile);
+		}
+		else if (TileObjects[i]->GetVoxelVolume().lock() != tile)
+		{
+			TileObjects[i]->SetVoxelVolume(tile);
+		}
+	}
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::UpdateTileTransforms()
+{
+	if (VolumeGrid == nullptr)
+	{
+		return;
+	}
+
+	VIntVector tileCount = VolumeGrid->GetTileCount();
+
+	for (size_t i = 0; i < TileObjects.size(); i++)
+	{
+		if (TileObjects[i] != nullptr)
+		{
+			TileObjects[i]->Position = GetTilePosition(VMathHelpers::Index1DTo3D(i, tileCount.Y, tileCount.Z));
+			TileObjects[i]->Rotation = Rotation;
+			TileObjects[i]->Scale = Scale;
+		}
+	}
+}
+
+std::vector<VolumeRaytracer::VObjectPtr<VolumeRaytracer::Scene::VVoxelObject>> VolumeRaytracer::Scene::VTiledVoxelObject::GetTileObjects() const
+{
+	std::vector<VObjectPtr<VVoxelObject>> res;
+
+	for (const auto& tileObject : TileObjects)
+	{
+		if (tileObject != nullptr)
+		{
+			res.push_back(tileObject);
+		}
+	}
+
+	return res;
+}
+
+VolumeRaytracer::VAABB VolumeRaytracer::Scene::VTiledVoxelObject::GetBounds() const
+{
+	if (VolumeGrid != nullptr)
+	{
+		return VAABB::Transform(VolumeGrid->GetGridBounds(), Position, Scale, Rotation);
+	}
+	else
+	{
+		return VLevelObject::GetBounds();
+	}
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::Initialize()
+{
+
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::BeginDestroy()
+{
+
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::OnSceneSet()
+{
+	RefreshTiles();
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::OnPendingSceneRemoval()
+{
+	DestroyTileObjects();
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Scene::VTiledVoxelObject::GetTilePosition(const VIntVector& tileIndex) const
+{
+	return Position + Rotation * (Scale * VolumeGrid->GetTileCenter(tileIndex));
+}
+
+void VolumeRaytracer::Scene::VTiledVoxelObject::DestroyTileObjects()
+{
+	std::shared_ptr<VScene> scene = GetScene().lock();
+
+	for (auto& tileObject : TileObjects)
+	{
+		if (tileObject != nullptr && scene != nullptr)
+		{
+			scene->DestroyObject(tileObject);
+		}
+	}
+
+	TileObjects.clear();
+}
\ No newline at end of file
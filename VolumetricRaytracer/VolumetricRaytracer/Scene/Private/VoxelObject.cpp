@@ -15,6 +15,7 @@
 #include "VoxelObject.h"
 #include "Scene.h"
 #include "VoxelVolume.h"
+#include <limits>
 
 void VolumeRaytracer::Scene::VVoxelObject::SetVoxelVolume(VObjectPtr<Voxel::VVoxelVolume> volume)
 {
@@ -84,6 +85,139 @@ VolumeRaytracer::VAABB VolumeRaytracer::Scene::VVoxelObject::GetBounds() const
 	}
 }
 
+void VolumeRaytracer::Scene::VVoxelObject::QueryPoints(const VVector* points, const size_t& count, Voxel::VVoxelDistanceResult* outResults)
+{
+	QuerySpheres(points, nullptr, count, outResults);
+}
+
+void VolumeRaytracer::Scene::VVoxelObject::QuerySpheres(const VVector* centers, const float* radii, const size_t& count, Voxel::VVoxelDistanceResult* outResults)
+{
+	VQueryTransform transform;
+
+	if (!GetQueryTransform(transform))
+	{
+		SetEmptyQueryResults(count, outResults);
+		return;
+	}
+
+	std::vector<VVector> localCenters(count);
+	std::vector<float> localRadii(radii != nullptr ? count : 0);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		localCenters[i] = transform.ToLocal(centers[i]);
+	}
+
+	for (size_t i = 0; i < localRadii.size(); i++)
+	{
+		localRadii[i] = radii[i] / transform.Scale;
+	}
+
+	VoxelVolume->QuerySpheres(localCenters.data(), radii != nullptr ? localRadii.data() : nullptr, count, outResults);
+
+	transform.ResultsToWorld(count, outResults);
+}
+
+void VolumeRaytracer::Scene::VVoxelObject::QueryCapsules(const VVector* starts, const VVector* ends, const float* radii, const size_t& count, Voxel::VVoxelDistanceResult* outResults)
+{
+	VQueryTransform transform;
+
+	if (!GetQueryTransform(transform))
+	{
+		SetEmptyQueryResults(count, outResults);
+		return;
+	}
+
+	std::vector<VVector> localStarts(count);
+	std::vector<VVector> localEnds(count);
+	std::vector<float> localRadii(radii != nullptr ? count : 0);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		localStarts[i] = transform.ToLocal(starts[i]);
+		localEnds[i] = transform.ToLocal(ends[i]);
+	}
+
+	for (size_t i = 0; i < localRadii.size(); i++)
+	{
+		localRadii[i] = radii[i] / transform.Scale;
+	}
+
+	VoxelVolume->QueryCapsules(localStarts.data(), localEnds.data(), radii != nullptr ? localRadii.data() : nullptr, count, outResults);
+
+	transform.ResultsToWorld(count, outResults);
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Scene::VVoxelObject::VQueryTransform::ToLocal(const VVector& point) const
+{
+	float x = point.X - Position.X;
+	float y = point.Y - Position.Y;
+	float z = point.Z - Position.Z;
+
+	return VVector(
+		Rows[0][0] * x + Rows[0][1] * y + Rows[0][2] * z,
+		Rows[1][0] * x + Rows[1][1] * y + Rows[1][2] * z,
+		Rows[2][0] * x + Rows[2][1] * y + Rows[2][2] * z);
+}
+
+void VolumeRaytracer::Scene::VVoxelObject::VQueryTransform::ResultsToWorld(const size_t& count, Voxel::VVoxelDistanceResult* results) const
+{
+	//Normals transform with the inverse transpose, which is the transpose of the rows
+	for (size_t i = 0; i < count; i++)
+	{
+		VVector n = results[i].Normal;
+
+		VVector worldNormal(
+			Rows[0][0] * n.X + Rows[1][0] * n.Y + Rows[2][0] * n.Z,
+			Rows[0][1] * n.X + Rows[1][1] * n.Y + Rows[2][1] * n.Z,
+			Rows[0][2] * n.X + Rows[1][2] * n.Y + Rows[2][2] * n.Z);
+
+		float length = worldNormal.Length();
+
+		results[i].Distance *= Scale;
+		results[i].Normal = length > 0.f ? worldNormal / length : VVector::ZERO;
+	}
+}
+
+bool VolumeRaytracer::Scene::VVoxelObject::GetQueryTransform(VQueryTransform& outTransform) const
+{
+	outTransform.Scale = VMathHelpers::Min(std::abs(Scale.X), VMathHelpers::Min(std::abs(Scale.Y), std::abs(Scale.Z)));
+
+	if (VoxelVolume == nullptr || !(outTransform.Scale > 0.f))
+	{
+		return false;
+	}
+
+	//Rotation as matrix rows so the per point transform is plain arithmetic
+	VQuat inverseRotation = Rotation.Inverse();
+
+	VVector localX = inverseRotation * VVector(1.f, 0.f, 0.f);
+	VVector localY = inverseRotation * VVector(0.f, 1.f, 0.f);
+	VVector localZ = inverseRotation * VVector(0.f, 0.f, 1.f);
+
+	const VVector axes[3] = { localX, localY, localZ };
+
+	for (int column = 0; column < 3; column++)
+	{
+		outTransform.Rows[0][column] = axes[column].X / Scale.X;
+		outTransform.Rows[1][column] = axes[column].Y / Scale.Y;
+		outTransform.Rows[2][column] = axes[column].Z / Scale.Z;
+	}
+
+	outTransform.Position = Position;
+
+	return true;
+}
+
+void VolumeRaytracer::Scene::VVoxelObject::SetEmptyQueryResults(const size_t& count, Voxel::VVoxelDistanceResult* outResults)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		outResults[i].Distance = std::numeric_limits<float>::max();
+		outResults[i].Normal = VVector::ZERO;
+	}
+}
+
 void VolumeRaytracer::Scene::VVoxelObject::Initialize()
 {
 	
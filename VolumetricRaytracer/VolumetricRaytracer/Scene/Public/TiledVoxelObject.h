@@ -0,0 +1,68 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "LevelObject.h"
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class VVoxelVolumeGrid;
+	}
+
+	namespace Scene
+	{
+		class VVoxelObject;
+
+		//Places a volume grid in the scene. Every loaded tile is rendered by its own voxel object which follows the transform of this object
+		class VTiledVoxelObject : public VLevelObject
+		{
+		public:
+			void SetVolumeGrid(VObjectPtr<Voxel::VVoxelVolumeGrid> grid);
+			VObjectPtr<Voxel::VVoxelVolumeGrid> GetVolumeGrid() const;
+
+			//Spawns objects for newly loaded tiles and destroys the ones of unloaded tiles. Call after streaming tiles in or out
+			void RefreshTiles();
+
+			//Moves the tile objects after Position, Rotation or Scale changed
+			void UpdateTileTransforms();
+
+			std::vector<VObjectPtr<VVoxelObject>> GetTileObjects() const;
+
+			VAABB GetBounds() const override;
+
+		protected:
+			void Initialize() override;
+			void BeginDestroy() override;
+
+			void OnSceneSet() override;
+			void OnPendingSceneRemoval() override;
+
+		private:
+			VVector GetTilePosition(const VIntVector& tileIndex) const;
+
+			void DestroyTileObjects();
+
+		private:
+			VObjectPtr<Voxel::VVoxelVolumeGrid> VolumeGrid;
+
+			//One entry per grid tile, null for tiles that are not loaded
+			std::vector<VObjectPtr<VVoxelObject>> TileObjects;
+		};
+	}
+}
\ No newline at end of file
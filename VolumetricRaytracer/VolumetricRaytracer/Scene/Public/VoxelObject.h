@@ -23,6 +23,7 @@ namespace VolumeRaytracer
 	namespace Voxel
 	{
 		class VVoxelVolume;
+		struct VVoxelDistanceResult;
 	}
 
 	namespace Scene
@@ -42,6 +43,27 @@ namespace VolumeRaytracer
 
 			VAABB GetBounds() const override;
 
+			//Batched world space distance queries, e.g. for particle collisions. Distances are scaled by the smallest scale component
+			void QueryPoints(const VVector* points, const size_t& count, Voxel::VVoxelDistanceResult* outResults);
+			void QuerySpheres(const VVector* centers, const float* radii, const size_t& count, Voxel::VVoxelDistanceResult* outResults);
+			void QueryCapsules(const VVector* starts, const VVector* ends, const float* radii, const size_t& count, Voxel::VVoxelDistanceResult* outResults);
+
+		private:
+			//World to volume space of the queries, scales distances by the smallest scale component
+			struct VQueryTransform
+			{
+			public:
+				VVector Position;
+				float Rows[3][3];
+				float Scale = 1.f;
+
+				VVector ToLocal(const VVector& point) const;
+				void ResultsToWorld(const size_t& count, Voxel::VVoxelDistanceResult* results) const;
+			};
+
+			bool GetQueryTransform(VQueryTransform& outTransform) const;
+			static void SetEmptyQueryResults(const size_t& count, Voxel::VVoxelDistanceResult* outResults);
+
 		private:
 			VObjectPtr<Voxel::VVoxelVolume> VoxelVolume;
 		protected:
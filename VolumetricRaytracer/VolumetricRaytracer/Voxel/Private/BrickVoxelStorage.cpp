@@ -0,0 +1,319 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "BrickVoxelStorage.h"
+#include <algorithm>
+#include <cassert>
+
+const size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::BRICK_SIZE;
+const size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::BRICK_VOXEL_COUNT;
+const uint32_t VolumeRaytracer::Voxel::VBrickVoxelStorage::INVALID_BRICK;
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VBrickVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Brick;
+}
+
+void VolumeRaytracer::Voxel::VBrickVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+	BrickCountAlongAxis = (VoxelCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+	FillVoxel = fillVoxel;
+
+	BrickPool.clear();
+	BrickPool.shrink_to_fit();
+
+	BrickTable.clear();
+	BrickTable.resize((uint64_t)BrickCountAlongAxis * BrickCountAlongAxis * BrickCountAlongAxis, INVALID_BRICK);
+}
+
+void VolumeRaytracer::Voxel::VBrickVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	size_t brickIndex = GetBrickIndex(voxelIndex);
+	uint32_t poolIndex = BrickTable[brickIndex];
+
+	if (poolIndex == INVALID_BRICK)
+	{
+		if (IsFillVoxel(voxel))
+		{
+			return;
+		}
+
+		poolIndex = AllocateBrick(brickIndex);
+	}
+
+	GetBrickVoxelsForEditing(poolIndex)[GetVoxelIndexInBrick(voxelIndex)] = voxel;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VBrickVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+	if (poolIndex == INVALID_BRICK)
+	{
+		return FillVoxel;
+	}
+
+	return GetBrickVoxels(poolIndex)[GetVoxelIndexInBrick(voxelIndex)];
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VBrickVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	return GetVoxel(VMathHelpers::Index1DTo3D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis));
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::GetAllocatedBytes() const
+{
+	return BrickTable.size() * sizeof(uint32_t) + BrickPool.size() * sizeof(VBrick);
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VBrickVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = BrickPool.size() * sizeof(VBrick);
+	res->Buffer = res->BufferSize > 0 ? new char[res->BufferSize] : nullptr;
+
+	for (size_t i = 0; i < BrickPool.size(); i++)
+	{
+		memcpy(res->Buffer + i * sizeof(VBrick), BrickPool[i]->Voxels, sizeof(VBrick));
+	}
+
+	std::shared_ptr<VSerializationArchive> brickTable = std::make_shared<VSerializationArchive>();
+	brickTable->BufferSize = BrickTable.size() * sizeof(uint32_t);
+	brickTable->Buffer = new char[brickTable->BufferSize];
+
+	memcpy(brickTable->Buffer, BrickTable.data(), brickTable->BufferSize);
+
+	res->Properties["BrickTable"] = brickTable;
+	res->Properties["FillVoxel"] = VSerializationArchive::From<VVoxel>(&FillVoxel);
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VBrickVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	FillVoxel = archive->Properties["FillVoxel"]->To<VVoxel>();
+
+	Allocate(voxelCountAlongAxis, FillVoxel);
+
+	std::shared_ptr<VSerializationArchive> brickTable = archive->Properties["BrickTable"];
+
+	memcpy(BrickTable.data(), brickTable->Buffer, VMathHelpers::Min(brickTable->BufferSize, BrickTable.size() * sizeof(uint32_t)));
+
+	BrickPool.resize(archive->BufferSize / sizeof(VBrick));
+
+	VBrick* mappedBricks = archive->GetMappedBufferAs<VBrick>(BrickPool.size());
+
+	for (size_t i = 0; i < BrickPool.size(); i++)
+	{
+		if (mappedBricks != nullptr)
+		{
+			//Bricks alias the mapped file and share ownership of the archive. GetBrickVoxelsForEditing copies them on first write
+			BrickPool[i] = std::shared_ptr<VBrick>(archive, mappedBricks + i);
+		}
+		else
+		{
+			BrickPool[i] = std::make_shared<VBrick>();
+			memcpy(BrickPool[i]->Voxels, archive->Buffer + i * sizeof(VBrick), sizeof(VBrick));
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VBrickVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			int y = min.Y;
+
+			while (y <= max.Y)
+			{
+				VIntVector voxelIndex = VIntVector(x, y, z);
+				int segmentLength = VMathHelpers::Min((int)(BRICK_SIZE - y % BRICK_SIZE), max.Y - y + 1);
+				uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+				if (poolIndex == INVALID_BRICK)
+				{
+					std::fill(outVoxels, outVoxels + segmentLength, FillVoxel);
+				}
+				else
+				{
+					memcpy(outVoxels, GetBrickVoxels(poolIndex) + GetVoxelIndexInBrick(voxelIndex), segmentLength * sizeof(VVoxel));
+				}
+
+				outVoxels += segmentLength;
+				y += segmentLength;
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VBrickVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			int y = min.Y;
+
+			while (y <= max.Y)
+			{
+				VIntVector voxelIndex = VIntVector(x, y, z);
+				int segmentLength = VMathHelpers::Min((int)(BRICK_SIZE - y % BRICK_SIZE), max.Y - y + 1);
+				size_t brickIndex = GetBrickIndex(voxelIndex);
+				uint32_t poolIndex = BrickTable[brickIndex];
+
+				if (poolIndex == INVALID_BRICK)
+				{
+					bool onlyFill = true;
+
+					for (int i = 0; i < segmentLength && onlyFill; i++)
+					{
+						onlyFill = IsFillVoxel(voxels[i]);
+					}
+
+					if (!onlyFill)
+					{
+						poolIndex = AllocateBrick(brickIndex);
+					}
+				}
+
+				if (poolIndex != INVALID_BRICK)
+				{
+					memcpy(GetBrickVoxelsForEditing(poolIndex) + GetVoxelIndexInBrick(voxelIndex), voxels, segmentLength * sizeof(VVoxel));
+				}
+
+				voxels += segmentLength;
+				y += segmentLength;
+			}
+		}
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	uint64_t brickCountAlongAxis = (voxelCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+
+	return brickCountAlongAxis * brickCountAlongAxis * brickCountAlongAxis * sizeof(uint32_t);
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::GetBrickCountAlongAxis() const
+{
+	return BrickCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::GetAllocatedBrickCount() const
+{
+	return BrickPool.size();
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::GetBrickIndex(const VIntVector& voxelIndex) const
+{
+	return VMathHelpers::Index3DTo1D(voxelIndex / BRICK_SIZE, BrickCountAlongAxis, BrickCountAlongAxis);
+}
+
+size_t VolumeRaytracer::Voxel::VBrickVoxelStorage::GetVoxelIndexInBrick(const VIntVector& voxelIndex) const
+{
+	return VMathHelpers::Index3DTo1D(voxelIndex.X % BRICK_SIZE, voxelIndex.Y % BRICK_SIZE, voxelIndex.Z % BRICK_SIZE, BRICK_SIZE, BRICK_SIZE);
+}
+
+uint32_t VolumeRaytracer::Voxel::VBrickVoxelStorage::AllocateBrick(const size_t& brickIndex)
+{
+	uint32_t poolIndex = (uint32_t)GetAllocatedBrickCount();
+
+	std::shared_ptr<VBrick> brick = std::make_shared<VBrick>();
+	std::fill(brick->Voxels, brick->Voxels + BRICK_VOXEL_COUNT, FillVoxel);
+
+	BrickPool.push_back(brick);
+	BrickTable[brickIndex] = poolIndex;
+
+	return poolIndex;
+}
+
+const VolumeRaytracer::Voxel::VVoxel* VolumeRaytracer::Voxel::VBrickVoxelStorage::GetBrickVoxels(const uint32_t& poolIndex) const
+{
+	return BrickPool[poolIndex]->Voxels;
+}
+
+VolumeRaytracer::Voxel::VVoxel* VolumeRaytracer::Voxel::VBrickVoxelStorage::GetBrickVoxelsForEditing(const uint32_t& poolIndex)
+{
+	std::shared_ptr<VBrick>& brick = BrickPool[poolIndex];
+
+	//Brick is still referenced by a snapshot. Copy it before writing
+	if (brick.use_count() > 1)
+	{
+		brick = std::make_shared<VBrick>(*brick);
+	}
+
+	return brick->Voxels;
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VBrickVoxelStorage::Clone() const
+{
+	return std::make_shared<VBrickVoxelStorage>(*this);
+}
+
+bool VolumeRaytracer::Voxel::VBrickVoxelStorage::IsFillVoxel(const VVoxel& voxel) const
+{
+	return voxel.Material == FillVoxel.Material && voxel.Density == FillVoxel.Density;
+}
+
+bool VolumeRaytracer::Voxel::VBrickVoxelStorage::AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+	//Allocating a brick is not thread safe, so PrepareConcurrentWrite has to allocate every brick that gets written
+	assert(poolIndex != INVALID_BRICK && "AtomicMinVoxel outside of a prepared region");
+
+	if (poolIndex == INVALID_BRICK)
+	{
+		return false;
+	}
+
+	return AtomicMinVoxelInPlace(BrickPool[poolIndex]->Voxels[GetVoxelIndexInBrick(voxelIndex)], voxel);
+}
+
+void VolumeRaytracer::Voxel::VBrickVoxelStorage::PrepareConcurrentWrite(const VIntVector& min, const VIntVector& max)
+{
+	VIntVector minBrick = VIntVector::Max(min, 0) / BRICK_SIZE;
+	VIntVector maxBrick = VIntVector::Min(max, (int)VoxelCountAlongAxis - 1) / BRICK_SIZE;
+
+	for (int x = minBrick.X; x <= maxBrick.X; x++)
+	{
+		for (int z = minBrick.Z; z <= maxBrick.Z; z++)
+		{
+			for (int y = minBrick.Y; y <= maxBrick.Y; y++)
+			{
+				size_t brickIndex = VMathHelpers::Index3DTo1D(x, y, z, BrickCountAlongAxis, BrickCountAlongAxis);
+				uint32_t poolIndex = BrickTable[brickIndex];
+
+				if (poolIndex == INVALID_BRICK)
+				{
+					AllocateBrick(brickIndex);
+				}
+				else
+				{
+					//Detach bricks shared with snapshots so concurrent writes don't have to copy
+					GetBrickVoxelsForEditing(poolIndex);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,104 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "CompactVoxelStorage.h"
+
+static_assert(sizeof(VolumeRaytracer::Voxel::VCompactVoxel) == 4, "VCompactVoxel is expected to be 4 bytes");
+
+VolumeRaytracer::Voxel::VCompactVoxelStorage::VCompactVoxelStorage(const float& cellSize)
+	: CellSize(cellSize)
+{}
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VCompactVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Compact;
+}
+
+void VolumeRaytracer::Voxel::VCompactVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+
+	Voxels = std::make_shared<std::vector<VCompactVoxel>>((uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis, VCompactVoxel::FromVoxel(fillVoxel, CellSize));
+}
+
+void VolumeRaytracer::Voxel::VCompactVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	MakeVoxelsUnique();
+
+	(*Voxels)[VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis)] = VCompactVoxel::FromVoxel(voxel, CellSize);
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VCompactVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	return (*Voxels)[VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis)].ToVoxel(CellSize);
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VCompactVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	return (*Voxels)[voxelIndex].ToVoxel(CellSize);
+}
+
+size_t VolumeRaytracer::Voxel::VCompactVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VCompactVoxelStorage::GetAllocatedBytes() const
+{
+	return Voxels != nullptr ? Voxels->size() * sizeof(VCompactVoxel) : 0;
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VCompactVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = Voxels->size() * sizeof(VCompactVoxel);
+	res->Buffer = new char[res->BufferSize];
+
+	memcpy(res->Buffer, Voxels->data(), res->BufferSize);
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VCompactVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	Allocate(voxelCountAlongAxis, VVoxel());
+
+	size_t bufferSize = VMathHelpers::Min(archive->BufferSize, Voxels->size() * sizeof(VCompactVoxel));
+
+	memcpy(Voxels->data(), archive->Buffer, bufferSize);
+}
+
+size_t VolumeRaytracer::Voxel::VCompactVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	return (uint64_t)voxelCountAlongAxis * voxelCountAlongAxis * voxelCountAlongAxis * sizeof(VCompactVoxel);
+}
+
+const VolumeRaytracer::Voxel::VCompactVoxel* VolumeRaytracer::Voxel::VCompactVoxelStorage::GetCompactVoxels() const
+{
+	return Voxels->data();
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VCompactVoxelStorage::Clone() const
+{
+	//Shares the voxels, the first write on either side copies them
+	return std::make_shared<VCompactVoxelStorage>(*this);
+}
+
+void VolumeRaytracer::Voxel::VCompactVoxelStorage::MakeVoxelsUnique()
+{
+	if (Voxels.use_count() > 1)
+	{
+		Voxels = std::make_shared<std::vector<VCompactVoxel>>(*Voxels);
+	}
+}
@@ -0,0 +1,164 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "DenseVoxelStorage.h"
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VDenseVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Dense;
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+
+	Voxels = std::make_shared<std::vector<VVoxel>>((uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis, fillVoxel);
+
+	VoxelData = Voxels->data();
+	MappedArchive = nullptr;
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	MakeVoxelsUnique();
+
+	VoxelData[VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis)] = voxel;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VDenseVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	return VoxelData[VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis)];
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VDenseVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	return VoxelData[voxelIndex];
+}
+
+size_t VolumeRaytracer::Voxel::VDenseVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VDenseVoxelStorage::GetAllocatedBytes() const
+{
+	return Voxels != nullptr ? Voxels->size() * sizeof(VVoxel) : 0;
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VDenseVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = (uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis * sizeof(VVoxel);
+	res->Buffer = new char[res->BufferSize];
+
+	memcpy(res->Buffer, VoxelData, res->BufferSize);
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	size_t rowLength = max.Y - min.Y + 1;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			memcpy(outVoxels, &VoxelData[VMathHelpers::Index3DTo1D(x, min.Y, z, VoxelCountAlongAxis, VoxelCountAlongAxis)], rowLength * sizeof(VVoxel));
+			outVoxels += rowLength;
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	MakeVoxelsUnique();
+
+	size_t rowLength = max.Y - min.Y + 1;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			memcpy(&VoxelData[VMathHelpers::Index3DTo1D(x, min.Y, z, VoxelCountAlongAxis, VoxelCountAlongAxis)], voxels, rowLength * sizeof(VVoxel));
+			voxels += rowLength;
+		}
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VDenseVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	return (uint64_t)voxelCountAlongAxis * voxelCountAlongAxis * voxelCountAlongAxis * sizeof(VVoxel);
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	uint64_t voxelCount = (uint64_t)voxelCountAlongAxis * voxelCountAlongAxis * voxelCountAlongAxis;
+	VVoxel* mappedVoxels = archive->GetMappedBufferAs<VVoxel>(voxelCount);
+
+	if (mappedVoxels != nullptr)
+	{
+		//Use the voxels in place. The mapping is copy on write so edits don't reach the file
+		VoxelCountAlongAxis = voxelCountAlongAxis;
+
+		Voxels = nullptr;
+
+		VoxelData = mappedVoxels;
+		MappedArchive = archive;
+	}
+	else
+	{
+		Allocate(voxelCountAlongAxis, VVoxel());
+
+		memcpy(VoxelData, archive->Buffer, VMathHelpers::Min(archive->BufferSize, voxelCount * sizeof(VVoxel)));
+	}
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VDenseVoxelStorage::Clone() const
+{
+	//Shares the voxels or the mapping, the first write on either side copies them
+	std::shared_ptr<VDenseVoxelStorage> res = std::make_shared<VDenseVoxelStorage>();
+	res->VoxelCountAlongAxis = VoxelCountAlongAxis;
+	res->Voxels = Voxels;
+	res->VoxelData = VoxelData;
+	res->MappedArchive = MappedArchive;
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::PrepareConcurrentWrite(const VIntVector&, const VIntVector&)
+{
+	MakeVoxelsUnique();
+}
+
+bool VolumeRaytracer::Voxel::VDenseVoxelStorage::AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	return AtomicMinVoxelInPlace(VoxelData[VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis)], voxel);
+}
+
+void VolumeRaytracer::Voxel::VDenseVoxelStorage::MakeVoxelsUnique()
+{
+	if (Voxels != nullptr && Voxels.use_count() > 1)
+	{
+		Voxels = std::make_shared<std::vector<VVoxel>>(*Voxels);
+		VoxelData = Voxels->data();
+	}
+	else if (MappedArchive != nullptr && MappedArchive.use_count() > 1)
+	{
+		//Writes to the mapping go to the pages in place, so a shared mapping is copied out first
+		Voxels = std::make_shared<std::vector<VVoxel>>(VoxelData, VoxelData + (uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis);
+		VoxelData = Voxels->data();
+		MappedArchive = nullptr;
+	}
+}
\ No newline at end of file
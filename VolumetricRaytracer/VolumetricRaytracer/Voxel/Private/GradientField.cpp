@@ -0,0 +1,218 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "GradientField.h"
+#include "VoxelStorage.h"
+#include <cmath>
+
+const int VolumeRaytracer::Voxel::VGradientField::UPDATE_TILE_SIZE;
+
+namespace
+{
+	float SignNotZero(const float& value)
+	{
+		return value >= 0.f ? 1.f : -1.f;
+	}
+
+	uint8_t QuantizeSnorm(const float& value)
+	{
+		return (uint8_t)std::lround((VolumeRaytracer::VMathHelpers::Clamp(value, -1.f, 1.f) * 0.5f + 0.5f) * 255.f);
+	}
+}
+
+void VolumeRaytracer::Voxel::VGradientField::Build(const IVVoxelStorage& voxels)
+{
+	VoxelCountAlongAxis = voxels.GetVoxelCountAlongAxis();
+
+	Normals.clear();
+	Normals.resize((uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis);
+
+	UpdateVoxels(voxels, VIntVector::ZERO, VIntVector::ONE * ((int)VoxelCountAlongAxis - 1));
+}
+
+void VolumeRaytracer::Voxel::VGradientField::Clear()
+{
+	VoxelCountAlongAxis = 0;
+
+	Normals.clear();
+	Normals.shrink_to_fit();
+}
+
+void VolumeRaytracer::Voxel::VGradientField::UpdateVoxels(const IVVoxelStorage& voxels, const VIntVector& minVoxel, const VIntVector& maxVoxel)
+{
+	if (IsEmpty() || voxels.GetVoxelCountAlongAxis() != VoxelCountAlongAxis)
+	{
+		return;
+	}
+
+	const int voxelCount = (int)VoxelCountAlongAxis;
+
+	VIntVector min = VIntVector::Max(minVoxel, 0);
+	VIntVector max = VIntVector::Min(maxVoxel, voxelCount - 1);
+
+	if (min.X > max.X || min.Y > max.Y || min.Z > max.Z)
+	{
+		return;
+	}
+
+	const int readMinY = VMathHelpers::Max(min.Y - 1, 0);
+	const int readMaxY = VMathHelpers::Min(max.Y + 1, voxelCount - 1);
+	const size_t rowLength = readMaxY - readMinY + 1;
+
+	const int zTileCount = (max.Z - min.Z) / UPDATE_TILE_SIZE + 1;
+	const int taskCount = (max.X - min.X + 1) * zTileCount;
+
+	//Every task handles one x slice of a z tile and reads the neighbouring slices around it
+	#pragma omp parallel for schedule(dynamic)
+	for (int task = 0; task < taskCount; task++)
+	{
+		const int x = min.X + task / zTileCount;
+		const int tileMinZ = min.Z + (task % zTileCount) * UPDATE_TILE_SIZE;
+		const int tileMaxZ = VMathHelpers::Min(tileMinZ + UPDATE_TILE_SIZE - 1, max.Z);
+
+		VIntVector readMin(VMathHelpers::Max(x - 1, 0), readMinY, VMathHelpers::Max(tileMinZ - 1, 0));
+		VIntVector readMax(VMathHelpers::Min(x + 1, voxelCount - 1), readMaxY, VMathHelpers::Min(tileMaxZ + 1, voxelCount - 1));
+
+		const size_t readSizeZ = readMax.Z - readMin.Z + 1;
+
+		std::vector<VVoxel> box((size_t)(readMax.X - readMin.X + 1) * readSizeZ * rowLength);
+		voxels.ReadBox(readMin, readMax, box.data());
+
+		auto getRow = [&](const int& rowX, const int& rowZ)
+		{
+			return &box[((size_t)(rowX - readMin.X) * readSizeZ + (rowZ - readMin.Z)) * rowLength];
+		};
+
+		for (int z = tileMinZ; z <= tileMaxZ; z++)
+		{
+			const VVoxel* row = getRow(x, z);
+			const VVoxel* rowXM = getRow(VMathHelpers::Max(x - 1, 0), z);
+			const VVoxel* rowXP = getRow(VMathHelpers::Min(x + 1, voxelCount - 1), z);
+			const VVoxel* rowZM = getRow(x, VMathHelpers::Max(z - 1, 0));
+			const VVoxel* rowZP = getRow(x, VMathHelpers::Min(z + 1, voxelCount - 1));
+
+			uint16_t* normals = &Normals[VMathHelpers::Index3DTo1D(x, 0, z, VoxelCountAlongAxis, VoxelCountAlongAxis)];
+
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				const size_t ly = y - readMinY;
+				const size_t lyM = VMathHelpers::Max(y - 1, 0) - readMinY;
+				const size_t lyP = VMathHelpers::Min(y + 1, voxelCount - 1) - readMinY;
+
+				normals[y] = EncodeNormal(
+					rowXP[ly].Density - rowXM[ly].Density,
+					row[lyP].Density - row[lyM].Density,
+					rowZP[ly].Density - rowZM[ly].Density);
+			}
+		}
+	}
+}
+
+bool VolumeRaytracer::Voxel::VGradientField::IsEmpty() const
+{
+	return Normals.empty();
+}
+
+size_t VolumeRaytracer::Voxel::VGradientField::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VGradientField::GetAllocatedBytes() const
+{
+	return Normals.size() * sizeof(uint16_t);
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Voxel::VGradientField::GetGradient(const VIntVector& voxelIndex) const
+{
+	return DecodeNormal(Normals[VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis)]);
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Voxel::VGradientField::GetNormal(const VIntVector& cellIndex, const VVector& cellPos) const
+{
+	size_t baseIndex = VMathHelpers::Index3DTo1D(cellIndex, VoxelCountAlongAxis, VoxelCountAlongAxis);
+
+	float normal[3] = { 0.f, 0.f, 0.f };
+
+	for (int c = 0; c < 8; c++)
+	{
+		int cx = c & 1;
+		int cy = (c >> 1) & 1;
+		int cz = (c >> 2) & 1;
+
+		float weight = (cx ? cellPos.X : 1.f - cellPos.X) * (cy ? cellPos.Y : 1.f - cellPos.Y) * (cz ? cellPos.Z : 1.f - cellPos.Z);
+
+		VVector corner = DecodeNormal(Normals[baseIndex + VMathHelpers::Index3DTo1D(cx, cy, cz, VoxelCountAlongAxis, VoxelCountAlongAxis)]);
+
+		normal[0] += corner.X * weight;
+		normal[1] += corner.Y * weight;
+		normal[2] += corner.Z * weight;
+	}
+
+	float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+	if (length <= 0.f)
+	{
+		return VVector::ZERO;
+	}
+
+	return VVector(normal[0] / length, normal[1] / length, normal[2] / length);
+}
+
+const std::vector<uint16_t>& VolumeRaytracer::Voxel::VGradientField::GetEncodedNormals() const
+{
+	return Normals;
+}
+
+uint16_t VolumeRaytracer::Voxel::VGradientField::EncodeNormal(const float& x, const float& y, const float& z)
+{
+	float length = std::abs(x) + std::abs(y) + std::abs(z);
+
+	//Flat or invalid regions have no direction, they decode to +Z
+	if (!(length > 0.f) || std::isinf(length))
+	{
+		return EncodeNormal(0.f, 0.f, 1.f);
+	}
+
+	float u = x / length;
+	float v = y / length;
+
+	if (z < 0.f)
+	{
+		float foldedU = (1.f - std::abs(v)) * SignNotZero(u);
+		float foldedV = (1.f - std::abs(u)) * SignNotZero(v);
+
+		u = foldedU;
+		v = foldedV;
+	}
+
+	return (uint16_t)QuantizeSnorm(u) | ((uint16_t)QuantizeSnorm(v) << 8);
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Voxel::VGradientField::DecodeNormal(const uint16_t& encodedNormal)
+{
+	float x = (float)(encodedNormal & 0xFF) * (2.f / 255.f) - 1.f;
+	float y = (float)(encodedNormal >> 8) * (2.f / 255.f) - 1.f;
+	float z = 1.f - std::abs(x) - std::abs(y);
+
+	float t = VMathHelpers::Max(-z, 0.f);
+
+	x += x >= 0.f ? -t : t;
+	y += y >= 0.f ? -t : t;
+
+	float length = std::sqrt(x * x + y * y + z * z);
+
+	return VVector(x / length, y / length, z / length);
+}
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "HalfVoxelStorage.h"
+
+namespace
+{
+	const size_t HALF_CONVERSION_CHUNK = 256;
+
+	//Tiny densities must not collapse to zero, otherwise the voxel loses the side of the surface it is on
+	uint16_t PreserveDensitySign(const uint16_t& half, const float& density)
+	{
+		if ((half & 0x7FFF) == 0 && density != 0.f)
+		{
+			return density < 0.f ? 0x8001 : 0x0001;
+		}
+
+		return half;
+	}
+}
+
+VolumeRaytracer::Voxel::VHalfVoxelStorage::VHalfVoxelStorage(const float& cellSize)
+	: CellSize(cellSize)
+{}
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VHalfVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Half;
+}
+
+void VolumeRaytracer::Voxel::VHalfVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+
+	size_t voxelCount = (uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis;
+
+	Densities = std::make_shared<std::vector<uint16_t>>(voxelCount, EncodeDensity(fillVoxel.Density));
+	Materials = std::make_shared<std::vector<uint8_t>>(voxelCount, fillVoxel.Material);
+}
+
+void VolumeRaytracer::Voxel::VHalfVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	size_t index = VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis);
+
+	MakePlanesUnique();
+
+	(*Densities)[index] = EncodeDensity(voxel.Density);
+	(*Materials)[index] = voxel.Material;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VHalfVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	return GetVoxel(VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis));
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VHalfVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	VVoxel res;
+	res.Density = DecodeDensity((*Densities)[voxelIndex]);
+	res.Material = (*Materials)[voxelIndex];
+
+	return res;
+}
+
+size_t VolumeRaytracer::Voxel::VHalfVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VHalfVoxelStorage::GetAllocatedBytes() const
+{
+	return Densities != nullptr ? Densities->size() * sizeof(uint16_t) + Materials->size() * sizeof(uint8_t) : 0;
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VHalfVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = Densities->size() * sizeof(uint16_t);
+	res->Buffer = new char[res->BufferSize];
+
+	memcpy(res->Buffer, Densities->data(), res->BufferSize);
+
+	std::shared_ptr<VSerializationArchive> materials = std::make_shared<VSerializationArchive>();
+	materials->BufferSize = Materials->size() * sizeof(uint8_t);
+	materials->Buffer = new char[materials->BufferSize];
+
+	memcpy(materials->Buffer, Materials->data(), materials->BufferSize);
+
+	res->Properties["Materials"] = materials;
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VHalfVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	Allocate(voxelCountAlongAxis, VVoxel());
+
+	memcpy(Densities->data(), archive->Buffer, VMathHelpers::Min(archive->BufferSize, Densities->size() * sizeof(uint16_t)));
+
+	std::shared_ptr<VSerializationArchive> materials = archive->Properties["Materials"];
+
+	memcpy(Materials->data(), materials->Buffer, VMathHelpers::Min(materials->BufferSize, Materials->size() * sizeof(uint8_t)));
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VHalfVoxelStorage::Clone() const
+{
+	//Shares the planes, the first write on either side copies them
+	return std::make_shared<VHalfVoxelStorage>(*this);
+}
+
+void VolumeRaytracer::Voxel::VHalfVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	size_t rowLength = max.Y - min.Y + 1;
+
+	float densities[HALF_CONVERSION_CHUNK];
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			const size_t rowStart = VMathHelpers::Index3DTo1D(x, min.Y, z, VoxelCountAlongAxis, VoxelCountAlongAxis);
+			const uint16_t* halfs = Densities->data() + rowStart;
+			const uint8_t* materials = Materials->data() + rowStart;
+
+			for (size_t chunkStart = 0; chunkStart < rowLength; chunkStart += HALF_CONVERSION_CHUNK)
+			{
+				size_t chunkLength = VMathHelpers::Min(HALF_CONVERSION_CHUNK, rowLength - chunkStart);
+
+				VMathHelpers::HalfToFloat(halfs + chunkStart, densities, chunkLength);
+
+				for (size_t y = 0; y < chunkLength; y++)
+				{
+					outVoxels[chunkStart + y].Density = densities[y] * CellSize;
+					outVoxels[chunkStart + y].Material = materials[chunkStart + y];
+				}
+			}
+
+			outVoxels += rowLength;
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VHalfVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	MakePlanesUnique();
+
+	size_t rowLength = max.Y - min.Y + 1;
+
+	const float invCellSize = 1.f / CellSize;
+
+	float densities[HALF_CONVERSION_CHUNK];
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			const size_t rowStart = VMathHelpers::Index3DTo1D(x, min.Y, z, VoxelCountAlongAxis, VoxelCountAlongAxis);
+			uint16_t* halfs = Densities->data() + rowStart;
+			uint8_t* materials = Materials->data() + rowStart;
+
+			for (size_t chunkStart = 0; chunkStart < rowLength; chunkStart += HALF_CONVERSION_CHUNK)
+			{
+				size_t chunkLength = VMathHelpers::Min(HALF_CONVERSION_CHUNK, rowLength - chunkStart);
+
+				for (size_t y = 0; y < chunkLength; y++)
+				{
+					densities[y] = VMathHelpers::Clamp(voxels[chunkStart + y].Density * invCellSize, -MAX_HALF_VALUE, MAX_HALF_VALUE);
+					materials[chunkStart + y] = voxels[chunkStart + y].Material;
+				}
+
+				VMathHelpers::FloatToHalf(densities, halfs + chunkStart, chunkLength);
+
+				for (size_t y = 0; y < chunkLength; y++)
+				{
+					halfs[chunkStart + y] = PreserveDensitySign(halfs[chunkStart + y], densities[y]);
+				}
+			}
+
+			voxels += rowLength;
+		}
+	}
+}
+
+const uint8_t* VolumeRaytracer::Voxel::VHalfVoxelStorage::GetMaterialPlane() const
+{
+	return Materials->data();
+}
+
+const uint16_t* VolumeRaytracer::Voxel::VHalfVoxelStorage::GetHalfDensityPlane() const
+{
+	return Densities->data();
+}
+
+size_t VolumeRaytracer::Voxel::VHalfVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	return (uint64_t)voxelCountAlongAxis * voxelCountAlongAxis * voxelCountAlongAxis * (sizeof(uint16_t) + sizeof(uint8_t));
+}
+
+uint16_t VolumeRaytracer::Voxel::VHalfVoxelStorage::EncodeDensity(const float& density) const
+{
+	float cellDensity = VMathHelpers::Clamp(density / CellSize, -MAX_HALF_VALUE, MAX_HALF_VALUE);
+
+	return PreserveDensitySign(VMathHelpers::FloatToHalf(cellDensity), cellDensity);
+}
+
+float VolumeRaytracer::Voxel::VHalfVoxelStorage::DecodeDensity(const uint16_t& density) const
+{
+	return VMathHelpers::HalfToFloat(density) * CellSize;
+}
+
+void VolumeRaytracer::Voxel::VHalfVoxelStorage::MakePlanesUnique()
+{
+	if (Densities.use_count() > 1)
+	{
+		Densities = std::make_shared<std::vector<uint16_t>>(*Densities);
+	}
+
+	if (Materials.use_count() > 1)
+	{
+		Materials = std::make_shared<std::vector<uint8_t>>(*Materials);
+	}
+}
\ No newline at end of file
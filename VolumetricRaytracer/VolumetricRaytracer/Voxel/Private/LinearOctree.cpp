@@ -0,0 +1,886 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "LinearOctree.h"
+#include "VoxelStorage.h"
+#include "SurfaceBitmap.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	using namespace VolumeRaytracer;
+	using namespace VolumeRaytracer::Voxel;
+
+	void InitNode(VLinearOctreeNode& node, const VIntVector& cellIndex, const uint8_t& depth)
+	{
+		node.FirstChild = VLinearOctreeNode::INVALID_NODE;
+		node.CellIndex[0] = (uint16_t)cellIndex.X;
+		node.CellIndex[1] = (uint16_t)cellIndex.Y;
+		node.CellIndex[2] = (uint16_t)cellIndex.Z;
+		node.ChildMask = 0;
+		node.Depth = depth;
+	}
+
+	//Regions without a surface cell become a leaf right away, only branches towards the surface are ever created
+	bool IsSurfaceRegion(const VSurfaceBitmap& surfaceBitmap, const VLinearOctreeNode& node, const uint8_t& maxDepth)
+	{
+		VIntVector cellIndex = node.GetCellIndex();
+
+		if (node.Depth == maxDepth)
+		{
+			return surfaceBitmap.IsSurfaceCell(cellIndex);
+		}
+
+		int regionCellCount = 1 << (maxDepth - node.Depth);
+
+		return surfaceBitmap.HasSurface(cellIndex, cellIndex + VIntVector::ONE * (regionCellCount - 1));
+	}
+
+	//Initializes the child block at firstChild, which has to be allocated already, and links it to the node
+	void SplitNode(std::vector<VLinearOctreeNode>& nodes, const uint32_t& nodeIndex, const uint32_t& firstChild, const uint8_t& maxDepth)
+	{
+		VIntVector cellIndex = nodes[nodeIndex].GetCellIndex();
+		uint8_t depth = nodes[nodeIndex].Depth;
+
+		int childCellOffset = 1 << (maxDepth - depth - 1);
+
+		for (int i = 0; i < 8; i++)
+		{
+			InitNode(nodes[firstChild + i], cellIndex + VCell::VOXEL_COORDS[i] * childCellOffset, depth + 1);
+		}
+
+		nodes[nodeIndex].FirstChild = firstChild;
+	}
+
+	//The distance bound protects the cells the traversal enters, not the field between the samples. Projecting a voxel onto the node box
+	//lands on a node voxel, so a voxel at distance d from the node differs from the node densities by at most d * densityPerCell and keeps
+	//their sign while d < MinDensity / densityPerCell. A surface cell has a corner that changed sign and reaches at most one cell diagonal
+	//from that corner towards the node, so it is at least MinDensity / densityPerCell - sqrt(3) cells away
+	const float CELL_DIAGONAL = 1.7320508f;
+
+	VIntVector GetRegionMaxCell(const VLinearOctreeNode& node, const uint8_t& maxDepth)
+	{
+		return node.GetCellIndex() + VIntVector::ONE * ((1 << (maxDepth - node.Depth)) - 1);
+	}
+
+	void ExtendDensityBounds(VOctreeDensityBounds& bounds, const float& density)
+	{
+		//NaN densities never pass a comparison and are ignored
+		if (density < bounds.MinDensity)
+		{
+			bounds.MinDensity = density;
+		}
+
+		if (density > bounds.MaxDensity)
+		{
+			bounds.MaxDensity = density;
+		}
+	}
+
+	void ExtendDensityBounds(VOctreeDensityBounds& bounds, const VOctreeDensityBounds& other)
+	{
+		bounds.MinDensity = std::min(bounds.MinDensity, other.MinDensity);
+		bounds.MaxDensity = std::max(bounds.MaxDensity, other.MaxDensity);
+	}
+
+	VOctreeDensityBounds EmptyDensityBounds()
+	{
+		VOctreeDensityBounds bounds;
+		bounds.MinDensity = std::numeric_limits<float>::max();
+		bounds.MaxDensity = -std::numeric_limits<float>::max();
+
+		return bounds;
+	}
+
+	//Densities of the voxels in the cell box, which includes the upper corners of the last cells
+	void ReadDensityBounds(const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell, VOctreeDensityBounds& inOutBounds)
+	{
+		size_t voxelCountAlongAxis = voxels.GetVoxelCountAlongAxis();
+
+		VIntVector minVoxel = minCell;
+		VIntVector maxVoxel = maxCell + VIntVector::ONE;
+
+		const float* densityPlane = voxels.GetDensityPlane();
+
+		if (densityPlane != nullptr)
+		{
+			for (int x = minVoxel.X; x <= maxVoxel.X; x++)
+			{
+				for (int z = minVoxel.Z; z <= maxVoxel.Z; z++)
+				{
+					const float* row = densityPlane + VMathHelpers::Index3DTo1D(x, minVoxel.Y, z, voxelCountAlongAxis, voxelCountAlongAxis);
+
+					for (int y = 0; y <= maxVoxel.Y - minVoxel.Y; y++)
+					{
+						ExtendDensityBounds(inOutBounds, row[y]);
+					}
+				}
+			}
+		}
+		else if (maxCell == minCell)
+		{
+			for (int v = 0; v < 8; v++)
+			{
+				ExtendDensityBounds(inOutBounds, voxels.GetVoxel(minCell + VCell::VOXEL_COORDS[v]).Density);
+			}
+		}
+		else
+		{
+			VIntVector size = maxVoxel - minVoxel + VIntVector::ONE;
+			std::vector<VVoxel> slab((size_t)size.Y * size.Z);
+
+			for (int x = minVoxel.X; x <= maxVoxel.X; x++)
+			{
+				voxels.ReadBox(VIntVector(x, minVoxel.Y, minVoxel.Z), VIntVector(x, maxVoxel.Y, maxVoxel.Z), slab.data());
+
+				for (const VVoxel& voxel : slab)
+				{
+					ExtendDensityBounds(inOutBounds, voxel.Density);
+				}
+			}
+		}
+	}
+
+	bool IntersectRayBox(const VVector& origin, const VVector& inverseDirection, const VVector& boxMin, const VVector& boxMax, float& outEnter, float& outExit)
+	{
+		float tx1 = (boxMin.X - origin.X) * inverseDirection.X;
+		float tx2 = (boxMax.X - origin.X) * inverseDirection.X;
+		float ty1 = (boxMin.Y - origin.Y) * inverseDirection.Y;
+		float ty2 = (boxMax.Y - origin.Y) * inverseDirection.Y;
+		float tz1 = (boxMin.Z - origin.Z) * inverseDirection.Z;
+		float tz2 = (boxMax.Z - origin.Z) * inverseDirection.Z;
+
+		outEnter = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::min(tz1, tz2));
+		outExit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+
+		return outEnter <= outExit;
+	}
+
+	//Returns true if the region of the node contains a surface cell
+	bool BuildNode(std::vector<VLinearOctreeNode>& nodes, const uint32_t& nodeIndex, const uint8_t& maxDepth, const VSurfaceBitmap& surfaceBitmap)
+	{
+		if (!IsSurfaceRegion(surfaceBitmap, nodes[nodeIndex], maxDepth))
+		{
+			return false;
+		}
+
+		if (nodes[nodeIndex].Depth == maxDepth)
+		{
+			return true;
+		}
+
+		uint32_t firstChild = (uint32_t)nodes.size();
+
+		nodes.resize(nodes.size() + 8);
+		SplitNode(nodes, nodeIndex, firstChild, maxDepth);
+
+		uint8_t childMask = 0;
+
+		for (int i = 0; i < 8; i++)
+		{
+			BuildNode(nodes, firstChild + i, maxDepth, surfaceBitmap);
+
+			if (!nodes[firstChild + i].IsLeaf())
+			{
+				childMask |= 1 << i;
+			}
+		}
+
+		nodes[nodeIndex].ChildMask = childMask;
+
+		return true;
+	}
+
+	//Same as BuildNode down to splitDepth, where the prebuilt subtrees are appended and their child indices relocated into the pool
+	void BuildTopNode(std::vector<VLinearOctreeNode>& nodes, const uint32_t& nodeIndex, const uint8_t& maxDepth, const uint8_t& splitDepth, 
+		const VSurfaceBitmap& surfaceBitmap, const std::vector<std::vector<VLinearOctreeNode>>& subtrees)
+	{
+		VIntVector cellIndex = nodes[nodeIndex].GetCellIndex();
+		uint8_t depth = nodes[nodeIndex].Depth;
+
+		if (depth == splitDepth)
+		{
+			size_t subtreeAxisCount = (size_t)1 << splitDepth;
+			size_t subtreeIndex = VMathHelpers::Index3DTo1D(cellIndex / (1 << (maxDepth - splitDepth)), subtreeAxisCount, subtreeAxisCount);
+
+			const std::vector<VLinearOctreeNode>& subtree = subtrees[subtreeIndex];
+
+			//Local index 0 is the subtree root, its descendants start at local index 1
+			uint32_t offset = (uint32_t)nodes.size() - 1;
+
+			nodes[nodeIndex] = subtree[0];
+			nodes.insert(nodes.end(), subtree.begin() + 1, subtree.end());
+
+			if (!nodes[nodeIndex].IsLeaf())
+			{
+				nodes[nodeIndex].FirstChild += offset;
+			}
+
+			for (size_t i = offset + 1; i < nodes.size(); i++)
+			{
+				if (!nodes[i].IsLeaf())
+				{
+					nodes[i].FirstChild += offset;
+				}
+			}
+
+			return;
+		}
+
+		if (!IsSurfaceRegion(surfaceBitmap, nodes[nodeIndex], maxDepth))
+		{
+			return;
+		}
+
+		uint32_t firstChild = (uint32_t)nodes.size();
+
+		nodes.resize(nodes.size() + 8);
+		SplitNode(nodes, nodeIndex, firstChild, maxDepth);
+
+		uint8_t childMask = 0;
+
+		for (int i = 0; i < 8; i++)
+		{
+			BuildTopNode(nodes, firstChild + i, maxDepth, splitDepth, surfaceBitmap, subtrees);
+
+			if (!nodes[firstChild + i].IsLeaf())
+			{
+				childMask |= 1 << i;
+			}
+		}
+
+		nodes[nodeIndex].ChildMask = childMask;
+	}
+}
+
+const uint32_t VolumeRaytracer::Voxel::VLinearOctreeNode::INVALID_NODE;
+const uint8_t VolumeRaytracer::Voxel::VLinearCellOctree::PARALLEL_SPLIT_DEPTH;
+
+bool VolumeRaytracer::Voxel::VLinearOctreeNode::IsLeaf() const
+{
+	return FirstChild == INVALID_NODE;
+}
+
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxel::VLinearOctreeNode::GetCellIndex() const
+{
+	return VIntVector(CellIndex[0], CellIndex[1], CellIndex[2]);
+}
+
+bool VolumeRaytracer::Voxel::VOctreeDensityBounds::IsOutside() const
+{
+	return MinDensity > 0;
+}
+
+bool VolumeRaytracer::Voxel::VOctreeDensityBounds::IsInside() const
+{
+	return MaxDensity < 0;
+}
+
+VolumeRaytracer::Voxel::VLinearCellOctree::VLinearCellOctree(const uint8_t& maxDepth, const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap /*= nullptr*/)
+	:MaxDepth(maxDepth)
+{
+	GenerateOctreeFromVoxelVolume(voxels, surfaceBitmap);
+}
+
+size_t VolumeRaytracer::Voxel::VLinearCellOctree::GetMaxDepth() const
+{
+	return MaxDepth;
+}
+
+size_t VolumeRaytracer::Voxel::VLinearCellOctree::GetCellCountAlongAxis() const
+{
+	return (size_t)1 << MaxDepth;
+}
+
+size_t VolumeRaytracer::Voxel::VLinearCellOctree::GetNodeCount() const
+{
+	return Nodes.size();
+}
+
+const VolumeRaytracer::Voxel::VLinearOctreeNode& VolumeRaytracer::Voxel::VLinearCellOctree::GetNode(const size_t& nodeIndex) const
+{
+	return Nodes[nodeIndex];
+}
+
+const std::vector<VolumeRaytracer::Voxel::VLinearOctreeNode>& VolumeRaytracer::Voxel::VLinearCellOctree::GetNodes() const
+{
+	return Nodes;
+}
+
+size_t VolumeRaytracer::Voxel::VLinearCellOctree::GetAllocatedBytes() const
+{
+	return Nodes.capacity() * sizeof(VLinearOctreeNode);
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::GetGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const
+{
+	VLinearOctreeNodeRange range;
+	range.FirstNode = 0;
+	range.NodeCount = (uint32_t)Nodes.size();
+
+	outNodeAxisCount = GetGPUNodeAxisCount(Nodes.size());
+
+	outNodes.clear();
+
+	GetGPUOctreeNodes(range, outNodeAxisCount, outNodes);
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::GetGPUOctreeNodes(const VLinearOctreeNodeRange& range, const size_t& nodeAxisCount, std::vector<VCellGPUOctreeNode>& outNodes) const
+{
+	size_t outIndex = outNodes.size();
+
+	outNodes.resize(outNodes.size() + range.NodeCount);
+
+	for (size_t i = range.FirstNode; i < (size_t)range.FirstNode + range.NodeCount; i++, outIndex++)
+	{
+		const VLinearOctreeNode& node = Nodes[i];
+		VCellGPUOctreeNode& gpuNode = outNodes[outIndex];
+
+		gpuNode.IsLeaf = node.IsLeaf();
+
+		if (HasDensityBounds())
+		{
+			gpuNode.MinDensity = DensityBounds[i].MinDensity;
+			gpuNode.MaxDensity = DensityBounds[i].MaxDensity;
+			gpuNode.DistanceBound = GetDistanceBound(i);
+		}
+
+		if (gpuNode.IsLeaf)
+		{
+			gpuNode.CellIndex = node.GetCellIndex();
+		}
+		else
+		{
+			gpuNode.Children.resize(8);
+
+			for (int c = 0; c < 8; c++)
+			{
+				gpuNode.Children[c] = VMathHelpers::Index1DTo3D(node.FirstChild + c, nodeAxisCount, nodeAxisCount);
+			}
+		}
+	}
+}
+
+bool VolumeRaytracer::Voxel::VLinearCellOctree::UpdateRegion(const VSurfaceBitmap& surfaceBitmap, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes)
+{
+	size_t changedRangeCount = outChangedNodes.size();
+
+	UpdateNode(0, surfaceBitmap, minCell, maxCell, outChangedNodes);
+
+	return outChangedNodes.size() != changedRangeCount;
+}
+
+size_t VolumeRaytracer::Voxel::VLinearCellOctree::GetFreeNodeCount() const
+{
+	return FreeChildBlocks.size() * 8;
+}
+
+size_t VolumeRaytracer::Voxel::VLinearCellOctree::GetGPUNodeAxisCount(const size_t& nodeCount)
+{
+	size_t size = std::ceil(std::cbrtf(nodeCount));
+
+	while (size * size * size < nodeCount)
+	{
+		size++;
+	}
+
+	return size;
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::GenerateOctreeFromVoxelVolume(const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap)
+{
+	VSurfaceBitmap localSurfaceBitmap;
+
+	if (surfaceBitmap == nullptr || surfaceBitmap->GetCellCountAlongAxis() != GetCellCountAlongAxis())
+	{
+		localSurfaceBitmap.Build(voxels);
+		surfaceBitmap = &localSurfaceBitmap;
+	}
+
+	Nodes.clear();
+	Nodes.resize(1);
+
+	FreeChildBlocks.clear();
+	DensityBounds.clear();
+
+	InitNode(Nodes[0], VIntVector::ZERO, 0);
+
+	//Small trees are not worth the merge step
+	if (MaxDepth <= PARALLEL_SPLIT_DEPTH + 1)
+	{
+		BuildNode(Nodes, 0, MaxDepth, *surfaceBitmap);
+	}
+	else
+	{
+		uint8_t splitDepth = PARALLEL_SPLIT_DEPTH;
+		int subtreeAxisCount = 1 << splitDepth;
+		int subtreeCellCount = 1 << (MaxDepth - splitDepth);
+		int64_t subtreeCount = (int64_t)subtreeAxisCount * subtreeAxisCount * subtreeAxisCount;
+
+		std::vector<std::vector<VLinearOctreeNode>> subtrees;
+		subtrees.resize(subtreeCount);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int64_t i = 0; i < subtreeCount; i++)
+		{
+			VIntVector subtreeIndex = VMathHelpers::Index1DTo3D((size_t)i, subtreeAxisCount, subtreeAxisCount);
+
+			std::vector<VLinearOctreeNode>& subtree = subtrees[i];
+
+			subtree.resize(1);
+			InitNode(subtree[0], subtreeIndex * subtreeCellCount, splitDepth);
+
+			BuildNode(subtree, 0, MaxDepth, *surfaceBitmap);
+		}
+
+		BuildTopNode(Nodes, 0, MaxDepth, splitDepth, *surfaceBitmap, subtrees);
+	}
+
+	Nodes.shrink_to_fit();
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::MergeNodeRanges(std::vector<VLinearOctreeNodeRange>& ranges)
+{
+	std::sort(ranges.begin(), ranges.end(), [](const VLinearOctreeNodeRange& a, const VLinearOctreeNodeRange& b)
+	{
+		return a.FirstNode < b.FirstNode;
+	});
+
+	size_t mergedCount = 0;
+
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (mergedCount > 0)
+		{
+			VLinearOctreeNodeRange& last = ranges[mergedCount - 1];
+			uint32_t lastEnd = last.FirstNode + last.NodeCount;
+
+			if (ranges[i].FirstNode <= lastEnd)
+			{
+				last.NodeCount = std::max(lastEnd, ranges[i].FirstNode + ranges[i].NodeCount) - last.FirstNode;
+				continue;
+			}
+		}
+
+		ranges[mergedCount++] = ranges[i];
+	}
+
+	ranges.resize(mergedCount);
+}
+
+bool VolumeRaytracer::Voxel::VLinearCellOctree::UpdateNode(const uint32_t& nodeIndex, const VSurfaceBitmap& surfaceBitmap, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes)
+{
+	VLinearOctreeNode node = Nodes[nodeIndex];
+
+	VIntVector regionMin = node.GetCellIndex();
+	VIntVector regionMax = regionMin + VIntVector::ONE * ((1 << (MaxDepth - node.Depth)) - 1);
+
+	if (node.Depth == MaxDepth)
+	{
+		return surfaceBitmap.IsSurfaceCell(regionMin);
+	}
+
+	if (regionMax.X < minCell.X || regionMax.Y < minCell.Y || regionMax.Z < minCell.Z ||
+		regionMin.X > maxCell.X || regionMin.Y > maxCell.Y || regionMin.Z > maxCell.Z)
+	{
+		return !node.IsLeaf();
+	}
+
+	VLinearOctreeNodeRange nodeRange;
+	nodeRange.FirstNode = nodeIndex;
+	nodeRange.NodeCount = 1;
+
+	if (node.IsLeaf())
+	{
+		//The region had no surface before and only cells inside the box changed
+		if (!surfaceBitmap.HasSurface(VIntVector::Max(regionMin, minCell), VIntVector::Min(regionMax, maxCell)))
+		{
+			return false;
+		}
+
+		BuildSubtree(nodeIndex, surfaceBitmap, minCell, maxCell, outChangedNodes);
+		outChangedNodes.push_back(nodeRange);
+
+		return true;
+	}
+
+	//Children outside the box keep their state, so the region only has to be tested through its children
+	bool hasSurface = false;
+	uint8_t childMask = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		hasSurface |= UpdateNode(node.FirstChild + i, surfaceBitmap, minCell, maxCell, outChangedNodes);
+
+		if (!Nodes[node.FirstChild + i].IsLeaf())
+		{
+			childMask |= 1 << i;
+		}
+	}
+
+	if (!hasSurface)
+	{
+		ReleaseSubtree(nodeIndex);
+
+		Nodes[nodeIndex].FirstChild = VLinearOctreeNode::INVALID_NODE;
+		Nodes[nodeIndex].ChildMask = 0;
+
+		outChangedNodes.push_back(nodeRange);
+
+		return false;
+	}
+
+	//The mask is not part of the GPU node, so the node itself does not need to be patched
+	Nodes[nodeIndex].ChildMask = childMask;
+
+	return true;
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::BuildSubtree(const uint32_t& nodeIndex, const VSurfaceBitmap& surfaceBitmap, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes)
+{
+	uint32_t firstChild = AllocateChildBlock();
+
+	SplitNode(Nodes, nodeIndex, firstChild, MaxDepth);
+
+	//The bounds of the old leaf cover the new children, UpdateDensityBounds refines them
+	if (!DensityBounds.empty())
+	{
+		DensityBounds.resize(Nodes.size());
+
+		for (int i = 0; i < 8; i++)
+		{
+			DensityBounds[firstChild + i] = DensityBounds[nodeIndex];
+		}
+	}
+
+	VLinearOctreeNodeRange blockRange;
+	blockRange.FirstNode = firstChild;
+	blockRange.NodeCount = 8;
+
+	outChangedNodes.push_back(blockRange);
+
+	uint8_t childMask = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		const VLinearOctreeNode& child = Nodes[firstChild + i];
+
+		if (child.Depth == MaxDepth)
+		{
+			continue;
+		}
+
+		VIntVector regionMin = VIntVector::Max(child.GetCellIndex(), minCell);
+		VIntVector regionMax = VIntVector::Min(child.GetCellIndex() + VIntVector::ONE * ((1 << (MaxDepth - child.Depth)) - 1), maxCell);
+
+		if (regionMin.X <= regionMax.X && regionMin.Y <= regionMax.Y && regionMin.Z <= regionMax.Z && surfaceBitmap.HasSurface(regionMin, regionMax))
+		{
+			BuildSubtree(firstChild + i, surfaceBitmap, minCell, maxCell, outChangedNodes);
+			childMask |= 1 << i;
+		}
+	}
+
+	Nodes[nodeIndex].ChildMask = childMask;
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::ReleaseSubtree(const uint32_t& nodeIndex)
+{
+	uint32_t firstChild = Nodes[nodeIndex].FirstChild;
+
+	if (firstChild == VLinearOctreeNode::INVALID_NODE)
+	{
+		return;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		ReleaseSubtree(firstChild + i);
+	}
+
+	FreeChildBlocks.push_back(firstChild);
+}
+
+uint32_t VolumeRaytracer::Voxel::VLinearCellOctree::AllocateChildBlock()
+{
+	if (!FreeChildBlocks.empty())
+	{
+		uint32_t firstChild = FreeChildBlocks.back();
+		FreeChildBlocks.pop_back();
+
+		return firstChild;
+	}
+
+	uint32_t firstChild = (uint32_t)Nodes.size();
+
+	Nodes.resize(Nodes.size() + 8);
+
+	return firstChild;
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::BuildDensityBounds(const IVVoxelStorage& voxels, const float& densityPerCell /*= 0*/)
+{
+	DensityPerCell = densityPerCell;
+
+	DensityBounds.clear();
+	DensityBounds.resize(Nodes.size());
+
+	int64_t nodeCount = (int64_t)Nodes.size();
+
+	#pragma omp parallel for schedule(dynamic, 256)
+	for (int64_t i = 0; i < nodeCount; i++)
+	{
+		const VLinearOctreeNode& node = Nodes[i];
+
+		if (node.IsLeaf())
+		{
+			VOctreeDensityBounds bounds = EmptyDensityBounds();
+			ReadDensityBounds(voxels, node.GetCellIndex(), GetRegionMaxCell(node, MaxDepth), bounds);
+
+			DensityBounds[i] = bounds;
+		}
+	}
+
+	BuildBranchDensityBounds(0);
+}
+
+void VolumeRaytracer::Voxel::VLinearCellOctree::UpdateDensityBounds(const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes)
+{
+	if (!HasDensityBounds())
+	{
+		return;
+	}
+
+	UpdateNodeDensityBounds(0, voxels, VIntVector::Max(minCell, 0), VIntVector::Min(maxCell, (int)GetCellCountAlongAxis() - 1), outChangedNodes);
+}
+
+bool VolumeRaytracer::Voxel::VLinearCellOctree::HasDensityBounds() const
+{
+	return !DensityBounds.empty() && DensityBounds.size() == Nodes.size();
+}
+
+const VolumeRaytracer::Voxel::VOctreeDensityBounds& VolumeRaytracer::Voxel::VLinearCellOctree::GetDensityBounds(const size_t& nodeIndex) const
+{
+	return DensityBounds[nodeIndex];
+}
+
+float VolumeRaytracer::Voxel::VLinearCellOctree::GetDistanceBound(const size_t& nodeIndex) const
+{
+	if (DensityPerCell <= 0 || !HasDensityBounds())
+	{
+		return 0;
+	}
+
+	const VOctreeDensityBounds& bounds = DensityBounds[nodeIndex];
+
+	float densityMargin = 0;
+
+	if (bounds.IsOutside())
+	{
+		densityMargin = bounds.MinDensity;
+	}
+	else if (bounds.IsInside())
+	{
+		densityMargin = -bounds.MaxDensity;
+	}
+
+	//The density the field can change over one cell diagonal is not available for skipping
+	return std::max((densityMargin - CELL_DIAGONAL * DensityPerCell) / DensityPerCell, 0.f);
+}
+
+bool VolumeRaytracer::Voxel::VLinearCellOctree::FindFirstSurfaceCandidate(const VVector& origin, const VVector& direction, const float& maxDistance, VOctreeRayHit& outHit, size_t* outVisitedNodeCount /*= nullptr*/) const
+{
+	float cellCount = (float)GetCellCountAlongAxis();
+	float directionLength = direction.Length();
+
+	if (outVisitedNodeCount != nullptr)
+	{
+		*outVisitedNodeCount = 0;
+	}
+
+	if (Nodes.empty() || directionLength <= 0)
+	{
+		return false;
+	}
+
+	VVector inverseDirection = VVector(1.f / direction.X, 1.f / direction.Y, 1.f / direction.Z);
+
+	float rootEnter = 0;
+	float rootExit = 0;
+
+	if (!IntersectRayBox(origin, inverseDirection, VVector::ZERO, VVector::ONE * cellCount, rootEnter, rootExit))
+	{
+		return false;
+	}
+
+	bool hasBounds = HasDensityBounds();
+
+	//Nudges the ray over node borders, measured in cells
+	float stepEpsilon = 1e-4f / directionLength;
+
+	float t = std::max(rootEnter, 0.f);
+	float tEnd = std::min(rootExit, maxDistance);
+
+	size_t visitedNodeCount = 0;
+	bool found = false;
+
+	while (t <= tEnd && !found)
+	{
+		VVector position = origin + direction * t;
+		position = VVector::Max(VVector::ZERO, VVector::Min(position, VVector::ONE * (cellCount - 1e-3f)));
+
+		uint32_t nodeIndex = 0;
+		float regionSize = cellCount;
+		VVector regionMin = VVector::ZERO;
+
+		//Walks down from the root to the first node that is uniform or a leaf
+		while (true)
+		{
+			const VLinearOctreeNode& node = Nodes[nodeIndex];
+			visitedNodeCount++;
+
+			if (hasBounds && DensityBounds[nodeIndex].IsInside())
+			{
+				outHit.Inside = true;
+				found = true;
+				break;
+			}
+
+			if (hasBounds && DensityBounds[nodeIndex].IsOutside())
+			{
+				break;
+			}
+
+			if (node.IsLeaf())
+			{
+				outHit.Inside = false;
+				found = true;
+				break;
+			}
+
+			regionSize *= 0.5f;
+
+			VVector center = regionMin + VVector::ONE * regionSize;
+			int childIndex = (position.X >= center.X ? 1 : 0) | (position.Y >= center.Y ? 2 : 0) | (position.Z >= center.Z ? 4 : 0);
+
+			regionMin = regionMin + VVector(VCell::VOXEL_COORDS[childIndex].X, VCell::VOXEL_COORDS[childIndex].Y, VCell::VOXEL_COORDS[childIndex].Z) * regionSize;
+			nodeIndex = node.FirstChild + childIndex;
+		}
+
+		if (found)
+		{
+			outHit.Distance = t;
+			outHit.NodeIndex = nodeIndex;
+			outHit.CellIndex = Nodes[nodeIndex].GetCellIndex();
+		}
+		else
+		{
+			float nodeEnter = 0;
+			float nodeExit = t;
+
+			IntersectRayBox(origin, inverseDirection, regionMin, regionMin + VVector::ONE * regionSize, nodeEnter, nodeExit);
+
+			//Nothing within the distance bound can be surface, even behind the node border
+			float skipDistance = std::max(nodeExit, t + GetDistanceBound(nodeIndex) / directionLength);
+
+			//Written so that a NaN from an axis parallel ray still moves forward
+			t = (skipDistance > t ? skipDistance : t) + stepEpsilon;
+		}
+	}
+
+	if (outVisitedNodeCount != nullptr)
+	{
+		*outVisitedNodeCount = visitedNodeCount;
+	}
+
+	return found;
+}
+
+VolumeRaytracer::Voxel::VOctreeDensityBounds VolumeRaytracer::Voxel::VLinearCellOctree::BuildBranchDensityBounds(const uint32_t& nodeIndex)
+{
+	const VLinearOctreeNode& node = Nodes[nodeIndex];
+
+	if (node.IsLeaf())
+	{
+		return DensityBounds[nodeIndex];
+	}
+
+	VOctreeDensityBounds bounds = EmptyDensityBounds();
+
+	for (int i = 0; i < 8; i++)
+	{
+		ExtendDensityBounds(bounds, BuildBranchDensityBounds(node.FirstChild + i));
+	}
+
+	DensityBounds[nodeIndex] = bounds;
+
+	return bounds;
+}
+
+VolumeRaytracer::Voxel::VOctreeDensityBounds VolumeRaytracer::Voxel::VLinearCellOctree::UpdateNodeDensityBounds(const uint32_t& nodeIndex, const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes)
+{
+	VLinearOctreeNode node = Nodes[nodeIndex];
+
+	VIntVector regionMin = node.GetCellIndex();
+	VIntVector regionMax = GetRegionMaxCell(node, MaxDepth);
+
+	if (regionMax.X < minCell.X || regionMax.Y < minCell.Y || regionMax.Z < minCell.Z ||
+		regionMin.X > maxCell.X || regionMin.Y > maxCell.Y || regionMin.Z > maxCell.Z)
+	{
+		return DensityBounds[nodeIndex];
+	}
+
+	VOctreeDensityBounds bounds;
+
+	if (node.IsLeaf())
+	{
+		if (node.Depth == MaxDepth)
+		{
+			bounds = EmptyDensityBounds();
+		}
+		else
+		{
+			//Voxels outside the box did not change, so the old interval still covers them
+			bounds = DensityBounds[nodeIndex];
+		}
+
+		ReadDensityBounds(voxels, VIntVector::Max(regionMin, minCell), VIntVector::Min(regionMax, maxCell), bounds);
+	}
+	else
+	{
+		bounds = EmptyDensityBounds();
+
+		for (int i = 0; i < 8; i++)
+		{
+			ExtendDensityBounds(bounds, UpdateNodeDensityBounds(node.FirstChild + i, voxels, minCell, maxCell, outChangedNodes));
+		}
+	}
+
+	const VOctreeDensityBounds& oldBounds = DensityBounds[nodeIndex];
+
+	if (oldBounds.MinDensity != bounds.MinDensity || oldBounds.MaxDensity != bounds.MaxDensity)
+	{
+		DensityBounds[nodeIndex] = bounds;
+
+		VLinearOctreeNodeRange nodeRange;
+		nodeRange.FirstNode = nodeIndex;
+		nodeRange.NodeCount = 1;
+
+		outChangedNodes.push_back(nodeRange);
+	}
+
+	return bounds;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "MortonVoxelStorage.h"
+
+const size_t VolumeRaytracer::Voxel::VMortonVoxelStorage::TILE_SIZE;
+const size_t VolumeRaytracer::Voxel::VMortonVoxelStorage::TILE_VOXEL_COUNT;
+
+namespace
+{
+	struct VTileMortonTable
+	{
+	public:
+		VTileMortonTable()
+		{
+			for (uint32_t x = 0; x < VolumeRaytracer::Voxel::VMortonVoxelStorage::TILE_SIZE; x++)
+			{
+				for (uint32_t y = 0; y < VolumeRaytracer::Voxel::VMortonVoxelStorage::TILE_SIZE; y++)
+				{
+					for (uint32_t z = 0; z < VolumeRaytracer::Voxel::VMortonVoxelStorage::TILE_SIZE; z++)
+					{
+						Offsets[(x << 6) | (y << 3) | z] = (uint16_t)VolumeRaytracer::VMathHelpers::MortonEncode3D(x, y, z);
+					}
+				}
+			}
+		}
+
+		uint16_t Offsets[VolumeRaytracer::Voxel::VMortonVoxelStorage::TILE_VOXEL_COUNT];
+	};
+
+	const VTileMortonTable TILE_MORTON_TABLE;
+}
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VMortonVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Morton;
+}
+
+void VolumeRaytracer::Voxel::VMortonVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+	TileCountAlongAxis = (VoxelCountAlongAxis + TILE_SIZE - 1) / TILE_SIZE;
+
+	Voxels = std::make_shared<std::vector<VVoxel>>((uint64_t)TileCountAlongAxis * TileCountAlongAxis * TileCountAlongAxis * TILE_VOXEL_COUNT, fillVoxel);
+}
+
+void VolumeRaytracer::Voxel::VMortonVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	MakeVoxelsUnique();
+
+	(*Voxels)[GetStorageIndex(voxelIndex)] = voxel;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VMortonVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	return (*Voxels)[GetStorageIndex(voxelIndex)];
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VMortonVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	return GetVoxel(VMathHelpers::Index1DTo3D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis));
+}
+
+size_t VolumeRaytracer::Voxel::VMortonVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VMortonVoxelStorage::GetAllocatedBytes() const
+{
+	return Voxels != nullptr ? Voxels->size() * sizeof(VVoxel) : 0;
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VMortonVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = Voxels->size() * sizeof(VVoxel);
+	res->Buffer = new char[res->BufferSize];
+
+	memcpy(res->Buffer, Voxels->data(), res->BufferSize);
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VMortonVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	Allocate(voxelCountAlongAxis, VVoxel());
+
+	size_t bufferSize = VMathHelpers::Min(archive->BufferSize, Voxels->size() * sizeof(VVoxel));
+
+	memcpy(Voxels->data(), archive->Buffer, bufferSize);
+}
+
+size_t VolumeRaytracer::Voxel::VMortonVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	uint64_t tileCountAlongAxis = (voxelCountAlongAxis + TILE_SIZE - 1) / TILE_SIZE;
+
+	return tileCountAlongAxis * tileCountAlongAxis * tileCountAlongAxis * TILE_VOXEL_COUNT * sizeof(VVoxel);
+}
+
+size_t VolumeRaytracer::Voxel::VMortonVoxelStorage::GetStorageIndex(const VIntVector& voxelIndex) const
+{
+	size_t tileIndex = VMathHelpers::Index3DTo1D(voxelIndex.X >> 3, voxelIndex.Y >> 3, voxelIndex.Z >> 3, TileCountAlongAxis, TileCountAlongAxis);
+	size_t localIndex = ((voxelIndex.X & 7) << 6) | ((voxelIndex.Y & 7) << 3) | (voxelIndex.Z & 7);
+
+	return tileIndex * TILE_VOXEL_COUNT + TILE_MORTON_TABLE.Offsets[localIndex];
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VMortonVoxelStorage::Clone() const
+{
+	//Shares the voxels, the first write on either side copies them
+	return std::make_shared<VMortonVoxelStorage>(*this);
+}
+
+void VolumeRaytracer::Voxel::VMortonVoxelStorage::PrepareConcurrentWrite(const VIntVector&, const VIntVector&)
+{
+	MakeVoxelsUnique();
+}
+
+bool VolumeRaytracer::Voxel::VMortonVoxelStorage::AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	return AtomicMinVoxelInPlace((*Voxels)[GetStorageIndex(voxelIndex)], voxel);
+}
+
+void VolumeRaytracer::Voxel::VMortonVoxelStorage::MakeVoxelsUnique()
+{
+	if (Voxels.use_count() > 1)
+	{
+		Voxels = std::make_shared<std::vector<VVoxel>>(*Voxels);
+	}
+}
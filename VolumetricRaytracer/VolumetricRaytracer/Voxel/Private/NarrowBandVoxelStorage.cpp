@@ -0,0 +1,464 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "NarrowBandVoxelStorage.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::BRICK_SIZE;
+const size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::BRICK_VOXEL_COUNT;
+const uint32_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::BAND_CELL_COUNT;
+const uint32_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::FAR_FIELD_BRICK;
+const uint32_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::FAR_FIELD_INSIDE;
+
+VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::VNarrowBandVoxelStorage(const float& cellSize)
+	: BandWidth(cellSize * BAND_CELL_COUNT)
+{}
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::NarrowBand;
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+	BrickCountAlongAxis = (VoxelCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+	FillVoxel = fillVoxel;
+
+	//A fill density inside the band can't be represented implicitly. It reads back clamped to the band edge
+	FarFieldDensity = VMathHelpers::Max(std::abs(FillVoxel.Density), BandWidth);
+
+	BrickPool.clear();
+	BrickPool.shrink_to_fit();
+	FreeBricks.clear();
+
+	BrickTable.clear();
+	BrickTable.resize((uint64_t)BrickCountAlongAxis * BrickCountAlongAxis * BrickCountAlongAxis, GetFarFieldEntry(FillVoxel));
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	size_t brickIndex = GetBrickIndex(voxelIndex);
+	uint32_t poolIndex = BrickTable[brickIndex];
+
+	if ((poolIndex & FAR_FIELD_BRICK) != 0)
+	{
+		if (IsFarFieldVoxel(voxel) && GetFarFieldEntry(voxel) == poolIndex)
+		{
+			return;
+		}
+
+		poolIndex = AllocateBrick(brickIndex);
+	}
+
+	GetBrickVoxelsForEditing(poolIndex)[GetVoxelIndexInBrick(voxelIndex)] = voxel;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+	if ((poolIndex & FAR_FIELD_BRICK) != 0)
+	{
+		return GetFarFieldVoxel(poolIndex);
+	}
+
+	return GetBrickVoxels(poolIndex)[GetVoxelIndexInBrick(voxelIndex)];
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	return GetVoxel(VMathHelpers::Index1DTo3D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis));
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetAllocatedBytes() const
+{
+	return BrickTable.size() * sizeof(uint32_t) + GetAllocatedBrickCount() * sizeof(VBrick);
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = GetAllocatedBrickCount() * sizeof(VBrick);
+	res->Buffer = res->BufferSize > 0 ? new char[res->BufferSize] : nullptr;
+
+	std::shared_ptr<VSerializationArchive> brickTable = std::make_shared<VSerializationArchive>();
+	brickTable->BufferSize = BrickTable.size() * sizeof(uint32_t);
+	brickTable->Buffer = new char[brickTable->BufferSize];
+
+	uint32_t* table = reinterpret_cast<uint32_t*>(brickTable->Buffer);
+	uint32_t brickCount = 0;
+
+	//Released bricks leave holes in the pool. The file only contains the bricks that are still referenced
+	for (size_t i = 0; i < BrickTable.size(); i++)
+	{
+		table[i] = BrickTable[i];
+
+		if ((BrickTable[i] & FAR_FIELD_BRICK) == 0)
+		{
+			memcpy(res->Buffer + brickCount * sizeof(VBrick), BrickPool[BrickTable[i]]->Voxels, sizeof(VBrick));
+			table[i] = brickCount++;
+		}
+	}
+
+	res->Properties["BrickTable"] = brickTable;
+	res->Properties["FillVoxel"] = VSerializationArchive::From<VVoxel>(&FillVoxel);
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	FillVoxel = archive->Properties["FillVoxel"]->To<VVoxel>();
+
+	Allocate(voxelCountAlongAxis, FillVoxel);
+
+	std::shared_ptr<VSerializationArchive> brickTable = archive->Properties["BrickTable"];
+
+	memcpy(BrickTable.data(), brickTable->Buffer, VMathHelpers::Min(brickTable->BufferSize, BrickTable.size() * sizeof(uint32_t)));
+
+	BrickPool.resize(archive->BufferSize / sizeof(VBrick));
+
+	VBrick* mappedBricks = archive->GetMappedBufferAs<VBrick>(BrickPool.size());
+
+	for (size_t i = 0; i < BrickPool.size(); i++)
+	{
+		if (mappedBricks != nullptr)
+		{
+			//Bricks alias the mapped file and share ownership of the archive. GetBrickVoxelsForEditing copies them on first write
+			BrickPool[i] = std::shared_ptr<VBrick>(archive, mappedBricks + i);
+		}
+		else
+		{
+			BrickPool[i] = std::make_shared<VBrick>();
+			memcpy(BrickPool[i]->Voxels, archive->Buffer + i * sizeof(VBrick), sizeof(VBrick));
+		}
+	}
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::Clone() const
+{
+	return std::make_shared<VNarrowBandVoxelStorage>(*this);
+}
+
+bool VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+	//Allocating a brick is not thread safe, so PrepareConcurrentWrite has to allocate every brick that gets written
+	assert((poolIndex & FAR_FIELD_BRICK) == 0 && "AtomicMinVoxel outside of a prepared region");
+
+	if ((poolIndex & FAR_FIELD_BRICK) != 0)
+	{
+		return false;
+	}
+
+	return AtomicMinVoxelInPlace(BrickPool[poolIndex]->Voxels[GetVoxelIndexInBrick(voxelIndex)], voxel);
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::PrepareConcurrentWrite(const VIntVector& min, const VIntVector& max)
+{
+	VIntVector minBrick = VIntVector::Max(min, 0) / BRICK_SIZE;
+	VIntVector maxBrick = VIntVector::Min(max, (int)VoxelCountAlongAxis - 1) / BRICK_SIZE;
+
+	for (int x = minBrick.X; x <= maxBrick.X; x++)
+	{
+		for (int z = minBrick.Z; z <= maxBrick.Z; z++)
+		{
+			for (int y = minBrick.Y; y <= maxBrick.Y; y++)
+			{
+				size_t brickIndex = VMathHelpers::Index3DTo1D(x, y, z, BrickCountAlongAxis, BrickCountAlongAxis);
+				uint32_t poolIndex = BrickTable[brickIndex];
+
+				if ((poolIndex & FAR_FIELD_BRICK) != 0)
+				{
+					AllocateBrick(brickIndex);
+				}
+				else
+				{
+					//Detach bricks shared with snapshots so concurrent writes don't have to copy
+					GetBrickVoxelsForEditing(poolIndex);
+				}
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::FinishConcurrentWrite(const VIntVector& min, const VIntVector& max)
+{
+	//Prepared bricks that only received far field writes go back to the table
+	ReleaseFarFieldBricks(min, max);
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			int y = min.Y;
+
+			while (y <= max.Y)
+			{
+				VIntVector voxelIndex = VIntVector(x, y, z);
+				int segmentLength = VMathHelpers::Min((int)(BRICK_SIZE - y % BRICK_SIZE), max.Y - y + 1);
+				uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+				if ((poolIndex & FAR_FIELD_BRICK) != 0)
+				{
+					std::fill(outVoxels, outVoxels + segmentLength, GetFarFieldVoxel(poolIndex));
+				}
+				else
+				{
+					memcpy(outVoxels, GetBrickVoxels(poolIndex) + GetVoxelIndexInBrick(voxelIndex), segmentLength * sizeof(VVoxel));
+				}
+
+				outVoxels += segmentLength;
+				y += segmentLength;
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			int y = min.Y;
+
+			while (y <= max.Y)
+			{
+				VIntVector voxelIndex = VIntVector(x, y, z);
+				int segmentLength = VMathHelpers::Min((int)(BRICK_SIZE - y % BRICK_SIZE), max.Y - y + 1);
+				size_t brickIndex = GetBrickIndex(voxelIndex);
+				uint32_t poolIndex = BrickTable[brickIndex];
+
+				if ((poolIndex & FAR_FIELD_BRICK) != 0)
+				{
+					bool onlyFarField = true;
+
+					for (int i = 0; i < segmentLength && onlyFarField; i++)
+					{
+						onlyFarField = IsFarFieldVoxel(voxels[i]) && GetFarFieldEntry(voxels[i]) == poolIndex;
+					}
+
+					if (!onlyFarField)
+					{
+						poolIndex = AllocateBrick(brickIndex);
+					}
+				}
+
+				if ((poolIndex & FAR_FIELD_BRICK) == 0)
+				{
+					memcpy(GetBrickVoxelsForEditing(poolIndex) + GetVoxelIndexInBrick(voxelIndex), voxels, segmentLength * sizeof(VVoxel));
+				}
+
+				voxels += segmentLength;
+				y += segmentLength;
+			}
+		}
+	}
+}
+
+bool VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::IsUniformMaterial(const VIntVector& min, const VIntVector& max, uint8_t& outMaterial) const
+{
+	VIntVector minBrick = VIntVector::Max(min, 0) / BRICK_SIZE;
+	VIntVector maxBrick = VIntVector::Min(max, (int)VoxelCountAlongAxis - 1) / BRICK_SIZE;
+
+	bool first = true;
+
+	//Only far field bricks know their material without looking at the voxels
+	for (int x = minBrick.X; x <= maxBrick.X; x++)
+	{
+		for (int z = minBrick.Z; z <= maxBrick.Z; z++)
+		{
+			for (int y = minBrick.Y; y <= maxBrick.Y; y++)
+			{
+				uint32_t poolIndex = BrickTable[VMathHelpers::Index3DTo1D(x, y, z, BrickCountAlongAxis, BrickCountAlongAxis)];
+
+				if ((poolIndex & FAR_FIELD_BRICK) == 0 || (!first && (uint8_t)(poolIndex & 0xFF) != outMaterial))
+				{
+					return false;
+				}
+
+				outMaterial = (uint8_t)(poolIndex & 0xFF);
+				first = false;
+			}
+		}
+	}
+
+	return !first;
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::ReleaseFarFieldBricks(const VIntVector& min, const VIntVector& max)
+{
+	VIntVector minBrick = VIntVector::Max(min, 0) / BRICK_SIZE;
+	VIntVector maxBrick = VIntVector::Min(max, (int)VoxelCountAlongAxis - 1) / BRICK_SIZE;
+
+	for (int x = minBrick.X; x <= maxBrick.X; x++)
+	{
+		for (int z = minBrick.Z; z <= maxBrick.Z; z++)
+		{
+			for (int y = minBrick.Y; y <= maxBrick.Y; y++)
+			{
+				size_t brickIndex = VMathHelpers::Index3DTo1D(x, y, z, BrickCountAlongAxis, BrickCountAlongAxis);
+				uint32_t poolIndex = BrickTable[brickIndex];
+
+				if ((poolIndex & FAR_FIELD_BRICK) != 0)
+				{
+					continue;
+				}
+
+				const VVoxel* voxels = GetBrickVoxels(poolIndex);
+
+				VIntVector brickMin = VIntVector(x, y, z) * (int)BRICK_SIZE;
+				VIntVector brickMax = VIntVector::Min(brickMin + VIntVector::ONE * ((int)BRICK_SIZE - 1), (int)VoxelCountAlongAxis - 1) - brickMin;
+
+				uint32_t entry = GetFarFieldEntry(voxels[0]);
+				bool onlyFarField = true;
+
+				//Bricks on the border of the volume are only partially used. The unused voxels are ignored
+				for (int bx = 0; bx <= brickMax.X && onlyFarField; bx++)
+				{
+					for (int by = 0; by <= brickMax.Y && onlyFarField; by++)
+					{
+						for (int bz = 0; bz <= brickMax.Z && onlyFarField; bz++)
+						{
+							const VVoxel& voxel = voxels[VMathHelpers::Index3DTo1D(bx, by, bz, BRICK_SIZE, BRICK_SIZE)];
+							onlyFarField = IsFarFieldVoxel(voxel) && GetFarFieldEntry(voxel) == entry;
+						}
+					}
+				}
+
+				if (onlyFarField)
+				{
+					ReleaseBrick(brickIndex, entry);
+				}
+			}
+		}
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	uint64_t brickCountAlongAxis = (voxelCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+
+	return brickCountAlongAxis * brickCountAlongAxis * brickCountAlongAxis * sizeof(uint32_t);
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetBrickCountAlongAxis() const
+{
+	return BrickCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetAllocatedBrickCount() const
+{
+	return BrickPool.size() - FreeBricks.size();
+}
+
+float VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetBandWidth() const
+{
+	return BandWidth;
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetBrickIndex(const VIntVector& voxelIndex) const
+{
+	return VMathHelpers::Index3DTo1D(voxelIndex / BRICK_SIZE, BrickCountAlongAxis, BrickCountAlongAxis);
+}
+
+size_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetVoxelIndexInBrick(const VIntVector& voxelIndex) const
+{
+	return VMathHelpers::Index3DTo1D(voxelIndex.X % BRICK_SIZE, voxelIndex.Y % BRICK_SIZE, voxelIndex.Z % BRICK_SIZE, BRICK_SIZE, BRICK_SIZE);
+}
+
+uint32_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::AllocateBrick(const size_t& brickIndex)
+{
+	std::shared_ptr<VBrick> brick = std::make_shared<VBrick>();
+	std::fill(brick->Voxels, brick->Voxels + BRICK_VOXEL_COUNT, GetFarFieldVoxel(BrickTable[brickIndex]));
+
+	uint32_t poolIndex = 0;
+
+	if (FreeBricks.empty())
+	{
+		poolIndex = (uint32_t)BrickPool.size();
+		BrickPool.push_back(brick);
+	}
+	else
+	{
+		poolIndex = FreeBricks.back();
+		FreeBricks.pop_back();
+		BrickPool[poolIndex] = brick;
+	}
+
+	BrickTable[brickIndex] = poolIndex;
+
+	return poolIndex;
+}
+
+void VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::ReleaseBrick(const size_t& brickIndex, const uint32_t& farFieldEntry)
+{
+	uint32_t poolIndex = BrickTable[brickIndex];
+
+	BrickPool[poolIndex] = nullptr;
+	FreeBricks.push_back(poolIndex);
+
+	BrickTable[brickIndex] = farFieldEntry;
+}
+
+const VolumeRaytracer::Voxel::VVoxel* VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetBrickVoxels(const uint32_t& poolIndex) const
+{
+	return BrickPool[poolIndex]->Voxels;
+}
+
+VolumeRaytracer::Voxel::VVoxel* VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetBrickVoxelsForEditing(const uint32_t& poolIndex)
+{
+	std::shared_ptr<VBrick>& brick = BrickPool[poolIndex];
+
+	//Brick is still referenced by a snapshot. Copy it before writing
+	if (brick.use_count() > 1)
+	{
+		brick = std::make_shared<VBrick>(*brick);
+	}
+
+	return brick->Voxels;
+}
+
+bool VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::IsFarFieldVoxel(const VVoxel& voxel) const
+{
+	return std::abs(voxel.Density) >= BandWidth;
+}
+
+uint32_t VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetFarFieldEntry(const VVoxel& voxel) const
+{
+	return FAR_FIELD_BRICK | (voxel.Density < 0 ? FAR_FIELD_INSIDE : 0) | voxel.Material;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VNarrowBandVoxelStorage::GetFarFieldVoxel(const uint32_t& entry) const
+{
+	VVoxel voxel;
+	voxel.Material = (uint8_t)(entry & 0xFF);
+	voxel.Density = (entry & FAR_FIELD_INSIDE) != 0 ? -FarFieldDensity : FarFieldDensity;
+
+	return voxel;
+}
\ No newline at end of file
@@ -13,6 +13,8 @@
 */
 
 #include "Octree.h"
+#include "VoxelStorage.h"
+#include "SurfaceBitmap.h"
 #include <cmath>
 
 namespace VolumeRaytracer
@@ -35,7 +37,7 @@ namespace VolumeRaytracer
 VolumeRaytracer::Voxel::VCellOctreeNode::VCellOctreeNode(const size_t& depth)
 	:Depth(depth)
 {
-	ToLeaf(VCell(), VIntVector::ZERO);
+	ToLeaf(VCell(), VIntVector::ZERO, false);
 }
 
 VolumeRaytracer::Voxel::VCellOctreeNode::~VCellOctreeNode()
@@ -50,7 +52,7 @@ void VolumeRaytracer::Voxel::VCellOctreeNode::ToBranch()
 		for (int i = 0; i < 8; i++)
 		{
 			Children.push_back(std::make_shared<VCellOctreeNode>(GetDepth() + 1));
-			Children[i]->ToLeaf(VoxelCell, Index);
+			Children[i]->ToLeaf(VoxelCell, Index, SurfaceCell);
 		}
 
 		Leaf = false;
@@ -58,11 +60,17 @@ void VolumeRaytracer::Voxel::VCellOctreeNode::ToBranch()
 }
 
 void VolumeRaytracer::Voxel::VCellOctreeNode::ToLeaf(const VCell& cell, const VIntVector& index)
+{
+	ToLeaf(cell, index, cell.HasSurface());
+}
+
+void VolumeRaytracer::Voxel::VCellOctreeNode::ToLeaf(const VCell& cell, const VIntVector& index, const bool& hasSurface)
 {
 	Children.clear();
 
 	VoxelCell = cell;
 	Index = index;
+	SurfaceCell = hasSurface;
 
 	Leaf = true;
 }
@@ -71,7 +79,7 @@ bool VolumeRaytracer::Voxel::VCellOctreeNode::TryToMergeNodes()
 {
 	if (IsLeaf())
 	{
-		return !VoxelCell.HasSurface();
+		return !SurfaceCell;
 	}
 	else
 	{
@@ -147,10 +155,10 @@ void VolumeRaytracer::Voxel::VCellOctreeNode::SetChildren(const std::vector<std:
 	Children = std::vector<std::shared_ptr<VCellOctreeNode>>(children);
 }
 
-VolumeRaytracer::Voxel::VCellOctree::VCellOctree(const uint8_t& maxDepth, const std::vector<VVoxel>& voxelArray)
+VolumeRaytracer::Voxel::VCellOctree::VCellOctree(const uint8_t& maxDepth, const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap /*= nullptr*/)
 	:MaxDepth(maxDepth)
 {
-	GenerateOctreeFromVoxelVolume(GetVoxelCountAlongAxis(), voxelArray);
+	GenerateOctreeFromVoxelVolume(voxels, surfaceBitmap);
 }
 
 VolumeRaytracer::Voxel::VCellOctree::~VCellOctree()
@@ -191,6 +199,11 @@ void VolumeRaytracer::Voxel::VCellOctree::GetGPUOctreeStructure(std::vector<VCel
 	size_t size;
 	size = std::ceil(std::cbrtf(nodes.size()));
 
+	while (size * size * size < nodes.size())
+	{
+		size++;
+	}
+
 	outNodeAxisCount = size;
 
 	outNodes.push_back(VCellGPUOctreeNode());
@@ -198,30 +211,65 @@ void VolumeRaytracer::Voxel::VCellOctree::GetGPUOctreeStructure(std::vector<VCel
 	GetGPUNodes(Root, size, 0, outNodes);
 }
 
-void VolumeRaytracer::Voxel::VCellOctree::GenerateOctreeFromVoxelVolume(const size_t& voxelAxisCount, const std::vector<VVoxel>& voxelArray)
+void VolumeRaytracer::Voxel::VCellOctree::GenerateOctreeFromVoxelVolume(const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap)
 {
 	std::vector<std::shared_ptr<VCellOctreeNode>> nodes;
 
 	int cellCountAlongAxis = GetCellCountAlongAxis();
-	int totalCellCount = cellCountAlongAxis * cellCountAlongAxis * cellCountAlongAxis;
+	int64_t totalCellCount = (int64_t)cellCountAlongAxis * cellCountAlongAxis * cellCountAlongAxis;
 
 	nodes.resize(totalCellCount);
 
-	//#pragma omp parallel for 
-	for (int i = 0; i < totalCellCount; i++)
+	size_t voxelCountAlongAxis = voxels.GetVoxelCountAlongAxis();
+	const float* densityPlane = voxels.GetDensityPlane();
+	const uint8_t* materialPlane = voxels.GetMaterialPlane();
+
+	size_t cornerOffsets[8];
+
+	for (int v = 0; v < 8; v++)
+	{
+		cornerOffsets[v] = VMathHelpers::Index3DTo1D(VCell::VOXEL_COORDS[v], voxelCountAlongAxis, voxelCountAlongAxis);
+	}
+
+	bool useSurfaceBitmap = surfaceBitmap != nullptr && surfaceBitmap->GetCellCountAlongAxis() == (size_t)cellCountAlongAxis;
+
+	//Every iteration only writes its own slot, so the tree is the same for any thread count
+	#pragma omp parallel for schedule(static) if(totalCellCount > 4096)
+	for (int64_t i = 0; i < totalCellCount; i++)
 	{
 		size_t voxelIndex1D = (size_t)i;
 		VIntVector cellIndex = VMathHelpers::Index1DTo3D(voxelIndex1D, cellCountAlongAxis, cellCountAlongAxis);
 
 		VCell cell;
 
-		for (int v = 0; v < 8; v++)
+		if (densityPlane != nullptr && materialPlane != nullptr)
+		{
+			size_t baseIndex = VMathHelpers::Index3DTo1D(cellIndex, voxelCountAlongAxis, voxelCountAlongAxis);
+
+			for (int v = 0; v < 8; v++)
+			{
+				cell.Voxels[v].Density = densityPlane[baseIndex + cornerOffsets[v]];
+				cell.Voxels[v].Material = materialPlane[baseIndex + cornerOffsets[v]];
+			}
+		}
+		else
 		{
-			cell.Voxels[v] = voxelArray[VMathHelpers::Index3DTo1D(cellIndex + VCell::VOXEL_COORDS[v], voxelAxisCount, voxelAxisCount)];
+			for (int v = 0; v < 8; v++)
+			{
+				cell.Voxels[v] = voxels.GetVoxel(cellIndex + VCell::VOXEL_COORDS[v]);
+			}
 		}
 
 		nodes[i] = std::make_shared<VCellOctreeNode>(MaxDepth);
-		nodes[i]->ToLeaf(cell, cellIndex);
+
+		if (useSurfaceBitmap)
+		{
+			nodes[i]->ToLeaf(cell, cellIndex, surfaceBitmap->IsSurfaceCell(cellIndex));
+		}
+		else
+		{
+			nodes[i]->ToLeaf(cell, cellIndex);
+		}
 	}
 
 	for (int depth = MaxDepth - 1; depth >= 0; depth--)
@@ -229,7 +277,8 @@ void VolumeRaytracer::Voxel::VCellOctree::GenerateOctreeFromVoxelVolume(const si
 		int internalAxisCount = std::pow(2, MaxDepth - depth);
 		int voxelIndexOffset = internalAxisCount / 2;
 
-		//#pragma omp parallel for collapse(3)
+		//A parent replaces the slot of its first child, which no other parent reads
+		#pragma omp parallel for collapse(3) if(depth > 1)
 		for (int x = 0; x < (cellCountAlongAxis - 1); x += internalAxisCount)
 		{
 			for (int y = 0; y < (cellCountAlongAxis - 1); y += internalAxisCount)
@@ -554,7 +603,7 @@ void VolumeRaytracer::Voxel::VCellOctree::GetGPUNodes(const std::shared_ptr<VCel
 	}
 	else
 	{
-		int firstChildIndex = outGpuNodes.size();
+		size_t firstChildIndex = outGpuNodes.size();
 
 		outGpuNodes.push_back(VCellGPUOctreeNode());
 		outGpuNodes.push_back(VCellGPUOctreeNode());
@@ -569,7 +618,7 @@ void VolumeRaytracer::Voxel::VCellOctree::GetGPUNodes(const std::shared_ptr<VCel
 
 		for (int i = 0; i < 8; i++)
 		{
-			int index = firstChildIndex + i;
+			size_t index = firstChildIndex + i;
 			VIntVector index3D = VMathHelpers::Index1DTo3D(index, gpuVolumeSize, gpuVolumeSize);
 
 			outGpuNodes[currentNodeIndex].Children.push_back(index3D);
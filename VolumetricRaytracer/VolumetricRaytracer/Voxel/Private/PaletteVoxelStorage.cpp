@@ -0,0 +1,368 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "PaletteVoxelStorage.h"
+#include <algorithm>
+
+const size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::BRICK_SIZE;
+const size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::BRICK_VOXEL_COUNT;
+const uint32_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::INVALID_BRICK;
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Palette;
+}
+
+void VolumeRaytracer::Voxel::VPaletteVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+	BrickCountAlongAxis = (VoxelCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+	FillVoxel = fillVoxel;
+
+	BrickPool.clear();
+	BrickPool.shrink_to_fit();
+
+	BrickTable.clear();
+	BrickTable.resize((uint64_t)BrickCountAlongAxis * BrickCountAlongAxis * BrickCountAlongAxis, INVALID_BRICK);
+}
+
+void VolumeRaytracer::Voxel::VPaletteVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	size_t brickIndex = GetBrickIndex(voxelIndex);
+	uint32_t poolIndex = BrickTable[brickIndex];
+
+	if (poolIndex == INVALID_BRICK)
+	{
+		if (IsFillVoxel(voxel))
+		{
+			return;
+		}
+
+		poolIndex = AllocateBrick(brickIndex);
+	}
+
+	VBrick& brick = GetBrickForEditing(poolIndex);
+	size_t indexInBrick = GetVoxelIndexInBrick(voxelIndex);
+
+	brick.Densities[indexInBrick] = voxel.Density;
+	brick.Materials.Set(indexInBrick, voxel.Material);
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+	if (poolIndex == INVALID_BRICK)
+	{
+		return FillVoxel;
+	}
+
+	const VBrick& brick = GetBrick(poolIndex);
+	size_t indexInBrick = GetVoxelIndexInBrick(voxelIndex);
+
+	VVoxel voxel;
+	voxel.Density = brick.Densities[indexInBrick];
+	voxel.Material = brick.Materials.Get(indexInBrick);
+
+	return voxel;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	return GetVoxel(VMathHelpers::Index1DTo3D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis));
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetAllocatedBytes() const
+{
+	size_t res = BrickTable.size() * sizeof(uint32_t) + BrickPool.size() * sizeof(VBrick);
+
+	for (const std::shared_ptr<VBrick>& brick : BrickPool)
+	{
+		res += brick->Materials.GetAllocatedBytes();
+	}
+
+	return res;
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VPaletteVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = BrickPool.size() * sizeof(float) * BRICK_VOXEL_COUNT;
+	res->Buffer = res->BufferSize > 0 ? new char[res->BufferSize] : nullptr;
+
+	std::vector<char> materials;
+
+	for (size_t i = 0; i < BrickPool.size(); i++)
+	{
+		memcpy(res->Buffer + i * sizeof(float) * BRICK_VOXEL_COUNT, BrickPool[i]->Densities, sizeof(float) * BRICK_VOXEL_COUNT);
+		BrickPool[i]->Materials.Serialize(materials);
+	}
+
+	std::shared_ptr<VSerializationArchive> brickTable = std::make_shared<VSerializationArchive>();
+	brickTable->BufferSize = BrickTable.size() * sizeof(uint32_t);
+	brickTable->Buffer = new char[brickTable->BufferSize];
+
+	memcpy(brickTable->Buffer, BrickTable.data(), brickTable->BufferSize);
+
+	std::shared_ptr<VSerializationArchive> brickMaterials = std::make_shared<VSerializationArchive>();
+	brickMaterials->BufferSize = materials.size();
+	brickMaterials->Buffer = materials.size() > 0 ? new char[materials.size()] : nullptr;
+
+	if (materials.size() > 0)
+	{
+		memcpy(brickMaterials->Buffer, materials.data(), materials.size());
+	}
+
+	res->Properties["BrickTable"] = brickTable;
+	res->Properties["BrickMaterials"] = brickMaterials;
+	res->Properties["FillVoxel"] = VSerializationArchive::From<VVoxel>(&FillVoxel);
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VPaletteVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	FillVoxel = archive->Properties["FillVoxel"]->To<VVoxel>();
+
+	Allocate(voxelCountAlongAxis, FillVoxel);
+
+	std::shared_ptr<VSerializationArchive> brickTable = archive->Properties["BrickTable"];
+
+	memcpy(BrickTable.data(), brickTable->Buffer, VMathHelpers::Min(brickTable->BufferSize, BrickTable.size() * sizeof(uint32_t)));
+
+	std::shared_ptr<VSerializationArchive> brickMaterials = archive->Properties["BrickMaterials"];
+
+	const char* materials = brickMaterials->Buffer;
+	const char* materialsEnd = brickMaterials->Buffer + brickMaterials->BufferSize;
+
+	BrickPool.resize(archive->BufferSize / (sizeof(float) * BRICK_VOXEL_COUNT));
+
+	for (size_t i = 0; i < BrickPool.size(); i++)
+	{
+		BrickPool[i] = std::make_shared<VBrick>();
+		memcpy(BrickPool[i]->Densities, archive->Buffer + i * sizeof(float) * BRICK_VOXEL_COUNT, sizeof(float) * BRICK_VOXEL_COUNT);
+
+		if (!BrickPool[i]->Materials.Deserialize(materials, materialsEnd))
+		{
+			BrickPool[i]->Materials.Fill(FillVoxel.Material);
+		}
+	}
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VPaletteVoxelStorage::Clone() const
+{
+	return std::make_shared<VPaletteVoxelStorage>(*this);
+}
+
+void VolumeRaytracer::Voxel::VPaletteVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	uint8_t materials[BRICK_SIZE];
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			int y = min.Y;
+
+			while (y <= max.Y)
+			{
+				VIntVector voxelIndex = VIntVector(x, y, z);
+				int segmentLength = VMathHelpers::Min((int)(BRICK_SIZE - y % BRICK_SIZE), max.Y - y + 1);
+				uint32_t poolIndex = BrickTable[GetBrickIndex(voxelIndex)];
+
+				if (poolIndex == INVALID_BRICK)
+				{
+					std::fill(outVoxels, outVoxels + segmentLength, FillVoxel);
+				}
+				else
+				{
+					const VBrick& brick = GetBrick(poolIndex);
+					size_t indexInBrick = GetVoxelIndexInBrick(voxelIndex);
+
+					brick.Materials.Decode(indexInBrick, segmentLength, materials);
+
+					for (int i = 0; i < segmentLength; i++)
+					{
+						outVoxels[i].Density = brick.Densities[indexInBrick + i];
+						outVoxels[i].Material = materials[i];
+					}
+				}
+
+				outVoxels += segmentLength;
+				y += segmentLength;
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VPaletteVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	uint8_t materials[BRICK_SIZE];
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			int y = min.Y;
+
+			while (y <= max.Y)
+			{
+				VIntVector voxelIndex = VIntVector(x, y, z);
+				int segmentLength = VMathHelpers::Min((int)(BRICK_SIZE - y % BRICK_SIZE), max.Y - y + 1);
+				size_t brickIndex = GetBrickIndex(voxelIndex);
+				uint32_t poolIndex = BrickTable[brickIndex];
+
+				if (poolIndex == INVALID_BRICK)
+				{
+					bool onlyFill = true;
+
+					for (int i = 0; i < segmentLength && onlyFill; i++)
+					{
+						onlyFill = IsFillVoxel(voxels[i]);
+					}
+
+					if (!onlyFill)
+					{
+						poolIndex = AllocateBrick(brickIndex);
+					}
+				}
+
+				if (poolIndex != INVALID_BRICK)
+				{
+					VBrick& brick = GetBrickForEditing(poolIndex);
+					size_t indexInBrick = GetVoxelIndexInBrick(voxelIndex);
+
+					for (int i = 0; i < segmentLength; i++)
+					{
+						brick.Densities[indexInBrick + i] = voxels[i].Density;
+						materials[i] = voxels[i].Material;
+					}
+
+					brick.Materials.Encode(indexInBrick, segmentLength, materials);
+				}
+
+				voxels += segmentLength;
+				y += segmentLength;
+			}
+		}
+	}
+}
+
+bool VolumeRaytracer::Voxel::VPaletteVoxelStorage::IsUniformMaterial(const VIntVector& min, const VIntVector& max, uint8_t& outMaterial) const
+{
+	VIntVector minBrick = VIntVector::Max(min, 0) / BRICK_SIZE;
+	VIntVector maxBrick = VIntVector::Min(max, (int)VoxelCountAlongAxis - 1) / BRICK_SIZE;
+
+	bool first = true;
+
+	for (int x = minBrick.X; x <= maxBrick.X; x++)
+	{
+		for (int z = minBrick.Z; z <= maxBrick.Z; z++)
+		{
+			for (int y = minBrick.Y; y <= maxBrick.Y; y++)
+			{
+				uint32_t poolIndex = BrickTable[VMathHelpers::Index3DTo1D(x, y, z, BrickCountAlongAxis, BrickCountAlongAxis)];
+				uint8_t material = FillVoxel.Material;
+
+				//Whole bricks are checked, so a brick only partially inside the box can report a mixed material. That's conservative
+				if (poolIndex != INVALID_BRICK && !GetBrick(poolIndex).Materials.IsUniform(material))
+				{
+					return false;
+				}
+
+				if (first)
+				{
+					outMaterial = material;
+					first = false;
+				}
+				else if (material != outMaterial)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return !first;
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	uint64_t brickCountAlongAxis = (voxelCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+
+	return brickCountAlongAxis * brickCountAlongAxis * brickCountAlongAxis * sizeof(uint32_t);
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetBrickCountAlongAxis() const
+{
+	return BrickCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetAllocatedBrickCount() const
+{
+	return BrickPool.size();
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetBrickIndex(const VIntVector& voxelIndex) const
+{
+	return VMathHelpers::Index3DTo1D(voxelIndex / BRICK_SIZE, BrickCountAlongAxis, BrickCountAlongAxis);
+}
+
+size_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetVoxelIndexInBrick(const VIntVector& voxelIndex) const
+{
+	return VMathHelpers::Index3DTo1D(voxelIndex.X % BRICK_SIZE, voxelIndex.Y % BRICK_SIZE, voxelIndex.Z % BRICK_SIZE, BRICK_SIZE, BRICK_SIZE);
+}
+
+uint32_t VolumeRaytracer::Voxel::VPaletteVoxelStorage::AllocateBrick(const size_t& brickIndex)
+{
+	uint32_t poolIndex = (uint32_t)GetAllocatedBrickCount();
+
+	std::shared_ptr<VBrick> brick = std::make_shared<VBrick>();
+	std::fill(brick->Densities, brick->Densities + BRICK_VOXEL_COUNT, FillVoxel.Density);
+	brick->Materials.Fill(FillVoxel.Material);
+
+	BrickPool.push_back(brick);
+	BrickTable[brickIndex] = poolIndex;
+
+	return poolIndex;
+}
+
+const VolumeRaytracer::Voxel::VPaletteVoxelStorage::VBrick& VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetBrick(const uint32_t& poolIndex) const
+{
+	return *BrickPool[poolIndex];
+}
+
+VolumeRaytracer::Voxel::VPaletteVoxelStorage::VBrick& VolumeRaytracer::Voxel::VPaletteVoxelStorage::GetBrickForEditing(const uint32_t& poolIndex)
+{
+	std::shared_ptr<VBrick>& brick = BrickPool[poolIndex];
+
+	//Brick is still referenced by a snapshot. Copy it before writing
+	if (brick.use_count() > 1)
+	{
+		brick = std::make_shared<VBrick>(*brick);
+	}
+
+	return *brick;
+}
+
+bool VolumeRaytracer::Voxel::VPaletteVoxelStorage::IsFillVoxel(const VVoxel& voxel) const
+{
+	return voxel.Material == FillVoxel.Material && voxel.Density == FillVoxel.Density;
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "PlanarVoxelStorage.h"
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetType() const
+{
+	return EVVoxelStorageType::Planar;
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel)
+{
+	VoxelCountAlongAxis = voxelCountAlongAxis;
+
+	size_t voxelCount = (uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis;
+
+	Densities = std::make_shared<std::vector<float>>(voxelCount, fillVoxel.Density);
+	Materials = std::make_shared<std::vector<uint8_t>>(voxelCount, fillVoxel.Material);
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	size_t index = VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis);
+
+	MakeDensitiesUnique();
+	MakeMaterialsUnique();
+
+	(*Densities)[index] = voxel.Density;
+	(*Materials)[index] = voxel.Material;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetVoxel(const VIntVector& voxelIndex) const
+{
+	return GetVoxel(VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis));
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetVoxel(const size_t& voxelIndex) const
+{
+	VVoxel res;
+	res.Density = (*Densities)[voxelIndex];
+	res.Material = (*Materials)[voxelIndex];
+
+	return res;
+}
+
+size_t VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetVoxelCountAlongAxis() const
+{
+	return VoxelCountAlongAxis;
+}
+
+size_t VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetAllocatedBytes() const
+{
+	return Densities != nullptr ? Densities->size() * sizeof(float) + Materials->size() * sizeof(uint8_t) : 0;
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VPlanarVoxelStorage::Serialize() const
+{
+	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
+	res->BufferSize = Densities->size() * sizeof(float);
+	res->Buffer = new char[res->BufferSize];
+
+	memcpy(res->Buffer, Densities->data(), res->BufferSize);
+
+	std::shared_ptr<VSerializationArchive> materials = std::make_shared<VSerializationArchive>();
+	materials->BufferSize = Materials->size() * sizeof(uint8_t);
+	materials->Buffer = new char[materials->BufferSize];
+
+	memcpy(materials->Buffer, Materials->data(), materials->BufferSize);
+
+	res->Properties["Materials"] = materials;
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive)
+{
+	Allocate(voxelCountAlongAxis, VVoxel());
+
+	memcpy(Densities->data(), archive->Buffer, VMathHelpers::Min(archive->BufferSize, Densities->size() * sizeof(float)));
+
+	std::shared_ptr<VSerializationArchive> materials = archive->Properties["Materials"];
+
+	memcpy(Materials->data(), materials->Buffer, VMathHelpers::Min(materials->BufferSize, Materials->size() * sizeof(uint8_t)));
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	size_t rowLength = max.Y - min.Y + 1;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			const size_t rowStart = VMathHelpers::Index3DTo1D(x, min.Y, z, VoxelCountAlongAxis, VoxelCountAlongAxis);
+			const float* densities = Densities->data() + rowStart;
+			const uint8_t* materials = Materials->data() + rowStart;
+
+			for (size_t y = 0; y < rowLength; y++)
+			{
+				outVoxels[y].Density = densities[y];
+				outVoxels[y].Material = materials[y];
+			}
+
+			outVoxels += rowLength;
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	MakeDensitiesUnique();
+	MakeMaterialsUnique();
+
+	size_t rowLength = max.Y - min.Y + 1;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			const size_t rowStart = VMathHelpers::Index3DTo1D(x, min.Y, z, VoxelCountAlongAxis, VoxelCountAlongAxis);
+			float* densities = Densities->data() + rowStart;
+			uint8_t* materials = Materials->data() + rowStart;
+
+			for (size_t y = 0; y < rowLength; y++)
+			{
+				densities[y] = voxels[y].Density;
+				materials[y] = voxels[y].Material;
+			}
+
+			voxels += rowLength;
+		}
+	}
+}
+
+const float* VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetDensityPlane() const
+{
+	return Densities->data();
+}
+
+const uint8_t* VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetMaterialPlane() const
+{
+	return Materials->data();
+}
+
+float* VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetDensityPlane()
+{
+	MakeDensitiesUnique();
+
+	return Densities->data();
+}
+
+uint8_t* VolumeRaytracer::Voxel::VPlanarVoxelStorage::GetMaterialPlane()
+{
+	MakeMaterialsUnique();
+
+	return Materials->data();
+}
+
+size_t VolumeRaytracer::Voxel::VPlanarVoxelStorage::EstimateAllocatedBytes(const size_t& voxelCountAlongAxis)
+{
+	return (uint64_t)voxelCountAlongAxis * voxelCountAlongAxis * voxelCountAlongAxis * (sizeof(float) + sizeof(uint8_t));
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VPlanarVoxelStorage::Clone() const
+{
+	//Shares both planes, the first write on either side copies the plane it touches
+	return std::make_shared<VPlanarVoxelStorage>(*this);
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::MakeDensitiesUnique()
+{
+	if (Densities.use_count() > 1)
+	{
+		Densities = std::make_shared<std::vector<float>>(*Densities);
+	}
+}
+
+void VolumeRaytracer::Voxel::VPlanarVoxelStorage::MakeMaterialsUnique()
+{
+	if (Materials.use_count() > 1)
+	{
+		Materials = std::make_shared<std::vector<uint8_t>>(*Materials);
+	}
+}
@@ -0,0 +1,470 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "SurfaceBitmap.h"
+#include "VoxelStorage.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define V_USE_AVX2_SURFACE_KERNEL
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define V_USE_SSE2_SURFACE_KERNEL
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	size_t GetWordCount(const size_t& bitCount)
+	{
+		return (bitCount + 63) / 64;
+	}
+
+	size_t PopCount(const uint64_t& value)
+	{
+#ifdef _MSC_VER
+		return (size_t)__popcnt64(value);
+#else
+		return (size_t)__builtin_popcountll(value);
+#endif
+	}
+
+	//Writes one bit per density into outPositive / outNegative. NaN counts as zero like VMathHelpers::Sign
+	void ClassifySigns(const float* densities, const size_t& count, uint64_t* outPositive, uint64_t* outNegative)
+	{
+		size_t wordCount = GetWordCount(count);
+
+		std::fill(outPositive, outPositive + wordCount, 0);
+		std::fill(outNegative, outNegative + wordCount, 0);
+
+		size_t i = 0;
+
+#if defined(V_USE_AVX2_SURFACE_KERNEL)
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 density = _mm256_loadu_ps(densities + i);
+
+			outPositive[i >> 6] |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(density, zero, _CMP_GT_OQ)) << (i & 63);
+			outNegative[i >> 6] |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(density, zero, _CMP_LT_OQ)) << (i & 63);
+		}
+#elif defined(V_USE_SSE2_SURFACE_KERNEL)
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 density = _mm_loadu_ps(densities + i);
+
+			outPositive[i >> 6] |= (uint64_t)_mm_movemask_ps(_mm_cmpgt_ps(density, zero)) << (i & 63);
+			outNegative[i >> 6] |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(density, zero)) << (i & 63);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			outPositive[i >> 6] |= (uint64_t)(densities[i] > 0) << (i & 63);
+			outNegative[i >> 6] |= (uint64_t)(densities[i] < 0) << (i & 63);
+		}
+	}
+
+	//Sets a bit for every cell whose eight materials ANDed together equal the material of its first voxel. Rows need cellCount + 1 entries
+	void ClassifyMaterials(const uint8_t* const rows[4], const size_t& cellCount, uint64_t* outSameMaterial)
+	{
+		std::fill(outSameMaterial, outSameMaterial + GetWordCount(cellCount), 0);
+
+		size_t i = 0;
+
+#if defined(V_USE_AVX2_SURFACE_KERNEL)
+		for (; i + 32 <= cellCount; i += 32)
+		{
+			__m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[0] + i));
+			__m256i lower = first;
+			__m256i upper = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[0] + i + 1));
+
+			for (int r = 1; r < 4; r++)
+			{
+				lower = _mm256_and_si256(lower, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i)));
+				upper = _mm256_and_si256(upper, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i + 1)));
+			}
+
+			__m256i same = _mm256_cmpeq_epi8(_mm256_and_si256(lower, upper), first);
+
+			outSameMaterial[i >> 6] |= (uint64_t)(uint32_t)_mm256_movemask_epi8(same) << (i & 63);
+		}
+#elif defined(V_USE_SSE2_SURFACE_KERNEL)
+		for (; i + 16 <= cellCount; i += 16)
+		{
+			__m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[0] + i));
+			__m128i lower = first;
+			__m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[0] + i + 1));
+
+			for (int r = 1; r < 4; r++)
+			{
+				lower = _mm_and_si128(lower, _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i)));
+				upper = _mm_and_si128(upper, _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i + 1)));
+			}
+
+			__m128i same = _mm_cmpeq_epi8(_mm_and_si128(lower, upper), first);
+
+			outSameMaterial[i >> 6] |= (uint64_t)(uint32_t)_mm_movemask_epi8(same) << (i & 63);
+		}
+#endif
+
+		for (; i < cellCount; i++)
+		{
+			uint8_t material = rows[0][i] & rows[0][i + 1];
+
+			for (int r = 1; r < 4; r++)
+			{
+				material &= rows[r][i] & rows[r][i + 1];
+			}
+
+			outSameMaterial[i >> 6] |= (uint64_t)(material == rows[0][i]) << (i & 63);
+		}
+	}
+
+	//Moves the bits of voxel i + 1 to position i, so that combining both describes the cell between the two voxels
+	uint64_t ShiftToNextVoxel(const std::vector<uint64_t>& words, const size_t& wordIndex)
+	{
+		uint64_t next = wordIndex + 1 < words.size() ? words[wordIndex + 1] : 0;
+
+		return (words[wordIndex] >> 1) | (next << 63);
+	}
+}
+
+void VolumeRaytracer::Voxel::VSurfaceBitmap::Build(const IVVoxelStorage& voxels)
+{
+	size_t voxelCountAlongAxis = voxels.GetVoxelCountAlongAxis();
+
+	if (voxelCountAlongAxis < 2)
+	{
+		Clear();
+		return;
+	}
+
+	CellCountAlongAxis = voxelCountAlongAxis - 1;
+
+	Words.clear();
+	Words.resize(GetWordCount((uint64_t)CellCountAlongAxis * CellCountAlongAxis * CellCountAlongAxis), 0);
+
+	UpdateCells(voxels, VIntVector::ZERO, VIntVector::ONE * (int)(CellCountAlongAxis - 1));
+}
+
+void VolumeRaytracer::Voxel::VSurfaceBitmap::Clear()
+{
+	CellCountAlongAxis = 0;
+
+	Words.clear();
+	Words.shrink_to_fit();
+}
+
+void VolumeRaytracer::Voxel::VSurfaceBitmap::UpdateCells(const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell)
+{
+	if (IsEmpty())
+	{
+		return;
+	}
+
+	VIntVector min = VIntVector::Max(minCell, 0);
+	VIntVector max = VIntVector::Min(maxCell, (int)CellCountAlongAxis - 1);
+
+	if (min.X > max.X || min.Y > max.Y || min.Z > max.Z)
+	{
+		return;
+	}
+
+	size_t cellCount = max.Y - min.Y + 1;
+	size_t voxelCount = cellCount + 1;
+	size_t wordCount = GetWordCount(voxelCount);
+
+	//Each step along x reads two voxel planes. Rows are ordered by x, then z
+	size_t zRowCount = max.Z - min.Z + 2;
+	size_t rowCount = zRowCount * 2;
+
+	std::vector<VVoxel> slab(rowCount * voxelCount);
+	std::vector<float> densities(voxelCount);
+	std::vector<uint8_t> materials(rowCount * voxelCount);
+	std::vector<uint64_t> positive(rowCount * wordCount);
+	std::vector<uint64_t> negative(rowCount * wordCount);
+
+	std::vector<uint64_t> andPositive(wordCount);
+	std::vector<uint64_t> orPositive(wordCount);
+	std::vector<uint64_t> andNegative(wordCount);
+	std::vector<uint64_t> orNegative(wordCount);
+	std::vector<uint64_t> sameMaterial(wordCount);
+	std::vector<uint64_t> surface(wordCount);
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		VIntVector slabMin = VIntVector(x, min.Y, min.Z);
+		VIntVector slabMax = VIntVector(x + 1, max.Y + 1, max.Z + 1);
+
+		//Cells of a slab with one material can only contain a surface through a sign change
+		uint8_t uniformMaterial = 0;
+		bool isUniformMaterial = voxels.IsUniformMaterial(slabMin, slabMax, uniformMaterial);
+
+		voxels.ReadBox(slabMin, slabMax, slab.data());
+
+		for (size_t r = 0; r < rowCount; r++)
+		{
+			const VVoxel* row = &slab[r * voxelCount];
+
+			for (size_t y = 0; y < voxelCount; y++)
+			{
+				densities[y] = row[y].Density;
+			}
+
+			if (!isUniformMaterial)
+			{
+				for (size_t y = 0; y < voxelCount; y++)
+				{
+					materials[r * voxelCount + y] = row[y].Material;
+				}
+			}
+
+			ClassifySigns(densities.data(), voxelCount, &positive[r * wordCount], &negative[r * wordCount]);
+		}
+
+		if (isUniformMaterial)
+		{
+			std::fill(sameMaterial.begin(), sameMaterial.end(), ~(uint64_t)0);
+		}
+
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			size_t localZ = z - min.Z;
+			size_t rows[4] = { localZ, zRowCount + localZ, localZ + 1, zRowCount + localZ + 1 };
+
+			const uint8_t* materialRows[4];
+
+			for (int r = 0; r < 4; r++)
+			{
+				materialRows[r] = &materials[rows[r] * voxelCount];
+			}
+
+			if (!isUniformMaterial)
+			{
+				ClassifyMaterials(materialRows, cellCount, sameMaterial.data());
+			}
+
+			for (size_t w = 0; w < wordCount; w++)
+			{
+				andPositive[w] = andNegative[w] = ~(uint64_t)0;
+				orPositive[w] = orNegative[w] = 0;
+
+				for (int r = 0; r < 4; r++)
+				{
+					andPositive[w] &= positive[rows[r] * wordCount + w];
+					orPositive[w] |= positive[rows[r] * wordCount + w];
+					andNegative[w] &= negative[rows[r] * wordCount + w];
+					orNegative[w] |= negative[rows[r] * wordCount + w];
+				}
+			}
+
+			for (size_t w = 0; w < wordCount; w++)
+			{
+				uint64_t cellAndPositive = andPositive[w] & ShiftToNextVoxel(andPositive, w);
+				uint64_t cellOrPositive = orPositive[w] | ShiftToNextVoxel(orPositive, w);
+				uint64_t cellAndNegative = andNegative[w] & ShiftToNextVoxel(andNegative, w);
+				uint64_t cellOrNegative = orNegative[w] | ShiftToNextVoxel(orNegative, w);
+
+				//All eight signs are equal if the corners agree on being positive and on being negative
+				uint64_t sameSign = ~(cellAndPositive ^ cellOrPositive) & ~(cellAndNegative ^ cellOrNegative);
+
+				surface[w] = ~(sameSign & sameMaterial[w]);
+			}
+
+			WriteBits(GetBitIndex(x, min.Y, z), surface.data(), cellCount);
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VSurfaceBitmap::UpdateVoxel(const IVVoxelStorage& voxels, const VIntVector& voxelIndex)
+{
+	if (IsEmpty())
+	{
+		return;
+	}
+
+	VIntVector min = VIntVector::Max(voxelIndex - VIntVector::ONE, 0);
+	VIntVector max = VIntVector::Min(voxelIndex + VIntVector::ONE, (int)CellCountAlongAxis);
+	VIntVector size = max - min + VIntVector::ONE;
+
+	VVoxel box[27];
+	voxels.ReadBox(min, max, box);
+
+	for (int x = min.X; x < max.X; x++)
+	{
+		for (int z = min.Z; z < max.Z; z++)
+		{
+			for (int y = min.Y; y < max.Y; y++)
+			{
+				VCell cell;
+
+				for (int v = 0; v < 8; v++)
+				{
+					VIntVector local = VIntVector(x, y, z) - min + VCell::VOXEL_COORDS[v];
+
+					cell.Voxels[v] = box[(local.X * size.Z + local.Z) * size.Y + local.Y];
+				}
+
+				uint64_t bit = cell.HasSurface() ? 1 : 0;
+
+				WriteBits(GetBitIndex(x, y, z), &bit, 1);
+			}
+		}
+	}
+}
+
+bool VolumeRaytracer::Voxel::VSurfaceBitmap::IsEmpty() const
+{
+	return Words.empty();
+}
+
+bool VolumeRaytracer::Voxel::VSurfaceBitmap::IsSurfaceCell(const VIntVector& cellIndex) const
+{
+	int cellCount = (int)CellCountAlongAxis;
+
+	if (IsEmpty() || cellIndex.X < 0 || cellIndex.Y < 0 || cellIndex.Z < 0 || cellIndex.X >= cellCount || cellIndex.Y >= cellCount || cellIndex.Z >= cellCount)
+	{
+		return false;
+	}
+
+	size_t bitIndex = GetBitIndex(cellIndex.X, cellIndex.Y, cellIndex.Z);
+
+	return (Words[bitIndex >> 6] >> (bitIndex & 63)) & 1;
+}
+
+size_t VolumeRaytracer::Voxel::VSurfaceBitmap::CountSurfaceCells() const
+{
+	size_t res = 0;
+
+	for (const uint64_t& word : Words)
+	{
+		res += PopCount(word);
+	}
+
+	return res;
+}
+
+size_t VolumeRaytracer::Voxel::VSurfaceBitmap::CountSurfaceCells(const VIntVector& minCell, const VIntVector& maxCell) const
+{
+	if (IsEmpty())
+	{
+		return 0;
+	}
+
+	VIntVector min = VIntVector::Max(minCell, 0);
+	VIntVector max = VIntVector::Min(maxCell, (int)CellCountAlongAxis - 1);
+
+	size_t res = 0;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z && min.Y <= max.Y; z++)
+		{
+			res += CountBits(GetBitIndex(x, min.Y, z), max.Y - min.Y + 1);
+		}
+	}
+
+	return res;
+}
+
+bool VolumeRaytracer::Voxel::VSurfaceBitmap::HasSurface(const VIntVector& minCell, const VIntVector& maxCell) const
+{
+	if (IsEmpty())
+	{
+		return false;
+	}
+
+	VIntVector min = VIntVector::Max(minCell, 0);
+	VIntVector max = VIntVector::Min(maxCell, (int)CellCountAlongAxis - 1);
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z && min.Y <= max.Y; z++)
+		{
+			if (CountBits(GetBitIndex(x, min.Y, z), max.Y - min.Y + 1) > 0)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+size_t VolumeRaytracer::Voxel::VSurfaceBitmap::GetCellCountAlongAxis() const
+{
+	return CellCountAlongAxis;
+}
+
+const std::vector<uint64_t>& VolumeRaytracer::Voxel::VSurfaceBitmap::GetWords() const
+{
+	return Words;
+}
+
+size_t VolumeRaytracer::Voxel::VSurfaceBitmap::GetBitIndex(const int& x, const int& y, const int& z) const
+{
+	return VMathHelpers::Index3DTo1D(x, y, z, CellCountAlongAxis, CellCountAlongAxis);
+}
+
+void VolumeRaytracer::Voxel::VSurfaceBitmap::WriteBits(const size_t& bitIndex, const uint64_t* bits, const size_t& bitCount)
+{
+	for (size_t i = 0; i < bitCount; i += 64)
+	{
+		size_t count = VMathHelpers::Min((size_t)64, bitCount - i);
+		uint64_t mask = count == 64 ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1);
+		uint64_t value = bits[i >> 6] & mask;
+
+		size_t dst = bitIndex + i;
+		size_t word = dst >> 6;
+		size_t shift = dst & 63;
+
+		Words[word] = (Words[word] & ~(mask << shift)) | (value << shift);
+
+		if (shift + count > 64)
+		{
+			Words[word + 1] = (Words[word + 1] & ~(mask >> (64 - shift))) | (value >> (64 - shift));
+		}
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VSurfaceBitmap::CountBits(const size_t& bitIndex, const size_t& bitCount) const
+{
+	size_t res = 0;
+	size_t end = bitIndex + bitCount;
+
+	for (size_t i = bitIndex; i < end;)
+	{
+		size_t shift = i & 63;
+		size_t count = VMathHelpers::Min(64 - shift, end - i);
+		uint64_t value = Words[i >> 6] >> shift;
+
+		if (count < 64)
+		{
+			value &= ((uint64_t)1 << count) - 1;
+		}
+
+		res += PopCount(value);
+		i += count;
+	}
+
+	return res;
+}
@@ -13,6 +13,7 @@
 */
 
 #include "Voxel.h"
+#include <cmath>
 
 bool VolumeRaytracer::Voxel::VCell::HasSurface() const
 {
@@ -92,3 +93,41 @@ VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VCell::GetAvgVoxel() cons
 }
 
 const float VolumeRaytracer::Voxel::VVoxel::DEFAULT_DENSITY = 30.f;
+
+const float VolumeRaytracer::Voxel::VCompactVoxel::DENSITY_STEPS_PER_CELL = 256.f;
+const uint8_t VolumeRaytracer::Voxel::VCompactVoxel::FLAG_DENSITY_CLAMPED;
+
+VolumeRaytracer::Voxel::VCompactVoxel VolumeRaytracer::Voxel::VCompactVoxel::FromVoxel(const VVoxel& voxel, const float& cellSize)
+{
+	VCompactVoxel res;
+
+	float quantized = std::round(voxel.Density / cellSize * DENSITY_STEPS_PER_CELL);
+
+	if (quantized > INT16_MAX || quantized < -INT16_MAX)
+	{
+		quantized = VMathHelpers::Clamp(quantized, (float)-INT16_MAX, (float)INT16_MAX);
+		res.Flags |= FLAG_DENSITY_CLAMPED;
+	}
+
+	res.Density = (int16_t)quantized;
+
+	//Keep the sign of tiny densities so surfaces do not move when quantizing
+	if (res.Density == 0 && voxel.Density != 0)
+	{
+		res.Density = voxel.Density < 0 ? -1 : 1;
+	}
+
+	res.Material = voxel.Material;
+
+	return res;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VCompactVoxel::ToVoxel(const float& cellSize) const
+{
+	VVoxel res;
+
+	res.Density = Density * cellSize / DENSITY_STEPS_PER_CELL;
+	res.Material = Material;
+
+	return res;
+}
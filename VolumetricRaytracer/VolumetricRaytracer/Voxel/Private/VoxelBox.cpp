@@ -0,0 +1,67 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "VoxelBox.h"
+
+void VolumeRaytracer::Voxel::VVoxelBox::Resize(const VIntVector& min, const VIntVector& max)
+{
+	Min = min;
+	Max = max;
+
+	Voxels.resize(GetVoxelCount());
+}
+
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxel::VVoxelBox::GetSize() const
+{
+	return Max - Min + VIntVector::ONE;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelBox::GetVoxelCount() const
+{
+	VIntVector size = GetSize();
+
+	if (size.X <= 0 || size.Y <= 0 || size.Z <= 0)
+	{
+		return 0;
+	}
+
+	return (uint64_t)size.X * size.Y * size.Z;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelBox::GetLocalIndex(const VIntVector& voxelIndex) const
+{
+	VIntVector size = GetSize();
+
+	return VMathHelpers::Index3DTo1D(voxelIndex - Min, size.Y, size.Z);
+}
+
+VolumeRaytracer::Voxel::VVoxel& VolumeRaytracer::Voxel::VVoxelBox::GetVoxel(const VIntVector& voxelIndex)
+{
+	return Voxels[GetLocalIndex(voxelIndex)];
+}
+
+const VolumeRaytracer::Voxel::VVoxel& VolumeRaytracer::Voxel::VVoxelBox::GetVoxel(const VIntVector& voxelIndex) const
+{
+	return Voxels[GetLocalIndex(voxelIndex)];
+}
+
+VolumeRaytracer::Voxel::VVoxel* VolumeRaytracer::Voxel::VVoxelBox::GetRow(const int& x, const int& z)
+{
+	return &Voxels[GetLocalIndex(VIntVector(x, Min.Y, z))];
+}
+
+const VolumeRaytracer::Voxel::VVoxel* VolumeRaytracer::Voxel::VVoxelBox::GetRow(const int& x, const int& z) const
+{
+	return &Voxels[GetLocalIndex(VIntVector(x, Min.Y, z))];
+}
@@ -0,0 +1,435 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "VoxelDistanceQuery.h"
+#include "VoxelStorage.h"
+#include "SurfaceBitmap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+const float VolumeRaytracer::Voxel::VVoxelDistanceQuery::MIN_DISTANCE_SLOPE = 0.5f;
+const float VolumeRaytracer::Voxel::VVoxelDistanceQuery::MAX_DISTANCE_SLOPE = 1.5f;
+const int VolumeRaytracer::Voxel::VVoxelDistanceQuery::MAX_SURFACE_SEARCH_CELLS;
+const size_t VolumeRaytracer::Voxel::VVoxelDistanceQuery::QUERY_CHUNK_SIZE;
+const float VolumeRaytracer::Voxel::VVoxelDistanceQuery::CAPSULE_SAMPLE_STEP = 0.5f;
+const size_t VolumeRaytracer::Voxel::VVoxelDistanceQuery::CAPSULE_REFINE_SAMPLE_COUNT;
+
+namespace
+{
+	struct VDensityField
+	{
+	public:
+		const VolumeRaytracer::Voxel::IVVoxelStorage* Voxels = nullptr;
+		const float* DensityPlane = nullptr;
+
+		size_t VoxelCountAlongAxis = 0;
+		size_t CornerOffsets[8];
+
+		float GetDensity(const size_t& voxelIndex) const
+		{
+			return DensityPlane != nullptr ? DensityPlane[voxelIndex] : Voxels->GetVoxel(voxelIndex).Density;
+		}
+
+		void GetCorners(const int& x, const int& y, const int& z, float* outCorners) const
+		{
+			size_t baseIndex = VolumeRaytracer::VMathHelpers::Index3DTo1D(x, y, z, VoxelCountAlongAxis, VoxelCountAlongAxis);
+
+			for (int c = 0; c < 8; c++)
+			{
+				outCorners[c] = GetDensity(baseIndex + CornerOffsets[c]);
+			}
+		}
+	};
+
+	//Corners are indexed x | y << 1 | z << 2
+	float SampleTrilinear(const float* corners, const float& u, const float& v, const float& w, float* outGradient)
+	{
+		float x00 = corners[0] + (corners[1] - corners[0]) * u;
+		float x10 = corners[2] + (corners[3] - corners[2]) * u;
+		float x01 = corners[4] + (corners[5] - corners[4]) * u;
+		float x11 = corners[6] + (corners[7] - corners[6]) * u;
+
+		float y0 = x00 + (x10 - x00) * v;
+		float y1 = x01 + (x11 - x01) * v;
+
+		outGradient[0] = ((corners[1] - corners[0]) * (1.f - v) + (corners[3] - corners[2]) * v) * (1.f - w) + ((corners[5] - corners[4]) * (1.f - v) + (corners[7] - corners[6]) * v) * w;
+		outGradient[1] = (x10 - x00) * (1.f - w) + (x11 - x01) * w;
+		outGradient[2] = y1 - y0;
+
+		return y0 + (y1 - y0) * w;
+	}
+
+	//A distance field changes by at most one cell along a cell edge and is never flat. cellDensity is the density one cell apart
+	bool IsDistanceCell(const float* corners, const float& cellDensity)
+	{
+		const float maxEdgeDelta = VolumeRaytracer::Voxel::VVoxelDistanceQuery::MAX_DISTANCE_SLOPE * cellDensity;
+
+		float gradient[3] = { 0.f, 0.f, 0.f };
+
+		for (int c = 0; c < 8; c++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int bit = 1 << axis;
+
+				if ((c & bit) == 0)
+				{
+					float delta = corners[c | bit] - corners[c];
+
+					if (std::abs(delta) > maxEdgeDelta)
+					{
+						return false;
+					}
+
+					gradient[axis] += delta * 0.25f;
+				}
+			}
+		}
+
+		const float minGradient = VolumeRaytracer::Voxel::VVoxelDistanceQuery::MIN_DISTANCE_SLOPE * cellDensity;
+
+		return gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2] >= minGradient * minGradient;
+	}
+
+	VolumeRaytracer::VVector ToNormal(const float* gradient)
+	{
+		float length = std::sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+
+		if (!(length > 0.f))
+		{
+			return VolumeRaytracer::VVector::ZERO;
+		}
+
+		return VolumeRaytracer::VVector(gradient[0] / length, gradient[1] / length, gradient[2] / length);
+	}
+
+	//Closest surface cell around a cell space position. The distance estimate walks to the closest point of the cell and adds the density there, converted to cells
+	bool FindNearestSurface(const VDensityField& field, const VolumeRaytracer::Voxel::VSurfaceBitmap& surfaceBitmap, const float* position, const int& maxSearchCells, const float& invCellDensity, float& outDistanceCells, float* outGradient)
+	{
+		using namespace VolumeRaytracer;
+
+		const int cellCount = (int)field.VoxelCountAlongAxis - 1;
+
+		VIntVector center(
+			VMathHelpers::Clamp((int)std::floor(position[0]), 0, cellCount - 1),
+			VMathHelpers::Clamp((int)std::floor(position[1]), 0, cellCount - 1),
+			VMathHelpers::Clamp((int)std::floor(position[2]), 0, cellCount - 1));
+
+		int foundRadius = -1;
+
+		for (int radius = 1; foundRadius < 0; radius = VMathHelpers::Min(radius * 2, maxSearchCells))
+		{
+			if (surfaceBitmap.HasSurface(center - VIntVector::ONE * radius, center + VIntVector::ONE * radius))
+			{
+				foundRadius = radius;
+			}
+			else if (radius >= maxSearchCells)
+			{
+				break;
+			}
+		}
+
+		if (foundRadius < 0)
+		{
+			return false;
+		}
+
+		//A surface cell in the Chebyshev radius can still be further away than one just outside of it
+		int searchRadius = VMathHelpers::Min((int)std::ceil(foundRadius * 1.7321f) + 1, maxSearchCells);
+
+		VIntVector searchMin = VIntVector::Max(center - VIntVector::ONE * searchRadius, 0);
+		VIntVector searchMax = VIntVector::Min(center + VIntVector::ONE * searchRadius, cellCount - 1);
+
+		bool found = false;
+		outDistanceCells = std::numeric_limits<float>::max();
+
+		for (int x = searchMin.X; x <= searchMax.X; x++)
+		{
+			for (int z = searchMin.Z; z <= searchMax.Z; z++)
+			{
+				if (!surfaceBitmap.HasSurface(VIntVector(x, searchMin.Y, z), VIntVector(x, searchMax.Y, z)))
+				{
+					continue;
+				}
+
+				for (int y = searchMin.Y; y <= searchMax.Y; y++)
+				{
+					if (!surfaceBitmap.IsSurfaceCell(VIntVector(x, y, z)))
+					{
+						continue;
+					}
+
+					float local[3] = {
+						VMathHelpers::Clamp(position[0] - x, 0.f, 1.f),
+						VMathHelpers::Clamp(position[1] - y, 0.f, 1.f),
+						VMathHelpers::Clamp(position[2] - z, 0.f, 1.f)
+					};
+
+					float dx = position[0] - (x + local[0]);
+					float dy = position[1] - (y + local[1]);
+					float dz = position[2] - (z + local[2]);
+
+					float cellDistance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+					if (cellDistance >= outDistanceCells)
+					{
+						continue;
+					}
+
+					float corners[8];
+					float gradient[3];
+
+					field.GetCorners(x, y, z, corners);
+
+					float density = SampleTrilinear(corners, local[0], local[1], local[2], gradient);
+					float estimate = cellDistance + std::abs(density) * invCellDensity;
+
+					if (estimate < outDistanceCells)
+					{
+						outDistanceCells = estimate;
+						outGradient[0] = gradient[0];
+						outGradient[1] = gradient[1];
+						outGradient[2] = gradient[2];
+
+						found = true;
+					}
+				}
+			}
+		}
+
+		return found;
+	}
+}
+
+bool VolumeRaytracer::Voxel::VVoxelDistanceResult::IsOverlapping() const
+{
+	return Distance <= 0.f;
+}
+
+float VolumeRaytracer::Voxel::VVoxelDistanceResult::GetPenetrationDepth() const
+{
+	return VMathHelpers::Max(-Distance, 0.f);
+}
+
+void VolumeRaytracer::Voxel::VVoxelDistanceQuery::QuerySpheres(const IVVoxelStorage& voxels, const VSurfaceBitmap& surfaceBitmap, const float& cellSize, const float& densityScale, const float& volumeExtends, const VVector* centers, const float* radii, const size_t& count, VVoxelDistanceResult* outResults)
+{
+	VDensityField field;
+	field.Voxels = &voxels;
+	field.DensityPlane = voxels.GetDensityPlane();
+	field.VoxelCountAlongAxis = voxels.GetVoxelCountAlongAxis();
+
+	if (field.VoxelCountAlongAxis < 2)
+	{
+		return;
+	}
+
+	for (int c = 0; c < 8; c++)
+	{
+		field.CornerOffsets[c] = VMathHelpers::Index3DTo1D(c & 1, (c >> 1) & 1, (c >> 2) & 1, field.VoxelCountAlongAxis, field.VoxelCountAlongAxis);
+	}
+
+	const float maxPosition = (float)(field.VoxelCountAlongAxis - 1);
+	const int maxCell = (int)field.VoxelCountAlongAxis - 2;
+	const float invCellSize = 1.f / cellSize;
+	const float invDensityScale = 1.f / densityScale;
+	const float cellDensity = cellSize * densityScale;
+	const float invCellDensity = 1.f / cellDensity;
+
+	const int64_t chunkCount = (int64_t)((count + QUERY_CHUNK_SIZE - 1) / QUERY_CHUNK_SIZE);
+
+	//Chunks are processed as structure of arrays so the position and interpolation math vectorizes, only the corner fetches stay scalar
+	#pragma omp parallel for schedule(dynamic) if(chunkCount > 16)
+	for (int64_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		const size_t first = (size_t)chunk * QUERY_CHUNK_SIZE;
+		const size_t chunkSize = VMathHelpers::Min(QUERY_CHUNK_SIZE, count - first);
+
+		float positions[3][QUERY_CHUNK_SIZE];
+		float boxDistances[QUERY_CHUNK_SIZE];
+		int cells[3][QUERY_CHUNK_SIZE];
+		float corners[8][QUERY_CHUNK_SIZE];
+
+		for (size_t i = 0; i < chunkSize; i++)
+		{
+			const VVector& center = centers[first + i];
+
+			positions[0][i] = (center.X + volumeExtends) * invCellSize;
+			positions[1][i] = (center.Y + volumeExtends) * invCellSize;
+			positions[2][i] = (center.Z + volumeExtends) * invCellSize;
+		}
+
+		for (size_t i = 0; i < chunkSize; i++)
+		{
+			float boxDistance = 0.f;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float clamped = VMathHelpers::Clamp(positions[axis][i], 0.f, maxPosition);
+				float outside = positions[axis][i] - clamped;
+
+				boxDistance += outside * outside;
+				positions[axis][i] = clamped;
+				cells[axis][i] = VMathHelpers::Min((int)clamped, maxCell);
+			}
+
+			boxDistances[i] = std::sqrt(boxDistance) * cellSize;
+		}
+
+		for (size_t i = 0; i < chunkSize; i++)
+		{
+			float cellCorners[8];
+
+			field.GetCorners(cells[0][i], cells[1][i], cells[2][i], cellCorners);
+
+			for (int c = 0; c < 8; c++)
+			{
+				corners[c][i] = cellCorners[c];
+			}
+		}
+
+		for (size_t i = 0; i < chunkSize; i++)
+		{
+			float cellCorners[8];
+
+			for (int c = 0; c < 8; c++)
+			{
+				cellCorners[c] = corners[c][i];
+			}
+
+			float gradient[3];
+			float density = SampleTrilinear(cellCorners, positions[0][i] - cells[0][i], positions[1][i] - cells[1][i], positions[2][i] - cells[2][i], gradient);
+			float radius = radii != nullptr ? radii[first + i] : 0.f;
+
+			VVoxelDistanceResult& result = outResults[first + i];
+
+			if (IsDistanceCell(cellCorners, cellDensity))
+			{
+				result.Distance = boxDistances[i] + density * invDensityScale - radius;
+				result.Normal = ToNormal(gradient);
+
+				continue;
+			}
+
+			//The field is clamped here, search for real surface cells. Outside it is enough to look as far as the sphere reaches
+			bool inside = density <= 0.f;
+			int searchCells = inside ? MAX_SURFACE_SEARCH_CELLS : VMathHelpers::Min((int)std::ceil((radius - boxDistances[i]) * invCellSize) + 1, MAX_SURFACE_SEARCH_CELLS);
+
+			float position[3] = { positions[0][i], positions[1][i], positions[2][i] };
+			float surfaceDistance = 0.f;
+
+			if (searchCells > 0 && FindNearestSurface(field, surfaceBitmap, position, searchCells, invCellDensity, surfaceDistance, gradient))
+			{
+				surfaceDistance *= cellSize;
+				result.Normal = ToNormal(gradient);
+			}
+			else
+			{
+				surfaceDistance = VMathHelpers::Max(searchCells, 1) * cellSize;
+				result.Normal = ToNormal(gradient);
+			}
+
+			result.Distance = inside ? boxDistances[i] - surfaceDistance - radius : boxDistances[i] + surfaceDistance - radius;
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelDistanceQuery::QueryCapsules(const IVVoxelStorage& voxels, const VSurfaceBitmap& surfaceBitmap, const float& cellSize, const float& densityScale, const float& volumeExtends, const VVector* starts, const VVector* ends, const float* radii, const size_t& count, VVoxelDistanceResult* outResults)
+{
+	//The density changes by at most MAX_DISTANCE_SLOPE per unit, so between two samples the minimum can't drop much below the closer one.
+	//All samples of all capsules go through one batched sphere query per pass
+	const float sampleStep = CAPSULE_SAMPLE_STEP * cellSize;
+
+	std::vector<size_t> sampleOffsets(count + 1, 0);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float segmentLength = (ends[i] - starts[i]).Length();
+		sampleOffsets[i + 1] = sampleOffsets[i] + (size_t)std::ceil(segmentLength / sampleStep) + 1;
+	}
+
+	std::vector<VVector> centers(sampleOffsets[count]);
+	std::vector<float> sampleRadii(radii != nullptr ? centers.size() : 0);
+	std::vector<VVoxelDistanceResult> results(centers.size());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t sampleCount = sampleOffsets[i + 1] - sampleOffsets[i];
+
+		for (size_t s = 0; s < sampleCount; s++)
+		{
+			float t = sampleCount > 1 ? (float)s / (sampleCount - 1) : 0.f;
+
+			centers[sampleOffsets[i] + s] = VVector::Lerp(starts[i], ends[i], t);
+		}
+
+		if (radii != nullptr)
+		{
+			std::fill(sampleRadii.begin() + sampleOffsets[i], sampleRadii.begin() + sampleOffsets[i + 1], radii[i]);
+		}
+	}
+
+	QuerySpheres(voxels, surfaceBitmap, cellSize, densityScale, volumeExtends, centers.data(), radii != nullptr ? sampleRadii.data() : nullptr, centers.size(), results.data());
+
+	//Second pass over the samples next to the closest one. The interval ends and the closest sample are part of it, so it never gets worse
+	std::vector<VVector> refineCenters(count * CAPSULE_REFINE_SAMPLE_COUNT);
+	std::vector<float> refineRadii(radii != nullptr ? refineCenters.size() : 0);
+	std::vector<VVoxelDistanceResult> refineResults(refineCenters.size());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t sampleCount = sampleOffsets[i + 1] - sampleOffsets[i];
+		size_t closest = 0;
+
+		for (size_t s = 1; s < sampleCount; s++)
+		{
+			if (results[sampleOffsets[i] + s].Distance < results[sampleOffsets[i] + closest].Distance)
+			{
+				closest = s;
+			}
+		}
+
+		float tMin = sampleCount > 1 ? (float)(closest > 0 ? closest - 1 : 0) / (sampleCount - 1) : 0.f;
+		float tMax = sampleCount > 1 ? (float)VMathHelpers::Min(closest + 1, sampleCount - 1) / (sampleCount - 1) : 0.f;
+
+		for (size_t s = 0; s < CAPSULE_REFINE_SAMPLE_COUNT; s++)
+		{
+			float t = tMin + (tMax - tMin) * s / (CAPSULE_REFINE_SAMPLE_COUNT - 1);
+
+			refineCenters[i * CAPSULE_REFINE_SAMPLE_COUNT + s] = VVector::Lerp(starts[i], ends[i], t);
+
+			if (radii != nullptr)
+			{
+				refineRadii[i * CAPSULE_REFINE_SAMPLE_COUNT + s] = radii[i];
+			}
+		}
+	}
+
+	QuerySpheres(voxels, surfaceBitmap, cellSize, densityScale, volumeExtends, refineCenters.data(), radii != nullptr ? refineRadii.data() : nullptr, refineCenters.size(), refineResults.data());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		outResults[i] = refineResults[i * CAPSULE_REFINE_SAMPLE_COUNT];
+
+		for (size_t s = 1; s < CAPSULE_REFINE_SAMPLE_COUNT; s++)
+		{
+			if (refineResults[i * CAPSULE_REFINE_SAMPLE_COUNT + s].Distance < outResults[i].Distance)
+			{
+				outResults[i] = refineResults[i * CAPSULE_REFINE_SAMPLE_COUNT + s];
+			}
+		}
+	}
+}
@@ -0,0 +1,280 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "VoxelMaterialPalette.h"
+#include <algorithm>
+#include <cstring>
+
+VolumeRaytracer::Voxel::VVoxelMaterialPalette::VVoxelMaterialPalette(const size_t& voxelCount /*= 0*/, const uint8_t& material /*= 0*/)
+	: VoxelCount(voxelCount)
+{
+	Fill(material);
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::Fill(const uint8_t& material)
+{
+	BitsPerVoxel = 0;
+
+	Palette.assign(1, material);
+
+	Indices.clear();
+	Indices.shrink_to_fit();
+}
+
+uint8_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::Get(const size_t& voxelIndex) const
+{
+	return Palette[GetPaletteIndex(voxelIndex)];
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::Set(const size_t& voxelIndex, const uint8_t& material)
+{
+	if (BitsPerVoxel == 0 && Palette[0] == material)
+	{
+		return;
+	}
+
+	SetPaletteIndex(voxelIndex, FindOrAddMaterial(material));
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::Decode(const size_t& voxelIndex, const size_t& count, uint8_t* outMaterials) const
+{
+	if (BitsPerVoxel == 0)
+	{
+		std::fill(outMaterials, outMaterials + count, Palette[0]);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		outMaterials[i] = Palette[GetPaletteIndex(voxelIndex + i)];
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::Encode(const size_t& voxelIndex, const size_t& count, const uint8_t* materials)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		Set(voxelIndex + i, materials[i]);
+	}
+}
+
+bool VolumeRaytracer::Voxel::VVoxelMaterialPalette::IsUniform(uint8_t& outMaterial) const
+{
+	outMaterial = Palette[0];
+
+	if (BitsPerVoxel == 0 || VoxelCount == 0)
+	{
+		return true;
+	}
+
+	//Entries are not removed on every write, so a brick can be uniform with a larger palette. Compare whole words against the repeated first index
+	uint32_t first = GetPaletteIndex(0);
+	uint64_t fieldMask = ((uint64_t)1 << BitsPerVoxel) - 1;
+	uint64_t pattern = (~(uint64_t)0 / fieldMask) * first;
+
+	size_t bitCount = VoxelCount * BitsPerVoxel;
+
+	for (size_t w = 0; w < Indices.size(); w++)
+	{
+		size_t validBits = VMathHelpers::Min((size_t)64, bitCount - w * 64);
+		uint64_t mask = validBits == 64 ? ~(uint64_t)0 : (((uint64_t)1 << validBits) - 1);
+
+		if (((Indices[w] ^ pattern) & mask) != 0)
+		{
+			return false;
+		}
+	}
+
+	outMaterial = Palette[first];
+
+	return true;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::GetVoxelCount() const
+{
+	return VoxelCount;
+}
+
+uint8_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::GetBitsPerVoxel() const
+{
+	return BitsPerVoxel;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::GetPaletteSize() const
+{
+	return Palette.size();
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::GetAllocatedBytes() const
+{
+	return Palette.capacity() + Indices.capacity() * sizeof(uint64_t);
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::Serialize(std::vector<char>& outData) const
+{
+	//Layout: bits per voxel, palette size - 1, palette, index words
+	size_t offset = outData.size();
+	size_t indexBytes = Indices.size() * sizeof(uint64_t);
+
+	outData.resize(offset + 2 + Palette.size() + indexBytes);
+
+	outData[offset] = (char)BitsPerVoxel;
+	outData[offset + 1] = (char)(Palette.size() - 1);
+
+	memcpy(&outData[offset + 2], Palette.data(), Palette.size());
+
+	if (indexBytes > 0)
+	{
+		memcpy(&outData[offset + 2 + Palette.size()], Indices.data(), indexBytes);
+	}
+}
+
+bool VolumeRaytracer::Voxel::VVoxelMaterialPalette::Deserialize(const char*& data, const char* dataEnd)
+{
+	if (dataEnd - data < 2)
+	{
+		return false;
+	}
+
+	uint8_t bitsPerVoxel = (uint8_t)data[0];
+	size_t paletteSize = (size_t)(uint8_t)data[1] + 1;
+	size_t indexBytes = GetWordCount(VoxelCount, bitsPerVoxel) * sizeof(uint64_t);
+
+	if ((bitsPerVoxel != 0 && bitsPerVoxel != 1 && bitsPerVoxel != 2 && bitsPerVoxel != 4 && bitsPerVoxel != 8) || (size_t)(dataEnd - data) < 2 + paletteSize + indexBytes)
+	{
+		return false;
+	}
+
+	BitsPerVoxel = bitsPerVoxel;
+
+	Palette.resize(paletteSize);
+	memcpy(Palette.data(), data + 2, paletteSize);
+
+	Indices.resize(indexBytes / sizeof(uint64_t));
+
+	if (indexBytes > 0)
+	{
+		memcpy(Indices.data(), data + 2 + paletteSize, indexBytes);
+	}
+
+	data += 2 + paletteSize + indexBytes;
+
+	return true;
+}
+
+uint32_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::GetPaletteIndex(const size_t& voxelIndex) const
+{
+	if (BitsPerVoxel == 0)
+	{
+		return 0;
+	}
+
+	size_t bit = voxelIndex * BitsPerVoxel;
+
+	//Fields never straddle two words because the widths divide 64
+	return (uint32_t)(Indices[bit >> 6] >> (bit & 63)) & ((1u << BitsPerVoxel) - 1);
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::SetPaletteIndex(const size_t& voxelIndex, const uint32_t& paletteIndex)
+{
+	if (BitsPerVoxel == 0)
+	{
+		return;
+	}
+
+	size_t bit = voxelIndex * BitsPerVoxel;
+	uint64_t mask = (((uint64_t)1 << BitsPerVoxel) - 1) << (bit & 63);
+
+	Indices[bit >> 6] = (Indices[bit >> 6] & ~mask) | (((uint64_t)paletteIndex << (bit & 63)) & mask);
+}
+
+uint32_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::FindOrAddMaterial(const uint8_t& material)
+{
+	for (size_t i = 0; i < Palette.size(); i++)
+	{
+		if (Palette[i] == material)
+		{
+			return (uint32_t)i;
+		}
+	}
+
+	size_t capacity = (size_t)1 << BitsPerVoxel;
+
+	if (Palette.size() >= capacity)
+	{
+		RemoveUnusedMaterials();
+		capacity = (size_t)1 << BitsPerVoxel;
+	}
+
+	if (Palette.size() >= capacity)
+	{
+		uint8_t bitsPerVoxel = BitsPerVoxel == 0 ? 1 : BitsPerVoxel * 2;
+
+		Repack(bitsPerVoxel);
+	}
+
+	Palette.push_back(material);
+
+	return (uint32_t)(Palette.size() - 1);
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::RemoveUnusedMaterials()
+{
+	if (BitsPerVoxel == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> remap(Palette.size(), UINT32_MAX);
+	std::vector<uint8_t> palette;
+
+	for (size_t i = 0; i < VoxelCount; i++)
+	{
+		uint32_t paletteIndex = GetPaletteIndex(i);
+
+		if (remap[paletteIndex] == UINT32_MAX)
+		{
+			remap[paletteIndex] = (uint32_t)palette.size();
+			palette.push_back(Palette[paletteIndex]);
+		}
+
+		SetPaletteIndex(i, remap[paletteIndex]);
+	}
+
+	Palette = palette;
+}
+
+void VolumeRaytracer::Voxel::VVoxelMaterialPalette::Repack(const uint8_t& bitsPerVoxel)
+{
+	std::vector<uint32_t> paletteIndices(VoxelCount);
+
+	for (size_t i = 0; i < VoxelCount; i++)
+	{
+		paletteIndices[i] = GetPaletteIndex(i);
+	}
+
+	BitsPerVoxel = bitsPerVoxel;
+	Indices.assign(GetWordCount(VoxelCount, BitsPerVoxel), 0);
+
+	for (size_t i = 0; i < VoxelCount; i++)
+	{
+		SetPaletteIndex(i, paletteIndices[i]);
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelMaterialPalette::GetWordCount(const size_t& voxelCount, const uint8_t& bitsPerVoxel)
+{
+	return (voxelCount * bitsPerVoxel + 63) / 64;
+}
\ No newline at end of file
@@ -0,0 +1,405 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "VoxelMeshExtractor.h"
+#include "VoxelStorage.h"
+#include "SurfaceBitmap.h"
+#include <cmath>
+
+const int VolumeRaytracer::Voxel::VVoxelMeshExtractor::BRICK_SIZE;
+
+namespace
+{
+	const float QEF_REGULARIZATION = 0.05f;
+
+	const uint8_t CELL_EDGE_CROSSING_X = 0x1;
+	const uint8_t CELL_EDGE_CROSSING_Y = 0x2;
+	const uint8_t CELL_EDGE_CROSSING_Z = 0x4;
+	const uint8_t CELL_CORNER_INSIDE = 0x8;
+
+	//Corners are indexed x | y << 1 | z << 2
+	const int CELL_EDGES[12][2] = {
+		{0, 1}, {2, 3}, {4, 5}, {6, 7},
+		{0, 2}, {1, 3}, {4, 6}, {5, 7},
+		{0, 4}, {1, 5}, {2, 6}, {3, 7}
+	};
+
+	struct VMeshBrick
+	{
+	public:
+		std::vector<int32_t> CellVertices;
+		std::vector<uint8_t> CellFlags;
+
+		std::vector<VolumeRaytracer::VVector> Positions;
+		std::vector<VolumeRaytracer::VVector> Normals;
+		std::vector<uint8_t> Materials;
+		std::vector<uint32_t> Indices;
+
+		uint32_t VertexOffset = 0;
+	};
+
+	//Same inside test the renderer uses when stepping through a cell
+	bool IsInside(const float& density)
+	{
+		return density <= 0.f;
+	}
+
+	void Normalize(float* v)
+	{
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+		if (length > 0.f)
+		{
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+	}
+
+	//Gradient of the trilinear interpolation used by GetDensity in Voxel.hlsli, in cell space
+	void GetTrilinearGradient(const float* corners, const float& u, const float& v, const float& w, float* outGradient)
+	{
+		outGradient[0] = ((corners[1] - corners[0]) * (1.f - v) + (corners[3] - corners[2]) * v) * (1.f - w) + ((corners[5] - corners[4]) * (1.f - v) + (corners[7] - corners[6]) * v) * w;
+		outGradient[1] = ((corners[2] - corners[0]) * (1.f - u) + (corners[3] - corners[1]) * u) * (1.f - w) + ((corners[6] - corners[4]) * (1.f - u) + (corners[7] - corners[5]) * u) * w;
+		outGradient[2] = ((corners[4] - corners[0]) * (1.f - u) + (corners[5] - corners[1]) * u) * (1.f - v) + ((corners[6] - corners[2]) * (1.f - u) + (corners[7] - corners[3]) * u) * v;
+	}
+
+	//Minimizes the distance to the tangent planes at the edge crossings. The regularization pulls the vertex towards the mass point of
+	//the crossings so flat and degenerate cells stay stable. Result is in cell space and clamped to the cell
+	void SolveCellVertex(const float* corners, float* outPosition, float* outNormal)
+	{
+		float points[12][3];
+		float normals[12][3];
+		int crossingCount = 0;
+
+		float mass[3] = { 0.f, 0.f, 0.f };
+
+		for (int e = 0; e < 12; e++)
+		{
+			int a = CELL_EDGES[e][0];
+			int b = CELL_EDGES[e][1];
+
+			if (IsInside(corners[a]) == IsInside(corners[b]))
+			{
+				continue;
+			}
+
+			float t = corners[a] / (corners[a] - corners[b]);
+			float* p = points[crossingCount];
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float pa = (float)((a >> axis) & 1);
+				float pb = (float)((b >> axis) & 1);
+
+				p[axis] = pa + (pb - pa) * t;
+				mass[axis] += p[axis];
+			}
+
+			GetTrilinearGradient(corners, p[0], p[1], p[2], normals[crossingCount]);
+			Normalize(normals[crossingCount]);
+
+			crossingCount++;
+		}
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			mass[axis] /= (float)crossingCount;
+		}
+
+		float ata[6] = { QEF_REGULARIZATION, 0.f, 0.f, QEF_REGULARIZATION, 0.f, QEF_REGULARIZATION };
+		float atb[3] = { 0.f, 0.f, 0.f };
+
+		for (int i = 0; i < crossingCount; i++)
+		{
+			const float* n = normals[i];
+			float d = n[0] * (points[i][0] - mass[0]) + n[1] * (points[i][1] - mass[1]) + n[2] * (points[i][2] - mass[2]);
+
+			ata[0] += n[0] * n[0];
+			ata[1] += n[0] * n[1];
+			ata[2] += n[0] * n[2];
+			ata[3] += n[1] * n[1];
+			ata[4] += n[1] * n[2];
+			ata[5] += n[2] * n[2];
+
+			atb[0] += n[0] * d;
+			atb[1] += n[1] * d;
+			atb[2] += n[2] * d;
+		}
+
+		//Symmetric 3x3 solve with the adjugate, the regularization keeps the determinant positive
+		float c00 = ata[3] * ata[5] - ata[4] * ata[4];
+		float c01 = ata[2] * ata[4] - ata[1] * ata[5];
+		float c02 = ata[1] * ata[4] - ata[2] * ata[3];
+		float c11 = ata[0] * ata[5] - ata[2] * ata[2];
+		float c12 = ata[1] * ata[2] - ata[0] * ata[4];
+		float c22 = ata[0] * ata[3] - ata[1] * ata[1];
+
+		float invDet = 1.f / (ata[0] * c00 + ata[1] * c01 + ata[2] * c02);
+
+		outPosition[0] = VolumeRaytracer::VMathHelpers::Clamp(mass[0] + (c00 * atb[0] + c01 * atb[1] + c02 * atb[2]) * invDet, 0.f, 1.f);
+		outPosition[1] = VolumeRaytracer::VMathHelpers::Clamp(mass[1] + (c01 * atb[0] + c11 * atb[1] + c12 * atb[2]) * invDet, 0.f, 1.f);
+		outPosition[2] = VolumeRaytracer::VMathHelpers::Clamp(mass[2] + (c02 * atb[0] + c12 * atb[1] + c22 * atb[2]) * invDet, 0.f, 1.f);
+
+		GetTrilinearGradient(corners, outPosition[0], outPosition[1], outPosition[2], outNormal);
+		Normalize(outNormal);
+	}
+
+	//Creates the vertices of every surface cell in the brick and remembers which cell edges cross the surface
+	void ExtractBrickVertices(const VolumeRaytracer::Voxel::IVVoxelStorage& voxels, const VolumeRaytracer::VIntVector& minCell, const VolumeRaytracer::VIntVector& maxCell, const float& cellSize, const VolumeRaytracer::VVector& volumeOrigin, VMeshBrick& brick)
+	{
+		using namespace VolumeRaytracer;
+		using namespace VolumeRaytracer::Voxel;
+
+		const int brickSize = VVoxelMeshExtractor::BRICK_SIZE;
+
+		VIntVector maxVoxel = maxCell + VIntVector::ONE;
+		VIntVector boxSize = maxVoxel - minCell + VIntVector::ONE;
+
+		std::vector<VVoxel> box((size_t)boxSize.X * boxSize.Y * boxSize.Z);
+		voxels.ReadBox(minCell, maxVoxel, box.data());
+
+		brick.CellVertices.assign((size_t)brickSize * brickSize * brickSize, -1);
+		brick.CellFlags.assign(brick.CellVertices.size(), 0);
+
+		size_t cornerOffsets[8];
+
+		for (int c = 0; c < 8; c++)
+		{
+			cornerOffsets[c] = (size_t)(c & 1) * boxSize.Y * boxSize.Z + (size_t)((c >> 2) & 1) * boxSize.Y + (size_t)((c >> 1) & 1);
+		}
+
+		for (int x = minCell.X; x <= maxCell.X; x++)
+		{
+			for (int z = minCell.Z; z <= maxCell.Z; z++)
+			{
+				const VVoxel* row = &box[(size_t)(x - minCell.X) * boxSize.Y * boxSize.Z + (size_t)(z - minCell.Z) * boxSize.Y];
+
+				for (int y = minCell.Y; y <= maxCell.Y; y++)
+				{
+					const VVoxel* cellVoxels = row + (y - minCell.Y);
+
+					float corners[8];
+					uint8_t insideMask = 0;
+
+					for (int c = 0; c < 8; c++)
+					{
+						corners[c] = cellVoxels[cornerOffsets[c]].Density;
+						insideMask |= IsInside(corners[c]) ? (uint8_t)(1 << c) : 0;
+					}
+
+					if (insideMask == 0 || insideMask == 0xFF)
+					{
+						continue;
+					}
+
+					size_t localCell = (size_t)(x - minCell.X) * brickSize * brickSize + (size_t)(z - minCell.Z) * brickSize + (size_t)(y - minCell.Y);
+
+					uint8_t flags = (insideMask & 0x1) ? CELL_CORNER_INSIDE : 0;
+					flags |= ((insideMask ^ (insideMask >> 1)) & 0x1) ? CELL_EDGE_CROSSING_X : 0;
+					flags |= ((insideMask ^ (insideMask >> 2)) & 0x1) ? CELL_EDGE_CROSSING_Y : 0;
+					flags |= ((insideMask ^ (insideMask >> 4)) & 0x1) ? CELL_EDGE_CROSSING_Z : 0;
+
+					brick.CellFlags[localCell] = flags;
+					brick.CellVertices[localCell] = (int32_t)brick.Positions.size();
+
+					float position[3];
+					float normal[3];
+
+					SolveCellVertex(corners, position, normal);
+
+					//The deepest inside corner decides the material, like the renderer shading the first inside voxel
+					int materialCorner = -1;
+
+					for (int c = 0; c < 8; c++)
+					{
+						if (IsInside(corners[c]) && (materialCorner < 0 || corners[c] < corners[materialCorner]))
+						{
+							materialCorner = c;
+						}
+					}
+
+					brick.Positions.push_back(volumeOrigin + VVector(x + position[0], y + position[1], z + position[2]) * cellSize);
+					brick.Normals.push_back(VVector(normal[0], normal[1], normal[2]));
+					brick.Materials.push_back(cellVoxels[cornerOffsets[materialCorner]].Material);
+				}
+			}
+		}
+	}
+
+	uint32_t GetCellVertex(const std::vector<VMeshBrick>& bricks, const int& brickCountAlongAxis, const int& x, const int& y, const int& z)
+	{
+		const int brickSize = VolumeRaytracer::Voxel::VVoxelMeshExtractor::BRICK_SIZE;
+
+		const VMeshBrick& brick = bricks[VolumeRaytracer::VMathHelpers::Index3DTo1D(x / brickSize, y / brickSize, z / brickSize, brickCountAlongAxis, brickCountAlongAxis)];
+
+		return brick.VertexOffset + (uint32_t)brick.CellVertices[VolumeRaytracer::VMathHelpers::Index3DTo1D(x % brickSize, y % brickSize, z % brickSize, brickSize, brickSize)];
+	}
+
+	//Emits a quad for every crossing edge starting at a cell of the brick. The quad faces away from the inside
+	void ExtractBrickQuads(const std::vector<VMeshBrick>& bricks, const int& brickCountAlongAxis, const VolumeRaytracer::VIntVector& minCell, const VolumeRaytracer::VIntVector& maxCell, VMeshBrick& brick)
+	{
+		using namespace VolumeRaytracer;
+
+		const int brickSize = Voxel::VVoxelMeshExtractor::BRICK_SIZE;
+
+		const uint8_t edgeFlags[3] = { CELL_EDGE_CROSSING_X, CELL_EDGE_CROSSING_Y, CELL_EDGE_CROSSING_Z };
+
+		//The other two axes of every edge direction in right handed order, the four cells around an edge lie below it along them
+		const int uAxes[3][3] = { {0, 1, 0}, {0, 0, 1}, {1, 0, 0} };
+		const int vAxes[3][3] = { {0, 0, 1}, {1, 0, 0}, {0, 1, 0} };
+
+		for (int x = minCell.X; x <= maxCell.X; x++)
+		{
+			for (int z = minCell.Z; z <= maxCell.Z; z++)
+			{
+				for (int y = minCell.Y; y <= maxCell.Y; y++)
+				{
+					uint8_t flags = brick.CellFlags[(size_t)(x - minCell.X) * brickSize * brickSize + (size_t)(z - minCell.Z) * brickSize + (size_t)(y - minCell.Y)];
+
+					if ((flags & (CELL_EDGE_CROSSING_X | CELL_EDGE_CROSSING_Y | CELL_EDGE_CROSSING_Z)) == 0)
+					{
+						continue;
+					}
+
+					for (int axis = 0; axis < 3; axis++)
+					{
+						if ((flags & edgeFlags[axis]) == 0)
+						{
+							continue;
+						}
+
+						const int* u = uAxes[axis];
+						const int* v = vAxes[axis];
+
+						if (x - u[0] - v[0] < 0 || y - u[1] - v[1] < 0 || z - u[2] - v[2] < 0)
+						{
+							continue;
+						}
+
+						uint32_t quad[4] = {
+							GetCellVertex(bricks, brickCountAlongAxis, x - u[0] - v[0], y - u[1] - v[1], z - u[2] - v[2]),
+							GetCellVertex(bricks, brickCountAlongAxis, x - v[0], y - v[1], z - v[2]),
+							GetCellVertex(bricks, brickCountAlongAxis, x, y, z),
+							GetCellVertex(bricks, brickCountAlongAxis, x - u[0], y - u[1], z - u[2])
+						};
+
+						if ((flags & CELL_CORNER_INSIDE) != 0)
+						{
+							brick.Indices.insert(brick.Indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+						}
+						else
+						{
+							brick.Indices.insert(brick.Indices.end(), { quad[0], quad[2], quad[1], quad[0], quad[3], quad[2] });
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelMesh::Clear()
+{
+	Positions.clear();
+	Normals.clear();
+	Materials.clear();
+	Indices.clear();
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelMesh::GetVertexCount() const
+{
+	return Positions.size();
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelMesh::GetTriangleCount() const
+{
+	return Indices.size() / 3;
+}
+
+void VolumeRaytracer::Voxel::VVoxelMeshExtractor::ExtractMesh(const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap, const float& cellSize, const VVector& volumeOrigin, VVoxelMesh& outMesh)
+{
+	outMesh.Clear();
+
+	int cellCountAlongAxis = (int)voxels.GetVoxelCountAlongAxis() - 1;
+
+	if (cellCountAlongAxis <= 0)
+	{
+		return;
+	}
+
+	int brickCountAlongAxis = (cellCountAlongAxis + BRICK_SIZE - 1) / BRICK_SIZE;
+	int brickCount = brickCountAlongAxis * brickCountAlongAxis * brickCountAlongAxis;
+
+	bool useSurfaceBitmap = surfaceBitmap != nullptr && surfaceBitmap->GetCellCountAlongAxis() == (size_t)cellCountAlongAxis;
+
+	std::vector<VMeshBrick> bricks(brickCount);
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < brickCount; i++)
+	{
+		VIntVector minCell = VMathHelpers::Index1DTo3D(i, brickCountAlongAxis, brickCountAlongAxis) * BRICK_SIZE;
+		VIntVector maxCell = VIntVector::Min(minCell + VIntVector::ONE * (BRICK_SIZE - 1), cellCountAlongAxis - 1);
+
+		if (useSurfaceBitmap && !surfaceBitmap->HasSurface(minCell, maxCell))
+		{
+			continue;
+		}
+
+		ExtractBrickVertices(voxels, minCell, maxCell, cellSize, volumeOrigin, bricks[i]);
+	}
+
+	uint32_t vertexCount = 0;
+
+	for (VMeshBrick& brick : bricks)
+	{
+		brick.VertexOffset = vertexCount;
+		vertexCount += (uint32_t)brick.Positions.size();
+	}
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < brickCount; i++)
+	{
+		if (bricks[i].Positions.empty())
+		{
+			continue;
+		}
+
+		VIntVector minCell = VMathHelpers::Index1DTo3D(i, brickCountAlongAxis, brickCountAlongAxis) * BRICK_SIZE;
+		VIntVector maxCell = VIntVector::Min(minCell + VIntVector::ONE * (BRICK_SIZE - 1), cellCountAlongAxis - 1);
+
+		ExtractBrickQuads(bricks, brickCountAlongAxis, minCell, maxCell, bricks[i]);
+	}
+
+	size_t indexCount = 0;
+
+	for (const VMeshBrick& brick : bricks)
+	{
+		indexCount += brick.Indices.size();
+	}
+
+	outMesh.Positions.reserve(vertexCount);
+	outMesh.Normals.reserve(vertexCount);
+	outMesh.Materials.reserve(vertexCount);
+	outMesh.Indices.reserve(indexCount);
+
+	for (const VMeshBrick& brick : bricks)
+	{
+		outMesh.Positions.insert(outMesh.Positions.end(), brick.Positions.begin(), brick.Positions.end());
+		outMesh.Normals.insert(outMesh.Normals.end(), brick.Normals.begin(), brick.Normals.end());
+		outMesh.Materials.insert(outMesh.Materials.end(), brick.Materials.begin(), brick.Materials.end());
+		outMesh.Indices.insert(outMesh.Indices.end(), brick.Indices.begin(), brick.Indices.end());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "VoxelStorage.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+void VolumeRaytracer::Voxel::IVVoxelStorage::ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const
+{
+	size_t i = 0;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				outVoxels[i++] = GetVoxel(VIntVector(x, y, z));
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::IVVoxelStorage::WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels)
+{
+	size_t i = 0;
+
+	for (int x = min.X; x <= max.X; x++)
+	{
+		for (int z = min.Z; z <= max.Z; z++)
+		{
+			for (int y = min.Y; y <= max.Y; y++)
+			{
+				SetVoxel(VIntVector(x, y, z), voxels[i++]);
+			}
+		}
+	}
+}
+
+bool VolumeRaytracer::Voxel::IVVoxelStorage::AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	std::lock_guard<std::mutex> lock(FallbackWriteMutex);
+
+	if (IsLowerVoxel(voxel, GetVoxel(voxelIndex)))
+	{
+		SetVoxel(voxelIndex, voxel);
+		return true;
+	}
+
+	return false;
+}
+
+bool VolumeRaytracer::Voxel::IVVoxelStorage::IsLowerVoxel(const VVoxel& voxel, const VVoxel& other)
+{
+	return voxel.Density < other.Density || (voxel.Density == other.Density && voxel.Material > other.Material);
+}
+
+bool VolumeRaytracer::Voxel::IVVoxelStorage::AtomicMinVoxelInPlace(VVoxel& target, const VVoxel& voxel)
+{
+	static_assert(sizeof(VVoxel) == sizeof(int64_t), "Voxels need to fit into a 64 bit compare and swap");
+
+	volatile int64_t* address = reinterpret_cast<volatile int64_t*>(&target);
+	int64_t expected = *address;
+
+	while (true)
+	{
+		VVoxel current;
+		memcpy(&current, &expected, sizeof(VVoxel));
+
+		if (!IsLowerVoxel(voxel, current))
+		{
+			return false;
+		}
+
+		//Only replace the fields so the padding bytes stay identical to the expected value
+		int64_t desired = expected;
+		memcpy(reinterpret_cast<char*>(&desired) + offsetof(VVoxel, Material), &voxel.Material, sizeof(voxel.Material));
+		memcpy(reinterpret_cast<char*>(&desired) + offsetof(VVoxel, Density), &voxel.Density, sizeof(voxel.Density));
+
+#ifdef _MSC_VER
+		int64_t previous = _InterlockedCompareExchange64(address, desired, expected);
+#else
+		int64_t previous = __sync_val_compare_and_swap(address, expected, desired);
+#endif
+
+		if (previous == expected)
+		{
+			return true;
+		}
+
+		expected = previous;
+	}
+}
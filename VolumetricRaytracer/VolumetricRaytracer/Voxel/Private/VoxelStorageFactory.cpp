@@ -0,0 +1,69 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#include "VoxelStorageFactory.h"
+#include "DenseVoxelStorage.h"
+#include "BrickVoxelStorage.h"
+#include "CompactVoxelStorage.h"
+#include "PlanarVoxelStorage.h"
+#include "MortonVoxelStorage.h"
+#include "NarrowBandVoxelStorage.h"
+#include "PaletteVoxelStorage.h"
+#include "HalfVoxelStorage.h"
+
+std::shared_ptr<VolumeRaytracer::Voxel::IVVoxelStorage> VolumeRaytracer::Voxel::VVoxelStorageFactory::CreateStorage(const EVVoxelStorageType& storageType, const float& cellSize)
+{
+	switch (storageType)
+	{
+	case EVVoxelStorageType::Brick:
+		return std::make_shared<VBrickVoxelStorage>();
+	case EVVoxelStorageType::Compact:
+		return std::make_shared<VCompactVoxelStorage>(cellSize);
+	case EVVoxelStorageType::Planar:
+		return std::make_shared<VPlanarVoxelStorage>();
+	case EVVoxelStorageType::Morton:
+		return std::make_shared<VMortonVoxelStorage>();
+	case EVVoxelStorageType::NarrowBand:
+		return std::make_shared<VNarrowBandVoxelStorage>(cellSize);
+	case EVVoxelStorageType::Palette:
+		return std::make_shared<VPaletteVoxelStorage>();
+	case EVVoxelStorageType::Half:
+		return std::make_shared<VHalfVoxelStorage>(cellSize);
+	default:
+		return std::make_shared<VDenseVoxelStorage>();
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelStorageFactory::EstimateAllocatedBytes(const EVVoxelStorageType& storageType, const size_t& voxelCountAlongAxis)
+{
+	switch (storageType)
+	{
+	case EVVoxelStorageType::Brick:
+		return VBrickVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	case EVVoxelStorageType::Compact:
+		return VCompactVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	case EVVoxelStorageType::Planar:
+		return VPlanarVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	case EVVoxelStorageType::Morton:
+		return VMortonVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	case EVVoxelStorageType::NarrowBand:
+		return VNarrowBandVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	case EVVoxelStorageType::Palette:
+		return VPaletteVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	case EVVoxelStorageType::Half:
+		return VHalfVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	default:
+		return VDenseVoxelStorage::EstimateAllocatedBytes(voxelCountAlongAxis);
+	}
+}
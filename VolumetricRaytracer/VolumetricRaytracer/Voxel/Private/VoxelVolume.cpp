@@ -14,16 +14,224 @@
 
 #include "VoxelVolume.h"
 #include "MathHelpers.h"
+#include "VoxelStorageFactory.h"
+#include "PlanarVoxelStorage.h"
+#include "LinearOctree.h"
 #include <cmath>
+#include <algorithm>
+#include <limits>
 
-VolumeRaytracer::Voxel::VVoxelVolume::VVoxelVolume(const uint8_t& resolution, const float& volumeExtends) :
+const uint8_t VolumeRaytracer::Voxel::VVoxelVolume::MAX_RESOLUTION;
+const uint8_t VolumeRaytracer::Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION;
+const size_t VolumeRaytracer::Voxel::VVoxelVolume::DIRTY_REGION_SIZE;
+
+namespace
+{
+	//Source samples used for one output coordinate along one axis. The volume is a cube so the same taps are used for x, y and z
+	struct VResampleAxisTaps
+	{
+	public:
+		float Position = 0;
+		int Nearest = 0;
+
+		std::vector<int> Indices;
+		std::vector<float> Weights;
+
+		//Source voxels deciding the sign and material of the output voxel
+		int ReferenceMin = 0;
+		int ReferenceMax = 0;
+		float ReferenceWeights[2] = {1, 0};
+
+		int SourceMin = 0;
+		int SourceMax = 0;
+	};
+
+	float EvaluateResampleKernel(const VolumeRaytracer::Voxel::EVResampleFilter& filter, const float& x)
+	{
+		float t = std::abs(x);
+
+		switch (filter)
+		{
+		case VolumeRaytracer::Voxel::EVResampleFilter::Tricubic:
+			//Catmull-Rom, interpolates the source values exactly at integer positions
+			if (t < 1)
+			{
+				return (1.5f * t - 2.5f) * t * t + 1.f;
+			}
+			else if (t < 2)
+			{
+				return ((-0.5f * t + 2.5f) * t - 4.f) * t + 2.f;
+			}
+			return 0;
+		default:
+			return t < 1 ? 1 - t : 0;
+		}
+	}
+
+	void CalculateResampleTaps(const VolumeRaytracer::Voxel::EVResampleFilter& filter, const size_t& sourceCount, const size_t& targetCount, std::vector<VResampleAxisTaps>& outTaps)
+	{
+		int sourceMax = (int)sourceCount - 1;
+
+		float scale = sourceMax / (targetCount - 1.f);
+
+		//When downsampling the kernel is stretched over the source voxels that fall between two output voxels
+		float kernelScale = VolumeRaytracer::VMathHelpers::Max(scale, 1.f);
+		float radius = (filter == VolumeRaytracer::Voxel::EVResampleFilter::Tricubic ? 2.f : 1.f) * kernelScale;
+
+		int footprint = (int)(scale * 0.5f);
+
+		outTaps.resize(targetCount);
+
+		for (size_t i = 0; i < targetCount; i++)
+		{
+			VResampleAxisTaps& taps = outTaps[i];
+			taps.Position = i * scale;
+			taps.Nearest = VolumeRaytracer::VMathHelpers::Min((int)std::round(taps.Position), sourceMax);
+
+			float weightSum = 0;
+
+			for (int s = (int)std::ceil(taps.Position - radius); s <= (int)std::floor(taps.Position + radius); s++)
+			{
+				float weight = EvaluateResampleKernel(filter, (s - taps.Position) / kernelScale);
+
+				if (weight != 0)
+				{
+					taps.Indices.push_back(VolumeRaytracer::VMathHelpers::Clamp(s, 0, sourceMax));
+					taps.Weights.push_back(weight);
+					weightSum += weight;
+				}
+			}
+
+			for (float& weight : taps.Weights)
+			{
+				weight /= weightSum;
+			}
+
+			if (scale > 1)
+			{
+				//Output voxels sit on source voxels, the reference is the footprint between the neighbouring output voxels
+				taps.ReferenceMin = VolumeRaytracer::VMathHelpers::Max(taps.Nearest - footprint, 0);
+				taps.ReferenceMax = VolumeRaytracer::VMathHelpers::Min(taps.Nearest + footprint, sourceMax);
+			}
+			else
+			{
+				//The reference are the two source voxels enclosing the output voxel
+				taps.ReferenceMin = VolumeRaytracer::VMathHelpers::Min((int)std::floor(taps.Position), sourceMax);
+				taps.ReferenceMax = VolumeRaytracer::VMathHelpers::Min(taps.ReferenceMin + 1, sourceMax);
+
+				float t = taps.Position - taps.ReferenceMin;
+				taps.ReferenceWeights[0] = 1 - t;
+				taps.ReferenceWeights[1] = t;
+			}
+
+			taps.SourceMin = VolumeRaytracer::VMathHelpers::Min(taps.Indices.front(), taps.ReferenceMin);
+			taps.SourceMax = VolumeRaytracer::VMathHelpers::Max(taps.Indices.back(), taps.ReferenceMax);
+		}
+	}
+
+	//Zero weight taps are skipped, so the source range is not monotonic and has to be collected over all output voxels
+	void GetResampleSourceRange(const std::vector<VResampleAxisTaps>& taps, const int& targetMin, const int& targetMax, int& outSourceMin, int& outSourceMax)
+	{
+		outSourceMin = taps[targetMin].SourceMin;
+		outSourceMax = taps[targetMin].SourceMax;
+
+		for (int i = targetMin + 1; i <= targetMax; i++)
+		{
+			outSourceMin = VolumeRaytracer::VMathHelpers::Min(outSourceMin, taps[i].SourceMin);
+			outSourceMax = VolumeRaytracer::VMathHelpers::Max(outSourceMax, taps[i].SourceMax);
+		}
+	}
+
+	//Row of the source box indexed with the global y coordinate
+	inline const VolumeRaytracer::Voxel::VVoxel* GetResampleSourceRow(const VolumeRaytracer::Voxel::VVoxelBox& source, const VolumeRaytracer::VIntVector& sourceSize, const int& x, const int& z)
+	{
+		return source.Voxels.data() + ((size_t)(x - source.Min.X) * sourceSize.Z + (z - source.Min.Z)) * sourceSize.Y - source.Min.Y;
+	}
+
+	VolumeRaytracer::Voxel::VVoxel ResampleVoxel(const VolumeRaytracer::Voxel::VVoxelBox& source, const VolumeRaytracer::VIntVector& sourceSize, const VResampleAxisTaps& tapsX, const VResampleAxisTaps& tapsY, const VResampleAxisTaps& tapsZ, const bool& downsampling)
+	{
+		float density = 0;
+
+		for (size_t ix = 0; ix < tapsX.Indices.size(); ix++)
+		{
+			for (size_t iz = 0; iz < tapsZ.Indices.size(); iz++)
+			{
+				const VolumeRaytracer::Voxel::VVoxel* row = GetResampleSourceRow(source, sourceSize, tapsX.Indices[ix], tapsZ.Indices[iz]);
+				float weightXZ = tapsX.Weights[ix] * tapsZ.Weights[iz];
+
+				for (size_t iy = 0; iy < tapsY.Indices.size(); iy++)
+				{
+					density += weightXZ * tapsY.Weights[iy] * row[tapsY.Indices[iy]].Density;
+				}
+			}
+		}
+
+		//Downsampling: the output is inside if any voxel of its footprint is inside, like the LOD min filter. Thin surface bands survive
+		//Upsampling: the output is inside if the trilinear interpolation of the enclosing voxels is inside, which is where the surface was before
+		float referenceDensity = 0;
+		float minDensity = std::numeric_limits<float>::infinity();
+		const VolumeRaytracer::Voxel::VVoxel* minVoxel = nullptr;
+
+		for (int x = tapsX.ReferenceMin; x <= tapsX.ReferenceMax; x++)
+		{
+			for (int z = tapsZ.ReferenceMin; z <= tapsZ.ReferenceMax; z++)
+			{
+				const VolumeRaytracer::Voxel::VVoxel* row = GetResampleSourceRow(source, sourceSize, x, z);
+
+				for (int y = tapsY.ReferenceMin; y <= tapsY.ReferenceMax; y++)
+				{
+					const VolumeRaytracer::Voxel::VVoxel& voxel = row[y];
+
+					if (voxel.Density < minDensity)
+					{
+						minDensity = voxel.Density;
+						minVoxel = &voxel;
+					}
+
+					if (!downsampling)
+					{
+						referenceDensity += tapsX.ReferenceWeights[x - tapsX.ReferenceMin] * tapsY.ReferenceWeights[y - tapsY.ReferenceMin] * tapsZ.ReferenceWeights[z - tapsZ.ReferenceMin] * voxel.Density;
+					}
+				}
+			}
+		}
+
+		if (downsampling)
+		{
+			referenceDensity = minDensity;
+		}
+
+		bool inside = referenceDensity < 0;
+
+		VolumeRaytracer::Voxel::VVoxel voxel;
+		voxel.Density = inside == (density < 0) ? density : referenceDensity;
+
+		if (inside)
+		{
+			voxel.Material = minVoxel->Material;
+		}
+		else
+		{
+			voxel.Material = GetResampleSourceRow(source, sourceSize, tapsX.Nearest, tapsZ.Nearest)[tapsY.Nearest].Material;
+		}
+
+		return voxel;
+	}
+}
+
+VolumeRaytracer::Voxel::VVoxelVolume::VVoxelVolume(const uint8_t& resolution, const float& volumeExtends, const EVVoxelStorageType& storageType /*= EVVoxelStorageType::Dense*/, const float& densityScale /*= 1.f*/) :
 	VolumeExtends(volumeExtends),
+	DensityScale(densityScale),
 	Resolution(resolution)
 {
-	VoxelCountAlongAxis = 2 + (std::pow(2, Resolution) - 1);
+	VoxelCountAlongAxis = GetVoxelCountAlongAxis(Resolution);
 	CellSize = (volumeExtends * 2) / (VoxelCountAlongAxis - 1.f);
 
-	Voxels.resize(GetVoxelCount(), VVoxel());
+	//Storages measure their density ranges in cells, so they get the density of one cell instead of its size
+	Voxels = VVoxelStorageFactory::CreateStorage(storageType, CellSize * DensityScale);
+	Voxels->Allocate(VoxelCountAlongAxis, VVoxel());
+
+	AllocateDirtyRegions();
 }
 
 unsigned int VolumeRaytracer::Voxel::VVoxelVolume::GetSize() const
@@ -33,7 +241,7 @@ unsigned int VolumeRaytracer::Voxel::VVoxelVolume::GetSize() const
 
 size_t VolumeRaytracer::Voxel::VVoxelVolume::GetVoxelCount() const
 {
-	return VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis;
+	return (uint64_t)VoxelCountAlongAxis * VoxelCountAlongAxis * VoxelCountAlongAxis;
 }
 
 float VolumeRaytracer::Voxel::VVoxelVolume::GetVolumeExtends() const
@@ -46,6 +254,11 @@ float VolumeRaytracer::Voxel::VVoxelVolume::GetCellSize() const
 	return CellSize;
 }
 
+float VolumeRaytracer::Voxel::VVoxelVolume::GetDensityScale() const
+{
+	return DensityScale;
+}
+
 VolumeRaytracer::VAABB VolumeRaytracer::Voxel::VVoxelVolume::GetVolumeBounds() const
 {
 	VAABB res;
@@ -60,9 +273,18 @@ void VolumeRaytracer::Voxel::VVoxelVolume::SetVoxel(const VIntVector& voxelIndex
 {
 	if (IsValidVoxelIndex(voxelIndex))
 	{
-		size_t index = VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis);
+		std::lock_guard<std::mutex> lock(EditMutex);
 
-		Voxels[index] = voxel;
+		Voxels->SetVoxel(voxelIndex, voxel);
+
+		MarkRegionDirtyLocked(voxelIndex, voxelIndex);
+
+		if (!SurfaceBitmapOutdated)
+		{
+			SurfaceBitmap.UpdateVoxel(*Voxels, voxelIndex);
+		}
+
+		UpdateGradientField(voxelIndex, voxelIndex);
 	}
 }
 
@@ -70,9 +292,7 @@ VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VVoxelVolume::GetVoxel(co
 {
 	if (IsValidVoxelIndex(voxelIndex))
 	{
-		size_t index = VMathHelpers::Index3DTo1D(voxelIndex, VoxelCountAlongAxis, VoxelCountAlongAxis);
-
-		return Voxels[index];
+		return Voxels->GetVoxel(voxelIndex);
 	}
 
 	return VVoxel();
@@ -81,7 +301,7 @@ VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VVoxelVolume::GetVoxel(co
 VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VVoxelVolume::GetVoxel(const size_t& voxelIndex) const
 {
 	if(voxelIndex < GetVoxelCount())
-		return Voxels[voxelIndex];
+		return Voxels->GetVoxel(voxelIndex);
 	else
 		return VVoxel();
 }
@@ -93,8 +313,118 @@ bool VolumeRaytracer::Voxel::VVoxelVolume::IsValidVoxelIndex(const VIntVector& v
 			voxelIndex.Z >= 0 && voxelIndex.Z < GetSize();
 }
 
+bool VolumeRaytracer::Voxel::VVoxelVolume::ReadVoxelBox(const VIntVector& min, const VIntVector& max, VVoxelBox& outBox) const
+{
+	if (!IsValidVoxelIndex(min) || !IsValidVoxelIndex(max) || min.X > max.X || min.Y > max.Y || min.Z > max.Z)
+	{
+		return false;
+	}
+
+	outBox.Resize(min, max);
+	Voxels->ReadBox(min, max, outBox.Voxels.data());
+
+	return true;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::WriteVoxelBox(const VVoxelBox& box)
+{
+	if (!IsValidVoxelIndex(box.Min) || !IsValidVoxelIndex(box.Max) || box.Voxels.size() != box.GetVoxelCount() || box.Voxels.empty())
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	Voxels->WriteBox(box.Min, box.Max, box.Voxels.data());
+
+	MarkRegionDirtyLocked(box.Min, box.Max);
+
+	if (!SurfaceBitmapOutdated)
+	{
+		SurfaceBitmap.UpdateCells(*Voxels, box.Min - VIntVector::ONE, box.Max);
+	}
+
+	UpdateGradientField(box.Min, box.Max);
+
+	return true;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::ParallelForEachVoxel(const VIntVector& min, const VIntVector& max, const std::function<void(const VIntVector&, VVoxel&)>& fn)
+{
+	VIntVector clampedMin = VIntVector::Max(min, 0);
+	VIntVector clampedMax = VIntVector::Min(max, GetSize() - 1);
+
+	VVoxelBox box;
+
+	if (!ReadVoxelBox(clampedMin, clampedMax, box))
+	{
+		return;
+	}
+
+	VIntVector boxSize = box.GetSize();
+
+#pragma omp parallel for if(box.GetVoxelCount() > 4096)
+	for (int x = clampedMin.X; x <= clampedMax.X; x++)
+	{
+		for (int z = clampedMin.Z; z <= clampedMax.Z; z++)
+		{
+			VVoxel* row = box.GetRow(x, z);
+
+			for (int y = 0; y < boxSize.Y; y++)
+			{
+				fn(VIntVector(x, clampedMin.Y + y, z), row[y]);
+			}
+		}
+	}
+
+	WriteVoxelBox(box);
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::BeginConcurrentWrite(const VIntVector& min, const VIntVector& max)
+{
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	Voxels->PrepareConcurrentWrite(VIntVector::Max(min, 0), VIntVector::Min(max, GetSize() - 1));
+
+	ConcurrentWriteOpen = true;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	if (IsValidVoxelIndex(voxelIndex))
+	{
+		return Voxels->AtomicMinVoxel(voxelIndex, voxel);
+	}
+
+	return false;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::EndConcurrentWrite(const VIntVector& min, const VIntVector& max)
+{
+	VIntVector clampedMin = VIntVector::Max(min, 0);
+	VIntVector clampedMax = VIntVector::Min(max, GetSize() - 1);
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	Voxels->FinishConcurrentWrite(clampedMin, clampedMax);
+
+	MarkRegionDirtyLocked(clampedMin, clampedMax);
+
+	if (!SurfaceBitmapOutdated)
+	{
+		SurfaceBitmap.UpdateCells(*Voxels, clampedMin - VIntVector::ONE, clampedMax);
+	}
+
+	UpdateGradientField(clampedMin, clampedMax);
+
+	ConcurrentWriteOpen = false;
+	ConcurrentWriteEnded.notify_all();
+}
+
 void VolumeRaytracer::Voxel::VVoxelVolume::SetMaterial(const VMaterial& material)
 {
+	std::lock_guard<std::mutex> lock(EditMutex);
+
 	GeometryMaterial = material;
 }
 
@@ -105,35 +435,110 @@ VolumeRaytracer::VMaterial VolumeRaytracer::Voxel::VVoxelVolume::GetMaterial() c
 
 void VolumeRaytracer::Voxel::VVoxelVolume::FillVolume(const VVoxel& voxel)
 {
-	Voxels.clear();
-	Voxels.resize(GetVoxelCount(), voxel);
+	std::lock_guard<std::mutex> lock(EditMutex);
 
-	MakeDirty();
+	Voxels->Allocate(VoxelCountAlongAxis, voxel);
+
+	MakeDirtyLocked();
 }
 
-void VolumeRaytracer::Voxel::VVoxelVolume::PostRender()
+void VolumeRaytracer::Voxel::VVoxelVolume::MakeDirty()
 {
-	ClearDirtyFlag();
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	MakeDirtyLocked();
 }
 
-const bool VolumeRaytracer::Voxel::VVoxelVolume::CanEverTick() const
+void VolumeRaytracer::Voxel::VVoxelVolume::MakeDirtyLocked()
 {
-	return true;
+	DirtyFlag = true;
+
+	std::fill(DirtyRegions.begin(), DirtyRegions.end(), 1);
+	DirtyRegionCount = DirtyRegions.size();
+
+	LODsOutdated = !LODs.empty();
+	SurfaceBitmapOutdated = true;
+	GradientFieldOutdated = true;
 }
 
-bool VolumeRaytracer::Voxel::VVoxelVolume::ShouldTick() const
+bool VolumeRaytracer::Voxel::VVoxelVolume::IsDirty() const
 {
-	return true;
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	return DirtyFlag;
 }
 
-void VolumeRaytracer::Voxel::VVoxelVolume::MakeDirty()
+void VolumeRaytracer::Voxel::VVoxelVolume::MarkRegionDirty(const VIntVector& min, const VIntVector& max)
+{
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	MarkRegionDirtyLocked(min, max);
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::MarkRegionDirtyLocked(const VIntVector& min, const VIntVector& max)
 {
+	VIntVector minRegion = VIntVector::Max(min, 0) / DIRTY_REGION_SIZE;
+	VIntVector maxRegion = VIntVector::Min(max, GetSize() - 1) / DIRTY_REGION_SIZE;
+
+	for (int x = minRegion.X; x <= maxRegion.X; x++)
+	{
+		for (int z = minRegion.Z; z <= maxRegion.Z; z++)
+		{
+			for (int y = minRegion.Y; y <= maxRegion.Y; y++)
+			{
+				uint8_t& dirty = DirtyRegions[VMathHelpers::Index3DTo1D(x, y, z, RegionCountAlongAxis, RegionCountAlongAxis)];
+
+				if (dirty == 0)
+				{
+					dirty = 1;
+					DirtyRegionCount++;
+				}
+			}
+		}
+	}
+
 	DirtyFlag = true;
+	LODsOutdated = !LODs.empty();
 }
 
-bool VolumeRaytracer::Voxel::VVoxelVolume::IsDirty() const
+void VolumeRaytracer::Voxel::VVoxelVolume::GetDirtyRegions(std::vector<VVoxelRegion>& outRegions) const
 {
-	return DirtyFlag;
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	outRegions.clear();
+	outRegions.reserve(DirtyRegionCount);
+
+	for (size_t i = 0; i < DirtyRegions.size(); i++)
+	{
+		if (DirtyRegions[i] != 0)
+		{
+			VVoxelRegion region;
+			region.Min = VMathHelpers::Index1DTo3D(i, RegionCountAlongAxis, RegionCountAlongAxis) * DIRTY_REGION_SIZE;
+			region.Max = VIntVector::Min(region.Min + VIntVector::ONE * (DIRTY_REGION_SIZE - 1), GetSize() - 1);
+
+			outRegions.push_back(region);
+		}
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolume::GetDirtyRegionCount() const
+{
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	return DirtyRegionCount;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolume::GetRegionCount() const
+{
+	return DirtyRegions.size();
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::ClearDirtyRegions()
+{
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	std::fill(DirtyRegions.begin(), DirtyRegions.end(), 0);
+	DirtyRegionCount = 0;
 }
 
 VolumeRaytracer::VVector VolumeRaytracer::Voxel::VVoxelVolume::VoxelIndexToRelativePosition(const VIntVector& voxelIndex) const
@@ -177,23 +582,33 @@ VolumeRaytracer::VIntVector VolumeRaytracer::Voxel::VVoxelVolume::RelativePositi
 
 std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VVoxelVolume::Serialize() const
 {
-	std::shared_ptr<VSerializationArchive> res = std::make_shared<VSerializationArchive>();
-	res->BufferSize = Voxels.size() * sizeof(VVoxel);
-	res->Buffer = new char[res->BufferSize];
+	std::shared_ptr<VSerializationArchive> res = Voxels->Serialize();
 
-	memcpy(res->Buffer, Voxels.data(), res->BufferSize);
+	EVVoxelStorageType storageType = GetStorageType();
 
 	std::shared_ptr<VSerializationArchive> resolution = VSerializationArchive::From<uint8_t>(&Resolution);
 	std::shared_ptr<VSerializationArchive> extends = VSerializationArchive::From<float>(&VolumeExtends);
 
 	res->Properties["Resolution"] = resolution;
 	res->Properties["Extends"] = extends;
+	res->Properties["StorageType"] = VSerializationArchive::From<EVVoxelStorageType>(&storageType);
+	res->Properties["DensityScale"] = VSerializationArchive::From<float>(&DensityScale);
+	res->Properties["DensityLipschitzBound"] = VSerializationArchive::From<float>(&DensityLipschitzBound);
 
 	VMaterial material = GetMaterial();
 
 	//res->Properties["Material"] = VSerializationArchive::From<VMaterial>(&material);
 	res->Properties["Material"] = material.Serialize();
 
+	size_t lodCount = LODs.size();
+
+	res->Properties["LODCount"] = VSerializationArchive::From<size_t>(&lodCount);
+
+	for (size_t i = 0; i < lodCount; i++)
+	{
+		res->Properties["LOD_" + std::to_string(i)] = LODs[i]->Serialize();
+	}
+
 	return res;
 }
 
@@ -208,22 +623,211 @@ void VolumeRaytracer::Voxel::VVoxelVolume::Deserialize(const std::wstring& sourc
 
 	SetMaterial(mat);
 
-	VoxelCountAlongAxis = 2 + (std::pow(2, Resolution) - 1);
+	VoxelCountAlongAxis = GetVoxelCountAlongAxis(Resolution);
 	CellSize = (VolumeExtends * 2) / (VoxelCountAlongAxis - 1.f);
 
-	Voxels.resize(GetVoxelCount(), VVoxel());
+	EVVoxelStorageType storageType = EVVoxelStorageType::Dense;
+
+	if (archive->Properties.find("StorageType") != archive->Properties.end())
+	{
+		storageType = archive->Properties["StorageType"]->To<EVVoxelStorageType>();
+	}
+
+	DensityScale = 1.f;
+
+	if (archive->Properties.find("DensityScale") != archive->Properties.end())
+	{
+		DensityScale = archive->Properties["DensityScale"]->To<float>();
+	}
 
-	memcpy(Voxels.data(), archive->Buffer, GetVoxelCount() * sizeof(VVoxel));
+	DensityLipschitzBound = 0;
 
+	if (archive->Properties.find("DensityLipschitzBound") != archive->Properties.end())
+	{
+		DensityLipschitzBound = archive->Properties["DensityLipschitzBound"]->To<float>();
+	}
+
+	Voxels = VVoxelStorageFactory::CreateStorage(storageType, CellSize * DensityScale);
+	Voxels->Deserialize(VoxelCountAlongAxis, archive);
+
+	AllocateDirtyRegions();
 	MakeDirty();
+
+	LODs.clear();
+
+	if (archive->Properties.find("LODCount") != archive->Properties.end())
+	{
+		size_t lodCount = archive->Properties["LODCount"]->To<size_t>();
+
+		for (size_t i = 0; i < lodCount; i++)
+		{
+			VObjectPtr<VVoxelVolume> lod = VObject::CreateObject<VVoxelVolume>(1, 1.f);
+			lod->Deserialize(sourcePath, archive->Properties["LOD_" + std::to_string(i)]);
+
+			LODs.push_back(lod);
+		}
+	}
+
+	LODsOutdated = false;
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::VLinearCellOctree> VolumeRaytracer::Voxel::VVoxelVolume::GenerateGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const
+{
+	std::shared_ptr<VLinearCellOctree> octree = std::make_shared<VLinearCellOctree>(Resolution, *Voxels, &GetSurfaceBitmap());
+	octree->BuildDensityBounds(*Voxels, DensityLipschitzBound * CellSize);
+
+	octree->GetGPUOctreeStructure(outNodes, outNodeAxisCount);
+
+	return octree;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::UpdateGPUOctreeStructure(VLinearCellOctree& octree, const size_t& nodeAxisCount, std::vector<VLinearOctreeNodeRange>& outChangedRanges, std::vector<VCellGPUOctreeNode>& outChangedNodes) const
+{
+	outChangedRanges.clear();
+	outChangedNodes.clear();
+
+	if (octree.GetMaxDepth() != Resolution || DirtyRegionCount == DirtyRegions.size())
+	{
+		return false;
+	}
+
+	const VSurfaceBitmap& surfaceBitmap = GetSurfaceBitmap();
+
+	std::vector<VVoxelRegion> dirtyRegions;
+	GetDirtyRegions(dirtyRegions);
+
+	VVoxelRegion dirtyBounds;
+	dirtyBounds.Min = VIntVector::ONE * (int)VoxelCountAlongAxis;
+	dirtyBounds.Max = VIntVector::ZERO;
+
+	for (const VVoxelRegion& region : dirtyRegions)
+	{
+		dirtyBounds.Min = VIntVector::Min(dirtyBounds.Min, region.Min);
+		dirtyBounds.Max = VIntVector::Max(dirtyBounds.Max, region.Max);
+	}
+
+	//A single brush usually dirties a compact block of regions, which is cheaper to walk once
+	VIntVector boundsRegionCount = (dirtyBounds.Max - dirtyBounds.Min) / DIRTY_REGION_SIZE + VIntVector::ONE;
+
+	if ((size_t)boundsRegionCount.X * boundsRegionCount.Y * boundsRegionCount.Z <= DirtyRegionCount * 2)
+	{
+		dirtyRegions.clear();
+		dirtyRegions.push_back(dirtyBounds);
+	}
+
+	//A voxel is a corner of the cells one index below it as well
+	for (const VVoxelRegion& region : dirtyRegions)
+	{
+		octree.UpdateRegion(surfaceBitmap, region.Min - VIntVector::ONE, region.Max, outChangedRanges);
+		octree.UpdateDensityBounds(*Voxels, region.Min - VIntVector::ONE, region.Max, outChangedRanges);
+	}
+
+	if (octree.GetNodeCount() > nodeAxisCount * nodeAxisCount * nodeAxisCount)
+	{
+		outChangedRanges.clear();
+		return false;
+	}
+
+	VLinearCellOctree::MergeNodeRanges(outChangedRanges);
+
+	for (const VLinearOctreeNodeRange& range : outChangedRanges)
+	{
+		octree.GetGPUOctreeNodes(range, nodeAxisCount, outChangedNodes);
+	}
+
+	return true;
 }
 
-void VolumeRaytracer::Voxel::VVoxelVolume::GenerateGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const
+void VolumeRaytracer::Voxel::VVoxelVolume::SetDensityLipschitzBound(const float& densityPerUnit)
 {
-	VCellOctree octree(Resolution, Voxels);
+	std::lock_guard<std::mutex> lock(EditMutex);
 
-	octree.CollapseTree();
-	octree.GetGPUOctreeStructure(outNodes, outNodeAxisCount);
+	if (DensityLipschitzBound != densityPerUnit)
+	{
+		DensityLipschitzBound = densityPerUnit;
+
+		MakeDirtyLocked();
+	}
+}
+
+float VolumeRaytracer::Voxel::VVoxelVolume::GetDensityLipschitzBound() const
+{
+	return DensityLipschitzBound;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::SetGradientFieldEnabled(const bool& enabled)
+{
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	GradientFieldEnabled = enabled;
+
+	if (!GradientFieldEnabled)
+	{
+		GradientField.Clear();
+		GradientFieldOutdated = true;
+	}
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::IsGradientFieldEnabled() const
+{
+	return GradientFieldEnabled;
+}
+
+const VolumeRaytracer::Voxel::VGradientField& VolumeRaytracer::Voxel::VVoxelVolume::GetGradientField() const
+{
+	std::lock_guard<std::mutex> lock(CacheMutex);
+
+	if (GradientFieldEnabled && GradientFieldOutdated)
+	{
+		GradientField.Build(*Voxels);
+		GradientFieldOutdated = false;
+	}
+
+	return GradientField;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::UpdateGradientField(const VIntVector& min, const VIntVector& max)
+{
+	//Central differences reach one voxel out, so the neighbours of the written region change as well
+	if (GradientFieldEnabled && !GradientFieldOutdated)
+	{
+		GradientField.UpdateVoxels(*Voxels, min - VIntVector::ONE, max + VIntVector::ONE);
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::ExtractMesh(VVoxelMesh& outMesh) const
+{
+	VVoxelMeshExtractor::ExtractMesh(*Voxels, &GetSurfaceBitmap(), CellSize, -VVector::ONE * VolumeExtends, outMesh);
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::QuerySpheres(const VVector* centers, const float* radii, const size_t& count, VVoxelDistanceResult* outResults) const
+{
+	VVoxelDistanceQuery::QuerySpheres(*Voxels, GetSurfaceBitmap(), CellSize, DensityScale, VolumeExtends, centers, radii, count, outResults);
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::QueryCapsules(const VVector* starts, const VVector* ends, const float* radii, const size_t& count, VVoxelDistanceResult* outResults) const
+{
+	VVoxelDistanceQuery::QueryCapsules(*Voxels, GetSurfaceBitmap(), CellSize, DensityScale, VolumeExtends, starts, ends, radii, count, outResults);
+}
+
+const VolumeRaytracer::Voxel::VSurfaceBitmap& VolumeRaytracer::Voxel::VVoxelVolume::GetSurfaceBitmap() const
+{
+	std::lock_guard<std::mutex> lock(CacheMutex);
+
+	if (SurfaceBitmapOutdated)
+	{
+		SurfaceBitmap.Build(*Voxels);
+		SurfaceBitmapOutdated = false;
+	}
+
+	return SurfaceBitmap;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::IsSurfaceBitmapOutdated() const
+{
+	std::lock_guard<std::mutex> lock(CacheMutex);
+
+	return SurfaceBitmapOutdated;
 }
 
 uint8_t VolumeRaytracer::Voxel::VVoxelVolume::GetResolution() const
@@ -231,6 +835,382 @@ uint8_t VolumeRaytracer::Voxel::VVoxelVolume::GetResolution() const
 	return Resolution;
 }
 
+size_t VolumeRaytracer::Voxel::VVoxelVolume::GetVoxelCountAlongAxis(const uint8_t& resolution)
+{
+	return ((size_t)1 << resolution) + 1;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolume::EstimateAllocatedBytes(const uint8_t& resolution, const EVVoxelStorageType& storageType)
+{
+	return VVoxelStorageFactory::EstimateAllocatedBytes(storageType, GetVoxelCountAlongAxis(resolution));
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::ResampleTo(const uint8_t& resolution, const EVResampleFilter& filter /*= EVResampleFilter::Trilinear*/)
+{
+	if (resolution > MAX_RESOLUTION)
+	{
+		return false;
+	}
+
+	if (resolution == Resolution)
+	{
+		return true;
+	}
+
+	size_t targetCount = GetVoxelCountAlongAxis(resolution);
+	float targetCellSize = (VolumeExtends * 2) / (targetCount - 1.f);
+	bool downsampling = resolution < Resolution;
+
+	std::vector<VResampleAxisTaps> taps;
+	CalculateResampleTaps(filter, VoxelCountAlongAxis, targetCount, taps);
+
+	std::shared_ptr<IVVoxelStorage> target = VVoxelStorageFactory::CreateStorage(GetStorageType(), targetCellSize * DensityScale);
+	target->Allocate(targetCount, VVoxel());
+
+	int brickCountAlongAxis = (int)((targetCount + DIRTY_REGION_SIZE - 1) / DIRTY_REGION_SIZE);
+	int brickCount = brickCountAlongAxis * brickCountAlongAxis * brickCountAlongAxis;
+	int targetMax = (int)targetCount - 1;
+
+#pragma omp parallel for schedule(dynamic)
+	for (int brick = 0; brick < brickCount; brick++)
+	{
+		VIntVector targetMin = VMathHelpers::Index1DTo3D(brick, brickCountAlongAxis, brickCountAlongAxis) * (int)DIRTY_REGION_SIZE;
+		VIntVector targetBrickMax = VIntVector::Min(targetMin + VIntVector::ONE * ((int)DIRTY_REGION_SIZE - 1), targetMax);
+
+		VIntVector sourceMin;
+		VIntVector sourceMax;
+
+		GetResampleSourceRange(taps, targetMin.X, targetBrickMax.X, sourceMin.X, sourceMax.X);
+		GetResampleSourceRange(taps, targetMin.Y, targetBrickMax.Y, sourceMin.Y, sourceMax.Y);
+		GetResampleSourceRange(taps, targetMin.Z, targetBrickMax.Z, sourceMin.Z, sourceMax.Z);
+
+		VVoxelBox source;
+		source.Resize(sourceMin, sourceMax);
+		Voxels->ReadBox(source.Min, source.Max, source.Voxels.data());
+
+		VIntVector sourceSize = source.GetSize();
+
+		VVoxelBox output;
+		output.Resize(targetMin, targetBrickMax);
+
+		for (int x = targetMin.X; x <= targetBrickMax.X; x++)
+		{
+			for (int z = targetMin.Z; z <= targetBrickMax.Z; z++)
+			{
+				VVoxel* row = output.GetRow(x, z) - targetMin.Y;
+
+				for (int y = targetMin.Y; y <= targetBrickMax.Y; y++)
+				{
+					row[y] = ResampleVoxel(source, sourceSize, taps[x], taps[y], taps[z], downsampling);
+				}
+			}
+		}
+
+		//Storages allocate on write (brick pool), so writes are serialized. They are cheap compared to the filtering
+#pragma omp critical
+		target->WriteBox(output.Min, output.Max, output.Voxels.data());
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	Resolution = resolution;
+	VoxelCountAlongAxis = targetCount;
+	CellSize = targetCellSize;
+	Voxels = target;
+
+	LODs.clear();
+
+	AllocateDirtyRegions();
+	MakeDirtyLocked();
+
+	return true;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::GenerateLODs(const uint8_t& maxLODCount /*= MAX_RESOLUTION*/)
+{
+	//Built aside and swapped in under the edit lock, snapshots keep sharing the previous levels until then
+	std::vector<std::shared_ptr<VVoxelVolume>> lods;
+
+	const VVoxelVolume* source = this;
+
+	//Every level halves the cell count along each axis. Voxel i of a level sits on voxel 2i of the finer level and takes the minimum density
+	//of its 3x3x3 footprint. Thin surface bands therefore survive downsampling and coarse levels stay conservative for shadow rays.
+	for (uint8_t lodResolution = Resolution; lodResolution > 1 && lods.size() < maxLODCount; lodResolution--)
+	{
+		VObjectPtr<VVoxelVolume> lod = VObject::CreateObject<VVoxelVolume>(lodResolution - 1, VolumeExtends, GetStorageType(), DensityScale);
+		lod->SetMaterial(GeometryMaterial);
+		//A minimum over a fixed footprint changes no faster than the densities it is taken from
+		lod->SetDensityLipschitzBound(DensityLipschitzBound);
+
+		int lodSize = (int)lod->GetSize();
+		int sourceMax = (int)source->GetSize() - 1;
+
+		VVoxelBox footprint;
+
+		for (int x = 0; x < lodSize; x++)
+		{
+			VIntVector footprintMin = VIntVector(VMathHelpers::Max(x * 2 - 1, 0), 0, 0);
+			VIntVector footprintMax = VIntVector(VMathHelpers::Min(x * 2 + 1, sourceMax), sourceMax, sourceMax);
+
+			source->ReadVoxelBox(footprintMin, footprintMax, footprint);
+
+			for (int z = 0; z < lodSize; z++)
+			{
+				for (int y = 0; y < lodSize; y++)
+				{
+					VVoxel lodVoxel = footprint.GetVoxel(VIntVector(x * 2, y * 2, z * 2));
+
+					for (int fx = footprintMin.X; fx <= footprintMax.X; fx++)
+					{
+						for (int fz = VMathHelpers::Max(z * 2 - 1, 0); fz <= VMathHelpers::Min(z * 2 + 1, sourceMax); fz++)
+						{
+							for (int fy = VMathHelpers::Max(y * 2 - 1, 0); fy <= VMathHelpers::Min(y * 2 + 1, sourceMax); fy++)
+							{
+								const VVoxel& voxel = footprint.GetVoxel(VIntVector(fx, fy, fz));
+
+								if (voxel.Density < lodVoxel.Density)
+								{
+									lodVoxel = voxel;
+								}
+							}
+						}
+					}
+
+					lod->Voxels->SetVoxel(VIntVector(x, y, z), lodVoxel);
+				}
+			}
+		}
+
+		lods.push_back(lod);
+		source = lod.get();
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	LODs.swap(lods);
+	LODsOutdated = false;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::ClearLODs()
+{
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	LODs.clear();
+	LODsOutdated = false;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolume::GetLODCount() const
+{
+	return LODs.size();
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolume::AreLODsOutdated() const
+{
+	return LODsOutdated;
+}
+
+std::shared_ptr<const VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxel::VVoxelVolume::GetLOD(const size_t& lod) const
+{
+	if (lod == 0 || lod > LODs.size())
+	{
+		return nullptr;
+	}
+
+	return LODs[lod - 1];
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolume::SelectLOD(const float& projectedSizeInPixels) const
+{
+	if (projectedSizeInPixels <= 0.f)
+	{
+		return LODs.size();
+	}
+
+	float cellsPerPixel = (VoxelCountAlongAxis - 1) / projectedSizeInPixels;
+
+	if (cellsPerPixel <= 1.f)
+	{
+		return 0;
+	}
+
+	size_t lod = (size_t)std::floor(std::log2(cellsPerPixel));
+
+	return VMathHelpers::Min(lod, LODs.size());
+}
+
+std::shared_ptr<const VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxel::VVoxelVolume::CreateSnapshot() const
+{
+	std::unique_lock<std::mutex> lock(EditMutex);
+	ConcurrentWriteEnded.wait(lock, [this]() { return !ConcurrentWriteOpen; });
+
+	std::shared_ptr<VVoxelVolume> snapshot = CopyForSnapshot();
+
+	snapshot->DirtyRegions = DirtyRegions;
+	snapshot->DirtyRegionCount = DirtyRegionCount;
+	snapshot->DirtyFlag = DirtyFlag;
+
+	return snapshot;
+}
+
+std::shared_ptr<const VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxel::VVoxelVolume::TakeSnapshot()
+{
+	//Edits write, patch the caches and mark their regions under the same lock. An edit therefore either ended before the clone and
+	//its regions are taken over here, or it starts after the swap, copies any payload the snapshot shares and stays dirty for the next one
+	std::unique_lock<std::mutex> lock(EditMutex);
+	ConcurrentWriteEnded.wait(lock, [this]() { return !ConcurrentWriteOpen; });
+
+	//Built here rather than on the snapshot, so the render thread pays for it once instead of on every edited frame
+	GetSurfaceBitmap();
+
+	std::shared_ptr<VVoxelVolume> snapshot = CopyForSnapshot();
+
+	snapshot->DirtyRegions.swap(DirtyRegions);
+	snapshot->DirtyRegionCount = DirtyRegionCount;
+	snapshot->DirtyFlag = DirtyFlag;
+
+	DirtyRegions.resize(snapshot->DirtyRegions.size(), 0);
+	DirtyRegionCount = 0;
+	DirtyFlag = false;
+
+	return snapshot;
+}
+
+std::shared_ptr<VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxel::VVoxelVolume::CopyForSnapshot() const
+{
+	//Constructed directly instead of through CreateObject, snapshots are plain data and may be created and released on any thread
+	std::shared_ptr<VVoxelVolume> snapshot = std::make_shared<VVoxelVolume>(0, VolumeExtends);
+
+	snapshot->Resolution = Resolution;
+	snapshot->VoxelCountAlongAxis = VoxelCountAlongAxis;
+	snapshot->CellSize = CellSize;
+	snapshot->DensityScale = DensityScale;
+	snapshot->GeometryMaterial = GeometryMaterial;
+	snapshot->Voxels = Voxels->Clone();
+	snapshot->RegionCountAlongAxis = RegionCountAlongAxis;
+	snapshot->LODs = LODs;
+	snapshot->LODsOutdated = LODsOutdated;
+	snapshot->DensityLipschitzBound = DensityLipschitzBound;
+	snapshot->GradientFieldEnabled = GradientFieldEnabled;
+
+	//The bitmap is cheap to copy compared to a rebuild and lets the snapshot patch octrees right away
+	std::lock_guard<std::mutex> lock(CacheMutex);
+
+	if (!SurfaceBitmapOutdated)
+	{
+		snapshot->SurfaceBitmap = SurfaceBitmap;
+		snapshot->SurfaceBitmapOutdated = false;
+	}
+
+	return snapshot;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::RestoreSnapshot(const std::shared_ptr<const VVoxelVolume>& snapshot)
+{
+	if (snapshot == nullptr || snapshot->Resolution != Resolution)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	VolumeExtends = snapshot->VolumeExtends;
+	CellSize = snapshot->CellSize;
+	DensityScale = snapshot->DensityScale;
+	GeometryMaterial = snapshot->GeometryMaterial;
+	Voxels = snapshot->Voxels->Clone();
+
+	MakeDirtyLocked();
+
+	LODs = snapshot->LODs;
+	LODsOutdated = snapshot->LODsOutdated;
+}
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VVoxelVolume::GetStorageType() const
+{
+	return Voxels->GetType();
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::ConvertStorage(const EVVoxelStorageType& storageType)
+{
+	if (storageType == GetStorageType())
+	{
+		return;
+	}
+
+	std::shared_ptr<IVVoxelStorage> target = VVoxelStorageFactory::CreateStorage(storageType, CellSize * DensityScale);
+	target->Allocate(VoxelCountAlongAxis, VVoxel());
+
+	int voxelCount = (int)VoxelCountAlongAxis;
+	int regionSize = (int)DIRTY_REGION_SIZE;
+
+	std::vector<VVoxel> column;
+
+	for (int x = 0; x < voxelCount; x += regionSize)
+	{
+		for (int z = 0; z < voxelCount; z += regionSize)
+		{
+			VIntVector min(x, 0, z);
+			VIntVector max(VMathHelpers::Min(x + regionSize, voxelCount) - 1, voxelCount - 1, VMathHelpers::Min(z + regionSize, voxelCount) - 1);
+
+			column.resize((size_t)(max.X - min.X + 1) * (max.Z - min.Z + 1) * voxelCount);
+
+			Voxels->ReadBox(min, max, column.data());
+			target->WriteBox(min, max, column.data());
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	Voxels = target;
+
+	LODs.clear();
+
+	MakeDirtyLocked();
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolume::GetAllocatedBytes() const
+{
+	return Voxels->GetAllocatedBytes();
+}
+
+const float* VolumeRaytracer::Voxel::VVoxelVolume::GetDensityPlane() const
+{
+	return Voxels->GetDensityPlane();
+}
+
+const uint8_t* VolumeRaytracer::Voxel::VVoxelVolume::GetMaterialPlane() const
+{
+	return Voxels->GetMaterialPlane();
+}
+
+float* VolumeRaytracer::Voxel::VVoxelVolume::GetDensityPlaneForEditing()
+{
+	if (GetStorageType() != EVVoxelStorageType::Planar)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	MakeDirtyLocked();
+
+	return std::static_pointer_cast<VPlanarVoxelStorage>(Voxels)->GetDensityPlane();
+}
+
+uint8_t* VolumeRaytracer::Voxel::VVoxelVolume::GetMaterialPlaneForEditing()
+{
+	if (GetStorageType() != EVVoxelStorageType::Planar)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(EditMutex);
+
+	MakeDirtyLocked();
+
+	return std::static_pointer_cast<VPlanarVoxelStorage>(Voxels)->GetMaterialPlane();
+}
+
 void VolumeRaytracer::Voxel::VVoxelVolume::Initialize()
 {
 	//if (GetSize() > 0)
@@ -259,5 +1239,19 @@ void VolumeRaytracer::Voxel::VVoxelVolume::BeginDestroy()
 
 void VolumeRaytracer::Voxel::VVoxelVolume::ClearDirtyFlag()
 {
+	std::lock_guard<std::mutex> lock(EditMutex);
+
 	DirtyFlag = false;
+
+	std::fill(DirtyRegions.begin(), DirtyRegions.end(), 0);
+	DirtyRegionCount = 0;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolume::AllocateDirtyRegions()
+{
+	RegionCountAlongAxis = (VoxelCountAlongAxis + DIRTY_REGION_SIZE - 1) / DIRTY_REGION_SIZE;
+
+	DirtyRegions.clear();
+	DirtyRegions.resize((uint64_t)RegionCountAlongAxis * RegionCountAlongAxis * RegionCountAlongAxis, 0);
+	DirtyRegionCount = 0;
 }
\ No newline at end of file
@@ -0,0 +1,553 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#include "VoxelVolumeGrid.h"
+#include "MathHelpers.h"
+#include <cmath>
+
+namespace
+{
+	bool IsLowerGridVoxel(const VolumeRaytracer::Voxel::VVoxel& voxel, const VolumeRaytracer::Voxel::VVoxel& other)
+	{
+		return voxel.Density < other.Density || (voxel.Density == other.Density && voxel.Material > other.Material);
+	}
+
+	bool IsSameGridVoxel(const VolumeRaytracer::Voxel::VVoxel& voxel, const VolumeRaytracer::Voxel::VVoxel& other)
+	{
+		return voxel.Density == other.Density && voxel.Material == other.Material;
+	}
+}
+
+VolumeRaytracer::Voxel::VVoxelVolumeGrid::VVoxelVolumeGrid(const uint8_t& tileResolution, const float& tileExtends, const VIntVector& tileCount, const EVVoxelStorageType& storageType /*= EVVoxelStorageType::Dense*/, const float& densityScale /*= 1.f*/) :
+	TileResolution(tileResolution),
+	TileExtends(tileExtends),
+	TileCount(VIntVector::Max(tileCount, 1)),
+	StorageType(storageType),
+	DensityScale(densityScale)
+{
+	Tiles.resize(GetTotalTileCount());
+}
+
+uint8_t VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTileResolution() const
+{
+	return TileResolution;
+}
+
+float VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTileExtends() const
+{
+	return TileExtends;
+}
+
+float VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetCellSize() const
+{
+	return (TileExtends * 2) / GetCellsPerTile();
+}
+
+VolumeRaytracer::Voxel::EVVoxelStorageType VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetStorageType() const
+{
+	return StorageType;
+}
+
+float VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetDensityScale() const
+{
+	return DensityScale;
+}
+
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTileCount() const
+{
+	return TileCount;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTotalTileCount() const
+{
+	return (size_t)TileCount.X * TileCount.Y * TileCount.Z;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolumeGrid::IsValidTileIndex(const VIntVector& tileIndex) const
+{
+	return tileIndex >= VIntVector::ZERO && tileIndex < TileCount;
+}
+
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetSize() const
+{
+	return TileCount * GetCellsPerTile() + VIntVector::ONE;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolumeGrid::IsValidVoxelIndex(const VIntVector& voxelIndex) const
+{
+	return voxelIndex >= VIntVector::ZERO && voxelIndex < GetSize();
+}
+
+VolumeRaytracer::VAABB VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetGridBounds() const
+{
+	VAABB res;
+
+	res.SetCenterPosition(VVector::ZERO);
+	res.SetExtends(VVector(TileCount.X, TileCount.Y, TileCount.Z) * TileExtends);
+
+	return res;
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTileCenter(const VIntVector& tileIndex) const
+{
+	VVector index = VVector(tileIndex.X, tileIndex.Y, tileIndex.Z) + VVector::ONE * 0.5f;
+	VVector count = VVector(TileCount.X, TileCount.Y, TileCount.Z);
+
+	return (index - count * 0.5f) * (TileExtends * 2);
+}
+
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTileVoxelOffset(const VIntVector& tileIndex) const
+{
+	return tileIndex * GetCellsPerTile();
+}
+
+VolumeRaytracer::VVector VolumeRaytracer::Voxel::VVoxelVolumeGrid::VoxelIndexToRelativePosition(const VIntVector& voxelIndex) const
+{
+	VVector voxelIndexF = VVector(voxelIndex.X, voxelIndex.Y, voxelIndex.Z);
+	VVector gridOrigin = -VVector(TileCount.X, TileCount.Y, TileCount.Z) * TileExtends;
+
+	return voxelIndexF * GetCellSize() + gridOrigin;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::SetFillVoxel(const VVoxel& voxel)
+{
+	FillVoxel = voxel;
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetFillVoxel() const
+{
+	return FillVoxel;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::SetMaterial(const VMaterial& material)
+{
+	GeometryMaterial = material;
+
+	for (auto& tile : Tiles)
+	{
+		if (tile != nullptr)
+		{
+			tile->SetMaterial(material);
+		}
+	}
+}
+
+VolumeRaytracer::VMaterial VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetMaterial() const
+{
+	return GeometryMaterial;
+}
+
+VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTile(const VIntVector& tileIndex) const
+{
+	if (!IsValidTileIndex(tileIndex))
+	{
+		return nullptr;
+	}
+
+	return Tiles[GetTileArrayIndex(tileIndex)];
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolumeGrid::IsTileLoaded(const VIntVector& tileIndex) const
+{
+	return GetTile(tileIndex) != nullptr;
+}
+
+std::vector<VolumeRaytracer::VIntVector> VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetLoadedTiles() const
+{
+	std::vector<VIntVector> res;
+
+	for (size_t i = 0; i < Tiles.size(); i++)
+	{
+		if (Tiles[i] != nullptr)
+		{
+			res.push_back(VMathHelpers::Index1DTo3D(i, TileCount.Y, TileCount.Z));
+		}
+	}
+
+	return res;
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetLoadedTileCount() const
+{
+	size_t res = 0;
+
+	for (const auto& tile : Tiles)
+	{
+		res += tile != nullptr ? 1 : 0;
+	}
+
+	return res;
+}
+
+VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxel::VVoxelVolumeGrid::AllocateTile(const VIntVector& tileIndex)
+{
+	if (!IsValidTileIndex(tileIndex))
+	{
+		return nullptr;
+	}
+
+	VObjectPtr<VVoxelVolume>& tile = Tiles[GetTileArrayIndex(tileIndex)];
+
+	if (tile == nullptr)
+	{
+		tile = VObject::CreateObject<VVoxelVolume>(TileResolution, TileExtends, StorageType, DensityScale);
+		tile->FillVolume(FillVoxel);
+		tile->SetMaterial(GeometryMaterial);
+
+		CopySharedBorders(tileIndex);
+	}
+
+	return tile;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolumeGrid::LoadTile(const VIntVector& tileIndex, VObjectPtr<VVoxelVolume> volume)
+{
+	if (!IsValidTileIndex(tileIndex) || volume == nullptr)
+	{
+		return false;
+	}
+
+	if (volume->GetResolution() != TileResolution || std::abs(volume->GetVolumeExtends() - TileExtends) > TileExtends * 1e-5f)
+	{
+		return false;
+	}
+
+	Tiles[GetTileArrayIndex(tileIndex)] = volume;
+
+	return true;
+}
+
+bool VolumeRaytracer::Voxel::VVoxelVolumeGrid::LoadTile(const VIntVector& tileIndex, const std::wstring& sourcePath, std::shared_ptr<VSerializationArchive> archive)
+{
+	if (!IsValidTileIndex(tileIndex) || archive == nullptr)
+	{
+		return false;
+	}
+
+	VObjectPtr<VVoxelVolume> volume = VObject::CreateObject<VVoxelVolume>(1, 1.f);
+	volume->Deserialize(sourcePath, archive);
+
+	return LoadTile(tileIndex, volume);
+}
+
+std::shared_ptr<VolumeRaytracer::VSerializationArchive> VolumeRaytracer::Voxel::VVoxelVolumeGrid::SerializeTile(const VIntVector& tileIndex) const
+{
+	VObjectPtr<VVoxelVolume> tile = GetTile(tileIndex);
+
+	return tile != nullptr ? tile->Serialize() : nullptr;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::UnloadTile(const VIntVector& tileIndex)
+{
+	if (IsValidTileIndex(tileIndex))
+	{
+		Tiles[GetTileArrayIndex(tileIndex)] = nullptr;
+	}
+}
+
+VolumeRaytracer::Voxel::VVoxel VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetVoxel(const VIntVector& voxelIndex) const
+{
+	if (!IsValidVoxelIndex(voxelIndex))
+	{
+		return FillVoxel;
+	}
+
+	std::vector<VIntVector> sharingTiles;
+	GetSharingTiles(voxelIndex, sharingTiles);
+
+	//Shared voxels are identical in every loaded tile, so the first one is enough
+	for (const VIntVector& tileIndex : sharingTiles)
+	{
+		VObjectPtr<VVoxelVolume> tile = GetTile(tileIndex);
+
+		if (tile != nullptr)
+		{
+			return tile->GetVoxel(voxelIndex - GetTileVoxelOffset(tileIndex));
+		}
+	}
+
+	return FillVoxel;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel)
+{
+	if (!IsValidVoxelIndex(voxelIndex))
+	{
+		return;
+	}
+
+	std::vector<VIntVector> sharingTiles;
+	GetSharingTiles(voxelIndex, sharingTiles);
+
+	for (const VIntVector& tileIndex : sharingTiles)
+	{
+		VObjectPtr<VVoxelVolume> tile = GetTile(tileIndex);
+
+		if (tile == nullptr)
+		{
+			if (IsSameGridVoxel(voxel, FillVoxel))
+			{
+				continue;
+			}
+
+			tile = AllocateTile(tileIndex);
+		}
+
+		tile->SetVoxel(voxelIndex - GetTileVoxelOffset(tileIndex), voxel);
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::StitchBorders()
+{
+	int last = GetCellsPerTile();
+
+	std::vector<VIntVector> sharingTiles;
+	std::vector<VVoxel> voxels;
+
+	VVoxelBox lowerFace;
+	VVoxelBox upperFace;
+
+	//Every shared voxel lies on the upper face of at least one tile sharing it. Face interiors are shared by two tiles and compared in bulk,
+	//edges can be shared by up to four tiles, including diagonal neighbors, and are always stitched voxel by voxel
+	for (size_t i = 0; i < Tiles.size(); i++)
+	{
+		if (Tiles[i] == nullptr)
+		{
+			continue;
+		}
+
+		VIntVector tileIndex = VMathHelpers::Index1DTo3D(i, TileCount.Y, TileCount.Z);
+		VIntVector offset = GetTileVoxelOffset(tileIndex);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			VIntVector step(axis == 0 ? 1 : 0, axis == 1 ? 1 : 0, axis == 2 ? 1 : 0);
+
+			if (!IsValidTileIndex(tileIndex + step))
+			{
+				continue;
+			}
+
+			VObjectPtr<VVoxelVolume> upper = GetTile(tileIndex + step);
+
+			VIntVector faceMin = step * last;
+			VIntVector faceMax = VIntVector::ONE * last;
+
+			if (upper != nullptr)
+			{
+				Tiles[i]->ReadVoxelBox(faceMin, faceMax, lowerFace);
+				upper->ReadVoxelBox(faceMin - step * last, faceMax - step * last, upperFace);
+			}
+
+			for (int u = 0; u <= last; u++)
+			{
+				for (int v = 0; v <= last; v++)
+				{
+					VIntVector local = axis == 0 ? VIntVector(last, u, v) : (axis == 1 ? VIntVector(u, last, v) : VIntVector(u, v, last));
+
+					bool isEdge = u == 0 || v == 0 || u == last || v == last;
+
+					if (isEdge || (upper != nullptr && !IsSameGridVoxel(lowerFace.GetVoxel(local), upperFace.GetVoxel(local - step * last))))
+					{
+						StitchVoxel(offset + local, sharingTiles, voxels);
+					}
+				}
+			}
+		}
+	}
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetAllocatedBytes() const
+{
+	size_t res = Tiles.size() * sizeof(VObjectPtr<VVoxelVolume>);
+
+	for (const auto& tile : Tiles)
+	{
+		if (tile != nullptr)
+		{
+			res += tile->GetAllocatedBytes();
+		}
+	}
+
+	return res;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::Initialize()
+{
+
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::BeginDestroy()
+{
+	Tiles.clear();
+}
+
+size_t VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetTileArrayIndex(const VIntVector& tileIndex) const
+{
+	return VMathHelpers::Index3DTo1D(tileIndex, TileCount.Y, TileCount.Z);
+}
+
+int VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetCellsPerTile() const
+{
+	return 1 << TileResolution;
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::GetSharingTiles(const VIntVector& voxelIndex, std::vector<VIntVector>& outTiles) const
+{
+	int cellsPerTile = GetCellsPerTile();
+
+	int candidates[3][2];
+	int candidateCount[3];
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int index = axis == 0 ? voxelIndex.X : (axis == 1 ? voxelIndex.Y : voxelIndex.Z);
+		int tileCount = axis == 0 ? TileCount.X : (axis == 1 ? TileCount.Y : TileCount.Z);
+
+		int tile = VMathHelpers::Min(index / cellsPerTile, tileCount - 1);
+
+		candidates[axis][0] = tile;
+		candidateCount[axis] = 1;
+
+		//The first voxel of a tile is also the last voxel of the previous one
+		if (tile > 0 && index == tile * cellsPerTile)
+		{
+			candidates[axis][1] = tile - 1;
+			candidateCount[axis] = 2;
+		}
+	}
+
+	outTiles.clear();
+
+	for (int x = 0; x < candidateCount[0]; x++)
+	{
+		for (int y = 0; y < candidateCount[1]; y++)
+		{
+			for (int z = 0; z < candidateCount[2]; z++)
+			{
+				outTiles.push_back(VIntVector(candidates[0][x], candidates[1][y], candidates[2][z]));
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::CopySharedBorders(const VIntVector& tileIndex)
+{
+	VObjectPtr<VVoxelVolume> tile = GetTile(tileIndex);
+	int last = GetCellsPerTile();
+
+	VVoxelBox box;
+
+	//All 26 neighbors, diagonal ones only share an edge or a corner
+	for (int dx = -1; dx <= 1; dx++)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				VIntVector offset(dx, dy, dz);
+				VObjectPtr<VVoxelVolume> neighbor = offset != VIntVector::ZERO ? GetTile(tileIndex + offset) : nullptr;
+
+				if (neighbor == nullptr)
+				{
+					continue;
+				}
+
+				VIntVector min;
+				VIntVector max;
+
+				min.X = dx > 0 ? last : 0;
+				min.Y = dy > 0 ? last : 0;
+				min.Z = dz > 0 ? last : 0;
+				max.X = dx < 0 ? 0 : last;
+				max.Y = dy < 0 ? 0 : last;
+				max.Z = dz < 0 ? 0 : last;
+
+				VIntVector neighborOffset = offset * last;
+
+				if (neighbor->ReadVoxelBox(min - neighborOffset, max - neighborOffset, box))
+				{
+					box.Min = min;
+					box.Max = max;
+
+					tile->WriteVoxelBox(box);
+				}
+			}
+		}
+	}
+}
+
+void VolumeRaytracer::Voxel::VVoxelVolumeGrid::StitchVoxel(const VIntVector& voxelIndex, std::vector<VIntVector>& sharingTiles, std::vector<VVoxel>& voxels)
+{
+	GetSharingTiles(voxelIndex, sharingTiles);
+
+	voxels.clear();
+
+	size_t loadedCount = 0;
+
+	for (VIntVector& tileIndex : sharingTiles)
+	{
+		VObjectPtr<VVoxelVolume> tile = GetTile(tileIndex);
+
+		if (tile != nullptr)
+		{
+			sharingTiles[loadedCount++] = tileIndex;
+			voxels.push_back(tile->GetVoxel(voxelIndex - GetTileVoxelOffset(tileIndex)));
+		}
+	}
+
+	VVoxel lowest = voxels.empty() ? FillVoxel : voxels[0];
+	bool identical = true;
+
+	for (const VVoxel& voxel : voxels)
+	{
+		identical &= IsSameGridVoxel(voxel, lowest);
+
+		if (IsLowerGridVoxel(voxel, lowest))
+		{
+			lowest = voxel;
+		}
+	}
+
+	if (identical)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < loadedCount; i++)
+	{
+		GetTile(sharingTiles[i])->SetVoxel(voxelIndex - GetTileVoxelOffset(sharingTiles[i]), lowest);
+	}
+
+	//Storages don't have to keep every value, the narrow band storage reads densities outside of the band back as its far field.
+	//In that case the stored value is handed to the other tiles, so all of them still read the same voxel
+	for (size_t i = 0; i < loadedCount; i++)
+	{
+		VVoxel stored = GetTile(sharingTiles[i])->GetVoxel(voxelIndex - GetTileVoxelOffset(sharingTiles[i]));
+
+		if (!IsSameGridVoxel(stored, lowest))
+		{
+			for (size_t j = 0; j < loadedCount; j++)
+			{
+				if (j != i)
+				{
+					GetTile(sharingTiles[j])->SetVoxel(voxelIndex - GetTileVoxelOffset(sharingTiles[j]), stored);
+				}
+			}
+
+			break;
+		}
+	}
+}
\ No newline at end of file
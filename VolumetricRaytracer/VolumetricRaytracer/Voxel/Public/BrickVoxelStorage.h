@@ -0,0 +1,87 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "VoxelStorage.h"
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class VBrickVoxelStorage : public IVVoxelStorage
+		{
+		public:
+			EVVoxelStorageType GetType() const override;
+
+			void Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel) override;
+
+			void SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel) override;
+			VVoxel GetVoxel(const VIntVector& voxelIndex) const override;
+			VVoxel GetVoxel(const size_t& voxelIndex) const override;
+
+			size_t GetVoxelCountAlongAxis() const override;
+			size_t GetAllocatedBytes() const override;
+
+			std::shared_ptr<VSerializationArchive> Serialize() const override;
+			void Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive) override;
+
+			std::shared_ptr<IVVoxelStorage> Clone() const override;
+
+			bool AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel) override;
+			void PrepareConcurrentWrite(const VIntVector& min, const VIntVector& max) override;
+
+			void ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const override;
+			void WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels) override;
+
+			static size_t EstimateAllocatedBytes(const size_t& voxelCountAlongAxis);
+
+			size_t GetBrickCountAlongAxis() const;
+			size_t GetAllocatedBrickCount() const;
+
+		public:
+			static const size_t BRICK_SIZE = 8;
+			static const size_t BRICK_VOXEL_COUNT = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+			static const uint32_t INVALID_BRICK = 0xFFFFFFFF;
+
+		private:
+			struct VBrick
+			{
+			public:
+				VVoxel Voxels[BRICK_VOXEL_COUNT];
+			};
+
+		private:
+			size_t GetBrickIndex(const VIntVector& voxelIndex) const;
+			size_t GetVoxelIndexInBrick(const VIntVector& voxelIndex) const;
+
+			uint32_t AllocateBrick(const size_t& brickIndex);
+
+			const VVoxel* GetBrickVoxels(const uint32_t& poolIndex) const;
+			VVoxel* GetBrickVoxelsForEditing(const uint32_t& poolIndex);
+
+			bool IsFillVoxel(const VVoxel& voxel) const;
+
+		private:
+			size_t VoxelCountAlongAxis = 0;
+			size_t BrickCountAlongAxis = 0;
+
+			VVoxel FillVoxel;
+
+			std::vector<uint32_t> BrickTable;
+			std::vector<std::shared_ptr<VBrick>> BrickPool;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "Vector.h"
+#include <vector>
+#include <stdint.h>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class IVVoxelStorage;
+
+		//Normalized density gradient per voxel, octahedral encoded into 2x8 bits. Follows the linear voxel index.
+		//The gradient is the central difference the shaders use in GetNormal, so blending it trilinearly gives the same normal without the extra fetches
+		class VGradientField
+		{
+		public:
+			void Build(const IVVoxelStorage& voxels);
+			void Clear();
+
+			//Recomputes the gradients of all voxels in the region. Callers need to include the neighbours of changed voxels
+			void UpdateVoxels(const IVVoxelStorage& voxels, const VIntVector& minVoxel, const VIntVector& maxVoxel);
+
+			bool IsEmpty() const;
+			size_t GetVoxelCountAlongAxis() const;
+			size_t GetAllocatedBytes() const;
+
+			VVector GetGradient(const VIntVector& voxelIndex) const;
+			VVector GetNormal(const VIntVector& cellIndex, const VVector& cellPos) const;
+
+			const std::vector<uint16_t>& GetEncodedNormals() const;
+
+			static uint16_t EncodeNormal(const float& x, const float& y, const float& z);
+			static VVector DecodeNormal(const uint16_t& encodedNormal);
+
+		public:
+			static const int UPDATE_TILE_SIZE = 8;
+
+		private:
+			size_t VoxelCountAlongAxis = 0;
+			std::vector<uint16_t> Normals;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "VoxelStorage.h"
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		//Stores densities as half floats relative to the cell size and materials in a separate plane. 3 bytes per voxel
+		class VHalfVoxelStorage : public IVVoxelStorage
+		{
+		public:
+			VHalfVoxelStorage(const float& cellSize);
+
+			EVVoxelStorageType GetType() const override;
+
+			void Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel) override;
+
+			void SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel) override;
+			VVoxel GetVoxel(const VIntVector& voxelIndex) const override;
+			VVoxel GetVoxel(const size_t& voxelIndex) const override;
+
+			size_t GetVoxelCountAlongAxis() const override;
+			size_t GetAllocatedBytes() const override;
+
+			std::shared_ptr<VSerializationArchive> Serialize() const override;
+			void Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive) override;
+
+			std::shared_ptr<IVVoxelStorage> Clone() const override;
+
+			void ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const override;
+			void WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels) override;
+
+			const uint8_t* GetMaterialPlane() const override;
+			const uint16_t* GetHalfDensityPlane() const;
+
+			static size_t EstimateAllocatedBytes(const size_t& voxelCountAlongAxis);
+
+		public:
+			static constexpr float MAX_HALF_VALUE = 65504.f;
+
+		private:
+			uint16_t EncodeDensity(const float& density) const;
+			float DecodeDensity(const uint16_t& density) const;
+
+			//Copies the planes before the first write if a clone still shares them
+			void MakePlanesUnique();
+
+		private:
+			float CellSize = 1.f;
+			size_t VoxelCountAlongAxis = 0;
+
+			//Shared between clones until one of them writes
+			std::shared_ptr<std::vector<uint16_t>> Densities = nullptr;
+			std::shared_ptr<std::vector<uint8_t>> Materials = nullptr;
+		};
+	}
+}
\ No newline at end of file
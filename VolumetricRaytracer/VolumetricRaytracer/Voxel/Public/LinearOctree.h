@@ -0,0 +1,145 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "Octree.h"
+#include <vector>
+#include <stdint.h>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class IVVoxelStorage;
+		class VSurfaceBitmap;
+
+		//12 byte node. The 8 children of a branch are stored next to each other starting at FirstChild.
+		//Leaves only reference the first cell of the region they cover, the voxels stay in the volume
+		struct VLinearOctreeNode
+		{
+		public:
+			static const uint32_t INVALID_NODE = 0xFFFFFFFF;
+
+			uint32_t FirstChild = INVALID_NODE;
+			uint16_t CellIndex[3] = { 0, 0, 0 };
+
+			//Bit i is set if child i is a branch
+			uint8_t ChildMask = 0;
+			uint8_t Depth = 0;
+
+			bool IsLeaf() const;
+			VIntVector GetCellIndex() const;
+		};
+
+		struct VLinearOctreeNodeRange
+		{
+		public:
+			uint32_t FirstNode = 0;
+			uint32_t NodeCount = 0;
+		};
+
+		struct VOctreeDensityBounds
+		{
+		public:
+			float MinDensity = 0;
+			float MaxDensity = 0;
+
+			bool IsOutside() const;
+			bool IsInside() const;
+		};
+
+		struct VOctreeRayHit
+		{
+		public:
+			float Distance = 0;
+			uint32_t NodeIndex = VLinearOctreeNode::INVALID_NODE;
+			VIntVector CellIndex;
+
+			//The node is completely inside the surface, a shadow ray can stop here
+			bool Inside = false;
+		};
+
+		//Pointer free replacement for VCellOctree. Builds the collapsed tree directly: a region becomes a leaf if none of its cells has a surface.
+		//Node i of the pool is GPU node i. A fresh tree is stored depth first, UpdateRegion reuses freed child blocks and appends new ones
+		class VLinearCellOctree
+		{
+		public:
+			VLinearCellOctree(const uint8_t& maxDepth, const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap = nullptr);
+
+			size_t GetMaxDepth() const;
+			size_t GetCellCountAlongAxis() const;
+
+			size_t GetNodeCount() const;
+			const VLinearOctreeNode& GetNode(const size_t& nodeIndex) const;
+			const std::vector<VLinearOctreeNode>& GetNodes() const;
+
+			size_t GetAllocatedBytes() const;
+
+			void GetGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const;
+			void GetGPUOctreeNodes(const VLinearOctreeNodeRange& range, const size_t& nodeAxisCount, std::vector<VCellGPUOctreeNode>& outNodes) const;
+
+			//Re-splits and re-merges the nodes overlapping the cell box after the surface bitmap was updated.
+			//Appends the ranges of nodes whose GPU representation changed. Returns false if nothing changed
+			bool UpdateRegion(const VSurfaceBitmap& surfaceBitmap, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes);
+
+			//Child blocks released by UpdateRegion that are not reused yet. They stay in the pool but are unreachable
+			size_t GetFreeNodeCount() const;
+
+			//Min/max density of every node. densityPerCell is a Lipschitz bound of the densities (largest change over one cell length),
+			//it enables distance bounds for sphere tracing steps. Pass 0 if the densities are not distance like
+			void BuildDensityBounds(const IVVoxelStorage& voxels, const float& densityPerCell = 0);
+
+			//Keeps the bounds conservative after UpdateRegion. Leaves that cover more than a cell only grow their interval, a full build tightens it again
+			void UpdateDensityBounds(const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes);
+
+			bool HasDensityBounds() const;
+			const VOctreeDensityBounds& GetDensityBounds(const size_t& nodeIndex) const;
+			float GetDistanceBound(const size_t& nodeIndex) const;
+
+			//Ray in cell coordinates, cell (x, y, z) spans [x, x + 1]. Skips every node whose density interval has no sign change and
+			//returns the first leaf that may contain the surface or the first node that is completely inside.
+			//Distances are measured in multiples of direction
+			bool FindFirstSurfaceCandidate(const VVector& origin, const VVector& direction, const float& maxDistance, VOctreeRayHit& outHit, size_t* outVisitedNodeCount = nullptr) const;
+
+			static size_t GetGPUNodeAxisCount(const size_t& nodeCount);
+			static void MergeNodeRanges(std::vector<VLinearOctreeNodeRange>& ranges);
+
+		public:
+			//Subtrees below this depth are built by worker threads and appended in order, so the result does not depend on the thread count
+			static const uint8_t PARALLEL_SPLIT_DEPTH = 3;
+
+		private:
+			void GenerateOctreeFromVoxelVolume(const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap);
+
+			bool UpdateNode(const uint32_t& nodeIndex, const VSurfaceBitmap& surfaceBitmap, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes);
+			void BuildSubtree(const uint32_t& nodeIndex, const VSurfaceBitmap& surfaceBitmap, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes);
+			void ReleaseSubtree(const uint32_t& nodeIndex);
+
+			uint32_t AllocateChildBlock();
+
+			VOctreeDensityBounds BuildBranchDensityBounds(const uint32_t& nodeIndex);
+			VOctreeDensityBounds UpdateNodeDensityBounds(const uint32_t& nodeIndex, const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell, std::vector<VLinearOctreeNodeRange>& outChangedNodes);
+
+		private:
+			uint8_t MaxDepth;
+			std::vector<VLinearOctreeNode> Nodes;
+			std::vector<uint32_t> FreeChildBlocks;
+
+			std::vector<VOctreeDensityBounds> DensityBounds;
+			float DensityPerCell = 0;
+		};
+	}
+}
\ No newline at end of file
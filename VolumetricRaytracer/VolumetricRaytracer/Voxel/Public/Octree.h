@@ -23,6 +23,9 @@ namespace VolumeRaytracer
 {
 	namespace Voxel
 	{
+		class IVVoxelStorage;
+		class VSurfaceBitmap;
+
 		class VCellOctreeNode
 		{
 		public:
@@ -31,6 +34,7 @@ namespace VolumeRaytracer
 
 			void ToBranch();
 			void ToLeaf(const VCell& cell, const VIntVector& index);
+			void ToLeaf(const VCell& cell, const VIntVector& index, const bool& hasSurface);
 
 			bool TryToMergeNodes();
 
@@ -49,6 +53,7 @@ namespace VolumeRaytracer
 			size_t Depth;
 
 			bool Leaf;
+			bool SurfaceCell = false;
 			VCell VoxelCell;
 			VIntVector Index;
 		};
@@ -59,12 +64,18 @@ namespace VolumeRaytracer
 			bool IsLeaf;
 			VIntVector CellIndex;
 			std::vector<VIntVector> Children;
+
+			//Conservative density interval of all voxels in the node region. An interval without a sign change lets a ray skip the node.
+			//DistanceBound is a lower bound for the distance to the surface in cells, 0 if unknown
+			float MinDensity = 0;
+			float MaxDensity = 0;
+			float DistanceBound = 0;
 		};
 
 		class VCellOctree
 		{
 		public:
-			VCellOctree(const uint8_t& maxDepth, const std::vector<VVoxel>& voxelArray);
+			VCellOctree(const uint8_t& maxDepth, const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap = nullptr);
 			~VCellOctree();
 
 			size_t GetMaxDepth() const;
@@ -77,7 +88,7 @@ namespace VolumeRaytracer
 			void GetGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const;
 
 		private:
-			void GenerateOctreeFromVoxelVolume(const size_t& voxelAxisCount, const std::vector<VVoxel>& voxelArray);
+			void GenerateOctreeFromVoxelVolume(const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap);
 
 			VIntVector CalculateOctreeNodeIndex(const VIntVector& parentIndex, const VIntVector& relativeIndex, const size_t& currentDepth) const;
 			std::shared_ptr<VCellOctreeNode> GetOctreeNode(const std::shared_ptr<VCellOctreeNode>& parent, const VIntVector& parentIndex, const VIntVector& cellIndex) const;
@@ -0,0 +1,67 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "VoxelStorage.h"
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class VPlanarVoxelStorage : public IVVoxelStorage
+		{
+		public:
+			EVVoxelStorageType GetType() const override;
+
+			void Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel) override;
+
+			void SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel) override;
+			VVoxel GetVoxel(const VIntVector& voxelIndex) const override;
+			VVoxel GetVoxel(const size_t& voxelIndex) const override;
+
+			size_t GetVoxelCountAlongAxis() const override;
+			size_t GetAllocatedBytes() const override;
+
+			std::shared_ptr<VSerializationArchive> Serialize() const override;
+			void Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive) override;
+
+			std::shared_ptr<IVVoxelStorage> Clone() const override;
+
+			void ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const override;
+			void WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels) override;
+
+			const float* GetDensityPlane() const override;
+			const uint8_t* GetMaterialPlane() const override;
+
+			float* GetDensityPlane();
+			uint8_t* GetMaterialPlane();
+
+			static size_t EstimateAllocatedBytes(const size_t& voxelCountAlongAxis);
+
+		private:
+			//Copy a plane before the first write if a clone still shares it
+			void MakeDensitiesUnique();
+			void MakeMaterialsUnique();
+
+		private:
+			size_t VoxelCountAlongAxis = 0;
+
+			//Each plane is shared between clones until one of them writes to it
+			std::shared_ptr<std::vector<float>> Densities = nullptr;
+			std::shared_ptr<std::vector<uint8_t>> Materials = nullptr;
+		};
+	}
+}
\ No newline at end of file
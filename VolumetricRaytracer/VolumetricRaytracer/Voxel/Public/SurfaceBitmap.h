@@ -0,0 +1,58 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "Vector.h"
+#include <vector>
+#include <stdint.h>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class IVVoxelStorage;
+
+		//One bit per cell, set if the cell contains a surface (same classification as VCell::HasSurface). Bits follow the linear cell index.
+		class VSurfaceBitmap
+		{
+		public:
+			void Build(const IVVoxelStorage& voxels);
+			void Clear();
+
+			void UpdateCells(const IVVoxelStorage& voxels, const VIntVector& minCell, const VIntVector& maxCell);
+			void UpdateVoxel(const IVVoxelStorage& voxels, const VIntVector& voxelIndex);
+
+			bool IsEmpty() const;
+			bool IsSurfaceCell(const VIntVector& cellIndex) const;
+
+			size_t CountSurfaceCells() const;
+			size_t CountSurfaceCells(const VIntVector& minCell, const VIntVector& maxCell) const;
+			bool HasSurface(const VIntVector& minCell, const VIntVector& maxCell) const;
+
+			size_t GetCellCountAlongAxis() const;
+			const std::vector<uint64_t>& GetWords() const;
+
+		private:
+			size_t GetBitIndex(const int& x, const int& y, const int& z) const;
+
+			void WriteBits(const size_t& bitIndex, const uint64_t* bits, const size_t& bitCount);
+			size_t CountBits(const size_t& bitIndex, const size_t& bitCount) const;
+
+		private:
+			size_t CellCountAlongAxis = 0;
+			std::vector<uint64_t> Words;
+		};
+	}
+}
\ No newline at end of file
@@ -20,7 +20,8 @@ namespace VolumeRaytracer
 {
 	namespace Voxel
 	{
-		struct VVoxel
+		//Aligned to 8 bytes so a voxel can be swapped atomically as a whole
+		struct alignas(8) VVoxel
 		{
 		public:
 			static const float DEFAULT_DENSITY;
@@ -29,6 +30,20 @@ namespace VolumeRaytracer
 			float Density = DEFAULT_DENSITY;
 		};
 
+		struct VCompactVoxel
+		{
+		public:
+			static const float DENSITY_STEPS_PER_CELL;
+			static const uint8_t FLAG_DENSITY_CLAMPED = 0x1;
+
+			int16_t Density = 0;
+			uint8_t Material = 0;
+			uint8_t Flags = 0;
+
+			static VCompactVoxel FromVoxel(const VVoxel& voxel, const float& cellSize);
+			VVoxel ToVoxel(const float& cellSize) const;
+		};
+
 		struct VCell
 		{
 		public:
@@ -0,0 +1,46 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "Voxel.h"
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		//Axis aligned block of voxels [Min, Max] stored in the same linear order as the volume (y is the fastest axis).
+		struct VVoxelBox
+		{
+		public:
+			VIntVector Min;
+			VIntVector Max;
+			std::vector<VVoxel> Voxels;
+
+			void Resize(const VIntVector& min, const VIntVector& max);
+
+			VIntVector GetSize() const;
+			size_t GetVoxelCount() const;
+
+			size_t GetLocalIndex(const VIntVector& voxelIndex) const;
+
+			VVoxel& GetVoxel(const VIntVector& voxelIndex);
+			const VVoxel& GetVoxel(const VIntVector& voxelIndex) const;
+
+			VVoxel* GetRow(const int& x, const int& z);
+			const VVoxel* GetRow(const int& x, const int& z) const;
+		};
+	}
+}
\ No newline at end of file
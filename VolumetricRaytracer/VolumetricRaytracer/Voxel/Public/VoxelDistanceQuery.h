@@ -0,0 +1,63 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "Vector.h"
+#include <stdint.h>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class IVVoxelStorage;
+		class VSurfaceBitmap;
+
+		struct VVoxelDistanceResult
+		{
+		public:
+			//Signed distance between the query shape and the surface, negative while they overlap
+			float Distance = 0.f;
+			//Surface normal at the closest point, pointing outside
+			VVector Normal = VVector::ZERO;
+
+			bool IsOverlapping() const;
+			float GetPenetrationDepth() const;
+		};
+
+		//Batched point, sphere and capsule queries against the density field of a volume, positions relative to the volume center.
+		//Cells whose densities change like a distance field (slope close to one) are sampled trilinearly. Anywhere else, like the clamped far field
+		//of a narrow band, the surface bitmap is searched for the closest surface cell instead. Without a surface in reach the result is a lower bound.
+		//densityScale is the density change per unit of distance, distances and penetration depths are returned in volume units
+		class VVoxelDistanceQuery
+		{
+		public:
+			static void QuerySpheres(const IVVoxelStorage& voxels, const VSurfaceBitmap& surfaceBitmap, const float& cellSize, const float& densityScale, const float& volumeExtends, const VVector* centers, const float* radii, const size_t& count, VVoxelDistanceResult* outResults);
+
+			//Capsules are the segments [starts, ends] grown by their radius. The segment is sampled with sphere queries every CAPSULE_SAMPLE_STEP cells,
+			//then the interval around the closest sample is sampled again, so the distance is within a fraction of a cell of the true minimum
+			static void QueryCapsules(const IVVoxelStorage& voxels, const VSurfaceBitmap& surfaceBitmap, const float& cellSize, const float& densityScale, const float& volumeExtends, const VVector* starts, const VVector* ends, const float* radii, const size_t& count, VVoxelDistanceResult* outResults);
+
+		public:
+			static const float MIN_DISTANCE_SLOPE;
+			static const float MAX_DISTANCE_SLOPE;
+			static const int MAX_SURFACE_SEARCH_CELLS = 16;
+			static const size_t QUERY_CHUNK_SIZE = 64;
+
+			static const float CAPSULE_SAMPLE_STEP;
+			static const size_t CAPSULE_REFINE_SAMPLE_COUNT = 9;
+		};
+	}
+}
\ No newline at end of file
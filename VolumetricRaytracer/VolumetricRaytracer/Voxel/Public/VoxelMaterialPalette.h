@@ -0,0 +1,70 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "MathHelpers.h"
+#include <vector>
+#include <stdint.h>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		//Palette compressed materials of a fixed number of voxels. Each voxel stores 0, 1, 2, 4 or 8 bits indexing a palette of distinct materials.
+		//The index width grows when a new material doesn't fit into the palette anymore
+		class VVoxelMaterialPalette
+		{
+		public:
+			VVoxelMaterialPalette(const size_t& voxelCount = 0, const uint8_t& material = 0);
+
+			void Fill(const uint8_t& material);
+
+			uint8_t Get(const size_t& voxelIndex) const;
+			void Set(const size_t& voxelIndex, const uint8_t& material);
+
+			void Decode(const size_t& voxelIndex, const size_t& count, uint8_t* outMaterials) const;
+			void Encode(const size_t& voxelIndex, const size_t& count, const uint8_t* materials);
+
+			//True if every voxel uses the same material. Bricks with a single palette entry answer without looking at the indices
+			bool IsUniform(uint8_t& outMaterial) const;
+
+			size_t GetVoxelCount() const;
+			uint8_t GetBitsPerVoxel() const;
+			size_t GetPaletteSize() const;
+			size_t GetAllocatedBytes() const;
+
+			void Serialize(std::vector<char>& outData) const;
+			bool Deserialize(const char*& data, const char* dataEnd);
+
+		private:
+			uint32_t GetPaletteIndex(const size_t& voxelIndex) const;
+			void SetPaletteIndex(const size_t& voxelIndex, const uint32_t& paletteIndex);
+
+			uint32_t FindOrAddMaterial(const uint8_t& material);
+			void RemoveUnusedMaterials();
+			void Repack(const uint8_t& bitsPerVoxel);
+
+			static size_t GetWordCount(const size_t& voxelCount, const uint8_t& bitsPerVoxel);
+
+		private:
+			size_t VoxelCount = 0;
+			uint8_t BitsPerVoxel = 0;
+
+			std::vector<uint8_t> Palette;
+			std::vector<uint64_t> Indices;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "Vector.h"
+#include <vector>
+#include <stdint.h>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class IVVoxelStorage;
+		class VSurfaceBitmap;
+
+		//Indexed triangle mesh. Positions are relative to the volume center like VVoxelVolume::VoxelIndexToRelativePosition
+		struct VVoxelMesh
+		{
+		public:
+			std::vector<VVector> Positions;
+			std::vector<VVector> Normals;
+			std::vector<uint8_t> Materials;
+			std::vector<uint32_t> Indices;
+
+			void Clear();
+
+			size_t GetVertexCount() const;
+			size_t GetTriangleCount() const;
+		};
+
+		//Dual contouring over the trilinear density field the renderer intersects. Every cell with a sign change gets one vertex,
+		//every edge with a sign change gets a quad between the four cells sharing it. Bricks of cells are processed in parallel
+		//and bricks without surface cells in the bitmap are skipped. The output does not depend on the thread count
+		class VVoxelMeshExtractor
+		{
+		public:
+			static void ExtractMesh(const IVVoxelStorage& voxels, const VSurfaceBitmap* surfaceBitmap, const float& cellSize, const VVector& volumeOrigin, VVoxelMesh& outMesh);
+
+		public:
+			static const int BRICK_SIZE = 8;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "Voxel.h"
+#include "ISerializable.h"
+#include <memory>
+#include <mutex>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		enum class EVVoxelStorageType
+		{
+			Dense = 0,
+			Brick = 1,
+			Compact = 2,
+			Planar = 3,
+			Morton = 4,
+			NarrowBand = 5,
+			Palette = 6,
+			Half = 7
+		};
+
+		class IVVoxelStorage
+		{
+		public:
+			IVVoxelStorage() = default;
+			virtual ~IVVoxelStorage() = default;
+
+			virtual EVVoxelStorageType GetType() const = 0;
+
+			virtual void Allocate(const size_t& voxelCountAlongAxis, const VVoxel& fillVoxel) = 0;
+
+			virtual void SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel) = 0;
+			virtual VVoxel GetVoxel(const VIntVector& voxelIndex) const = 0;
+			virtual VVoxel GetVoxel(const size_t& voxelIndex) const = 0;
+
+			virtual size_t GetVoxelCountAlongAxis() const = 0;
+			virtual size_t GetAllocatedBytes() const = 0;
+
+			virtual std::shared_ptr<VSerializationArchive> Serialize() const = 0;
+			virtual void Deserialize(const size_t& voxelCountAlongAxis, std::shared_ptr<VSerializationArchive> archive) = 0;
+
+			//Shares the payload until either side writes. Brick, NarrowBand and Palette storages then copy only the 8x8x8 bricks a write touches,
+			//all others copy their whole payload. Clone must not overlap writes to the original, VVoxelVolume serializes both with its edit lock
+			virtual std::shared_ptr<IVVoxelStorage> Clone() const = 0;
+
+			virtual void ReadBox(const VIntVector& min, const VIntVector& max, VVoxel* outVoxels) const;
+			virtual void WriteBox(const VIntVector& min, const VIntVector& max, const VVoxel* voxels);
+
+			virtual const float* GetDensityPlane() const { return nullptr; }
+			virtual const uint8_t* GetMaterialPlane() const { return nullptr; }
+
+			//Fast path for storages that track materials per region. False means unknown, not necessarily mixed
+			virtual bool IsUniformMaterial(const VIntVector&, const VIntVector&, uint8_t&) const { return false; }
+
+			//Keeps the lower density, equal densities keep the higher material. Returns true if the voxel changed.
+			//Safe to call from multiple threads for voxels inside a region passed to PrepareConcurrentWrite. The default implementation locks this storage
+			virtual bool AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel);
+			virtual void PrepareConcurrentWrite(const VIntVector&, const VIntVector&) {}
+			virtual void FinishConcurrentWrite(const VIntVector&, const VIntVector&) {}
+
+		protected:
+			//Clones share no state with the original, so each one gets its own lock
+			IVVoxelStorage(const IVVoxelStorage&) {}
+			IVVoxelStorage& operator=(const IVVoxelStorage&) { return *this; }
+
+			static bool IsLowerVoxel(const VVoxel& voxel, const VVoxel& other);
+			static bool AtomicMinVoxelInPlace(VVoxel& target, const VVoxel& voxel);
+
+		private:
+			std::mutex FallbackWriteMutex;
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+#pragma once
+
+#include "VoxelStorage.h"
+#include <memory>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		class VVoxelStorageFactory
+		{
+		public:
+			//cellSize is the density of one cell of distance. It equals the world cell size for exact signed distances
+			static std::shared_ptr<IVVoxelStorage> CreateStorage(const EVVoxelStorageType& storageType, const float& cellSize);
+			static size_t EstimateAllocatedBytes(const EVVoxelStorageType& storageType, const size_t& voxelCountAlongAxis);
+		};
+	}
+}
\ No newline at end of file
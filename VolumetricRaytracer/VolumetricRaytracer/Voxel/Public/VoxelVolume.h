@@ -15,12 +15,22 @@
 #pragma once
 
 #include "Octree.h"
+#include "LinearOctree.h"
+#include "VoxelStorage.h"
+#include "VoxelBox.h"
+#include "SurfaceBitmap.h"
+#include "GradientField.h"
+#include "VoxelMeshExtractor.h"
+#include "VoxelDistanceQuery.h"
 #include "Object.h"
 #include "ISerializable.h"
 #include "Material.h"
 #include "AABB.h"
 #include <string>
 #include <iterator>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 namespace VolumeRaytracer
 {
@@ -34,38 +44,71 @@ namespace VolumeRaytracer
 
 	namespace Voxel
 	{
+		enum class EVResampleFilter
+		{
+			Trilinear = 0,
+			Tricubic = 1
+		};
+
+		struct VVoxelRegion
+		{
+		public:
+			VIntVector Min;
+			VIntVector Max;
+		};
+
 		class VVoxelVolume : public VObject, public IVSerializable
 		{
 		public:
-			VVoxelVolume(const uint8_t& resolution, const float& volumeExtends);
+			static const uint8_t MAX_RESOLUTION = 12;
+			//The DX traversal texture stores cell and child indices in 8 bit channels, so larger volumes can only be used on the CPU
+			static const uint8_t MAX_RENDER_RESOLUTION = 8;
+			static const size_t DIRTY_REGION_SIZE = 8;
+
+			//densityScale is the density change per world unit of distance near the surface, 1 for exact signed distances.
+			//Storages that keep a band around the surface or quantize densities size their ranges with it
+			VVoxelVolume(const uint8_t& resolution, const float& volumeExtends, const EVVoxelStorageType& storageType = EVVoxelStorageType::Dense, const float& densityScale = 1.f);
 
 			unsigned int GetSize() const;
 			size_t GetVoxelCount() const;
 			float GetVolumeExtends() const;
 			float GetCellSize() const;
+			float GetDensityScale() const;
 
 			VAABB GetVolumeBounds() const;
 
+			//Takes the edit lock for every voxel. Bulk edits should use WriteVoxelBox or ParallelForEachVoxel, which lock,
+			//mark their regions and patch the caches once per box
 			void SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel);
 			VVoxel GetVoxel(const VIntVector& voxelIndex) const;
 			VVoxel GetVoxel(const size_t& voxelIndex) const;
 			bool IsValidVoxelIndex(const VIntVector& voxelIndex) const;
 
-			void SetMaterial(const VMaterial& material);
-			VMaterial GetMaterial() const;
-
-			void FillVolume(const VVoxel& voxel);
-			void PostRender() override;
+			bool ReadVoxelBox(const VIntVector& min, const VIntVector& max, VVoxelBox& outBox) const;
+			bool WriteVoxelBox(const VVoxelBox& box);
 
+			void ParallelForEachVoxel(const VIntVector& min, const VIntVector& max, const std::function<void(const VIntVector&, VVoxel&)>& fn);
 
-			const bool CanEverTick() const override;
+			//Lock free writes from multiple threads. Prepare every region first, then call AtomicMinVoxel from any thread and finish the written region with EndConcurrentWrite.
+			//Snapshots wait until the write is finished, so the thread that began it must not take one in between
+			void BeginConcurrentWrite(const VIntVector& min, const VIntVector& max);
+			bool AtomicMinVoxel(const VIntVector& voxelIndex, const VVoxel& voxel);
+			void EndConcurrentWrite(const VIntVector& min, const VIntVector& max);
 
+			void SetMaterial(const VMaterial& material);
+			VMaterial GetMaterial() const;
 
-			bool ShouldTick() const override;
+			void FillVolume(const VVoxel& voxel);
 
 			void MakeDirty();
 			bool IsDirty() const;
 
+			void MarkRegionDirty(const VIntVector& min, const VIntVector& max);
+			void GetDirtyRegions(std::vector<VVoxelRegion>& outRegions) const;
+			size_t GetDirtyRegionCount() const;
+			size_t GetRegionCount() const;
+			void ClearDirtyRegions();
+
 			VVector VoxelIndexToRelativePosition(const VIntVector& voxelIndex) const;
 			VIntVector RelativePositionToCellIndex(const VVector& pos) const;
 			VIntVector RelativePositionToVoxelIndex(const VVector& pos) const;
@@ -75,28 +118,129 @@ namespace VolumeRaytracer
 
 			void Deserialize(const std::wstring& sourcePath, std::shared_ptr<VSerializationArchive> archive) override;
 
-			void GenerateGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const;
+			//Returns the octree behind the GPU nodes. Keep it to patch it with UpdateGPUOctreeStructure after later edits
+			std::shared_ptr<VLinearCellOctree> GenerateGPUOctreeStructure(std::vector<VCellGPUOctreeNode>& outNodes, size_t& outNodeAxisCount) const;
+
+			//Patches an octree of an earlier GenerateGPUOctreeStructure call with the dirty regions. Returns false if a full rebuild is needed,
+			//because the whole volume changed or the node pool outgrew nodeAxisCount
+			bool UpdateGPUOctreeStructure(VLinearCellOctree& octree, const size_t& nodeAxisCount, std::vector<VLinearOctreeNodeRange>& outChangedRanges, std::vector<VCellGPUOctreeNode>& outChangedNodes) const;
+
+			//Largest density change per world unit, 1 for exact signed distances. Enables distance bounds in the octree nodes, 0 disables them
+			void SetDensityLipschitzBound(const float& densityPerUnit);
+			float GetDensityLipschitzBound() const;
+
+			//Caches are built on first use. Concurrent const access is safe, writes need exclusive access like every other edit
+			const VSurfaceBitmap& GetSurfaceBitmap() const;
+			//Once built, edits patch the bitmap in place. It is only outdated again after changes to the whole volume
+			bool IsSurfaceBitmapOutdated() const;
+
+			//Optional precomputed normals. Built in parallel on first access and kept up to date by voxel writes while enabled
+			void SetGradientFieldEnabled(const bool& enabled);
+			bool IsGradientFieldEnabled() const;
+			const VGradientField& GetGradientField() const;
+
+			//Triangle mesh of the density surface for collision, raster fallback and previews
+			void ExtractMesh(VVoxelMesh& outMesh) const;
+
+			//Signed distances of spheres relative to the volume center. Radii can be null to query points
+			void QuerySpheres(const VVector* centers, const float* radii, const size_t& count, VVoxelDistanceResult* outResults) const;
+			//Signed distances of capsules between starts and ends. Radii can be null to query segments
+			void QueryCapsules(const VVector* starts, const VVector* ends, const float* radii, const size_t& count, VVoxelDistanceResult* outResults) const;
 
 			uint8_t GetResolution() const;
 
+			static size_t GetVoxelCountAlongAxis(const uint8_t& resolution);
+			static size_t EstimateAllocatedBytes(const uint8_t& resolution, const EVVoxelStorageType& storageType);
+
+			//Resamples the volume to another resolution while keeping its extends. The inside/outside classification of every output voxel
+			//is taken from the source so filtering never moves or erodes the surface. Returns false if the resolution is out of range
+			bool ResampleTo(const uint8_t& resolution, const EVResampleFilter& filter = EVResampleFilter::Trilinear);
+
+			void GenerateLODs(const uint8_t& maxLODCount = MAX_RESOLUTION);
+			void ClearLODs();
+			size_t GetLODCount() const;
+			bool AreLODsOutdated() const;
+			std::shared_ptr<const VVoxelVolume> GetLOD(const size_t& lod) const;
+			size_t SelectLOD(const float& projectedSizeInPixels) const;
+
+			//Immutable copy for readers on another thread. It carries the dirty regions of the volume at the time it was taken.
+			//Edits and snapshots share one lock, so an edit is either complete in a snapshot or missing from it, never half of it.
+			//Taking a snapshot copies no voxels. The first edit after it does, per touched brick in the Brick, NarrowBand and Palette
+			//storages and for the whole volume in all others. Keeping many snapshots, e.g. as undo history, is only cheap with the former
+			std::shared_ptr<const VVoxelVolume> CreateSnapshot() const;
+			//Snapshot that takes over the dirty regions, the volume starts tracking again from a clean state. Used by the render sync,
+			//so edits made after the snapshot are picked up by the next one. Builds the surface bitmap of the volume if it is outdated,
+			//later edits keep it current and every following snapshot copies it instead of rebuilding it for the octree patch
+			std::shared_ptr<const VVoxelVolume> TakeSnapshot();
+			void RestoreSnapshot(const std::shared_ptr<const VVoxelVolume>& snapshot);
+
+			EVVoxelStorageType GetStorageType() const;
+			size_t GetAllocatedBytes() const;
+
+			//Moves the voxels into another storage type. Lossy storages like Compact or Half quantize the densities on the way
+			void ConvertStorage(const EVVoxelStorageType& storageType);
+
+			const float* GetDensityPlane() const;
+			const uint8_t* GetMaterialPlane() const;
+
+			//Writes through these planes bypass the edit lock. Take no snapshot until they are done
+			float* GetDensityPlaneForEditing();
+			uint8_t* GetMaterialPlaneForEditing();
+
 		protected:
 			void Initialize() override;
 			void BeginDestroy() override;
 
 			void ClearDirtyFlag();
 
+		private:
+			//Copy of everything but the dirty state, shared by CreateSnapshot and TakeSnapshot
+			std::shared_ptr<VVoxelVolume> CopyForSnapshot() const;
+
+			void AllocateDirtyRegions();
+			//Expect EditMutex to be held by the caller
+			void MakeDirtyLocked();
+			void MarkRegionDirtyLocked(const VIntVector& min, const VIntVector& max);
+			void UpdateGradientField(const VIntVector& min, const VIntVector& max);
+
 		private:
 			float VolumeExtends = 0;
 			float CellSize = 0;
+			float DensityScale = 1.f;
 			
 			uint8_t Resolution = 0;
 			size_t VoxelCountAlongAxis = 0;
 
-			std::vector<VVoxel> Voxels;
+			std::shared_ptr<IVVoxelStorage> Voxels;
 
 			VMaterial GeometryMaterial;
 
+			//Held by every edit for its write, cache patches and dirty marking, and by the snapshots for the storage clone and
+			//the dirty state hand over. A storage therefore never copies or writes a payload while a snapshot takes a share of it
+			mutable std::mutex EditMutex;
+			//AtomicMinVoxel runs outside of the lock, snapshots wait until EndConcurrentWrite
+			mutable std::condition_variable ConcurrentWriteEnded;
+			bool ConcurrentWriteOpen = false;
+
 			bool DirtyFlag = false;
+
+			size_t RegionCountAlongAxis = 0;
+			size_t DirtyRegionCount = 0;
+			std::vector<uint8_t> DirtyRegions;
+
+			std::vector<std::shared_ptr<VVoxelVolume>> LODs;
+			bool LODsOutdated = false;
+
+			mutable std::mutex CacheMutex;
+
+			mutable VSurfaceBitmap SurfaceBitmap;
+			mutable bool SurfaceBitmapOutdated = true;
+
+			float DensityLipschitzBound = 0;
+
+			mutable VGradientField GradientField;
+			bool GradientFieldEnabled = false;
+			mutable bool GradientFieldOutdated = true;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+	Copyright (c) 2021 Thomas Schngrundner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+*/
+
+
+#pragma once
+
+#include "VoxelVolume.h"
+#include <vector>
+
+namespace VolumeRaytracer
+{
+	namespace Voxel
+	{
+		//Grid of independently allocated volumes for objects that are too large for a single volume.
+		//Neighboring tiles share their border voxels, so both sides of a seam sample the same densities.
+		//Tiles without surface are never allocated and read as the fill voxel
+		class VVoxelVolumeGrid : public VObject
+		{
+		public:
+			VVoxelVolumeGrid(const uint8_t& tileResolution, const float& tileExtends, const VIntVector& tileCount, const EVVoxelStorageType& storageType = EVVoxelStorageType::Dense, const float& densityScale = 1.f);
+
+			uint8_t GetTileResolution() const;
+			float GetTileExtends() const;
+			float GetCellSize() const;
+			EVVoxelStorageType GetStorageType() const;
+			float GetDensityScale() const;
+
+			VIntVector GetTileCount() const;
+			size_t GetTotalTileCount() const;
+			bool IsValidTileIndex(const VIntVector& tileIndex) const;
+
+			//Voxels along each axis of the whole grid. Shared borders are only counted once
+			VIntVector GetSize() const;
+			bool IsValidVoxelIndex(const VIntVector& voxelIndex) const;
+
+			VAABB GetGridBounds() const;
+
+			//Tile center relative to the grid center
+			VVector GetTileCenter(const VIntVector& tileIndex) const;
+			VIntVector GetTileVoxelOffset(const VIntVector& tileIndex) const;
+			VVector VoxelIndexToRelativePosition(const VIntVector& voxelIndex) const;
+
+			void SetFillVoxel(const VVoxel& voxel);
+			VVoxel GetFillVoxel() const;
+
+			void SetMaterial(const VMaterial& material);
+			VMaterial GetMaterial() const;
+
+			VObjectPtr<VVoxelVolume> GetTile(const VIntVector& tileIndex) const;
+			bool IsTileLoaded(const VIntVector& tileIndex) const;
+			std::vector<VIntVector> GetLoadedTiles() const;
+			size_t GetLoadedTileCount() const;
+
+			//Creates a tile filled with the fill voxel. Borders shared with loaded neighbors are copied from them
+			VObjectPtr<VVoxelVolume> AllocateTile(const VIntVector& tileIndex);
+
+			//Tiles can be streamed in and out independently. A loaded volume must match the tile resolution and extends
+			bool LoadTile(const VIntVector& tileIndex, VObjectPtr<VVoxelVolume> volume);
+			bool LoadTile(const VIntVector& tileIndex, const std::wstring& sourcePath, std::shared_ptr<VSerializationArchive> archive);
+			std::shared_ptr<VSerializationArchive> SerializeTile(const VIntVector& tileIndex) const;
+			void UnloadTile(const VIntVector& tileIndex);
+
+			//Grid wide voxel access. Writes go to every tile sharing the voxel and allocate missing tiles if the voxel differs from the fill voxel
+			VVoxel GetVoxel(const VIntVector& voxelIndex) const;
+			void SetVoxel(const VIntVector& voxelIndex, const VVoxel& voxel);
+
+			//Makes shared border voxels identical by keeping the lower density of both sides. Call after tiles were written independently
+			void StitchBorders();
+
+			size_t GetAllocatedBytes() const;
+
+		protected:
+			void Initialize() override;
+			void BeginDestroy() override;
+
+		private:
+			size_t GetTileArrayIndex(const VIntVector& tileIndex) const;
+			int GetCellsPerTile() const;
+
+			void GetSharingTiles(const VIntVector& voxelIndex, std::vector<VIntVector>& outTiles) const;
+			void CopySharedBorders(const VIntVector& tileIndex);
+			void StitchVoxel(const VIntVector& voxelIndex, std::vector<VIntVector>& sharingTiles, std::vector<VVoxel>& voxels);
+
+		private:
+			uint8_t TileResolution = 0;
+			float TileExtends = 0;
+			VIntVector TileCount;
+			EVVoxelStorageType StorageType = EVVoxelStorageType::Dense;
+			float DensityScale = 1.f;
+
+			VVoxel FillVoxel;
+			VMaterial GeometryMaterial;
+
+			std::vector<VObjectPtr<VVoxelVolume>> Tiles;
+		};
+	}
+}
\ No newline at end of file
@@ -16,6 +16,8 @@
 #include "VoxelVolume.h"
 #include "Scene.h"
 #include "VoxelObject.h"
+#include "TiledVoxelObject.h"
+#include "VoxelVolumeGrid.h"
 #include "VolumeConverter.h"
 #include <iostream>
 #include <string>
@@ -31,19 +33,46 @@ VolumeRaytracer::VObjectPtr<VolumeRaytracer::Scene::VScene> VolumeRaytracer::Vox
 	std::cout << "Converting meshes to voxel volumes" << std::endl;
 
 	boost::unordered_map<std::string, VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolume>> volumes;
+	boost::unordered_map<std::string, VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolumeGrid>> volumeGrids;
 
 	for (const auto& mesh : sceneInfo.Meshes)
 	{
-		volumes[mesh.first] = VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh.second, textureLib);
+		int tileCount = 1;
+		uint8_t tileResolution = 5;
+
+		if (VVolumeConverter::ExtractTileCountFromName(mesh.second.MeshName, tileCount) && VVolumeConverter::ExtractResolutionFromName(mesh.second.MeshName, tileResolution))
+		{
+			//Tiles only exist to get large meshes into the renderer, so their resolution is capped instead of falling back to a single volume
+			if (tileResolution > Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION)
+			{
+				std::cout << "[ERROR] Mesh with name " << mesh.second.MeshName << " has tile resolution " << (int)tileResolution << " but the renderer supports at most " << (int)Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION << " per tile. Use more tiles instead. Using tile resolution " << (int)Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION << "!" << std::endl;
+				tileResolution = Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION;
+			}
+
+			volumeGrids[mesh.first] = VVolumeConverter::ConvertMeshInfoToVolumeGrid(mesh.second, textureLib, tileResolution, tileCount);
+		}
+		else
+		{
+			volumes[mesh.first] = VVolumeConverter::ConvertMeshInfoToVoxelVolume(mesh.second, textureLib);
+		}
 	}
 
 	std::cout << "Converting scene objects" << std::endl;
 
 	for (const auto& object : sceneInfo.Objects)
 	{
-		VObjectPtr<Scene::VVoxelObject> obj = scene->SpawnObject<Scene::VVoxelObject>(object.Position, object.Rotation, object.Scale);
+		if (volumeGrids.find(object.MeshID) != volumeGrids.end())
+		{
+			VObjectPtr<Scene::VTiledVoxelObject> obj = scene->SpawnObject<Scene::VTiledVoxelObject>(object.Position, object.Rotation, object.Scale);
 
-		obj->SetVoxelVolume(volumes[object.MeshID]);
+			obj->SetVolumeGrid(volumeGrids[object.MeshID]);
+		}
+		else
+		{
+			VObjectPtr<Scene::VVoxelObject> obj = scene->SpawnObject<Scene::VVoxelObject>(object.Position, object.Rotation, object.Scale);
+
+			obj->SetVoxelVolume(volumes[object.MeshID]);
+		}
 	}
 
 	std::cout << "Converting lights" << std::endl;
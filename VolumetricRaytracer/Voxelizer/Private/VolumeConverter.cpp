@@ -14,9 +14,12 @@
 
 #include "VolumeConverter.h"
 #include "VoxelVolume.h"
+#include "VoxelVolumeGrid.h"
 #include "MathHelpers.h"
 #include <iostream>
 #include <cmath>
+#include <limits>
+#include <cassert>
 
 namespace VolumeRaytracer
 {
@@ -27,63 +30,185 @@ namespace VolumeRaytracer
 	}
 }
 
-VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib)
+VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolume> VolumeRaytracer::Voxelizer::VVolumeConverter::ConvertMeshInfoToVoxelVolume(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib, const Voxel::EVVoxelStorageType& storageType /*= Voxel::EVVoxelStorageType::NarrowBand*/)
 {
-	float extends = VMathHelpers::Max(meshInfo.Bounds.GetExtends().X, VMathHelpers::Max(meshInfo.Bounds.GetExtends().Y, meshInfo.Bounds.GetExtends().Z));
-	extends += extends * 0.25f;
+	float extends = GetMeshVolumeExtends(meshInfo);
+	uint8_t desiredResolution = GetMeshResolution(meshInfo);
 
-	uint8_t desiredResolution = 5;
+	size_t estimatedBytes = Voxel::VVoxelVolume::EstimateAllocatedBytes(desiredResolution, storageType);
+	size_t voxelCountAlongAxis = Voxel::VVoxelVolume::GetVoxelCountAlongAxis(desiredResolution);
 
-	if (!ExtractResolutionFromName(meshInfo.MeshName, desiredResolution))
+	std::cout << "Allocating volume " << meshInfo.MeshName << " with " << voxelCountAlongAxis << "^3 voxels. Estimated initial memory: " << (estimatedBytes / 1024.0 / 1024.0) << " MB" << std::endl;
+
+	float cellSize = (extends * 2) / (voxelCountAlongAxis - 1.f);
+	float extractionThreshold = cellSize /** 0.5f*/ * std::sqrt(3);
+
+	//Densities are distances divided by the extraction threshold
+	VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(desiredResolution, extends, storageType, 1.f / extractionThreshold);
+
+	Voxel::VVoxel defaultVoxel;
+	defaultVoxel.Material = 0;
+	defaultVoxel.Density = extends * 2.f;
+
+	volume->FillVolume(defaultVoxel);
+
+	int triangleCount = (int)(meshInfo.Indices.size() / 3);
+
+	VIntVector writeMin = VIntVector::ONE * (int)volume->GetSize();
+	VIntVector writeMax = VIntVector::ZERO;
+
+	//Triangles overlap, so voxels are written with an atomic min. Prepare every touched region up front
+	for (int triangle = 0; triangle < triangleCount; triangle++)
 	{
-		desiredResolution = 5;
-		std::cout << "[WARNING] Mesh with name " << meshInfo.MeshName << " has no or invalid resolution specifier. Correct syntax is meshName_resolution (cubeMesh_6). Using default resolution of 5!" << std::endl;
+		VIntVector minIndex;
+		VIntVector maxIndex;
+
+		GetTriangleVoxelBounds(volume, meshInfo.Vertices[meshInfo.Indices[triangle * 3]], meshInfo.Vertices[meshInfo.Indices[triangle * 3 + 1]], meshInfo.Vertices[meshInfo.Indices[triangle * 3 + 2]], extractionThreshold, minIndex, maxIndex);
+
+		volume->BeginConcurrentWrite(minIndex, maxIndex);
+
+		writeMin = VIntVector::Min(writeMin, minIndex);
+		writeMax = VIntVector::Max(writeMax, maxIndex);
 	}
 
-	if (desiredResolution > 8)
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int triangle = 0; triangle < triangleCount; triangle++)
 	{
-		std::cout << "[WARNING] Mesh with name " << meshInfo.MeshName << " has invalid resolution. Resolution needs to be between or equal than 0 and 8.";
-		desiredResolution = 5;
+		const VVertex& v1 = meshInfo.Vertices[meshInfo.Indices[triangle * 3]];
+		const VVertex& v2 = meshInfo.Vertices[meshInfo.Indices[triangle * 3 + 1]];
+		const VVertex& v3 = meshInfo.Vertices[meshInfo.Indices[triangle * 3 + 2]];
+
+		VoxelizeTriangle(volume, v1, v2, v3, extractionThreshold);
 	}
 
-	VObjectPtr<Voxel::VVoxelVolume> volume = VObject::CreateObject<Voxel::VVoxelVolume>(desiredResolution, extends);
+	volume->EndConcurrentWrite(writeMin, writeMax);
+
+	volume->SetMaterial(GetMeshMaterial(meshInfo, textureLib));
+
+	return volume;
+}
+
+VolumeRaytracer::VObjectPtr<VolumeRaytracer::Voxel::VVoxelVolumeGrid> VolumeRaytracer::Voxelizer::VVolumeConverter::ConvertMeshInfoToVolumeGrid(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib, const uint8_t& tileResolution, const int& tilesAlongAxis)
+{
+	float extends = GetMeshVolumeExtends(meshInfo);
+	int tiles = VMathHelpers::Max(tilesAlongAxis, 1);
+
+	float tileExtends = extends / tiles;
+	float extractionThreshold = (tileExtends * 2) / (1 << tileResolution) * std::sqrt(3);
+
+	VObjectPtr<Voxel::VVoxelVolumeGrid> grid = VObject::CreateObject<Voxel::VVoxelVolumeGrid>(tileResolution, tileExtends, VIntVector::ONE * tiles, Voxel::EVVoxelStorageType::NarrowBand, 1.f / extractionThreshold);
 
 	Voxel::VVoxel defaultVoxel;
 	defaultVoxel.Material = 0;
 	defaultVoxel.Density = extends * 2.f;
 
-	volume->FillVolume(defaultVoxel);
+	grid->SetFillVoxel(defaultVoxel);
+	grid->SetMaterial(GetMeshMaterial(meshInfo, textureLib));
+
+	float cellSize = grid->GetCellSize();
+	int cellsPerTile = 1 << tileResolution;
+
+	VVector gridOrigin = grid->GetGridBounds().GetMin();
+	VIntVector tileCount = grid->GetTileCount();
 
-	float extractionThreshold = volume->GetCellSize() /** 0.5f*/ * std::sqrt(3);
+	//Bin triangles into every tile their voxel bounds touch. Triangles near a seam end up in both tiles, so shared border voxels see the same triangles
+	std::vector<std::vector<int>> tileTriangles(grid->GetTotalTileCount());
 
-	for (size_t index = 0; index <= (meshInfo.Indices.size() - 3); index += 3)
+	int triangleCount = (int)(meshInfo.Indices.size() / 3);
+
+	for (int triangle = 0; triangle < triangleCount; triangle++)
 	{
-		const VVertex& v1 = meshInfo.Vertices[meshInfo.Indices[index]];
-		const VVertex& v2 = meshInfo.Vertices[meshInfo.Indices[index + 1]];
-		const VVertex& v3 = meshInfo.Vertices[meshInfo.Indices[index + 2]];
+		const VVector& p1 = meshInfo.Vertices[meshInfo.Indices[triangle * 3]].Position;
+		const VVector& p2 = meshInfo.Vertices[meshInfo.Indices[triangle * 3 + 1]].Position;
+		const VVector& p3 = meshInfo.Vertices[meshInfo.Indices[triangle * 3 + 2]].Position;
 
-		VoxelizeTriangle(volume, v1, v2, v3, extractionThreshold);
+		VVector min = (VVector::Min(p1, VVector::Min(p2, p3)) - VVector::ONE * extractionThreshold - gridOrigin) / cellSize;
+		VVector max = (VVector::Max(p1, VVector::Max(p2, p3)) + VVector::ONE * extractionThreshold - gridOrigin) / cellSize;
+
+		VIntVector minVoxel = VIntVector((int)std::round(min.X), (int)std::round(min.Y), (int)std::round(min.Z)) - VIntVector::ONE;
+		VIntVector maxVoxel = VIntVector((int)std::round(max.X), (int)std::round(max.Y), (int)std::round(max.Z)) + VIntVector::ONE;
+
+		//Tile t covers the voxels [t * cellsPerTile, (t + 1) * cellsPerTile]
+		VIntVector minTile = VIntVector::Max(VIntVector::Min((minVoxel - VIntVector::ONE * cellsPerTile) / cellsPerTile, tileCount - VIntVector::ONE), 0);
+		VIntVector maxTile = VIntVector::Min(VIntVector::Max(maxVoxel / cellsPerTile, 0), tileCount - VIntVector::ONE);
+
+		for (int x = minTile.X; x <= maxTile.X; x++)
+		{
+			for (int y = minTile.Y; y <= maxTile.Y; y++)
+			{
+				for (int z = minTile.Z; z <= maxTile.Z; z++)
+				{
+					VIntVector tileStart = VIntVector(x, y, z) * cellsPerTile;
+
+					if (maxVoxel >= tileStart && minVoxel <= tileStart + VIntVector::ONE * cellsPerTile)
+					{
+						tileTriangles[VMathHelpers::Index3DTo1D(x, y, z, tileCount.Y, tileCount.Z)].push_back(triangle);
+					}
+				}
+			}
+		}
 	}
 
-	VMaterial material = meshInfo.Material;
-	std::string matName = meshInfo.MaterialName;
+	//Tiles are created up front because object creation registers with the tick manager
+	std::vector<size_t> surfaceTiles;
 
-	if (textureLib.Materials.find(meshInfo.MaterialName) != textureLib.Materials.end())
+	for (size_t i = 0; i < tileTriangles.size(); i++)
 	{
-		const VMaterialTextures& tex = textureLib.Materials.at(matName);
+		if (!tileTriangles[i].empty())
+		{
+			grid->AllocateTile(VMathHelpers::Index1DTo3D(i, tileCount.Y, tileCount.Z));
+			surfaceTiles.push_back(i);
+		}
+	}
 
-		material.AlbedoTexturePath = tex.Albedo;
-		material.NormalTexturePath = tex.Normal;
-		material.RMTexturePath = tex.RM;
-		material.TextureScale = tex.TextureTiling;
+	std::cout << "Allocating volume grid " << meshInfo.MeshName << " with " << surfaceTiles.size() << " of " << grid->GetTotalTileCount() << " tiles. Tile size: " << Voxel::VVoxelVolume::GetVoxelCountAlongAxis(tileResolution) << "^3 voxels" << std::endl;
+
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int)surfaceTiles.size(); i++)
+	{
+		VIntVector tileIndex = VMathHelpers::Index1DTo3D(surfaceTiles[i], tileCount.Y, tileCount.Z);
+
+		VoxelizeTile(grid->GetTile(tileIndex), grid->GetTileCenter(tileIndex), meshInfo, tileTriangles[surfaceTiles[i]], extractionThreshold);
 	}
 
-	volume->SetMaterial(material);
+	grid->StitchBorders();
 
-	return volume;
+	return grid;
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeVertex(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v)
+bool VolumeRaytracer::Voxelizer::VVolumeConverter::ExtractTileCountFromName(const std::string& name, int& outTileCount)
+{
+	size_t terminatorIndex = name.rfind('_');
+
+	if (terminatorIndex != std::string::npos)
+	{
+		size_t separatorIndex = name.find('x', terminatorIndex);
+
+		if (separatorIndex != std::string::npos)
+		{
+			try
+			{
+				int tiles = std::stoi(name.substr(separatorIndex + 1));
+
+				if (tiles < 1 || tiles > 64)
+				{
+					return false;
+				}
+
+				outTileCount = tiles;
+				return true;
+			}
+			catch (std::invalid_argument)
+			{}
+			catch (std::out_of_range)
+			{}
+		}
+	}
+
+	return false;
+}
+
+void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeVertex(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v)
 {
 	VIntVector index;
 
@@ -103,7 +228,7 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeVertex(std::shared_pt
 	}
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeEdge(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v1, const VVertex& v2)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeEdge(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2)
 {
 	VEdgeRay ray;
 
@@ -122,11 +247,6 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeEdge(std::shared_ptr<
 	VIntVector voxelIndex = volume->RelativePositionToVoxelIndex(v1.Position);;
 	VIntVector nextVoxel;
 
-	auto& getPositionAlongRay = [](const VEdgeRay& ray, const float& t)
-	{
-		return ray.Origin + ray.Direction * t;
-	};
-
 	while (t <= tMax)
 	{
 		nextVoxel = GoToNextVoxelAlongEdge(volume, ray, voxelIndex, voxelTravelingDir, tExit);
@@ -135,7 +255,7 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeEdge(std::shared_ptr<
 		{
 			Voxel::VVoxel v = volume->GetVoxel(voxelIndex);
 
-			float density = -GetNearestDistanceFromEdgeToPoint(volume->VoxelIndexToRelativePosition(voxelIndex), /*getPositionAlongRay(ray, t), getPositionAlongRay(ray, tExit),*/ v1.Position, v2.Position);
+			float density = -GetNearestDistanceFromEdgeToPoint(volume->VoxelIndexToRelativePosition(voxelIndex), v1.Position, v2.Position);
 
 			if (v.Density > 0)
 			{
@@ -158,7 +278,7 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeEdge(std::shared_ptr<
 	}
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeFace(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeFace(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold)
 {
 	VTriangle triangle;
 	triangle.V1 = v1.Position;
@@ -169,89 +289,88 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeFace(std::shared_ptr<
 
 	VTriangleRegions triangleRegions = CalculateTriangleRegionVectors(triangle);
 
-	VAABB triangleBoundingBox = GetTriangleBoundingBox(triangle, 0.f);
-
 	VIntVector minCellIndex;
 	VIntVector maxCellIndex;
 
-	GetVoxelizedBoundingBox(volume, triangleBoundingBox, minCellIndex, maxCellIndex, surfaceThreshold);
-	
-	minCellIndex = minCellIndex.Max(minCellIndex, 0);
-	maxCellIndex = maxCellIndex.Min(maxCellIndex, volume->GetSize() - 1);
+	GetTriangleVoxelBounds(volume, v1, v2, v3, surfaceThreshold, minCellIndex, maxCellIndex);
+
+	minCellIndex = VIntVector::Max(minCellIndex, 0);
+	maxCellIndex = VIntVector::Min(maxCellIndex, volume->GetSize() - 1);
 
 	for (int x = minCellIndex.X; x <= maxCellIndex.X; x++)
 	{
-		for (int y = minCellIndex.Y; y <= maxCellIndex.Y; y++)
+		for (int z = minCellIndex.Z; z <= maxCellIndex.Z; z++)
 		{
-			for (int z = minCellIndex.Z; z <= maxCellIndex.Z; z++)
+			for (int y = minCellIndex.Y; y <= maxCellIndex.Y; y++)
 			{
-				VIntVector voxelIndex = VIntVector(x, y, z);
-				VVector voxelPos = volume->VoxelIndexToRelativePosition(voxelIndex);
-
-				VTriangleRegionalVoxelDistances distances = CalculateTriangleRegionDistances(triangleRegions, triangle, voxelPos);
+				VoxelizeFaceVoxel(volume, VIntVector(x, y, z), triangle, triangleRegions, surfaceThreshold);
+			}
+		}
+	}
+}
 
-				EVTriangleRegion region = GetTriangleRegion(triangleRegions, distances);
+void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeFaceVoxel(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VTriangle& triangle, const VTriangleRegions& triangleRegions, const float& surfaceThreshold)
+{
+	VVector voxelPos = volume->VoxelIndexToRelativePosition(voxelIndex);
 
-				Voxel::VVoxel voxel = volume->GetVoxel(voxelIndex);
-				float density = voxel.Density;
+	VTriangleRegionalVoxelDistances distances = CalculateTriangleRegionDistances(triangleRegions, triangle, voxelPos);
 
-				switch (region)
-				{
-				case EVTriangleRegion::R1:
-					density = 1.f - (std::abs(distances.A) / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				case EVTriangleRegion::R2:
-					density = 1.f - (std::sqrt(distances.A * distances.A + distances.G * distances.G) / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				case EVTriangleRegion::R3:
-					density = 1.f - (std::sqrt(distances.A * distances.A + distances.F * distances.F) / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				case EVTriangleRegion::R4:
-					density = 1.f - (std::sqrt(distances.A * distances.A + distances.E * distances.E) / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				case EVTriangleRegion::R5:
-					density = 1.f - ((voxelPos - triangle.V1).Length() / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				case EVTriangleRegion::R6:
-					density = 1.f - ((voxelPos - triangle.V2).Length() / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				case EVTriangleRegion::R7:
-					density = 1.f - ((voxelPos - triangle.V3).Length() / surfaceThreshold);
-					density = -1.f * density + 0.5f;
-					break;
-				}
+	EVTriangleRegion region = GetTriangleRegion(triangleRegions, distances);
 
+	float density = std::numeric_limits<float>::infinity();
 
-				/*if (std::abs(density) < std::abs(voxel.Density))
-				{
-					if (!(voxel.Density < 0.f && density > 0.f))
-					{
-						voxel.Density = density;
-						voxel.Material = voxel.Density <= 0.f ? 1 : 0;
+	switch (region)
+	{
+	case EVTriangleRegion::R1:
+		density = 1.f - (std::abs(distances.A) / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	case EVTriangleRegion::R2:
+		density = 1.f - (std::sqrt(distances.A * distances.A + distances.G * distances.G) / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	case EVTriangleRegion::R3:
+		density = 1.f - (std::sqrt(distances.A * distances.A + distances.F * distances.F) / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	case EVTriangleRegion::R4:
+		density = 1.f - (std::sqrt(distances.A * distances.A + distances.E * distances.E) / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	case EVTriangleRegion::R5:
+		density = 1.f - ((voxelPos - triangle.V1).Length() / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	case EVTriangleRegion::R6:
+		density = 1.f - ((voxelPos - triangle.V2).Length() / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	case EVTriangleRegion::R7:
+		density = 1.f - ((voxelPos - triangle.V3).Length() / surfaceThreshold);
+		density = -1.f * density + 0.5f;
+		break;
+	}
 
-						volume->SetVoxel(voxelIndex, voxel);
-					}
-				}*/
 
-				if (density < voxel.Density)
-				{
-					voxel.Density = density;
-					voxel.Material = voxel.Density <= 0.f ? 1 : 0;
+	/*if (std::abs(density) < std::abs(voxel.Density))
+	{
+		if (!(voxel.Density < 0.f && density > 0.f))
+		{
+			voxel.Density = density;
+			voxel.Material = voxel.Density <= 0.f ? 1 : 0;
 
-					volume->SetVoxel(voxelIndex, voxel);
-				}
-			}
+			volume->SetVoxel(voxelIndex, voxel);
 		}
-	}
+	}*/
+
+	Voxel::VVoxel voxel;
+	voxel.Density = density;
+	voxel.Material = voxel.Density <= 0.f ? 1 : 0;
+
+	volume->AtomicMinVoxel(voxelIndex, voxel);
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeTriangle(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeTriangle(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold)
 {
 	//VoxelizeEdge(volume, v1, v2);
 	//VoxelizeEdge(volume, v1, v3);
@@ -260,7 +379,91 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeTriangle(std::shared_
 	VoxelizeFace(volume, v1, v2, v3, surfaceThreshold);
 }
 
-VolumeRaytracer::VIntVector VolumeRaytracer::Voxelizer::VVolumeConverter::GetCellIndex(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::VoxelizeTile(const std::shared_ptr<Voxel::VVoxelVolume>& tile, const VVector& tileCenter, const VMeshInfo& meshInfo, const std::vector<int>& triangles, const float& surfaceThreshold)
+{
+	std::vector<VVertex> vertices(triangles.size() * 3);
+
+	VIntVector writeMin = VIntVector::ONE * (int)tile->GetSize();
+	VIntVector writeMax = VIntVector::ZERO;
+
+	//Triangles are moved into tile space so the single volume voxelization can be reused unchanged
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			vertices[i * 3 + corner] = meshInfo.Vertices[meshInfo.Indices[triangles[i] * 3 + corner]];
+			vertices[i * 3 + corner].Position = vertices[i * 3 + corner].Position - tileCenter;
+		}
+
+		VIntVector minIndex;
+		VIntVector maxIndex;
+
+		GetTriangleVoxelBounds(tile, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], surfaceThreshold, minIndex, maxIndex);
+
+		tile->BeginConcurrentWrite(minIndex, maxIndex);
+
+		writeMin = VIntVector::Min(writeMin, minIndex);
+		writeMax = VIntVector::Max(writeMax, maxIndex);
+	}
+
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		VoxelizeTriangle(tile, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], surfaceThreshold);
+	}
+
+	tile->EndConcurrentWrite(writeMin, writeMax);
+}
+
+float VolumeRaytracer::Voxelizer::VVolumeConverter::GetMeshVolumeExtends(const VMeshInfo& meshInfo)
+{
+	float extends = VMathHelpers::Max(meshInfo.Bounds.GetExtends().X, VMathHelpers::Max(meshInfo.Bounds.GetExtends().Y, meshInfo.Bounds.GetExtends().Z));
+	extends += extends * 0.25f;
+
+	return extends;
+}
+
+uint8_t VolumeRaytracer::Voxelizer::VVolumeConverter::GetMeshResolution(const VMeshInfo& meshInfo)
+{
+	uint8_t desiredResolution = 5;
+
+	if (!ExtractResolutionFromName(meshInfo.MeshName, desiredResolution))
+	{
+		desiredResolution = 5;
+		std::cout << "[WARNING] Mesh with name " << meshInfo.MeshName << " has no or invalid resolution specifier. Correct syntax is meshName_resolution (cubeMesh_6). Using default resolution of 5!" << std::endl;
+	}
+
+	if (desiredResolution > Voxel::VVoxelVolume::MAX_RESOLUTION)
+	{
+		std::cout << "[WARNING] Mesh with name " << meshInfo.MeshName << " has invalid resolution. Resolution needs to be between or equal than 0 and " << (int)Voxel::VVoxelVolume::MAX_RESOLUTION << "." << std::endl;
+		desiredResolution = 5;
+	}
+	else if (desiredResolution > Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION)
+	{
+		std::cout << "[WARNING] Mesh with name " << meshInfo.MeshName << " has resolution " << (int)desiredResolution << " but the renderer supports at most " << (int)Voxel::VVoxelVolume::MAX_RENDER_RESOLUTION << ". The volume can only be used on the CPU. Split the mesh into tiles (meshName_<resolution>x<tiles>, e.g. cube_8x4) to render it." << std::endl;
+	}
+
+	return desiredResolution;
+}
+
+VolumeRaytracer::VMaterial VolumeRaytracer::Voxelizer::VVolumeConverter::GetMeshMaterial(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib)
+{
+	VMaterial material = meshInfo.Material;
+	std::string matName = meshInfo.MaterialName;
+
+	if (textureLib.Materials.find(meshInfo.MaterialName) != textureLib.Materials.end())
+	{
+		const VMaterialTextures& tex = textureLib.Materials.at(matName);
+
+		material.AlbedoTexturePath = tex.Albedo;
+		material.NormalTexturePath = tex.Normal;
+		material.RMTexturePath = tex.RM;
+		material.TextureScale = tex.TextureTiling;
+	}
+
+	return material;
+}
+
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxelizer::VVolumeConverter::GetCellIndex(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v)
 {
 	VIntVector res = volume->RelativePositionToCellIndex(v.Position);
 
@@ -318,7 +521,7 @@ float VolumeRaytracer::Voxelizer::VVolumeConverter::GetNearestDinstanceFromPlane
 	return VVector::VectorProjection(point, planeNormal).Length();
 }
 
-//void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensity(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVoxelIndex& cellIndex, const VTriangle& triangle)
+//void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensity(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVoxelIndex& cellIndex, const VTriangle& triangle)
 //{
 //	float voxelDots[8];
 //	VVoxelIndex voxelIndices[8];
@@ -394,7 +597,7 @@ bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsPointOnTriangleIfProjected(
 
 	VVector p = triRotation * relToTrianglePoint;
 	
-	auto& signFunc = [](const VVector& p1, const VVector& p2, const VVector& p3)
+	auto signFunc = [](const VVector& p1, const VVector& p2, const VVector& p3)
 	{
 		return (p1.X - p3.X) * (p2.Y - p3.Y) - (p2.X - p3.X) * (p1.Y - p3.Y);
 	}; 
@@ -414,7 +617,7 @@ bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsPointOnTriangleIfProjected(
 
 bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsPointInTriangle(const VVector2D& point, const VVector2D& v1, const VVector2D& v2, const VVector2D& v3)
 {
-	auto& signFunc = [](const VVector2D& p1, const VVector2D& p2, const VVector2D& p3)
+	auto signFunc = [](const VVector2D& p1, const VVector2D& p2, const VVector2D& p3)
 	{
 		return (p1.X - p3.X) * (p2.Y - p3.Y) - (p2.X - p3.X) * (p1.Y - p3.Y);
 	};
@@ -432,7 +635,7 @@ bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsPointInTriangle(const VVect
 	return !(neg && pos);
 }
 
-bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsTriangleInsideVoxelBounds(std::shared_ptr<Voxel::VVoxelVolume> volume, const VIntVector& voxelIndex, const VTriangle& triangle)
+bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsTriangleInsideVoxelBounds(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VTriangle& triangle)
 {
 	const VVector voxelCornerOffsets[8] = 
 	{
@@ -471,7 +674,7 @@ bool VolumeRaytracer::Voxelizer::VVolumeConverter::IsTriangleInsideVoxelBounds(s
 	return hasPos && hasNeg;
 }
 
-VolumeRaytracer::VIntVector VolumeRaytracer::Voxelizer::VVolumeConverter::GoToNextVoxelAlongEdge(std::shared_ptr<Voxel::VVoxelVolume> volume, const VEdgeRay& ray, const VIntVector& voxelIndex, const VIntVector& voxelDir, float& outNewT)
+VolumeRaytracer::VIntVector VolumeRaytracer::Voxelizer::VVolumeConverter::GoToNextVoxelAlongEdge(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VEdgeRay& ray, const VIntVector& voxelIndex, const VIntVector& voxelDir, float& outNewT)
 {
 	VVector tMax = VVector(100000, 100000, 100000);
 	VIntVector res = voxelIndex;
@@ -529,7 +732,7 @@ VolumeRaytracer::VIntVector VolumeRaytracer::Voxelizer::VVolumeConverter::GoToNe
 	return res;
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensityWithEdgeIntersection(std::shared_ptr<Voxel::VVoxelVolume> volume, const VIntVector& voxelIndex, const VVector& edgeStart, const VVector& edgeEnd)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensityWithEdgeIntersection(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VVector& edgeStart, const VVector& edgeEnd)
 {
 	const VIntVector cellOffset[8] = {
 		VIntVector(0,0,0),
@@ -590,7 +793,7 @@ void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensityWithEdgeInte
 	}
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensityWithTriangleIntersection(std::shared_ptr<Voxel::VVoxelVolume> volume, const VIntVector& voxelIndex, const VTriangle& triangle)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::UpdateCellDensityWithTriangleIntersection(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VTriangle& triangle)
 {
 	const VIntVector cellOffset[8] = {
 			VIntVector(0,0,0),
@@ -666,6 +869,12 @@ bool VolumeRaytracer::Voxelizer::VVolumeConverter::ExtractResolutionFromName(con
 		try
 		{
 			res = std::stoi(resStr);
+
+			if (res < 0 || res > 255)
+			{
+				return false;
+			}
+
 			outResolution = (uint8_t)res;
 			return true;
 		}
@@ -691,7 +900,17 @@ VolumeRaytracer::VAABB VolumeRaytracer::Voxelizer::VVolumeConverter::GetTriangle
 	return res;
 }
 
-void VolumeRaytracer::Voxelizer::VVolumeConverter::GetVoxelizedBoundingBox(std::shared_ptr<Voxel::VVoxelVolume> volume, const VAABB& aabb, VIntVector& outMin, VIntVector& outMax, const float& threshold)
+void VolumeRaytracer::Voxelizer::VVolumeConverter::GetTriangleVoxelBounds(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold, VIntVector& outMin, VIntVector& outMax)
+{
+	VTriangle triangle;
+	triangle.V1 = v1.Position;
+	triangle.V2 = v2.Position;
+	triangle.V3 = v3.Position;
+
+	GetVoxelizedBoundingBox(volume, GetTriangleBoundingBox(triangle, 0.f), outMin, outMax, surfaceThreshold);
+}
+
+void VolumeRaytracer::Voxelizer::VVolumeConverter::GetVoxelizedBoundingBox(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VAABB& aabb, VIntVector& outMin, VIntVector& outMax, const float& threshold)
 {
 	VVector min = aabb.GetMin() - VVector::ONE * threshold;
 	VVector max = aabb.GetMax() + VVector::ONE * threshold;
@@ -776,6 +995,6 @@ VolumeRaytracer::Voxelizer::EVTriangleRegion VolumeRaytracer::Voxelizer::VVolume
 	}
 	else
 	{
-		assert(1==2, "This code segment should not be reachable");
+		assert(false && "This code segment should not be reachable");
 	}
 }
@@ -16,12 +16,14 @@
 #include "Object.h"
 #include "SceneInfo.h"
 #include "AABB.h"
+#include "VoxelStorage.h"
 
 namespace VolumeRaytracer
 {
 	namespace Voxel
 	{
 		class VVoxelVolume;
+		class VVoxelVolumeGrid;
 	}
 
 	namespace Voxelizer
@@ -83,16 +85,30 @@ namespace VolumeRaytracer
 		class VVolumeConverter
 		{
 		public:
-			static VObjectPtr<Voxel::VVoxelVolume> ConvertMeshInfoToVoxelVolume(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib);
+			//Densities are written relative to the surface threshold, the volume gets the matching density scale so narrow band and quantized storages keep them
+			static VObjectPtr<Voxel::VVoxelVolume> ConvertMeshInfoToVoxelVolume(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib, const Voxel::EVVoxelStorageType& storageType = Voxel::EVVoxelStorageType::NarrowBand);
+
+			//Splits the mesh bounds into tilesAlongAxis^3 tiles of the given resolution. Only tiles touched by the surface are allocated, each one is voxelized by its own task
+			static VObjectPtr<Voxel::VVoxelVolumeGrid> ConvertMeshInfoToVolumeGrid(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib, const uint8_t& tileResolution, const int& tilesAlongAxis);
+
+			//Meshes named meshName_<resolution>x<tiles> (cubeMesh_8x4) are converted to a grid of tiles
+			static bool ExtractTileCountFromName(const std::string& name, int& outTileCount);
+			static bool ExtractResolutionFromName(const std::string& name, uint8_t& outResolution);
 
 		private:
-			static void VoxelizeVertex(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v);
-			static void VoxelizeEdge(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v1, const VVertex& v2);
-			static void VoxelizeFace(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold);
+			static void VoxelizeVertex(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v);
+			static void VoxelizeEdge(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2);
+			static void VoxelizeFace(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold);
+			static void VoxelizeFaceVoxel(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VTriangle& triangle, const VTriangleRegions& triangleRegions, const float& surfaceThreshold);
 
-			static void VoxelizeTriangle(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold);
+			static void VoxelizeTriangle(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold);
+			static void VoxelizeTile(const std::shared_ptr<Voxel::VVoxelVolume>& tile, const VVector& tileCenter, const VMeshInfo& meshInfo, const std::vector<int>& triangles, const float& surfaceThreshold);
 
-			static VIntVector GetCellIndex(std::shared_ptr<Voxel::VVoxelVolume> volume, const VVertex& v);
+			static float GetMeshVolumeExtends(const VMeshInfo& meshInfo);
+			static uint8_t GetMeshResolution(const VMeshInfo& meshInfo);
+			static VMaterial GetMeshMaterial(const VMeshInfo& meshInfo, const VTextureLibrary& textureLib);
+
+			static VIntVector GetCellIndex(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v);
 
 			static VVector GetTriangleNormal(const VVertex& v1, const VVertex& v2, const VVertex& v3);
 			static VVector GetTriangleMidpoint(const VVertex& v1, const VVertex& v2, const VVertex& v3);
@@ -103,17 +119,16 @@ namespace VolumeRaytracer
 			static bool IsPointOnTriangleIfProjected(const VVector& relToTrianglePoint, const VTriangle& triangle);
 			static bool IsPointInTriangle(const VVector2D& point, const VVector2D& v1, const VVector2D& v2, const VVector2D& v3);
 
-			static bool IsTriangleInsideVoxelBounds(std::shared_ptr<Voxel::VVoxelVolume> volume, const VIntVector& voxelIndex, const VTriangle& triangle);
-
-			static VIntVector GoToNextVoxelAlongEdge(std::shared_ptr<Voxel::VVoxelVolume> volume, const VEdgeRay& ray, const VIntVector& voxelIndex, const VIntVector& voxelDir, float& outNewT);
+			static bool IsTriangleInsideVoxelBounds(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VTriangle& triangle);
 
-			static void UpdateCellDensityWithEdgeIntersection(std::shared_ptr<Voxel::VVoxelVolume> volume, const VIntVector& voxelIndex, const VVector& edgeStart, const VVector& edgeEnd);
-			static void UpdateCellDensityWithTriangleIntersection(std::shared_ptr<Voxel::VVoxelVolume> volume, const VIntVector& voxelIndex, const VTriangle& triangle);
+			static VIntVector GoToNextVoxelAlongEdge(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VEdgeRay& ray, const VIntVector& voxelIndex, const VIntVector& voxelDir, float& outNewT);
 
-			static bool ExtractResolutionFromName(const std::string& name, uint8_t& outResolution);
+			static void UpdateCellDensityWithEdgeIntersection(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VVector& edgeStart, const VVector& edgeEnd);
+			static void UpdateCellDensityWithTriangleIntersection(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VIntVector& voxelIndex, const VTriangle& triangle);
 
 			static VAABB GetTriangleBoundingBox(const VTriangle& triangle, const float& threshold);
-			static void GetVoxelizedBoundingBox(std::shared_ptr<Voxel::VVoxelVolume> volume, const VAABB& aabb, VIntVector& outMin, VIntVector& outMax, const float& threshold);
+			static void GetTriangleVoxelBounds(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VVertex& v1, const VVertex& v2, const VVertex& v3, const float& surfaceThreshold, VIntVector& outMin, VIntVector& outMax);
+			static void GetVoxelizedBoundingBox(const std::shared_ptr<Voxel::VVoxelVolume>& volume, const VAABB& aabb, VIntVector& outMin, VIntVector& outMax, const float& threshold);
 
 			static VTriangleRegions CalculateTriangleRegionVectors(const VTriangle& triangle);
 			static VTriangleRegionalVoxelDistances CalculateTriangleRegionDistances(const VTriangleRegions& regions, const VTriangle& triangle, const VVector& point);